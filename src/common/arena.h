@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "common/macros.h"
+
+static constexpr size_t ARENA_INIT_BLOCK_SIZE = 8192;       // size of the first arena block in bytes
+static constexpr size_t ARENA_MAX_BLOCK_SIZE = 1 << 20;     // arena blocks stop doubling at this size
+
+/**
+ * @brief 按语句分配的内存池（bump allocator）
+ *
+ * 执行一条语句时产生的元组、Value的raw缓冲区等临时对象都从Arena中分配，只移动指针，不调用malloc；
+ * 这些内存不会被单独释放，而是在语句结束、Arena析构时一次性释放。
+ * 通过Mark/Rewind（或ArenaScope）可以把某一段时间内分配的内存整体回收并复用，已申请的块不会归还给系统。
+ */
+class Arena {
+   public:
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    Arena() = default;
+
+    DISALLOW_COPY(Arena);
+
+    void *Allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        while (true) {
+            if (curr_block_ < blocks_.size()) {
+                Block &block = blocks_[curr_block_];
+                uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+                size_t start = ((base + offset_ + align - 1) & ~(uintptr_t)(align - 1)) - base;
+                if (start + bytes <= block.size) {
+                    offset_ = start + bytes;
+                    return block.data.get() + start;
+                }
+                // 当前块放不下，尝试复用下一个已申请的块
+                if (curr_block_ + 1 < blocks_.size() && blocks_[curr_block_ + 1].size >= bytes + align) {
+                    curr_block_++;
+                    offset_ = 0;
+                    continue;
+                }
+            }
+            AddBlock(bytes + align);
+        }
+    }
+
+    char *AllocateBytes(size_t bytes) { return static_cast<char *>(Allocate(bytes, 1)); }
+
+    Mark GetMark() const { return {curr_block_, offset_}; }
+
+    // 回收mark之后分配的所有内存，mark必须是在这之后的分配之前取得的
+    void Rewind(const Mark &mark) {
+        curr_block_ = mark.block;
+        offset_ = mark.offset;
+    }
+
+    void Reset() { Rewind({0, 0}); }
+
+    size_t MemoryUsage() const {
+        size_t usage = 0;
+        for (auto &block : blocks_) {
+            usage += block.size;
+        }
+        return usage;
+    }
+
+   private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    // 在curr_block_之后插入一个新块并切换过去，之后的已有块保持不变以便继续复用
+    void AddBlock(size_t min_size) {
+        size_t size = blocks_.empty() ? ARENA_INIT_BLOCK_SIZE : std::min(blocks_.back().size * 2, ARENA_MAX_BLOCK_SIZE);
+        size = std::max(size, min_size);
+        size_t pos = blocks_.empty() ? 0 : curr_block_ + 1;
+        blocks_.insert(blocks_.begin() + pos, Block{std::unique_ptr<char[]>(new char[size]), size});
+        curr_block_ = pos;
+        offset_ = 0;
+    }
+
+    std::vector<Block> blocks_;
+    size_t curr_block_ = 0;
+    size_t offset_ = 0;
+};
+
+/**
+ * @brief RAII：离开作用域时回收作用域内从Arena分配的内存
+ * @note 作用域必须严格嵌套，作用域内分配的对象不能在作用域外使用
+ */
+class ArenaScope {
+   public:
+    explicit ArenaScope(Arena *arena) : arena_(arena) {
+        if (arena_ != nullptr) {
+            mark_ = arena_->GetMark();
+        }
+    }
+
+    ~ArenaScope() {
+        if (arena_ != nullptr) {
+            arena_->Rewind(mark_);
+        }
+    }
+
+    DISALLOW_COPY(ArenaScope);
+
+   private:
+    Arena *arena_;
+    Arena::Mark mark_{};
+};
+
+/**
+ * @brief 从Arena分配内存的STL分配器，deallocate不做任何事
+ * @note 例如std::allocate_shared可以把shared_ptr的控制块和对象一起放进Arena
+ */
+template <typename T>
+class ArenaAllocator {
+   public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena *arena) : arena_(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena_) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    friend bool operator==(const ArenaAllocator<T> &x, const ArenaAllocator<U> &y) {
+        return x.arena_ == y.arena_;
+    }
+
+    template <typename U>
+    friend bool operator!=(const ArenaAllocator<T> &x, const ArenaAllocator<U> &y) {
+        return x.arena_ != y.arena_;
+    }
+
+   private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena *arena_;
+};
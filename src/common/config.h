@@ -50,3 +50,39 @@ static const std::string LOG_FILE_NAME = "db.log";
 
 // replacer
 static const std::string REPLACER_TYPE = "LRU";
+
+// background compactor (VACUUM), disabled by default
+static constexpr bool ENABLE_AUTO_VACUUM = false;
+static constexpr int AUTO_VACUUM_INTERVAL = 60;                // seconds between two compactor passes
+static constexpr double AUTO_VACUUM_FILL_THRESHOLD = 0.5;     // vacuum tables whose pages are filled below this ratio
+
+// bulk load (COPY FROM)
+static constexpr int COPY_BATCH_PAGES = 256;                   // records formatted in memory before each append, in heap pages
+static constexpr int COPY_READ_BUFFER_SIZE = 1 << 20;          // read buffer of the CSV file in bytes
+
+// sort-based index build (CREATE INDEX)
+static constexpr size_t INDEX_BUILD_SORT_MEMORY = 64 << 20;     // bytes of (key, value) pairs sorted in memory, more spill to run files
+static constexpr double INDEX_BUILD_FILL_FACTOR = 0.9;          // leaves are packed to this ratio of their capacity
+static constexpr int INDEX_BUILD_MERGE_ROUNDS = 8;               // CREATE INDEX CONCURRENTLY: side log merges done while writers run
+static constexpr size_t INDEX_BUILD_FINAL_MERGE_CHANGES = 1024;  // stop merging early once fewer changes than this are logged
+static constexpr int INDEX_BUILD_THREADS = 1;                    // heap scan/sort threads when CREATE INDEX has no PARALLEL n
+static constexpr int INDEX_BUILD_MAX_THREADS = 64;               // upper bound of PARALLEL n
+
+// Bloom filters of B+ tree indexes (skip the descent for keys that are not there)
+static constexpr bool ENABLE_INDEX_BLOOM_FILTER = true;
+static constexpr int INDEX_BLOOM_BITS_PER_KEY = 16;            // filter bits per key, about 0.1% false positives
+static constexpr int INDEX_BLOOM_MIN_BLOCKS = 16;              // 64-byte blocks of the filter of an empty index
+
+// streaming export (COPY TO)
+static constexpr int COPY_WRITE_BUFFER_SIZE = 1 << 20;         // output buffer of the exported file in bytes
+static constexpr int COPY_BINARY_CHUNK_ROWS = 8192;            // rows per column chunk of the binary format
+
+// table statistics (ANALYZE)
+static constexpr int ANALYZE_SAMPLE_ROWS = 30000;              // reservoir sample size used to build histograms
+static constexpr int ANALYZE_HISTOGRAM_BUCKETS = 100;          // buckets of each equi-depth histogram
+static constexpr double INDEX_SCAN_MAX_SELECTIVITY = 0.2;      // with statistics, prefer a seq scan above this selectivity
+static constexpr double BITMAP_SCAN_MIN_SELECTIVITY = 0.01;    // with statistics, read the heap in page order through a rid bitmap above this selectivity
+static constexpr double BITMAP_SCAN_MAX_SELECTIVITY = 0.5;     // and prefer a seq scan over a bitmap heap scan above this one
+
+// hash partitioning (PARTITION BY HASH)
+static constexpr int MAX_PARTITIONS = 256;                     // upper bound of PARTITIONS n, every partition keeps its files open
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/arena.h"
 #include "transaction/concurrency/lock_manager.h"
 #include "recovery/log_manager.h"
 
@@ -18,4 +19,5 @@ public:
     Transaction *txn_;
     char *data_send_;
     int *offset_;
+    Arena arena_;  // 语句级内存池：执行过程中的元组和Value缓冲区从这里分配，随Context析构一次性释放
 };
\ No newline at end of file
@@ -62,6 +62,11 @@ class InvalidColLengthError : public RedBaseError {
     InvalidColLengthError(int col_len) : RedBaseError("Invalid column length: " + std::to_string(col_len)) {}
 };
 
+class InvalidIndexColsError : public RedBaseError {
+   public:
+    InvalidIndexColsError(const std::string &cols) : RedBaseError("Invalid index columns: " + cols) {}
+};
+
 class IndexEntryNotFoundError : public RedBaseError {
    public:
     IndexEntryNotFoundError() : RedBaseError("Index entry not found") {}
@@ -127,6 +132,35 @@ class AmbiguousColumnError : public RedBaseError {
     AmbiguousColumnError(const std::string &col_name) : RedBaseError("Ambiguous column: " + col_name) {}
 };
 
+class CsvFormatError : public RedBaseError {
+   public:
+    CsvFormatError(const std::string &file_name, int line_no, const std::string &msg)
+        : RedBaseError("CSV format error: " + file_name + ':' + std::to_string(line_no) + ", " + msg) {}
+};
+
+class DuplicateKeyError : public RedBaseError {
+   public:
+    DuplicateKeyError(const std::string &tab_name) : RedBaseError("Duplicate primary key in table: " + tab_name) {}
+};
+
+class ClusteredTableError : public RedBaseError {
+   public:
+    ClusteredTableError(const std::string &tab_name, const std::string &msg)
+        : RedBaseError("Clustered table " + tab_name + ": " + msg) {}
+};
+
+class PartitionedTableError : public RedBaseError {
+   public:
+    PartitionedTableError(const std::string &tab_name, const std::string &msg)
+        : RedBaseError("Partitioned table " + tab_name + ": " + msg) {}
+};
+
+class TableInUseError : public RedBaseError {
+   public:
+    TableInUseError(const std::string &tab_name, const std::string &msg)
+        : RedBaseError("Table " + tab_name + " is in use: " + msg) {}
+};
+
 class PageNotExistError : public RedBaseError {
    public:
     PageNotExistError(const std::string &table_name, int page_no)
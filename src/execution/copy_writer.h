@@ -0,0 +1,203 @@
+#pragma once
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/macros.h"
+#include "execution_defs.h"
+#include "system/sm_meta.h"
+
+/**
+ * @brief COPY ... TO的输出：把扫描得到的元组直接写入文件
+ *
+ * 不经过RecordPrinter和data_send_，元组先写入大块的用户态缓冲区，满了之后再一次write()到文件
+ * @note cols是元组的列定义（投影算子的cols()），offset是列在元组中的偏移
+ */
+class CopyWriter {
+   public:
+    CopyWriter(const std::string &file_name, const std::vector<ColMeta> &cols) : cols_(cols) {
+        fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw UnixError();
+        }
+        buf_.resize(COPY_WRITE_BUFFER_SIZE);
+    }
+
+    virtual ~CopyWriter() { close(fd_); }
+
+    DISALLOW_COPY(CopyWriter);
+
+    virtual void write_row(const char *rec) = 0;
+
+    // 写完所有元组后调用，输出文件尾并把缓冲区刷到文件中
+    virtual void finish() { flush(); }
+
+   protected:
+    void append(const void *data, size_t len) {
+        if (used_ + len > buf_.size()) {
+            flush();
+            if (len > buf_.size()) {
+                write_all((const char *)data, len);
+                return;
+            }
+        }
+        memcpy(buf_.data() + used_, data, len);
+        used_ += len;
+    }
+
+    void append_char(char c) {
+        if (used_ == buf_.size()) {
+            flush();
+        }
+        buf_[used_++] = c;
+    }
+
+    void append_u32(uint32_t val) { append(&val, sizeof(val)); }
+
+    void flush() {
+        write_all(buf_.data(), used_);
+        used_ = 0;
+    }
+
+    std::vector<ColMeta> cols_;
+
+   private:
+    void write_all(const char *data, size_t len) {
+        while (len > 0) {
+            ssize_t n = write(fd_, data, len);
+            if (n < 0) {
+                throw UnixError();
+            }
+            data += n;
+            len -= n;
+        }
+    }
+
+    int fd_;
+    std::vector<char> buf_;
+    size_t used_ = 0;
+};
+
+/**
+ * @brief CSV格式：与COPY FROM的格式相同，导出的文件可以直接导入
+ * @note 浮点数输出为能精确还原的最短形式；含逗号、引号或换行的字符串用双引号括起，字符串内的双引号写成两个
+ */
+class CsvCopyWriter : public CopyWriter {
+   public:
+    using CopyWriter::CopyWriter;
+
+    void write_row(const char *rec) override {
+        for (size_t i = 0; i < cols_.size(); i++) {
+            auto &col = cols_[i];
+            const char *val = rec + col.offset;
+            if (i > 0) {
+                append_char(',');
+            }
+            if (col.type == TYPE_STRING) {
+                write_string(val, strnlen(val, col.len));
+                continue;
+            }
+            char num[32];
+            auto res = col.type == TYPE_INT ? std::to_chars(num, num + sizeof(num), *(int *)val)
+                                            : std::to_chars(num, num + sizeof(num), *(float *)val);
+            append(num, res.ptr - num);
+        }
+        append_char('\n');
+    }
+
+   private:
+    void write_string(const char *str, size_t len) {
+        bool need_quote = false;
+        for (size_t i = 0; i < len && !need_quote; i++) {
+            need_quote = str[i] == ',' || str[i] == '"' || str[i] == '\r' || str[i] == '\n';
+        }
+        if (!need_quote) {
+            append(str, len);
+            return;
+        }
+        append_char('"');
+        for (size_t i = 0; i < len; i++) {
+            if (str[i] == '"') {
+                append_char('"');
+            }
+            append_char(str[i]);
+        }
+        append_char('"');
+    }
+};
+
+/**
+ * @brief 紧凑的二进制列存格式，所有整数均为小端
+ *
+ * 文件头：  "RMDBCOPY" | uint32 版本号 | uint32 列数 | 每列：uint32 类型, uint32 长度, uint32 列名长度, 列名
+ * 数据块：  uint32 行数 | 依次存放每一列在这些行上的值：
+ *          INT/FLOAT列是行数个4字节的值；CHAR列先是行数个uint32的实际长度，再是去掉末尾'\0'之后的字符串拼接
+ * 文件尾：  uint32 0（行数为0的数据块）
+ * @note 每COPY_BINARY_CHUNK_ROWS行组成一个数据块，块内按列连续存放，便于按列读取和压缩
+ */
+class BinaryCopyWriter : public CopyWriter {
+   public:
+    static constexpr char MAGIC[8] = {'R', 'M', 'D', 'B', 'C', 'O', 'P', 'Y'};
+    static constexpr uint32_t VERSION = 1;
+
+    BinaryCopyWriter(const std::string &file_name, const std::vector<ColMeta> &cols)
+        : CopyWriter(file_name, cols), chunk_cols_(cols.size()), chunk_lens_(cols.size()) {
+        append(MAGIC, sizeof(MAGIC));
+        append_u32(VERSION);
+        append_u32(cols_.size());
+        for (auto &col : cols_) {
+            append_u32(col.type);
+            append_u32(col.len);
+            append_u32(col.name.size());
+            append(col.name.data(), col.name.size());
+        }
+    }
+
+    void write_row(const char *rec) override {
+        for (size_t i = 0; i < cols_.size(); i++) {
+            auto &col = cols_[i];
+            const char *val = rec + col.offset;
+            size_t len = col.len;
+            if (col.type == TYPE_STRING) {
+                len = strnlen(val, col.len);
+                chunk_lens_[i].push_back(len);
+            }
+            chunk_cols_[i].insert(chunk_cols_[i].end(), val, val + len);
+        }
+        if (++chunk_rows_ == COPY_BINARY_CHUNK_ROWS) {
+            flush_chunk();
+        }
+    }
+
+    void finish() override {
+        flush_chunk();
+        append_u32(0);
+        flush();
+    }
+
+   private:
+    void flush_chunk() {
+        if (chunk_rows_ == 0) {
+            return;
+        }
+        append_u32(chunk_rows_);
+        for (size_t i = 0; i < cols_.size(); i++) {
+            if (cols_[i].type == TYPE_STRING) {
+                append(chunk_lens_[i].data(), chunk_lens_[i].size() * sizeof(uint32_t));
+                chunk_lens_[i].clear();
+            }
+            append(chunk_cols_[i].data(), chunk_cols_[i].size());
+            chunk_cols_[i].clear();
+        }
+        chunk_rows_ = 0;
+    }
+
+    std::vector<std::vector<char>> chunk_cols_;     // 当前数据块中每一列的值
+    std::vector<std::vector<uint32_t>> chunk_lens_;  // 当前数据块中CHAR列每个值的长度
+    uint32_t chunk_rows_ = 0;
+};
@@ -1,11 +1,18 @@
 #include "execution_manager.h"
 
+#include "copy_writer.h"
+#include "executor_append.h"
+#include "executor_bitmap_heap_scan.h"
+#include "executor_copy_from.h"
 #include "executor_delete.h"
+#include "executor_index_only_scan.h"
 #include "executor_index_scan.h"
 #include "executor_insert.h"
+#include "executor_limit.h"
 #include "executor_nestedloop_join.h"
 #include "executor_projection.h"
 #include "executor_seq_scan.h"
+#include "executor_sort.h"
 #include "executor_update.h"
 #include "index/ix.h"
 #include "record_printer.h"
@@ -76,21 +83,210 @@ std::vector<Condition> QlManager::check_where_clause(const std::vector<std::stri
     return res_conds;
 }
 
-int QlManager::get_indexNo(std::string tab_name, std::vector<Condition> curr_conds) {
-    int index_no = -1;
+/**
+ * @brief 用ANALYZE得到的统计信息估计条件 col op value 的选择率
+ *
+ * @return double 选择率，没有统计信息或条件不是列与值比较时返回1
+ */
+double QlManager::estimate_selectivity(const Condition &cond) {
+    if (!cond.is_rhs_val || cond.rhs_val.raw == nullptr) {
+        return 1;
+    }
+    auto tab_stats = sm_manager_->db_.get_stats(cond.lhs_col.tab_name);
+    auto col_stats = tab_stats == nullptr ? nullptr : tab_stats->get_col(cond.lhs_col.col_name);
+    if (col_stats == nullptr || col_stats->type != cond.rhs_val.type) {
+        return 1;
+    }
+    const char *key = cond.rhs_val.raw->data;
+    switch (cond.op) {
+        case OP_EQ:
+            return col_stats->eq_selectivity(key);
+        case OP_NE:
+            return 1 - col_stats->eq_selectivity(key);
+        case OP_LT:
+            return col_stats->lt_selectivity(key, false);
+        case OP_LE:
+            return col_stats->lt_selectivity(key, true);
+        case OP_GT:
+            return 1 - col_stats->lt_selectivity(key, true);
+        case OP_GE:
+            return 1 - col_stats->lt_selectivity(key, false);
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief 估计表经过conds中只涉及本表的条件过滤后剩下的行数（假设各列独立）
+ *
+ * @return double 行数，表没有统计信息时返回-1
+ */
+double QlManager::estimate_rows(const std::string &tab_name, const std::vector<Condition> &conds) {
+    auto tab_stats = sm_manager_->db_.get_stats(tab_name);
+    if (tab_stats == nullptr) {
+        return -1;
+    }
+    double rows = tab_stats->num_rows;
+    for (auto &cond : conds) {
+        if (cond.is_rhs_val && cond.lhs_col.tab_name == tab_name) {
+            rows *= estimate_selectivity(cond);
+        }
+    }
+    return rows;
+}
+
+/**
+ * @brief 索引index能否用于curr_conds中的条件
+ * @note 组合索引按前缀匹配：从第一列开始，每列上有等值条件时继续匹配下一列，遇到有范围条件的列时匹配到该列为止；
+ * 哈希索引只能用于所有索引列上都有等值条件的查找。
+ *
+ * @param num_match 匹配的索引列数
+ * @param first_pos 第一列上第一个条件在curr_conds中的位置
+ * @param sel 匹配的条件的选择率（没有统计信息时为1）
+ */
+bool QlManager::match_index(const std::string &tab_name, const IndexMeta &index,
+                            const std::vector<Condition> &curr_conds, size_t *num_match, size_t *first_pos,
+                            double *sel) {
     TabMeta &tab = sm_manager_->db_.get_table(tab_name);
-    for (auto &cond : curr_conds) {//如果是值，且不是非等于它上面的索引才可以用，否则其他的索引不可以用
-        if (cond.is_rhs_val && cond.op != OP_NE) {
-            // If rhs is value and op is not "!=", find if lhs has index
-            auto lhs_col = tab.get_col(cond.lhs_col.col_name);
-            if (lhs_col->index) {
-                // This column has index, use it
-                index_no = lhs_col - tab.cols.begin();
-                break;
+    *num_match = 0;
+    *first_pos = curr_conds.size();
+    *sel = 1;
+    size_t num_eq = 0;  // 有等值条件的前缀列数
+    for (int col : index.cols) {
+        bool has_eq = false;
+        bool has_range = false;
+        for (size_t i = 0; i < curr_conds.size(); i++) {
+            auto &cond = curr_conds[i];
+            if (!cond.is_rhs_val || cond.op == OP_NE || cond.lhs_col.tab_name != tab_name ||
+                cond.lhs_col.col_name != tab.cols[col].name) {
+                continue;
+            }
+            if (*num_match == 0) {
+                *first_pos = std::min(*first_pos, i);
+            }
+            *sel *= estimate_selectivity(cond);
+            if (cond.op == OP_EQ) {
+                has_eq = true;
+            } else {
+                has_range = true;
             }
         }
+        if (!has_eq && !has_range) {
+            break;
+        }
+        (*num_match)++;
+        if (!has_eq) {
+            break;
+        }
+        num_eq++;
+    }
+    return *num_match > 0 && !(index.hash && num_eq < index.cols.size());
+}
+
+/**
+ * @brief 选择curr_conds可以使用的索引
+ * @note 有统计信息时选择匹配的条件选择率最低的索引，选择率太高时不如直接顺序扫描；
+ * 否则选择匹配列数最多的索引，列数相同时选择第一列的条件在前面的
+ *
+ * @return std::vector<int> 所选索引的索引列，没有可用的索引时为空
+ */
+std::vector<int> QlManager::get_indexNo(std::string tab_name, std::vector<Condition> curr_conds) {
+    TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    bool has_stats = sm_manager_->db_.get_stats(tab_name) != nullptr;
+    std::vector<int> best_cols;
+    double best_sel = INDEX_SCAN_MAX_SELECTIVITY;
+    size_t best_match = 0;
+    size_t best_pos = curr_conds.size();
+    for (auto &index : tab.get_indexes()) {
+        size_t num_match;
+        size_t first_pos;
+        double sel;
+        if (!match_index(tab_name, index, curr_conds, &num_match, &first_pos, &sel)) {
+            continue;
+        }
+        if (has_stats) {
+            if (sel <= best_sel) {
+                best_sel = sel;
+                best_cols = index.cols;
+            }
+        } else if (num_match > best_match || (num_match == best_match && first_pos < best_pos)) {
+            best_match = num_match;
+            best_pos = first_pos;
+            best_cols = index.cols;
+        }
+    }
+    return best_cols;
+}
+
+/**
+ * @brief 有统计信息时选择位图堆扫描使用的索引
+ * @note 选择率最低的索引的选择率在[BITMAP_SCAN_MIN_SELECTIVITY, BITMAP_SCAN_MAX_SELECTIVITY]之间时，
+ * 匹配的记录多，索引扫描按key的顺序在堆文件中来回读取页面，改为收集rid后按页面顺序读取；
+ * 其他选择率不超过BITMAP_SCAN_MAX_SELECTIVITY的索引也参与扫描，rid取交集后要读的页面更少
+ *
+ * @return 所选索引的索引列，第一个是选择率最低的；不适合位图堆扫描时为空
+ */
+std::vector<std::vector<int>> QlManager::get_bitmap_indexes(const std::string &tab_name,
+                                                           const std::vector<Condition> &curr_conds) {
+    TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    if (tab.is_clustered() || sm_manager_->db_.get_stats(tab_name) == nullptr) {
+        return {};
+    }
+    std::vector<std::pair<double, std::vector<int>>> candidates;
+    for (auto &index : tab.get_indexes()) {
+        size_t num_match;
+        size_t first_pos;
+        double sel;
+        if (match_index(tab_name, index, curr_conds, &num_match, &first_pos, &sel) &&
+            sel <= BITMAP_SCAN_MAX_SELECTIVITY) {
+            candidates.emplace_back(sel, index.cols);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto &x, const auto &y) { return x.first < y.first; });
+    if (candidates.empty() || candidates[0].first < BITMAP_SCAN_MIN_SELECTIVITY) {
+        return {};
+    }
+    std::vector<std::vector<int>> indexes_cols;
+    for (auto &candidate : candidates) {
+        indexes_cols.push_back(std::move(candidate.second));
+    }
+    return indexes_cols;
+}
+
+/**
+ * @brief 生成一个表（分区表的第part个分区）上的扫描算子，index_cols为空时顺序扫描
+ * @param index_only 查询用到的列都被索引覆盖，只扫描索引而不读取记录
+ */
+std::unique_ptr<AbstractExecutor> QlManager::build_scan(const std::string &tab_name,
+                                                        const std::vector<Condition> &conds,
+                                                        const std::vector<int> &index_cols, Context *context,
+                                                        int part, bool index_only) {
+    if (index_cols.empty()) {
+        return std::make_unique<SeqScanExecutor>(sm_manager_, tab_name, conds, context, part);
+    }
+    if (index_only) {
+        return std::make_unique<IndexOnlyScanExecutor>(sm_manager_, tab_name, conds, index_cols, context, part);
+    }
+    return std::make_unique<IndexScanExecutor>(sm_manager_, tab_name, conds, index_cols, context, part);
+}
+
+/**
+ * @brief 扫描分区表中满足conds的记录，按分区返回它们的rid
+ * @note 只扫描分区裁剪后剩下的分区；所有分区都扫描完才返回，修改时把记录搬到其他分区不会被再次扫描到
+ */
+std::vector<std::vector<Rid>> QlManager::collect_part_rids(const std::string &tab_name,
+                                                           const std::vector<Condition> &conds,
+                                                           const std::vector<int> &index_cols, Context *context) {
+    TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    std::vector<std::vector<Rid>> part_rids(tab.num_parts);
+    for (int part : AppendExecutor::prune_parts(tab, conds)) {
+        auto scan = build_scan(tab_name, conds, index_cols, context, part);
+        for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
+            part_rids[part].push_back(scan->rid());
+        }
     }
-    return index_no;
+    return part_rids;
 }
 
 void QlManager::insert_into(const std::string &tab_name, std::vector<Value> values, Context *context) {
@@ -102,6 +298,40 @@ void QlManager::insert_into(const std::string &tab_name, std::vector<Value> valu
     // lab3 task3 Todo end
 }
 
+void QlManager::copy_from(const std::string &tab_name, const std::string &file_name, Context *context) {
+    auto copy_executor = std::make_unique<CopyFromExecutor>(sm_manager_, tab_name, file_name, context);
+    copy_executor->Next();
+    RecordPrinter::print_record_count(copy_executor->num_rows(), context);
+}
+
+/**
+ * @brief COPY ... TO：按select plan扫描，把结果元组直接写入文件
+ *
+ * @param file_name 输出文件，已存在时会被覆盖
+ * @param format 输出格式，见CsvCopyWriter和BinaryCopyWriter
+ */
+void QlManager::copy_to(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
+                        std::vector<Condition> conds, const std::string &file_name, CopyFormat format,
+                        Context *context, std::vector<OrderByCol> order_cols, int limit) {
+    auto executorTreeRoot =
+        build_select_plan(sel_cols, tab_names, std::move(conds), context, std::move(order_cols), limit);
+    std::unique_ptr<CopyWriter> writer;
+    if (format == COPY_BINARY) {
+        writer = std::make_unique<BinaryCopyWriter>(file_name, executorTreeRoot->cols());
+    } else {
+        writer = std::make_unique<CsvCopyWriter>(file_name, executorTreeRoot->cols());
+    }
+    size_t num_rec = 0;
+    for (executorTreeRoot->beginTuple(); !executorTreeRoot->is_end(); executorTreeRoot->nextTuple()) {
+        ArenaScope arena_scope(&context->arena_);
+        auto tuple = executorTreeRoot->Next();
+        writer->write_row(tuple->data);
+        num_rec++;
+    }
+    writer->finish();
+    RecordPrinter::print_record_count(num_rec, context);
+}
+
 void QlManager::delete_from(const std::string &tab_name, std::vector<Condition> conds, Context *context) {
     // Parse where clause
     conds = check_where_clause({tab_name}, conds);
@@ -111,15 +341,33 @@ void QlManager::delete_from(const std::string &tab_name, std::vector<Condition>
     std::unique_ptr<AbstractExecutor> scanExecutor;
     // lab3 task3 Todo
     // 根据get_indexNo判断conds上有无索引
-    int index_no = get_indexNo(tab_name, conds);
-    if(index_no == -1){
+    auto index_cols = get_indexNo(tab_name, conds);
+    if (sm_manager_->db_.get_table(tab_name).is_partitioned()) {
+        auto part_rids = collect_part_rids(tab_name, conds, index_cols, context);
+        for (size_t part = 0; part < part_rids.size(); part++) {
+            if (!part_rids[part].empty()) {
+                std::make_unique<DeleteExecutor>(sm_manager_, tab_name, conds, part_rids[part], context, part)->Next();
+            }
+        }
+        return;
+    }
+    if(index_cols.empty()){
         scanExecutor = std::make_unique<SeqScanExecutor>(sm_manager_, tab_name, conds, context);
     }else{
-        scanExecutor = std::make_unique<IndexScanExecutor>(sm_manager_, tab_name, conds, index_no, context);
+        scanExecutor = std::make_unique<IndexScanExecutor>(sm_manager_, tab_name, conds, index_cols, context);
     }
     // 创建合适的scan executor(有索引优先用索引)
     // lab3 task3 Todo end
 
+    if (sm_manager_->db_.get_table(tab_name).is_clustered()) {
+        // 聚簇表没有rid，先收集要删除的记录，扫描结束后再修改B+树
+        std::vector<RmRecord> recs;
+        for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
+            recs.push_back(*scanExecutor->Next());
+        }
+        std::make_unique<DeleteExecutor>(sm_manager_, tab_name, conds, std::move(recs), context)->Next();
+        return;
+    }
     for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
         rids.push_back(scanExecutor->rid());
     }
@@ -153,15 +401,35 @@ void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> s
     std::unique_ptr<AbstractExecutor> scanExecutor;
     // lab3 task3 Todo
     // 根据get_indexNo判断conds上有无索引
-    int index_no = get_indexNo(tab_name, conds);
-    if(index_no == -1){
+    auto index_cols = get_indexNo(tab_name, conds);
+    if (tab.is_partitioned()) {
+        // 修改了分区键的记录会搬到其他分区，所以先收集完所有分区的rid再修改
+        auto part_rids = collect_part_rids(tab_name, conds, index_cols, context);
+        for (size_t part = 0; part < part_rids.size(); part++) {
+            if (!part_rids[part].empty()) {
+                std::make_unique<UpdateExecutor>(sm_manager_, tab_name, set_clauses, conds, part_rids[part], context,
+                                                 part)
+                    ->Next();
+            }
+        }
+        return;
+    }
+    if(index_cols.empty()){
         scanExecutor = std::make_unique<SeqScanExecutor>(sm_manager_, tab_name, conds, context);
     }else{
-        scanExecutor = std::make_unique<IndexScanExecutor>(sm_manager_, tab_name, conds, index_no, context);
+        scanExecutor = std::make_unique<IndexScanExecutor>(sm_manager_, tab_name, conds, index_cols, context);
     }
     // 创建合适的scan executor(有索引优先用索引)
     // lab3 task3 Todo end
 
+    if (tab.is_clustered()) {
+        std::vector<RmRecord> recs;
+        for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
+            recs.push_back(*scanExecutor->Next());
+        }
+        std::make_unique<UpdateExecutor>(sm_manager_, tab_name, set_clauses, conds, std::move(recs), context)->Next();
+        return;
+    }
     for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
         rids.push_back(scanExecutor->rid());
     }
@@ -199,15 +467,54 @@ std::vector<Condition> pop_conds(std::vector<Condition> &conds, const std::vecto
     return solved_conds;
 }
 
+/**
+ * @brief 按索引的顺序扫描（DESC时反向扫描）得到的就是order_cols的顺序
+ * @note 有等值条件的索引列在扫描范围内取值不变，可以跳过，其余的索引列要依次是ORDER BY的各列，且排序方向都相同；
+ * 哈希索引的桶是无序的
+ */
+static bool index_in_order(const TabMeta &tab, const IndexMeta &index, const std::vector<Condition> &conds,
+                           const std::vector<OrderByCol> &order_cols) {
+    if (index.hash) {
+        return false;
+    }
+    size_t num_order = 0;  // 已经匹配的ORDER BY列数
+    for (int col : index.cols) {
+        if (num_order == order_cols.size()) {
+            break;
+        }
+        auto &order_col = order_cols[num_order];
+        if (order_col.desc != order_cols[0].desc) {
+            return false;
+        }
+        if (order_col.col.tab_name == tab.name && order_col.col.col_name == tab.cols[col].name) {
+            num_order++;
+            continue;
+        }
+        bool has_eq = std::any_of(conds.begin(), conds.end(), [&](const Condition &cond) {
+            return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.tab_name == tab.name &&
+                   cond.lhs_col.col_name == tab.cols[col].name;
+        });
+        if (!has_eq) {
+            return false;
+        }
+    }
+    return num_order == order_cols.size();
+}
+
 /**
  * @brief select plan 生成
  *
- * @param sel_cols select plan 选取的列
+ * @param sel_cols select plan 选取的列，为空时表示选取所有列；返回时填上补全了表名的列
  * @param tab_names select plan 目标的表
  * @param conds select plan 选取条件
+ * @param order_cols ORDER BY的各列，单表查询能按索引的顺序扫描时不排序，否则在投影之前加排序算子
+ * @param limit LIMIT的行数，-1表示没有LIMIT
+ * @return 以投影算子（有LIMIT时是LIMIT算子）为根的算子树
  */
-void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
-                            std::vector<Condition> conds, Context *context) {
+std::unique_ptr<AbstractExecutor> QlManager::build_select_plan(std::vector<TabCol> &sel_cols,
+                                                               const std::vector<std::string> &tab_names,
+                                                               std::vector<Condition> conds, Context *context,
+                                                               std::vector<OrderByCol> order_cols, int limit) {
     // Parse selector
     auto all_cols = get_all_cols(tab_names);//std::vector<ColMeta>
     if (sel_cols.empty()) {
@@ -224,21 +531,86 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
     }
     // Parse where clause
     conds = check_where_clause(tab_names, conds);
+    for (auto &order_col : order_cols) {
+        order_col.col = check_column(all_cols, order_col.col);
+    }
+    // 所有表都有统计信息时，把过滤后估计行数少的表放在连接的外层
+    std::vector<std::string> join_order = tab_names;
+    if (std::all_of(tab_names.begin(), tab_names.end(),
+                    [&](const std::string &tab_name) { return sm_manager_->db_.get_stats(tab_name) != nullptr; })) {
+        std::map<std::string, double> est_rows;
+        for (auto &tab_name : tab_names) {
+            est_rows[tab_name] = estimate_rows(tab_name, conds);
+        }
+        std::stable_sort(join_order.begin(), join_order.end(),
+                         [&](const std::string &a, const std::string &b) { return est_rows[a] < est_rows[b]; });
+    }
+    // 查询用到的所有列：投影的列和各条件中的列，某个表用到的列都被所选的索引覆盖时只扫描索引
+    std::vector<TabCol> used_cols = sel_cols;
+    for (auto &order_col : order_cols) {
+        used_cols.push_back(order_col.col);
+    }
+    for (auto &cond : conds) {
+        used_cols.push_back(cond.lhs_col);
+        if (!cond.is_rhs_val) {
+            used_cols.push_back(cond.rhs_col);
+        }
+    }
     // Scan table , 生成表算子列表tab_nodes
-    std::vector<std::unique_ptr<AbstractExecutor>> table_scan_executors(tab_names.size());//每个表给一个扫描算子
-    for (size_t i = 0; i < tab_names.size(); i++) {
-        auto curr_conds = pop_conds(conds, {tab_names.begin(), tab_names.begin() + i + 1});//获得这个表上的conds
-        int index_no = get_indexNo(tab_names[i], curr_conds);//获得这个表上可以用的索引的列值
+    std::vector<std::unique_ptr<AbstractExecutor>> table_scan_executors(join_order.size());//每个表给一个扫描算子
+    bool sorted = false;  // 扫描结果已经是ORDER BY的顺序
+    for (size_t i = 0; i < join_order.size(); i++) {
+        auto curr_conds = pop_conds(conds, {join_order.begin(), join_order.begin() + i + 1});//获得这个表上的conds
+        auto index_cols = get_indexNo(join_order[i], curr_conds);//获得这个表上可以用的索引的列值
         // lab3 task2 Todo
         // 根据get_indexNo判断conds上有无索引
-        if(index_no == -1){//表示没有索引
+        TabMeta &tab = sm_manager_->db_.get_table(join_order[i]);
+        // 单表查询的ORDER BY：能按索引的顺序（DESC时反向）扫描就不用再排序
+        bool reverse = false;
+        if (!order_cols.empty() && join_order.size() == 1 && !tab.is_partitioned()) {
+            if (index_cols.empty() && limit >= 0) {
+                // 没有可用于条件的索引时，带LIMIT的查询按排序列上的索引扫描，只读开头（或末尾）的几个页面
+                for (auto &index : tab.get_indexes()) {
+                    if (index_in_order(tab, index, curr_conds, order_cols)) {
+                        index_cols = index.cols;
+                        break;
+                    }
+                }
+            }
+            if (!index_cols.empty() && index_in_order(tab, tab.get_index_meta(index_cols), curr_conds, order_cols)) {
+                sorted = true;
+                reverse = order_cols[0].desc;
+            }
+        }
+        bool index_only = !index_cols.empty() && !tab.is_clustered() &&
+                          IndexOnlyScanExecutor::covers(tab, tab.get_index_meta(index_cols), used_cols);
+        // 匹配的记录多时收集rid后按页面顺序读取堆文件；要按索引的顺序输出或只扫描索引时不用
+        std::vector<std::vector<int>> bitmap_indexes;
+        if (!index_only && !sorted && !tab.is_partitioned()) {
+            bitmap_indexes = get_bitmap_indexes(join_order[i], curr_conds);
+        }
+        if (tab.is_partitioned()) {
+            // 分区表每个分区一个扫描算子，由AppendExecutor拼接并做分区裁剪
+            std::vector<std::unique_ptr<AbstractExecutor>> part_scans;
+            for (int part = 0; part < tab.num_parts; part++) {
+                part_scans.push_back(build_scan(join_order[i], curr_conds, index_cols, context, part, index_only));
+            }
+            table_scan_executors[i] =
+                std::make_unique<AppendExecutor>(tab, std::move(part_scans), std::move(curr_conds), context);
+        } else if (!bitmap_indexes.empty()) {
+            table_scan_executors[i] = std::make_unique<BitmapHeapScanExecutor>(sm_manager_, join_order[i], curr_conds,
+                                                                               bitmap_indexes, context);
+        } else if(index_cols.empty()){//表示没有索引
             // printf("-----------------------我建立了顺序索引\n");
-            // std::cout << tab_names[i] << std::endl;
-            std::unique_ptr<AbstractExecutor> seq_scan = std::make_unique<SeqScanExecutor>(sm_manager_, tab_names[i], curr_conds, context);
+            // std::cout << join_order[i] << std::endl;
+            std::unique_ptr<AbstractExecutor> seq_scan = std::make_unique<SeqScanExecutor>(sm_manager_, join_order[i], curr_conds, context);
             table_scan_executors[i] = std::move(seq_scan);
+        } else if (index_only) {
+            table_scan_executors[i] = std::make_unique<IndexOnlyScanExecutor>(sm_manager_, join_order[i], curr_conds,
+                                                                              index_cols, context, 0, reverse);
         }else{
             // printf("我建立了index索引\n");
-            std::unique_ptr<AbstractExecutor> index_scan = std::make_unique<IndexScanExecutor>(sm_manager_, tab_names[i], curr_conds, index_no, context);
+            std::unique_ptr<AbstractExecutor> index_scan = std::make_unique<IndexScanExecutor>(sm_manager_, join_order[i], curr_conds, index_cols, context, 0, reverse);
             table_scan_executors[i] = std::move(index_scan);
         }
         // 创建合适的scan executor(有索引优先用索引)存入table_scan_executors
@@ -261,9 +633,23 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
     // SeqScanExecutor* left = dynamic_cast<SeqScanExecutor*>(zi->left_.get());
     // SeqScanExecutor* right = dynamic_cast<SeqScanExecutor*>(zi->right_.get());
     // printf("左孩子：%s,右孩子：%s\n",left->tab_name_,right->tab_name_);
+    if (!order_cols.empty() && !sorted) {
+        executorTreeRoot = std::make_unique<SortExecutor>(std::move(executorTreeRoot), order_cols);
+    }
     // 生成query_plan tree完毕后, 根节点转换成投影算子
-    executorTreeRoot = std::make_unique<ProjectionExecutor>(std::move(executorTreeRoot), std::move(sel_cols));
+    executorTreeRoot = std::make_unique<ProjectionExecutor>(std::move(executorTreeRoot), sel_cols);
+    if (limit >= 0) {
+        executorTreeRoot = std::make_unique<LimitExecutor>(std::move(executorTreeRoot), limit);
+    }
     // lab3 task2 Todo End
+    return executorTreeRoot;
+}
+
+void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
+                            std::vector<Condition> conds, Context *context, std::vector<OrderByCol> order_cols,
+                            int limit) {
+    auto executorTreeRoot =
+        build_select_plan(sel_cols, tab_names, std::move(conds), context, std::move(order_cols), limit);
 
     // Column titles
     std::vector<std::string> captions;
@@ -281,6 +667,7 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
     // 执行query_plan
     for (executorTreeRoot->beginTuple(); !executorTreeRoot->is_end(); executorTreeRoot->nextTuple()) {
         // std::cout << "在根节点进行了一次next" << std::endl;
+        ArenaScope arena_scope(&context->arena_);  // 输出一行后回收这一行的中间元组
         auto Tuple = executorTreeRoot->Next();
         std::vector<std::string> columns;
         for (auto &col : executorTreeRoot->cols()) {
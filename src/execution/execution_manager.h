@@ -45,9 +45,14 @@ struct Value {
         str_val = std::move(str_val_);
     }
 
-    void init_raw(int len) {
+    // arena非空时raw（连同shared_ptr的控制块）从arena中分配
+    void init_raw(int len, Arena *arena = nullptr) {
         assert(raw == nullptr);
-        raw = std::make_shared<RmRecord>(len);
+        if (arena != nullptr) {
+            raw = std::allocate_shared<RmRecord>(ArenaAllocator<RmRecord>(arena), len, arena);
+        } else {
+            raw = std::make_shared<RmRecord>(len);
+        }
         if (type == TYPE_INT) {
             assert(len == sizeof(int));
             *(int *)(raw->data) = int_val;
@@ -66,6 +71,8 @@ struct Value {
 
 enum CompOp { OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE };
 
+enum CopyFormat { COPY_CSV, COPY_BINARY };
+
 struct Condition {
     TabCol lhs_col;   // left-hand side column
     CompOp op;        // comparison operator
@@ -79,6 +86,14 @@ struct SetClause {
     Value rhs;
 };
 
+// ORDER BY的一列
+struct OrderByCol {
+    TabCol col;
+    bool desc;  // 是否降序
+};
+
+class AbstractExecutor;
+
 class QlManager {
    private:
     SmManager *sm_manager_;
@@ -94,12 +109,34 @@ class QlManager {
                     std::vector<Condition> conds, Context *context);
 
     void select_from(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
-                     std::vector<Condition> conds, Context *context);
+                     std::vector<Condition> conds, Context *context, std::vector<OrderByCol> order_cols = {},
+                     int limit = -1);
+
+    void copy_from(const std::string &tab_name, const std::string &file_name, Context *context);
+
+    void copy_to(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names, std::vector<Condition> conds,
+                 const std::string &file_name, CopyFormat format, Context *context,
+                 std::vector<OrderByCol> order_cols = {}, int limit = -1);
 
    private:
+    std::unique_ptr<AbstractExecutor> build_select_plan(std::vector<TabCol> &sel_cols,
+                                                        const std::vector<std::string> &tab_names,
+                                                        std::vector<Condition> conds, Context *context,
+                                                        std::vector<OrderByCol> order_cols = {}, int limit = -1);
     TabCol check_column(const std::vector<ColMeta> &all_cols, TabCol target);
     std::vector<ColMeta> get_all_cols(const std::vector<std::string> &tab_names);
     std::vector<Condition> check_where_clause(const std::vector<std::string> &tab_names,
                                               const std::vector<Condition> &conds);
-    int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
+    double estimate_selectivity(const Condition &cond);
+    double estimate_rows(const std::string &tab_name, const std::vector<Condition> &conds);
+    bool match_index(const std::string &tab_name, const IndexMeta &index, const std::vector<Condition> &curr_conds,
+                     size_t *num_match, size_t *first_pos, double *sel);
+    std::vector<int> get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
+    std::vector<std::vector<int>> get_bitmap_indexes(const std::string &tab_name,
+                                                     const std::vector<Condition> &curr_conds);
+    std::unique_ptr<AbstractExecutor> build_scan(const std::string &tab_name, const std::vector<Condition> &conds,
+                                                 const std::vector<int> &index_cols, Context *context, int part = 0,
+                                                 bool index_only = false);
+    std::vector<std::vector<Rid>> collect_part_rids(const std::string &tab_name, const std::vector<Condition> &conds,
+                                                    const std::vector<int> &index_cols, Context *context);
 };
@@ -9,7 +9,7 @@ class AbstractExecutor {
    public:
     Rid _abstract_rid;
 
-    Context *context_;
+    Context *context_ = nullptr;
 
     virtual ~AbstractExecutor() = default;
 
@@ -34,6 +34,9 @@ class AbstractExecutor {
 
     virtual void feed(const std::map<TabCol, Value> &feed_dict){};
 
+    // 当前语句的内存池，算子产生的中间元组从这里分配
+    Arena *arena() const { return context_ == nullptr ? nullptr : &context_->arena_; }
+
     std::vector<ColMeta>::const_iterator get_col(const std::vector<ColMeta> &rec_cols, const TabCol &target) {
         auto pos = std::find_if(rec_cols.begin(), rec_cols.end(), [&](const ColMeta &col) {
             return col.tab_name == target.tab_name && col.name == target.col_name;
@@ -44,25 +47,39 @@ class AbstractExecutor {
         return pos;
     }
 
-    std::map<TabCol, Value> rec2dict(const std::vector<ColMeta> &cols, const RmRecord *rec) {
-        std::map<TabCol, Value> rec_dict;
+    // 把rec中cols各列的值写入rec_dict；已有的列原地覆盖，连同raw缓冲区一起重写，不重新分配
+    void rec2dict(const std::vector<ColMeta> &cols, const RmRecord *rec, std::map<TabCol, Value> *rec_dict) {
         for (auto &col : cols) {
             TabCol key = {.tab_name = col.tab_name, .col_name = col.name};
-            Value val;
             char *val_buf = rec->data + col.offset;
+            auto it = rec_dict->find(key);
+            if (it != rec_dict->end()) {
+                Value &val = it->second;
+                assert(val.type == col.type && val.raw != nullptr);
+                if (col.type == TYPE_INT) {
+                    val.int_val = *(int *)val_buf;
+                    *(int *)(val.raw->data) = val.int_val;
+                } else if (col.type == TYPE_FLOAT) {
+                    val.float_val = *(float *)val_buf;
+                    *(float *)(val.raw->data) = val.float_val;
+                } else if (col.type == TYPE_STRING) {
+                    val.str_val.assign(val_buf, strnlen(val_buf, col.len));
+                    memset(val.raw->data, 0, col.len);
+                    memcpy(val.raw->data, val.str_val.c_str(), val.str_val.size());
+                }
+                continue;
+            }
+            Value val;
             if (col.type == TYPE_INT) {
                 val.set_int(*(int *)val_buf);
             } else if (col.type == TYPE_FLOAT) {
                 val.set_float(*(float *)val_buf);
             } else if (col.type == TYPE_STRING) {
-                std::string str_val((char *)val_buf, col.len);
-                str_val.resize(strlen(str_val.c_str()));
-                val.set_str(str_val);
+                val.set_str(std::string(val_buf, strnlen(val_buf, col.len)));
             }
-            assert(rec_dict.count(key) == 0);
+            // 得到的Value会feed给右子算子，跨外层元组复用，raw不从arena分配
             val.init_raw(col.len);
-            rec_dict[key] = val;
+            (*rec_dict)[key] = val;
         }
-        return rec_dict;
     }
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief 分区表的扫描：依次输出各分区扫描算子的元组
+ *
+ * 每个分区一个SeqScan或IndexScan子算子，beginTuple时根据（可能由连接运算feed进来的）条件做分区裁剪，
+ * 分区键上有等值条件时只扫描值所在的那一个分区
+ */
+class AppendExecutor : public AbstractExecutor {
+   private:
+    TabMeta tab_;
+    std::vector<std::unique_ptr<AbstractExecutor>> children_;  // 下标就是分区号
+    std::vector<Condition> conds_;
+    std::vector<Condition> fed_conds_;
+    std::map<TabCol, Value> feed_dict_;  // 最近一次feed的值，子算子在开始扫描之前才feed
+    bool fed_ = false;
+
+    std::vector<int> parts_;  // 裁剪后要扫描的分区
+    size_t curr_ = 0;         // 当前扫描的是parts_[curr_]
+
+   public:
+    AppendExecutor(const TabMeta &tab, std::vector<std::unique_ptr<AbstractExecutor>> children,
+                   std::vector<Condition> conds, Context *context) {
+        tab_ = tab;
+        children_ = std::move(children);
+        conds_ = std::move(conds);
+        context_ = context;
+        std::map<CompOp, CompOp> swap_op = {
+            {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+        };
+        for (auto &cond : conds_) {
+            if (cond.lhs_col.tab_name != tab_.name) {
+                // 与子算子一样，把本表的列换到左边
+                std::swap(cond.lhs_col, cond.rhs_col);
+                cond.op = swap_op.at(cond.op);
+            }
+        }
+        fed_conds_ = conds_;
+    }
+
+    /**
+     * @brief 分区裁剪：返回满足conds的记录可能所在的分区
+     * @note 右值还没有转成分区列的原始格式（raw为空或类型不同）时不裁剪
+     */
+    static std::vector<int> prune_parts(const TabMeta &tab, const std::vector<Condition> &conds) {
+        auto &part_col = tab.cols[tab.part_col];
+        for (auto &cond : conds) {
+            if (cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.tab_name == tab.name &&
+                cond.lhs_col.col_name == part_col.name && cond.rhs_val.raw != nullptr &&
+                cond.rhs_val.type == part_col.type) {
+                return {tab.get_key_part(cond.rhs_val.raw->data)};
+            }
+        }
+        std::vector<int> parts(tab.num_parts);
+        for (int part = 0; part < tab.num_parts; part++) {
+            parts[part] = part;
+        }
+        return parts;
+    }
+
+    std::string getType() override { return "Append"; }
+
+    void beginTuple() override {
+        parts_ = prune_parts(tab_, fed_conds_);
+        curr_ = 0;
+        begin_child();
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        children_[parts_[curr_]]->nextTuple();
+        if (children_[parts_[curr_]]->is_end()) {
+            curr_++;
+            begin_child();
+        }
+    }
+
+    bool is_end() const override { return curr_ == parts_.size(); }
+
+    size_t tupleLen() const override { return children_[0]->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return children_[0]->cols(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return children_[parts_[curr_]]->Next();
+    }
+
+    void feed(const std::map<TabCol, Value> &feed_dict) override {
+        fed_conds_ = conds_;
+        for (auto &cond : fed_conds_) {
+            if (!cond.is_rhs_val && cond.rhs_col.tab_name != tab_.name) {
+                cond.is_rhs_val = true;
+                cond.rhs_val = feed_dict.at(cond.rhs_col);
+            }
+        }
+        feed_dict_ = feed_dict;
+        fed_ = true;
+    }
+
+    Rid &rid() override { return children_[parts_[curr_]]->rid(); }
+
+    // 当前元组所在的分区
+    int part() const { return parts_[curr_]; }
+
+   private:
+    // 从parts_[curr_]开始找到第一个非空的分区
+    void begin_child() {
+        for (; curr_ < parts_.size(); curr_++) {
+            auto &child = children_[parts_[curr_]];
+            if (fed_) {
+                child->feed(feed_dict_);
+            }
+            child->beginTuple();
+            if (!child->is_end()) {
+                break;
+            }
+        }
+    }
+};
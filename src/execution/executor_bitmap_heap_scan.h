@@ -0,0 +1,137 @@
+#pragma once
+
+#include <map>
+
+#include "executor_index_scan.h"
+#include "record/bitmap.h"
+
+/**
+ * @brief 按页面分组的rid位图：每个堆页面一个与页内slot对应的位图，按page_no有序遍历
+ */
+class RidBitmap {
+    int bitmap_size_;                         // 每个页面的位图字节数，与RmFileHdr::bitmap_size相同
+    std::map<int, std::vector<char>> pages_;  // page_no -> 页内slot的位图，只包含有rid的页面
+
+   public:
+    explicit RidBitmap(int bitmap_size) : bitmap_size_(bitmap_size) {}
+
+    void set(const Rid &rid) {
+        auto &bitmap = pages_[rid.page_no];
+        if (bitmap.empty()) {
+            bitmap.resize(bitmap_size_, 0);
+        }
+        Bitmap::set(bitmap.data(), rid.slot_no);
+    }
+
+    // 只保留也在other中的rid（多个索引上的条件是AND），变空的页面不再访问
+    void intersect(const RidBitmap &other) {
+        for (auto it = pages_.begin(); it != pages_.end();) {
+            auto other_it = other.pages_.find(it->first);
+            bool is_empty = true;
+            if (other_it != other.pages_.end()) {
+                for (int i = 0; i < bitmap_size_; i++) {
+                    it->second[i] &= other_it->second[i];
+                    is_empty = is_empty && it->second[i] == 0;
+                }
+            }
+            it = is_empty ? pages_.erase(it) : std::next(it);
+        }
+    }
+
+    const std::map<int, std::vector<char>> &pages() const { return pages_; }
+};
+
+/**
+ * @brief 位图堆扫描：先扫描一个或多个索引上的范围，把rid收集到按页面分组的位图中（多个索引取交集），
+ * 再按page_no的顺序逐页读取记录，每个堆页面只读一次
+ * @note 索引扫描按key的顺序读取记录，匹配的记录多时在堆文件中来回跳、反复读同一个页面；
+ * 位图堆扫描的输出按rid有序而不是按key有序。读出的记录仍用所有条件重新判断
+ */
+class BitmapHeapScanExecutor : public IndexScanExecutor {
+    std::vector<IndexMeta> indexes_;  // 所扫描的各个索引，结果取交集
+    std::unique_ptr<RidBitmap> bitmap_;
+    std::map<int, std::vector<char>>::const_iterator page_it_;  // 下一个要读取的页面
+    int page_no_ = RM_NO_PAGE;                                 // 当前页面
+    std::vector<std::pair<int, RmRecord>> page_records_;       // 当前页面中位图选中的记录
+    size_t pos_ = 0;                                           // 当前记录在page_records_中的位置
+
+   public:
+    BitmapHeapScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                           const std::vector<std::vector<int>> &indexes_cols, Context *context, int part = 0)
+        : IndexScanExecutor(sm_manager, std::move(tab_name), std::move(conds), indexes_cols[0], context, part) {
+        assert(pk_ih_ == nullptr);
+        TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
+        for (auto &index_cols : indexes_cols) {
+            indexes_.push_back(tab.get_index_meta(index_cols));
+        }
+    }
+
+    std::string getType() override { return "bitmapHeapScan"; }
+
+    void beginTuple() override {
+        check_runtime_conds();
+        int bitmap_size = fh_->get_file_hdr().bitmap_size;
+        for (size_t i = 0; i < indexes_.size(); i++) {
+            auto &index = indexes_[i];
+            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(part_name_, index.cols)).get();
+            Iid lower, upper;
+            scan_range(ih, index, cols_, fed_conds_, &lower, &upper);
+            auto bitmap = std::make_unique<RidBitmap>(bitmap_size);
+            std::vector<Rid> rids;
+            for (IxScan scan(ih, lower, upper, sm_manager_->get_bpm()); !scan.is_end();) {
+                rids.clear();
+                scan.next_batch(&rids);  // 每次取出一个叶子中的rid
+                for (auto &rid : rids) {
+                    bitmap->set(rid);
+                }
+            }
+            if (i == 0) {
+                bitmap_ = std::move(bitmap);
+            } else {
+                bitmap_->intersect(*bitmap);
+            }
+        }
+        page_it_ = bitmap_->pages().begin();
+        page_records_.clear();
+        pos_ = 0;
+        find_match();
+    }
+
+    void nextTuple() override {
+        check_runtime_conds();
+        assert(!is_end());
+        pos_++;
+        find_match();
+    }
+
+    bool is_end() const override { return pos_ >= page_records_.size() && page_it_ == bitmap_->pages().end(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        auto &rec = page_records_[pos_].second;
+        auto res = std::make_unique<RmRecord>(rec.size, arena());
+        memcpy(res->data, rec.data, rec.size);
+        return res;
+    }
+
+   private:
+    // 从pos_开始找到第一个满足fed_conds_的记录，当前页面读完后按顺序读取位图中的下一个页面
+    void find_match() {
+        while (true) {
+            for (; pos_ < page_records_.size(); pos_++) {
+                if (eval_conds(cols_, fed_conds_, &page_records_[pos_].second)) {
+                    rid_ = Rid{page_no_, page_records_[pos_].first};
+                    return;
+                }
+            }
+            if (page_it_ == bitmap_->pages().end()) {
+                return;
+            }
+            page_no_ = page_it_->first;
+            page_records_.clear();
+            pos_ = 0;
+            fh_->get_page_records(page_no_, page_it_->second.data(), &page_records_);
+            ++page_it_;
+        }
+    }
+};
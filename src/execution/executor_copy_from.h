@@ -0,0 +1,359 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief COPY table FROM 'file'：把CSV文件批量导入表中
+ *
+ * 逐行读取文件，把每行直接格式化成记录写入批缓冲区，攒满COPY_BATCH_PAGES个页面后
+ * 用RmFileHandle::append_records一次写入新的堆页面，不经过解析器和InsertExecutor；
+ * 每个索引只收集(key, rid)，全部读完后排序，空索引用IxIndexHandle::bulk_load自底向上建树，
+ * 非空索引退化为按key有序地逐条insert_entry。
+ * 聚簇表没有堆文件：读完所有记录后按主键排序，主键索引为空时直接把记录bulk_load到叶子结点中。
+ * 分区表的每个分区有自己的批缓冲区和索引，记录按分区键分到各分区中写入。
+ * @note CSV格式：字段以逗号分隔，含逗号、引号或换行的字段用双引号括起，字段内的双引号写成两个双引号
+ */
+class CopyFromExecutor : public AbstractExecutor {
+   private:
+    struct IndexLoad {
+        IndexMeta index;
+        IxIndexHandle *ih;
+        std::vector<char> keys;  // 所有记录在索引上的key，依次存放，每个长度为index.col_tot_len
+        std::vector<char> vals;  // 对应的值，每个长度为索引的val_len（rid之后是INCLUDE列）
+    };
+
+    // 一个分区（不分区的表只有一个）的写入状态
+    struct PartLoad {
+        std::string name;  // 分区的存储名
+        RmFileHandle *fh;
+        std::vector<char> batch;  // 还没有写入记录文件的记录
+        int batch_size = 0;
+        std::vector<IndexLoad> indexes;
+    };
+
+    TabMeta tab_;
+    std::string tab_name_;
+    std::string file_name_;
+    Rid rid_;
+    SmManager *sm_manager_;
+    size_t num_rows_ = 0;
+    int line_no_ = 0;
+
+   public:
+    CopyFromExecutor(SmManager *sm_manager, const std::string &tab_name, const std::string &file_name,
+                     Context *context) {
+        sm_manager_ = sm_manager;
+        tab_ = sm_manager_->db_.get_table(tab_name);
+        tab_name_ = tab_name;
+        file_name_ = file_name;
+        context_ = context;
+    }
+
+    std::unique_ptr<RmRecord> Next() override {
+        std::vector<char> read_buf(COPY_READ_BUFFER_SIZE);
+        std::ifstream ifs;
+        ifs.rdbuf()->pubsetbuf(read_buf.data(), read_buf.size());
+        ifs.open(file_name_);
+        if (!ifs.is_open()) {
+            throw FileNotFoundError(file_name_);
+        }
+        if (tab_.is_clustered()) {
+            load_clustered(ifs);
+            return nullptr;
+        }
+
+        std::vector<PartLoad> parts(tab_.num_parts);
+        for (int part = 0; part < tab_.num_parts; part++) {
+            auto &load = parts[part];
+            load.name = tab_.get_part_name(part);
+            load.fh = sm_manager_->fhs_.at(load.name).get();
+            for (auto &index : tab_.get_indexes()) {
+                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(load.name, index.cols)).get();
+                load.indexes.push_back(IndexLoad{.index = index, .ih = ih, .keys = {}, .vals = {}});
+            }
+        }
+
+        RmFileHdr file_hdr = parts[0].fh->get_file_hdr();
+        int record_size = file_hdr.record_size;
+        // 所有分区的批缓冲区加起来约为COPY_BATCH_PAGES个页面
+        int batch_capacity = file_hdr.num_records_per_page * std::max(1, COPY_BATCH_PAGES / tab_.num_parts);
+        for (auto &load : parts) {
+            load.batch.resize((size_t)batch_capacity * record_size);
+        }
+        std::vector<char> row(record_size);
+        std::vector<Rid> rids;
+        std::vector<std::string> fields;
+        try {
+            while (read_row(ifs, &fields)) {
+                PartLoad *load = &parts[0];
+                char *dst = load->batch.data() + (size_t)load->batch_size * record_size;
+                if (tab_.is_partitioned()) {
+                    // 格式化之后才知道记录属于哪个分区
+                    format_record(fields, row.data());
+                    load = &parts[tab_.get_part(row.data())];
+                    dst = load->batch.data() + (size_t)load->batch_size * record_size;
+                    memcpy(dst, row.data(), record_size);
+                } else {
+                    format_record(fields, dst);
+                }
+                if (++load->batch_size == batch_capacity) {
+                    flush_batch(load, &rids);
+                }
+            }
+            for (auto &load : parts) {
+                flush_batch(&load, &rids);
+            }
+        } catch (RedBaseError &) {
+            // 出错之前已经写入堆文件的记录也要进入索引，保证表和索引一致（可由事务回滚撤销）
+            for (auto &load : parts) {
+                for (auto &index : load.indexes) {
+                    build_index(&index);
+                }
+            }
+            throw;
+        }
+
+        for (auto &load : parts) {
+            for (auto &index : load.indexes) {
+                build_index(&index);
+            }
+        }
+        return nullptr;
+    }
+
+    Rid &rid() override { return rid_; }
+
+    size_t num_rows() const { return num_rows_; }
+
+   private:
+    /**
+     * @brief 读取一行CSV并切分成字段，空行被跳过
+     * @return 文件已读完时返回false
+     */
+    bool read_row(std::istream &is, std::vector<std::string> *fields) {
+        std::string line;
+        do {
+            if (!std::getline(is, line)) {
+                return false;
+            }
+            line_no_++;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+        } while (line.empty());
+
+        fields->clear();
+        std::string field;
+        bool in_quotes = false;
+        size_t i = 0;
+        while (true) {
+            if (i == line.size()) {
+                if (!in_quotes) {
+                    break;
+                }
+                // 引号内的换行属于字段本身，继续读下一行
+                if (!std::getline(is, line)) {
+                    throw CsvFormatError(file_name_, line_no_, "unterminated quoted field");
+                }
+                line_no_++;
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                field.push_back('\n');
+                i = 0;
+                continue;
+            }
+            char c = line[i++];
+            if (in_quotes) {
+                if (c != '"') {
+                    field.push_back(c);
+                } else if (i < line.size() && line[i] == '"') {
+                    field.push_back('"');
+                    i++;
+                } else {
+                    in_quotes = false;
+                }
+            } else if (c == '"') {
+                in_quotes = true;
+            } else if (c == ',') {
+                fields->push_back(std::move(field));
+                field.clear();
+            } else {
+                field.push_back(c);
+            }
+        }
+        fields->push_back(std::move(field));
+        return true;
+    }
+
+    // 按表的列定义把一行字段格式化成记录，写到buf中
+    void format_record(const std::vector<std::string> &fields, char *buf) {
+        if (fields.size() != tab_.cols.size()) {
+            throw CsvFormatError(file_name_, line_no_,
+                                 "expected " + std::to_string(tab_.cols.size()) + " fields, got " +
+                                     std::to_string(fields.size()));
+        }
+        for (size_t i = 0; i < tab_.cols.size(); i++) {
+            auto &col = tab_.cols[i];
+            auto &field = fields[i];
+            char *dst = buf + col.offset;
+            if (col.type == TYPE_STRING) {
+                if ((int)field.size() > col.len) {
+                    throw CsvFormatError(file_name_, line_no_, "value of column " + col.name + " is too long");
+                }
+                memset(dst, 0, col.len);
+                memcpy(dst, field.data(), field.size());
+                continue;
+            }
+            const char *begin = field.c_str();
+            char *end = nullptr;
+            errno = 0;
+            if (col.type == TYPE_INT) {
+                long val = strtol(begin, &end, 10);
+                if (val < INT32_MIN || val > INT32_MAX) {
+                    errno = ERANGE;
+                }
+                *(int *)dst = (int)val;
+            } else {
+                *(float *)dst = strtof(begin, &end);
+            }
+            while (end != begin && isspace(*end)) {
+                end++;
+            }
+            if (end == begin || *end != '\0' || errno == ERANGE) {
+                throw CsvFormatError(file_name_, line_no_,
+                                     "invalid " + coltype2str(col.type) + " value '" + field + "' for column " + col.name);
+            }
+        }
+    }
+
+    // 把分区批缓冲区中的记录写入它的堆文件，并记下每个索引的(key, rid)
+    void flush_batch(PartLoad *load, std::vector<Rid> *rids) {
+        int batch_size = load->batch_size;
+        if (batch_size == 0) {
+            return;
+        }
+        const char *batch = load->batch.data();
+        int record_size = load->fh->get_file_hdr().record_size;
+        rids->clear();
+        load->fh->append_records(batch, batch_size, rids);
+        for (int i = 0; i < batch_size; i++) {
+            const char *rec = batch + (size_t)i * record_size;
+            int part = tab_.get_part(rec);
+            context_->txn_->AppendWriteRecord(new WriteRecord(WType::INSERT_TUPLE, tab_name_, (*rids)[i], part));
+            sm_manager_->capture_index_change(tab_, part, (*rids)[i], nullptr, rec, context_);
+        }
+        for (auto &index : load->indexes) {
+            int len = index.index.col_tot_len;
+            size_t old_size = index.keys.size();
+            index.keys.resize(old_size + (size_t)batch_size * len);
+            for (int i = 0; i < batch_size; i++) {
+                char *key = index.keys.data() + old_size + (size_t)i * len;
+                const char *rec_key = tab_.get_index_key(index.index, batch + (size_t)i * record_size, key);
+                if (rec_key != key) {
+                    memcpy(key, rec_key, len);
+                }
+            }
+            int val_len = index.ih->get_file_hdr().val_len;
+            old_size = index.vals.size();
+            index.vals.resize(old_size + (size_t)batch_size * val_len);
+            for (int i = 0; i < batch_size; i++) {
+                char *val = index.vals.data() + old_size + (size_t)i * val_len;
+                const char *rec_val = tab_.get_index_val(index.index, batch + (size_t)i * record_size, (*rids)[i], val);
+                if (rec_val != val) {
+                    memcpy(val, rec_val, val_len);
+                }
+            }
+        }
+        num_rows_ += batch_size;
+        rid_ = rids->back();
+        load->batch_size = 0;
+    }
+
+    /**
+     * @brief 导入聚簇表：先读入并格式化所有记录，按主键排序，有重复主键时不做任何修改并抛出DuplicateKeyError
+     */
+    void load_clustered(std::istream &is) {
+        auto &pk = tab_.cols[tab_.pk_col];
+        int record_size = tab_.cols.back().offset + tab_.cols.back().len;
+        std::vector<char> recs;
+        std::vector<std::string> fields;
+        while (read_row(is, &fields)) {
+            recs.resize(recs.size() + record_size);
+            format_record(fields, recs.data() + recs.size() - record_size);
+        }
+        size_t num_recs = recs.size() / record_size;
+        auto rec_at = [&](size_t i) { return recs.data() + i * record_size; };
+        std::vector<size_t> order(num_recs);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return ix_compare(rec_at(a) + pk.offset, rec_at(b) + pk.offset, pk.type, pk.len) < 0;
+        });
+        for (size_t i = 1; i < num_recs; i++) {
+            if (ix_compare(rec_at(order[i - 1]) + pk.offset, rec_at(order[i]) + pk.offset, pk.type, pk.len) == 0) {
+                throw DuplicateKeyError(tab_name_);
+            }
+        }
+
+        auto pk_ih = sm_manager_->get_clustered_index(tab_name_);
+        std::vector<std::pair<const char *, const char *>> entries;
+        entries.reserve(num_recs);
+        for (size_t i : order) {
+            entries.emplace_back(rec_at(i) + pk.offset, rec_at(i));
+        }
+        bool has_secondary = tab_.get_indexes().size() > 1;
+        if (has_secondary || !pk_ih->bulk_load(entries, context_->txn_)) {
+            for (auto &entry : entries) {
+                sm_manager_->clustered_insert(tab_name_, entry.second, context_);
+                context_->txn_->AppendWriteRecord(
+                    new WriteRecord(WType::INSERT_TUPLE, tab_name_, RmRecord(record_size, (char *)entry.second)));
+                num_rows_++;
+            }
+            return;
+        }
+        for (auto &entry : entries) {
+            context_->txn_->AppendWriteRecord(
+                new WriteRecord(WType::INSERT_TUPLE, tab_name_, RmRecord(record_size, (char *)entry.second)));
+            sm_manager_->capture_index_change(tab_, 0, Rid{RM_NO_PAGE, -1}, nullptr, entry.second, context_);
+        }
+        num_rows_ = num_recs;
+    }
+
+    // 对收集到的key排序去重（key相同时保留先出现的记录，与insert_entry一致），然后建树
+    void build_index(IndexLoad *index) {
+        int len = index->index.col_tot_len;
+        const IxFileHdr &file_hdr = index->ih->get_file_hdr();
+        const char *keys = index->keys.data();
+        int val_len = file_hdr.val_len;
+        std::vector<int> order(index->vals.size() / val_len);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return ix_compare(keys + (size_t)a * len, keys + (size_t)b * len, file_hdr) < 0;
+        });
+
+        std::vector<std::pair<const char *, const char *>> entries;
+        entries.reserve(order.size());
+        for (int i : order) {
+            const char *key = keys + (size_t)i * len;
+            if (!entries.empty() && ix_compare(entries.back().first, key, file_hdr) == 0) {
+                continue;
+            }
+            entries.emplace_back(key, index->vals.data() + (size_t)i * val_len);
+        }
+
+        if (!index->ih->bulk_load(entries, context_->txn_)) {
+            for (auto &entry : entries) {
+                index->ih->insert_entry(entry.first, entry.second, context_->txn_);
+            }
+        }
+    }
+};
@@ -11,54 +11,76 @@ class DeleteExecutor : public AbstractExecutor {
     std::vector<Condition> conds_;
     RmFileHandle *fh_;
     std::vector<Rid> rids_;
+    std::vector<RmRecord> recs_;  // 聚簇表没有rid，直接保存要删除的记录
     std::string tab_name_;
+    int part_ = 0;
+    std::string part_name_;  // 记录所在分区的存储名，不分区的表就是表名
     SmManager *sm_manager_;
 
    public:
+    // 分区表上rids都是第part个分区中的记录
     DeleteExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Condition> conds,
-                   std::vector<Rid> rids, Context *context) {
+                   std::vector<Rid> rids, Context *context, int part = 0) {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        part_ = part;
+        part_name_ = tab_.get_part_name(part);
+        fh_ = sm_manager_->fhs_.at(part_name_).get();
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
+
+    DeleteExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Condition> conds,
+                   std::vector<RmRecord> recs, Context *context) {
+        sm_manager_ = sm_manager;
+        tab_name_ = tab_name;
+        tab_ = sm_manager_->db_.get_table(tab_name);
+        fh_ = nullptr;
+        conds_ = conds;
+        recs_ = std::move(recs);
+        context_ = context;
+    }
     std::unique_ptr<RmRecord> Next() override {
+        if (tab_.is_clustered()) {
+            for (auto &rec : recs_) {
+                sm_manager_->clustered_delete(tab_name_, rec.data, context_);
+                context_->txn_->AppendWriteRecord(new WriteRecord(WType::DELETE_TUPLE, tab_name_, std::move(rec)));
+            }
+            return nullptr;
+        }
         // Get all index files
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
-        for (size_t col_i = 0; col_i < tab_.cols.size(); col_i++) {
-            if (tab_.cols[col_i].index) {
-                // lab3 task3 Todo
-                // 获取需要的索引句柄,填充vector ihs
+        auto indexes = tab_.get_indexes();
+        std::vector<IxIndexHandle *> ihs;
+        for (auto &index : indexes) {
+            // lab3 task3 Todo
+            // 获取需要的索引句柄,填充vector ihs
 
-                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, col_i)).get();//返回的是IxIndexhandle*
-                // ih->insert_entry(rec.data + col.offset, rid_, context_->txn_);//rec.data + col.offset指向的是key的字段，也即向b+树中插入字段(key,value)，其中value是rid_
-                ihs.push_back(ih);
+            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(part_name_, index.cols)).get();//返回的是IxIndexhandle*
+            ihs.push_back(ih);
 
-                // lab3 task3 Todo end
-            }
+            // lab3 task3 Todo end
         }
+        std::vector<char> key_buf;
         // Delete each rid from record file and index file
         for (auto &rid : rids_) {
+            ArenaScope arena_scope(arena());
             auto rec = fh_->get_record(rid, context_);
             // lab3 task3 Todo
             // Delete from index file
             // Delete from record file 、
 
-             for (size_t i = 0; i < tab_.cols.size(); i++) {
-                auto &col = tab_.cols[i];
-                if (col.index) {
-                    auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, i)).get();//返回的是IxIndexhandle
-                    ih->delete_entry(rec->data + col.offset, context_->txn_);//rec.data + col.offset指向的是key的字段，也即向b+树中插入字段(key,value)，其中value是rid_
-                }
+            for (size_t i = 0; i < indexes.size(); i++) {
+                key_buf.resize(indexes[i].col_tot_len);
+                ihs[i]->delete_entry(tab_.get_index_key(indexes[i], rec->data, key_buf.data()), context_->txn_);
             }
             // Delete from record file
             fh_->delete_record(rid,context_);
+            sm_manager_->capture_index_change(tab_, part_, rid, rec->data, nullptr, context_);
 
-            // record a delete operation into the transaction
-            WriteRecord *wr = new WriteRecord(WType::DELETE_TUPLE, tab_name_, rid, *rec);
+            // record a delete operation into the transaction（把读出的记录移入写集合，不再额外拷贝）
+            WriteRecord *wr = new WriteRecord(WType::DELETE_TUPLE, tab_name_, rid, std::move(*rec), part_);
             context_->txn_->AppendWriteRecord(wr);
 
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "executor_index_scan.h"
+
+/**
+ * @brief 只扫描索引（index-only scan）：查询用到的列都在索引的叶子结点中（索引列和INCLUDE列）时，
+ * 直接由叶子结点中的key和值拼出记录，不读取堆文件
+ * @note 拼出的记录与表的记录格式相同，没有被索引覆盖的列填0，由查询计划保证谓词和投影只用到被覆盖的列；
+ * 只用于堆表，聚簇表的主键索引本身就存放整条记录
+ */
+class IndexOnlyScanExecutor : public IndexScanExecutor {
+    std::vector<char> key_buf_;
+    std::vector<char> val_buf_;
+
+   public:
+    IndexOnlyScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                          const std::vector<int> &index_cols, Context *context, int part = 0, bool reverse = false)
+        : IndexScanExecutor(sm_manager, std::move(tab_name), std::move(conds), index_cols, context, part, reverse) {
+        assert(pk_ih_ == nullptr);
+        key_buf_.resize(index_.col_tot_len);
+    }
+
+    std::string getType() override { return "indexOnlyScan"; }
+
+    /**
+     * @brief 索引index是否覆盖了tab_name表上查询用到的所有列
+     *
+     * @param used_cols 查询用到的列（可以包含其他表的列）
+     */
+    static bool covers(const TabMeta &tab, const IndexMeta &index, const std::vector<TabCol> &used_cols) {
+        return std::all_of(used_cols.begin(), used_cols.end(), [&](const TabCol &col) {
+            if (col.tab_name != tab.name) {
+                return true;
+            }
+            auto pos = std::find_if(tab.cols.begin(), tab.cols.end(),
+                                    [&](const ColMeta &meta) { return meta.name == col.col_name; });
+            return pos != tab.cols.end() && index.covers(pos - tab.cols.begin());
+        });
+    }
+
+   protected:
+    // 由叶子结点中的key和值拼出记录：key中依次是各索引列，值中rid之后依次是各INCLUDE列
+    std::unique_ptr<RmRecord> get_record() override {
+        val_buf_.resize(ih_->get_file_hdr().val_len);
+        static_cast<IxScan *>(scan_.get())->get_entry(key_buf_.data(), val_buf_.data());
+        std::unique_ptr<RmRecord> rec(new RmRecord(len_, arena()));
+        memset(rec->data, 0, len_);
+        const char *src = key_buf_.data();
+        for (int col : index_.cols) {
+            memcpy(rec->data + cols_[col].offset, src, cols_[col].len);
+            src += cols_[col].len;
+        }
+        src = val_buf_.data() + sizeof(Rid);
+        for (int col : index_.include_cols) {
+            memcpy(rec->data + cols_[col].offset, src, cols_[col].len);
+            src += cols_[col].len;
+        }
+        return rec;
+    }
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <limits>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
@@ -7,7 +9,7 @@
 #include "system/sm.h"
 
 class IndexScanExecutor : public AbstractExecutor {
-   private:
+   protected:
     std::string tab_name_;
     std::vector<Condition> conds_;
     RmFileHandle *fh_;
@@ -15,24 +17,40 @@ class IndexScanExecutor : public AbstractExecutor {
     size_t len_;
     std::vector<Condition> fed_conds_;
 
-    int index_no_;
+    IndexMeta index_;
+    std::string part_name_;           // 所扫描分区的存储名，不分区的表就是表名
+    IxIndexHandle *pk_ih_ = nullptr;  // 聚簇表的主键索引，记录保存在它的叶子结点中
+    bool is_pk_index_ = false;        // 聚簇表上扫描的是否就是主键索引
+    std::vector<char> pk_buf_;        // 聚簇表的二级索引中读出的主键
+    // 聚簇表的二级索引扫描时，当前叶子中各主键在主键索引中成批查到的记录：
+    // pk_batch_recs_中第i条是叶子pk_batch_page_中第pk_batch_first_ + i个键值对对应的记录
+    int pk_batch_page_ = INVALID_PAGE_ID;
+    int pk_batch_first_ = 0;
+    std::vector<char> pk_batch_recs_;
+    std::vector<bool> pk_batch_found_;
 
-    Rid rid_;
+    Rid rid_;  // 当前扫描到的记录的rid（聚簇表中是记录在所扫描索引的叶子结点中的位置）
     std::unique_ptr<RecScan> scan_;
+    IxIndexHandle *ih_ = nullptr;
+    bool reverse_;  // 从上界向下界反向扫描，按索引列降序输出
 
     SmManager *sm_manager_;
 
    public:
-    IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, int index_no,
-                      Context *context) {
+    // 分区表上只扫描第part个分区的索引，各分区的扫描由AppendExecutor拼接起来
+    // index_cols是所扫描索引的索引列，组合索引上用前缀列的条件确定扫描范围；reverse时降序扫描（ORDER BY ... DESC）
+    IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                      const std::vector<int> &index_cols, Context *context, int part = 0, bool reverse = false) {
         // lab3 task2 todo
         // 参考seqscan作法,实现indexscan构造方法
 
         sm_manager_ = sm_manager;
+        reverse_ = reverse;
         tab_name_ = std::move(tab_name);
         conds_ = std::move(conds);
         TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        part_name_ = tab.get_part_name(part);
+        fh_ = tab.is_clustered() ? nullptr : sm_manager_->fhs_.at(part_name_).get();
         cols_ = tab.cols;
         len_ = cols_.back().offset + cols_.back().len;
         context_ = context;
@@ -50,67 +68,39 @@ class IndexScanExecutor : public AbstractExecutor {
             }
         }
         fed_conds_ = conds_;
-        index_no_ = index_no;
+        index_ = tab.get_index_meta(index_cols);
+        if (tab.is_clustered()) {
+            pk_ih_ = sm_manager_->get_clustered_index(tab_name_);
+            is_pk_index_ = index_cols == std::vector<int>{tab.pk_col};
+        }
 
 
         // lab3 task2 todo END
     }
 
-    std::string getType() { return "indexScan"; }
+    std::string getType() override { return "indexScan"; }
 
     void beginTuple() {
         check_runtime_conds();
 
         // index is available, scan index
-        auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_no_)).get();
-        Iid lower = ih->leaf_begin();
-        Iid upper = ih->leaf_end();
-        auto &index_col = cols_[index_no_];
-        for (auto &cond : fed_conds_) {
-            if (cond.is_rhs_val && cond.op != OP_NE && cond.lhs_col.col_name == index_col.name) {
-                char *rhs_key = cond.rhs_val.raw->data;
-                if (cond.op == OP_EQ) {
-                    lower = ih->lower_bound(rhs_key);
-                    upper = ih->upper_bound(rhs_key);
-                // lab3 task2 todo
-                /**
-                 * else if(cond.op == ?){
-                 *
-                 * }else if(){
-                 * ...
-                 * }else if(){
-                 * ...
-                 * }
-                 * ...
-                 * else{
-                 *  throw InternalError("Unexpected op type");
-                 * }
-                 *
-                 *
-                 */
-                // 利用cond 进行索引扫描
-                } else if (cond.op == OP_LT) {//左值小于右值，那么应该更新上界
-                    upper = ih->upper_bound(rhs_key);
-                } else if (cond.op == OP_GT) {//左值大于右值，应该更新下界
-                    lower = ih->lower_bound(rhs_key); 
-                } else if (cond.op == OP_LE) {
-                    upper = ih->upper_bound(rhs_key);
-                } else if (cond.op == OP_GE) {
-                    lower = ih->lower_bound(rhs_key); 
-                } else{
-                   throw InternalError("Unexpected op type");
-                  }
-
-
-                // lab3 task2 todo end
-                break;
-            }
+        auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(part_name_, index_.cols)).get();
+        Iid lower, upper;
+        // lab3 task2 todo
+        // 利用cond 进行索引扫描
+        scan_range(ih, index_, cols_, fed_conds_, &lower, &upper);
+        // lab3 task2 todo end
+        scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm(), reverse_);
+        ih_ = ih;
+        if (pk_ih_ != nullptr) {
+            pk_buf_.resize(ih->get_file_hdr().val_len);
+            pk_batch_page_ = INVALID_PAGE_ID;
         }
-        scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm());
         // Get the first record
         while (!scan_->is_end()) {
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
+            rid_ = scan_pos();
+            ArenaScope arena_scope(arena());  // 被判定的记录用完即回收
+            auto rec = get_record();
             if (eval_conds(cols_, fed_conds_, rec.get())) {
                 break;
             }
@@ -127,9 +117,10 @@ class IndexScanExecutor : public AbstractExecutor {
         for (scan_->next(); !scan_->is_end(); scan_->next()) {  // 用TableIterator遍历TableHeap中的所有Tuple
             // lab3 task2 todo
             // 获取当前记录(参考beginTuple())赋给算子成员rid_
-            rid_ = scan_->rid();
+            rid_ = scan_pos();
             // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
-            auto rec = fh_->get_record(rid_, context_); 
+            ArenaScope arena_scope(arena());
+            auto rec = get_record();
             // 扫描到下一个满足条件的记录,赋rid_,中止循环
             if(eval_conds(cols_, fed_conds_, rec.get())){
                 break;
@@ -148,7 +139,7 @@ class IndexScanExecutor : public AbstractExecutor {
 
     std::unique_ptr<RmRecord> Next() override {
         assert(!is_end());
-        return fh_->get_record(rid_, context_);
+        return get_record();
     }
 
     void feed(const std::map<TabCol, Value> &feed_dict) override {
@@ -215,4 +206,174 @@ class IndexScanExecutor : public AbstractExecutor {
         return std::all_of(conds.begin(), conds.end(),
                            [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
     }
+
+    /**
+     * @brief 用conds中索引列上的条件确定索引ih（索引index）上的扫描范围[lower, upper)
+     * @note 索引列从第一列开始依次用等值条件确定key的前缀，遇到没有等值条件的列时用该列上的范围条件确定上下界；
+     * 上下界的key中没有确定的列填上该类型的最小值或最大值，组合索引上只匹配前缀列也能得到扫描范围；
+     * 哈希索引上所有索引列都有等值条件（见QlManager::get_indexNo），上下界落在key所在的桶中；
+     * 所有索引列都是等值条件时先查Bloom filter，key不存在时扫描范围为空
+     */
+    static void scan_range(IxIndexHandle *ih, const IndexMeta &index, const std::vector<ColMeta> &cols,
+                           const std::vector<Condition> &conds, Iid *lower, Iid *upper) {
+        std::vector<char> lower_key(index.col_tot_len);
+        std::vector<char> upper_key(index.col_tot_len);
+        size_t num_lower = 0;     // lower_key中由条件确定的列数
+        size_t num_upper = 0;
+        bool lower_open = false;  // 下界是 > 而不是 >=
+        bool upper_open = false;  // 上界是 < 而不是 <=
+        int offset = 0;
+        for (int col_idx : index.cols) {
+            auto &col = cols[col_idx];
+            const Condition *eq_cond = nullptr;
+            const Condition *lower_cond = nullptr;
+            const Condition *upper_cond = nullptr;
+            for (auto &cond : conds) {
+                if (!cond.is_rhs_val || cond.op == OP_NE || cond.lhs_col.col_name != col.name) {
+                    continue;
+                }
+                if (cond.op == OP_EQ) {
+                    eq_cond = &cond;
+                } else if (cond.op == OP_GT || cond.op == OP_GE) {
+                    lower_cond = &cond;
+                } else if (cond.op == OP_LT || cond.op == OP_LE) {
+                    upper_cond = &cond;
+                } else {
+                    throw InternalError("Unexpected op type");
+                }
+            }
+            if (eq_cond != nullptr) {
+                memcpy(lower_key.data() + offset, eq_cond->rhs_val.raw->data, col.len);
+                memcpy(upper_key.data() + offset, eq_cond->rhs_val.raw->data, col.len);
+                num_lower++;
+                num_upper++;
+                offset += col.len;
+                continue;
+            }
+            if (lower_cond != nullptr) {
+                memcpy(lower_key.data() + offset, lower_cond->rhs_val.raw->data, col.len);
+                num_lower++;
+                lower_open = lower_cond->op == OP_GT;
+            }
+            if (upper_cond != nullptr) {
+                memcpy(upper_key.data() + offset, upper_cond->rhs_val.raw->data, col.len);
+                num_upper++;
+                upper_open = upper_cond->op == OP_LT;
+            }
+            break;
+        }
+        if (offset == index.col_tot_len && !ih->may_contain(lower_key.data())) {
+            // 所有索引列上都是等值条件，Bloom filter排除了这个key，不用查找上下界
+            *lower = *upper = ih->leaf_end();
+            return;
+        }
+        if (num_lower > 0) {
+            // > v 时其后的列填最大值，跳过所有以v为前缀的key
+            fill_key(lower_key.data(), index, cols, num_lower, lower_open);
+            *lower = lower_open ? ih->upper_bound(lower_key.data()) : ih->lower_bound(lower_key.data());
+        } else {
+            *lower = ih->leaf_begin();
+        }
+        if (num_upper > 0) {
+            fill_key(upper_key.data(), index, cols, num_upper, !upper_open);
+            *upper = upper_open ? ih->lower_bound(upper_key.data()) : ih->upper_bound(upper_key.data());
+        } else {
+            *upper = ih->leaf_end();
+        }
+        if (num_lower > 0 && num_upper > 0) {
+            // 条件矛盾时（如 a > 5 and a < 3）下界在上界之后，扫描范围为空
+            int cmp = ix_compare(lower_key.data(), upper_key.data(), ih->get_file_hdr());
+            if (cmp > 0 || (cmp == 0 && (lower_open || upper_open))) {
+                *lower = *upper;
+            }
+        }
+    }
+
+   private:
+    // 把key中从第from_col个索引列开始的各列填为该列类型的最大值（is_max）或最小值
+    static void fill_key(char *key, const IndexMeta &index, const std::vector<ColMeta> &cols, size_t from_col,
+                         bool is_max) {
+        int offset = 0;
+        for (size_t i = 0; i < index.cols.size(); i++) {
+            auto &col = cols[index.cols[i]];
+            if (i >= from_col) {
+                char *dst = key + offset;
+                if (col.type == TYPE_INT) {
+                    int val = is_max ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+                    memcpy(dst, &val, sizeof(int));
+                } else if (col.type == TYPE_FLOAT) {
+                    float val = is_max ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+                    memcpy(dst, &val, sizeof(float));
+                } else {
+                    // 字符串按memcmp比较
+                    memset(dst, is_max ? 0xff : 0, col.len);
+                }
+            }
+            offset += col.len;
+        }
+    }
+
+    // 当前扫描位置，聚簇表中是IxScan的iid
+    Rid scan_pos() const {
+        if (pk_ih_ != nullptr) {
+            auto &iid = static_cast<IxScan *>(scan_.get())->iid();
+            return Rid{iid.page_no, iid.slot_no};
+        }
+        return scan_->rid();
+    }
+
+   protected:
+    // 读取rid_（即扫描的当前位置）处的记录：聚簇表扫描主键索引时直接从叶子结点复制，扫描二级索引时先读出主键再查主键索引
+    virtual std::unique_ptr<RmRecord> get_record() {
+        if (pk_ih_ == nullptr) {
+            return fh_->get_record(rid_, context_);
+        }
+        std::unique_ptr<RmRecord> rec(new RmRecord(len_, arena()));
+        auto scan = static_cast<IxScan *>(scan_.get());
+        if (is_pk_index_) {
+            scan->get_val(rec->data);
+            return rec;
+        }
+        int num = pk_batch_found_.size();
+        if (rid_.page_no != pk_batch_page_ || rid_.slot_no < pk_batch_first_ || rid_.slot_no >= pk_batch_first_ + num) {
+            fetch_pk_batch();
+        }
+        int i = rid_.slot_no - pk_batch_first_;
+        if (!pk_batch_found_[i]) {
+            throw IndexEntryNotFoundError();
+        }
+        memcpy(rec->data, pk_batch_recs_.data() + i * len_, len_);
+        return rec;
+    }
+
+   private:
+    // 读出当前叶子中余下的主键，排序后在主键索引中批量查找（GetValues复用相邻key的查找路径），
+    // 而不是每条记录都从主键索引的根结点查找一次
+    void fetch_pk_batch() {
+        auto scan = static_cast<IxScan *>(scan_.get());
+        std::vector<char> pks;
+        pk_batch_page_ = rid_.page_no;
+        pk_batch_first_ = scan->leaf_vals(&pks);
+        size_t pk_len = pk_buf_.size();
+        size_t num = pks.size() / pk_len;
+        std::vector<const char *> keys(num);
+        for (size_t i = 0; i < num; i++) {
+            keys[i] = pks.data() + i * pk_len;
+        }
+        auto &pk_hdr = pk_ih_->get_file_hdr();
+        std::sort(keys.begin(), keys.end(),
+                  [&](const char *a, const char *b) { return ix_compare(a, b, pk_hdr) < 0; });
+        size_t val_len = pk_hdr.val_len;
+        std::vector<char> recs(num * val_len);
+        std::vector<bool> found;
+        pk_ih_->GetValues(keys, recs.data(), &found, context_->txn_);
+        // 恢复成叶子中的顺序
+        pk_batch_recs_.resize(num * len_);
+        pk_batch_found_.assign(num, false);
+        for (size_t j = 0; j < num; j++) {
+            size_t i = (keys[j] - pks.data()) / pk_len;
+            memcpy(pk_batch_recs_.data() + i * len_, recs.data() + j * val_len, len_);
+            pk_batch_found_[i] = found[j];
+        }
+    }
 };
\ No newline at end of file
@@ -23,8 +23,8 @@ class InsertExecutor : public AbstractExecutor {
         if (values.size() != tab_.cols.size()) {
             throw InvalidValueCountError();
         }
-        // Get record file handle
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        // 记录文件在Next()中确定：聚簇表没有记录文件，分区表要按记录的分区键选择分区
+        fh_ = nullptr;
         context_ = context;
     };
 
@@ -34,7 +34,7 @@ class InsertExecutor : public AbstractExecutor {
         // Insert into record file
         // Insert into index
 
-        RmRecord rec(fh_->get_file_hdr().record_size);
+        RmRecord rec(tab_.cols.back().offset + tab_.cols.back().len);
         for (size_t i = 0; i < values_.size(); i++) {
             auto &col = tab_.cols[i];
             auto &val = values_[i];
@@ -44,22 +44,36 @@ class InsertExecutor : public AbstractExecutor {
             val.init_raw(col.len);
             memcpy(rec.data + col.offset, val.raw->data, col.len);
         }
+        if (tab_.is_clustered()) {
+            // 记录插入主键索引的叶子结点，二级索引由SmManager一并维护
+            sm_manager_->clustered_insert(tab_name_, rec.data, context_);
+            context_->txn_->AppendWriteRecord(new WriteRecord(WType::INSERT_TUPLE, tab_name_, std::move(rec)));
+            return nullptr;
+        }
+        // Get record file handle（分区表的每个分区有自己的记录文件和索引）
+        int part = tab_.get_part(rec.data);
+        auto part_name = tab_.get_part_name(part);
+        fh_ = sm_manager_->fhs_.at(part_name).get();
         // Insert into record file
         rid_ = fh_->insert_record(rec.data, context_);
 
-        // Transaction insert
-        WriteRecord *wr = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_);
+        // Transaction insert（分区表的写集合记录表名和分区号）
+        WriteRecord *wr = new WriteRecord(WType::INSERT_TUPLE, tab_name_, rid_, part);
         context_->txn_->AppendWriteRecord(wr);
 
         // Insert into index
-        for (size_t i = 0; i < tab_.cols.size(); i++) {
-            auto &col = tab_.cols[i];
-            if (col.index) {
-                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, i)).get();//返回的是IxIndexhandle
-                ih->insert_entry(rec.data + col.offset, rid_, context_->txn_);//rec.data + col.offset指向的是key的字段，也即向b+树中插入字段(key,value)，其中value是rid_
-            }
-
+        std::vector<char> key_buf;
+        std::vector<char> val_buf;
+        for (auto &index : tab_.get_indexes()) {
+            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(part_name, index.cols)).get();//返回的是IxIndexhandle
+            key_buf.resize(index.col_tot_len);
+            val_buf.resize(ih->get_file_hdr().val_len);
+            // key指向记录中索引列的字段（组合索引拼接在key_buf中），也即向b+树中插入字段(key,value)，其中value是rid_（及INCLUDE列）
+            ih->insert_entry(tab_.get_index_key(index, rec.data, key_buf.data()),
+                             tab_.get_index_val(index, rec.data, rid_, val_buf.data()), context_->txn_);
         }
+        // 正在CREATE INDEX CONCURRENTLY的索引
+        sm_manager_->capture_index_change(tab_, part, rid_, nullptr, rec.data, context_);
 
         // lab3 task3 Todo end
         return nullptr;
@@ -0,0 +1,54 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief LIMIT算子：只输出子算子的前limit个元组
+ * @note 达到limit后不再调用子算子的nextTuple，按索引顺序（或反向）扫描时只读取开头的几个页面
+ */
+class LimitExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;
+    size_t limit_;
+    size_t count_ = 0;  // 已经输出的元组数
+
+   public:
+    LimitExecutor(std::unique_ptr<AbstractExecutor> prev, size_t limit) : prev_(std::move(prev)), limit_(limit) {
+        context_ = prev_->context_;
+    }
+
+    std::string getType() override { return "Limit"; }
+
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    void beginTuple() override {
+        count_ = 0;
+        if (limit_ > 0) {
+            prev_->beginTuple();
+        }
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        count_++;
+        if (count_ < limit_) {
+            prev_->nextTuple();
+        }
+    }
+
+    bool is_end() const override { return count_ >= limit_ || prev_->is_end(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return prev_->Next();
+    }
+
+    void feed(const std::map<TabCol, Value> &feed_dict) override { throw InternalError("Cannot feed a limit node"); }
+
+    Rid &rid() override { return _abstract_rid; }
+};
@@ -12,13 +12,14 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
     size_t len_;
     std::vector<ColMeta> cols_;
 
-    std::map<TabCol, Value> prev_feed_dict_;
+    std::map<TabCol, Value> feed_dict_;  // 喂给右子算子的<列,值>，各外层元组复用同一个map
 
    public:
     NestedLoopJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right) {
         // 设置左右孩子
         left_ = std::move(left);
         right_ = std::move(right);
+        context_ = left_->context_;
         // 得到连接(笛卡尔积)结果元组的长度
         len_ = left_->tupleLen() + right_->tupleLen();
         // 默认以左孩子作为outer table
@@ -81,7 +82,7 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
 
     std::unique_ptr<RmRecord> Next() override {
         assert(!is_end());
-        auto record = std::make_unique<RmRecord>(len_);
+        auto record = std::make_unique<RmRecord>(len_, arena());
         // lab3 task2 Todo
         // 你需要调用左右算子的Next()获取下一个记录进行拼接赋给返回的连接结果std::make_unique<RmRecord>record中
         // memecpy()可能对你有所帮助
@@ -99,21 +100,22 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
 
     // 递归更新条件谓词
     void feed(const std::map<TabCol, Value> &feed_dict) override {
-        prev_feed_dict_ = feed_dict;
+        feed_dict_ = feed_dict;
         left_->feed(feed_dict);
     }
 
     // 默认以right 作inner table
     void feed_right() {
-        // 将左子算子的ColMeta数组和对应的下一个元组转换成<TabCol,Value>的map
-        // 每一个表列和其对应的Value相对应
-        auto left_dict = rec2dict(left_->cols(), left_->Next().get());
-        auto feed_dict = prev_feed_dict_;
-        // 将左子算子的<列,值>map中的KV对增加到prev_feed_dict_(feed_dict)中
-        feed_dict.insert(left_dict.begin(), left_dict.end());
-        // 右子算子调用feed,对当前的feed_dict
+        // 将左子算子的ColMeta数组和对应的下一个元组转换成<TabCol,Value>，写入feed_dict_
+        // feed_dict_中已有上层feed下来的KV对；左子算子的列第一次插入，之后原地覆盖
+        {
+            // 左子算子的元组取完值即回收，否则每个外层元组都会留在arena中直到语句结束
+            ArenaScope arena_scope(arena());
+            rec2dict(left_->cols(), left_->Next().get(), &feed_dict_);
+        }
+        // 右子算子调用feed,对当前的feed_dict_
         // 重置右子算子的连接条件
-        right_->feed(feed_dict);
+        right_->feed(feed_dict_);
     }
 
     Rid &rid() override { return _abstract_rid; }
@@ -15,6 +15,7 @@ class ProjectionExecutor : public AbstractExecutor {
    public:
     ProjectionExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &sel_cols) {
         prev_ = std::move(prev);
+        context_ = prev_->context_;
 
         size_t curr_offset = 0;
         auto &prev_cols = prev_->cols();
@@ -49,7 +50,7 @@ class ProjectionExecutor : public AbstractExecutor {
         auto &prev_cols = prev_->cols();
         auto prev_rec = prev_->Next();
         auto &proj_cols = cols_;
-        auto proj_rec = std::make_unique<RmRecord>(len_);
+        auto proj_rec = std::make_unique<RmRecord>(len_, arena());
         for (size_t proj_idx = 0; proj_idx < proj_cols.size(); proj_idx++) {
             size_t prev_idx = sel_idxs_[proj_idx];
             auto &prev_col = prev_cols[prev_idx];
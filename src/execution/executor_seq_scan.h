@@ -11,22 +11,30 @@ class SeqScanExecutor : public AbstractExecutor {
     std::string tab_name_;
     std::vector<Condition> conds_;  // 初始扫描条件(来自SQL)
     RmFileHandle *fh_;              // TableHeap
+    IxIndexHandle *ih_ = nullptr;   // 聚簇表的主键索引，记录保存在它的叶子结点中
     std::vector<ColMeta> cols_;
     size_t len_;
     std::vector<Condition> fed_conds_;  // 实际扫描条件(可能由于连接运算动态改变)
 
-    Rid rid_;                        // 当前扫描到的记录的rid
+    Rid rid_;                        // 当前扫描到的记录的rid（聚簇表中是记录在主键索引叶子结点中的位置）
     std::unique_ptr<RecScan> scan_;  // table_iterator
 
     SmManager *sm_manager_;
 
    public:
-    SeqScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, Context *context) {
+    // 分区表上只扫描第part个分区，各分区的扫描由AppendExecutor拼接起来
+    SeqScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, Context *context,
+                    int part = 0) {
         sm_manager_ = sm_manager;
         tab_name_ = std::move(tab_name);
         conds_ = std::move(conds);
         TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        if (tab.is_clustered()) {
+            fh_ = nullptr;
+            ih_ = sm_manager_->get_clustered_index(tab_name_);
+        } else {
+            fh_ = sm_manager_->fhs_.at(tab.get_part_name(part)).get();
+        }
         cols_ = tab.cols;
         len_ = cols_.back().offset + cols_.back().len;
         context_ = context;
@@ -55,13 +63,19 @@ class SeqScanExecutor : public AbstractExecutor {
     void beginTuple() override {
         check_runtime_conds();
 
-        scan_ = std::make_unique<RmScan>(fh_);
+        if (ih_ != nullptr) {
+            // 聚簇表按主键顺序遍历叶子结点
+            scan_ = std::make_unique<IxScan>(ih_, ih_->leaf_begin(), ih_->leaf_end(), sm_manager_->get_bpm());
+        } else {
+            scan_ = std::make_unique<RmScan>(fh_);
+        }
 
         // 得到第一个满足fed_conds_条件的record,并把其rid赋给算子成员rid_
         while (!scan_->is_end()) {
-            rid_ = scan_->rid();
+            rid_ = scan_pos();
             try {
-                auto rec = fh_->get_record(rid_, context_);  // TableHeap->GetTuple() 当前扫描到的记录
+                ArenaScope arena_scope(arena());  // 被判定的记录用完即回收
+                auto rec = get_record();  // TableHeap->GetTuple() 当前扫描到的记录
                 // lab3 task2 todo
                 // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
                 // 满足则中止循环
@@ -76,8 +90,6 @@ class SeqScanExecutor : public AbstractExecutor {
 
             scan_->next();  // 找下一个有record的位置
         }
-        auto now = fh_->get_record(rid_, context_);
-
     }
 
     void nextTuple() override {
@@ -88,9 +100,10 @@ class SeqScanExecutor : public AbstractExecutor {
             // 获取当前记录(参考beginTuple())赋给算子成员rid_
             // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
             // 满足则中止循环
-            rid_ = scan_->rid();
+            rid_ = scan_pos();
             // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
-            auto rec = fh_->get_record(rid_, context_); 
+            ArenaScope arena_scope(arena());
+            auto rec = get_record();
             // 满足则中止循环
             // printf("进入了一次eval_conds,全部比较\n");
             if(eval_conds(cols_, fed_conds_, rec.get())){
@@ -100,8 +113,6 @@ class SeqScanExecutor : public AbstractExecutor {
              
             // lab3 task2 todo End
         }
-        auto now = fh_->get_record(rid_, context_);
-        // printf("目前记录为%s\n",now.get()->data+4);        
     }
 
     bool is_end() const override { return scan_->is_end(); }
@@ -113,7 +124,7 @@ class SeqScanExecutor : public AbstractExecutor {
     std::unique_ptr<RmRecord> Next() override {
         // lab3 task2 todo
         // 利用fh_得到记录record
-        return fh_->get_record(rid_,context_);
+        return get_record();
         // lab3 task2 todo end
     }
 
@@ -181,4 +192,24 @@ class SeqScanExecutor : public AbstractExecutor {
         return std::all_of(conds.begin(), conds.end(),
                            [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
     }
+
+   private:
+    // 当前扫描位置，聚簇表中是IxScan的iid
+    Rid scan_pos() const {
+        if (ih_ != nullptr) {
+            auto &iid = static_cast<IxScan *>(scan_.get())->iid();
+            return Rid{iid.page_no, iid.slot_no};
+        }
+        return scan_->rid();
+    }
+
+    // 读取rid_（即扫描的当前位置）处的记录，聚簇表从主键索引pin住的叶子结点中复制
+    std::unique_ptr<RmRecord> get_record() {
+        if (ih_ == nullptr) {
+            return fh_->get_record(rid_, context_);
+        }
+        std::unique_ptr<RmRecord> rec(new RmRecord(len_, arena()));
+        static_cast<IxScan *>(scan_.get())->get_val(rec->data);
+        return rec;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief 排序算子：读出子算子的所有元组，按ORDER BY的各列排序后依次输出
+ * @note 列的比较方式与索引中key的顺序相同（ix_compare），所以和按索引顺序扫描得到的结果一致
+ */
+class SortExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;
+    std::vector<ColMeta> order_cols_;  // 排序列在子算子元组中的位置
+    std::vector<bool> order_desc_;     // 各排序列是否降序
+    std::vector<std::unique_ptr<RmRecord>> tuples_;
+    size_t pos_ = 0;
+
+   public:
+    SortExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<OrderByCol> &order_cols) {
+        prev_ = std::move(prev);
+        context_ = prev_->context_;
+        for (auto &order_col : order_cols) {
+            order_cols_.push_back(*get_col(prev_->cols(), order_col.col));
+            order_desc_.push_back(order_col.desc);
+        }
+    }
+
+    std::string getType() override { return "Sort"; }
+
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    void beginTuple() override {
+        tuples_.clear();
+        for (prev_->beginTuple(); !prev_->is_end(); prev_->nextTuple()) {
+            ArenaScope arena_scope(arena());  // 子算子的元组复制出来后即回收
+            tuples_.push_back(std::make_unique<RmRecord>(*prev_->Next()));
+        }
+        std::stable_sort(tuples_.begin(), tuples_.end(),
+                         [&](const std::unique_ptr<RmRecord> &x, const std::unique_ptr<RmRecord> &y) {
+                             for (size_t i = 0; i < order_cols_.size(); i++) {
+                                 auto &col = order_cols_[i];
+                                 int cmp = ix_compare(x->data + col.offset, y->data + col.offset, col.type, col.len);
+                                 if (cmp != 0) {
+                                     return order_desc_[i] ? cmp > 0 : cmp < 0;
+                                 }
+                             }
+                             return false;
+                         });
+        pos_ = 0;
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        pos_++;
+    }
+
+    bool is_end() const override { return pos_ >= tuples_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        auto rec = std::make_unique<RmRecord>(tuples_[pos_]->size, arena());
+        memcpy(rec->data, tuples_[pos_]->data, rec->size);
+        return rec;
+    }
+
+    void feed(const std::map<TabCol, Value> &feed_dict) override { throw InternalError("Cannot feed a sort node"); }
+
+    Rid &rid() override { return _abstract_rid; }
+};
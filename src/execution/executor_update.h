@@ -11,67 +11,99 @@ class UpdateExecutor : public AbstractExecutor {
     std::vector<Condition> conds_;
     RmFileHandle *fh_;
     std::vector<Rid> rids_;
+    std::vector<RmRecord> recs_;  // 聚簇表没有rid，直接保存要修改的记录
     std::string tab_name_;
+    int part_ = 0;
+    std::string part_name_;  // 记录所在分区的存储名，不分区的表就是表名
     std::vector<SetClause> set_clauses_;
     SmManager *sm_manager_;
 
    public:
+    // 分区表上rids都是第part个分区中的记录
     UpdateExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<SetClause> set_clauses,
-                   std::vector<Condition> conds, std::vector<Rid> rids, Context *context) {
+                   std::vector<Condition> conds, std::vector<Rid> rids, Context *context, int part = 0) {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         set_clauses_ = set_clauses;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        part_ = part;
+        part_name_ = tab_.get_part_name(part);
+        fh_ = sm_manager_->fhs_.at(part_name_).get();
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
+
+    UpdateExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<SetClause> set_clauses,
+                   std::vector<Condition> conds, std::vector<RmRecord> recs, Context *context) {
+        sm_manager_ = sm_manager;
+        tab_name_ = tab_name;
+        set_clauses_ = set_clauses;
+        tab_ = sm_manager_->db_.get_table(tab_name);
+        fh_ = nullptr;
+        conds_ = conds;
+        recs_ = std::move(recs);
+        context_ = context;
+    }
     std::unique_ptr<RmRecord> Next() override {
-        // Get all necessary index files
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
-        for (auto &set_clause : set_clauses_) {
-            auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
-            if (lhs_col->index) {
-                size_t lhs_col_idx = lhs_col - tab_.cols.begin();
+        if (tab_.is_clustered()) {
+            update_clustered();
+            return nullptr;
+        }
+        // Get all necessary index files（包含被修改的列的索引，INCLUDE列被修改时也要更新叶子结点中的值）
+        std::vector<IndexMeta> indexes;
+        std::vector<IxIndexHandle *> ihs;
+        for (auto &index : tab_.get_indexes()) {
+            bool is_set = std::any_of(set_clauses_.begin(), set_clauses_.end(), [&](const SetClause &set_clause) {
+                int lhs_col_idx = tab_.get_col(set_clause.lhs.col_name) - tab_.cols.begin();
+                return index.covers(lhs_col_idx);
+            });
+            if (is_set) {
                 // lab3 task3 Todo
                 // 获取需要的索引句柄,填充vector ihs
-                 ihs[lhs_col_idx] = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, lhs_col_idx)).get();
+                indexes.push_back(index);
+                ihs.push_back(get_index(part_name_, index));
                 // lab3 task3 Todo end
             }
         }
+        std::vector<char> key_buf;
+        std::vector<char> val_buf;
         // Update each rid from record file and index file
         for (auto &rid : rids_) {
+            ArenaScope arena_scope(arena());
             auto rec = fh_->get_record(rid, context_);
             //auto tuple = fh_->get_record(rid,context_);
             //auto tuple_ptr = tuple.get();
+
+            // 新记录在arena中构造，旧记录rec原样保留，稍后移入写集合
+            RmRecord new_rec(rec->size, arena());
+            memcpy(new_rec.data, rec->data, rec->size);
+            for(auto &set_clause : set_clauses_) {
+                auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
+                memcpy(new_rec.data + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+            }
+            int new_part = tab_.get_part(new_rec.data);
+            if (new_part != part_) {
+                move_to_part(rid, std::move(*rec), new_rec.data, new_part);
+                continue;
+            }
              
             // lab3 task3 Todo
             // Remove old entry from index
-            for(size_t i = 0; i < tab_.cols.size(); i++) {
-                auto &col = tab_.cols[i];
-                if(ihs[i]) {
-                    ihs[i]->delete_entry(rec->data + col.offset, context_->txn_);
-                }
+            for(size_t i = 0; i < indexes.size(); i++) {
+                key_buf.resize(indexes[i].col_tot_len);
+                ihs[i]->delete_entry(tab_.get_index_key(indexes[i], rec->data, key_buf.data()), context_->txn_);
             }
 
             // lab3 task3 Todo end
 
-            // record a update operation into the transaction
-            RmRecord update_record(*rec);
-            //memcpy(update_record.data, rec->data, rec->size);
-
             // lab3 task3 Todo
             // Update record in record file
-            for(auto &set_clause : set_clauses_) {
-                auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
-                memcpy(rec->data + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
-            }
-            fh_->update_record(rid, rec->data, context_);
+            fh_->update_record(rid, new_rec.data, context_);
+            sm_manager_->capture_index_change(tab_, part_, rid, rec->data, new_rec.data, context_);
  
-             // record a update operation into the transaction
-            //RmRecord update_record(*rec);
-            auto* writeRecord = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, rid, update_record);
+            // record a update operation into the transaction
+            auto* writeRecord = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, rid, std::move(*rec), part_);
             context_->txn_->AppendWriteRecord(writeRecord);
 
             //WriteRecord *wr = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, rid, *rec);
@@ -81,11 +113,11 @@ class UpdateExecutor : public AbstractExecutor {
 
             // lab3 task3 Todo
             // Insert new entry into index
-             for(size_t i = 0; i < tab_.cols.size(); i++) {
-                auto &col = tab_.cols[i];
-                if(ihs[i]) {
-                    ihs[i]->insert_entry(rec->data + col.offset, rid, context_->txn_);
-                }
+            for(size_t i = 0; i < indexes.size(); i++) {
+                key_buf.resize(indexes[i].col_tot_len);
+                val_buf.resize(ihs[i]->get_file_hdr().val_len);
+                ihs[i]->insert_entry(tab_.get_index_key(indexes[i], new_rec.data, key_buf.data()),
+                                     tab_.get_index_val(indexes[i], new_rec.data, rid, val_buf.data()), context_->txn_);
             }
  
  
@@ -94,4 +126,56 @@ class UpdateExecutor : public AbstractExecutor {
         return nullptr;
     }
     Rid &rid() override { return _abstract_rid; }
+
+   private:
+    IxIndexHandle *get_index(const std::string &part_name, const IndexMeta &index) {
+        return sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(part_name, index.cols)).get();
+    }
+
+    // 分区键被修改后记录属于另一个分区：从本分区的记录文件和索引中删除，再插入新分区，写集合中记为先删除后插入
+    void move_to_part(const Rid &rid, RmRecord old_rec, char *new_rec, int new_part) {
+        auto indexes = tab_.get_indexes();
+        std::vector<char> key_buf;
+        for (auto &index : indexes) {
+            key_buf.resize(index.col_tot_len);
+            get_index(part_name_, index)
+                ->delete_entry(tab_.get_index_key(index, old_rec.data, key_buf.data()), context_->txn_);
+        }
+        fh_->delete_record(rid, context_);
+        sm_manager_->capture_index_change(tab_, part_, rid, old_rec.data, nullptr, context_);
+        context_->txn_->AppendWriteRecord(new WriteRecord(WType::DELETE_TUPLE, tab_name_, rid, std::move(old_rec), part_));
+
+        auto new_part_name = tab_.get_part_name(new_part);
+        Rid new_rid = sm_manager_->fhs_.at(new_part_name)->insert_record(new_rec, context_);
+        context_->txn_->AppendWriteRecord(new WriteRecord(WType::INSERT_TUPLE, tab_name_, new_rid, new_part));
+        std::vector<char> val_buf;
+        for (auto &index : indexes) {
+            auto ih = get_index(new_part_name, index);
+            key_buf.resize(index.col_tot_len);
+            val_buf.resize(ih->get_file_hdr().val_len);
+            ih->insert_entry(tab_.get_index_key(index, new_rec, key_buf.data()),
+                             tab_.get_index_val(index, new_rec, new_rid, val_buf.data()), context_->txn_);
+        }
+        sm_manager_->capture_index_change(tab_, new_part, new_rid, nullptr, new_rec, context_);
+    }
+
+    // 聚簇表的修改由SmManager::clustered_update完成；主键被修改时记录移动了位置，写集合中记为先删除后插入
+    void update_clustered() {
+        auto &pk = tab_.cols[tab_.pk_col];
+        for (auto &rec : recs_) {
+            RmRecord new_rec(rec.size);
+            memcpy(new_rec.data, rec.data, rec.size);
+            for (auto &set_clause : set_clauses_) {
+                auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
+                memcpy(new_rec.data + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+            }
+            sm_manager_->clustered_update(tab_name_, rec.data, new_rec.data, context_);
+            if (memcmp(rec.data + pk.offset, new_rec.data + pk.offset, pk.len) == 0) {
+                context_->txn_->AppendWriteRecord(new WriteRecord(WType::UPDATE_TUPLE, tab_name_, std::move(rec)));
+            } else {
+                context_->txn_->AppendWriteRecord(new WriteRecord(WType::DELETE_TUPLE, tab_name_, std::move(rec)));
+                context_->txn_->AppendWriteRecord(new WriteRecord(WType::INSERT_TUPLE, tab_name_, std::move(new_rec)));
+            }
+        }
+    }
 };
\ No newline at end of file
@@ -80,12 +80,13 @@ class InterpForTest {
         } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(root)) {
             // create index;
 
-            sm_manager_->create_index(x->tab_name, x->col_name, context);
+            sm_manager_->create_index(x->tab_name, x->col_names, context, x->blink, x->include_cols, x->hash,
+                                      x->concurrently, x->num_threads > 0 ? x->num_threads : INDEX_BUILD_THREADS);
 
         } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(root)) {
             // drop index
 
-            sm_manager_->drop_index(x->tab_name, x->col_name, context);
+            sm_manager_->drop_index(x->tab_name, x->col_names, context);
 
         } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
             // insert;
@@ -123,7 +124,7 @@ class InterpForTest {
                 sel_cols.push_back(sel_col);
             }
 
-            ql_manager_->select_from(sel_cols, x->tabs, conds, context);
+            ql_manager_->select_from(sel_cols, x->tabs, conds, context, interp_order_by(x->orders), x->limit);
 
         } else {
             throw InternalError("Unexpected AST root");
@@ -176,4 +177,13 @@ class InterpForTest {
         }
         return conds;
     }
+    std::vector<OrderByCol> interp_order_by(const std::vector<std::shared_ptr<ast::OrderBy>> &sv_orders) {
+        std::vector<OrderByCol> order_cols;
+        for (auto &sv_order : sv_orders) {
+            OrderByCol order_col = {.col = {.tab_name = sv_order->col->tab_name, .col_name = sv_order->col->col_name},
+                                    .desc = sv_order->dir == ast::SV_ORDER_DESC};
+            order_cols.push_back(order_col);
+        }
+        return order_cols;
+    }
 };
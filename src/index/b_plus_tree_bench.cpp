@@ -0,0 +1,153 @@
+/**
+ * @brief int索引点查的微基准：比较结点内查找的几种方式，以及整个索引上GetValue的吞吐量
+ *
+ * 用法：b_plus_tree_bench [key的个数] [点查次数]
+ * 1. 结点内查找：在一个结点大小的有序key数组上分别用按类型比较的二分查找、无分支二分查找、AVX2顺序比较
+ * 2. 索引点查：在批量建好的int索引上随机GetValue，分别按整数查找（默认）和按类型比较（旧的未编码索引文件的方式）
+ */
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+#define private public
+#include "ix.h"
+#include "ix_search.h"
+#undef private
+
+#include "storage/buffer_pool_manager.h"
+
+const std::string BENCH_DB_NAME = "BPlusTreeBench_db";
+const std::string BENCH_FILE_NAME = "table1";
+
+// 执行fn并返回每秒执行的次数
+static double ops_per_sec(int num_ops, const std::function<void()> &fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_ops / elapsed.count();
+}
+
+// 在n个编码后的int key上比较结点内的几种查找方式
+static void bench_node_search(int n, int num_lookups) {
+    std::vector<char> keys(n * sizeof(int));
+    std::vector<int> values(n);
+    for (int i = 0; i < n; i++) {
+        values[i] = i * 2 - n;  // 有负数，编码后仍然有序
+        ix_encode_col(reinterpret_cast<const char *>(&values[i]), keys.data() + i * sizeof(int), TYPE_INT,
+                      sizeof(int));
+    }
+    std::default_random_engine rng(n);
+    std::uniform_int_distribution<int> dist(-n - 1, n + 1);
+    std::vector<uint32_t> targets(num_lookups);  // 编码后的target
+    std::vector<int> raw_targets(num_lookups);
+    for (int i = 0; i < num_lookups; i++) {
+        raw_targets[i] = dist(rng);
+        char buf[sizeof(int)];
+        ix_encode_col(reinterpret_cast<const char *>(&raw_targets[i]), buf, TYPE_INT, sizeof(int));
+        targets[i] = ix_load_be32(buf);
+    }
+
+    long checksum = 0;
+    // 未编码的key数组上按类型比较的二分查找
+    double scalar = ops_per_sec(num_lookups, [&]() {
+        const char *raw_keys = reinterpret_cast<const char *>(values.data());
+        for (int i = 0; i < num_lookups; i++) {
+            const char *target = reinterpret_cast<const char *>(&raw_targets[i]);
+            int lo = 0, hi = n;
+            while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (ix_compare(raw_keys + mid * sizeof(int), target, TYPE_INT, sizeof(int)) < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            checksum += lo;
+        }
+    });
+    double branchless = ops_per_sec(num_lookups, [&]() {
+        for (int i = 0; i < num_lookups; i++) {
+            checksum += ix_branchless_search<uint32_t, false>(keys.data(), 0, n, targets[i]);
+        }
+    });
+    printf("node search, %4d keys: typed binary %10.0f/s, branchless binary %10.0f/s", n, scalar, branchless);
+#ifdef IX_HAVE_AVX2_SEARCH
+    if (ix_cpu_has_avx2()) {
+        double simd = ops_per_sec(num_lookups, [&]() {
+            for (int i = 0; i < num_lookups; i++) {
+                checksum += ix_simd_search<uint32_t, false>(keys.data(), 0, n, targets[i]);
+            }
+        });
+        printf(", avx2 linear %10.0f/s", simd);
+    }
+#endif
+    printf("  (checksum %ld)\n", checksum);
+}
+
+// 在有num_keys个key的int索引上随机点查num_lookups次
+static void bench_index_lookup(int num_keys, int num_lookups) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(8192, disk_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    Transaction txn(0);
+
+    for (bool normalized : {true, false}) {
+        if (ix_manager->exists(BENCH_FILE_NAME, 0)) {
+            ix_manager->destroy_index(BENCH_FILE_NAME, 0);
+        }
+        ix_manager->create_index(BENCH_FILE_NAME, 0, TYPE_INT, sizeof(int));
+        auto ih = ix_manager->open_index(BENCH_FILE_NAME, 0);
+        // 不编码的索引文件走按类型比较的查找
+        ih->file_hdr_.normalized = normalized;
+        IxSorter sorter(ih->get_file_hdr(), INDEX_BUILD_SORT_MEMORY, BENCH_FILE_NAME + ".sort");
+        for (int key = 0; key < num_keys; key++) {
+            Rid rid{.page_no = key / 100, .slot_no = key % 100};
+            sorter.add(reinterpret_cast<const char *>(&key), reinterpret_cast<const char *>(&rid));
+        }
+        ih->bulk_load(&sorter, &txn);
+
+        std::default_random_engine rng(num_keys);
+        std::uniform_int_distribution<int> dist(0, num_keys - 1);
+        std::vector<int> targets(num_lookups);
+        for (auto &target : targets) {
+            target = dist(rng);
+        }
+        size_t found = 0;
+        double throughput = ops_per_sec(num_lookups, [&]() {
+            std::vector<Rid> rids;
+            for (int key : targets) {
+                rids.clear();
+                found += ih->GetValue(reinterpret_cast<const char *>(&key), &rids, &txn);
+            }
+        });
+        printf("index lookup, %d keys, %s: %10.0f lookups/s (%zu found)\n", num_keys,
+               normalized ? "integer search" : "typed compare", throughput, found);
+        ix_manager->close_index(ih.get());
+        ix_manager->destroy_index(BENCH_FILE_NAME, 0);
+    }
+}
+
+int main(int argc, char **argv) {
+    int num_keys = argc > 1 ? atoi(argv[1]) : 1000000;
+    int num_lookups = argc > 2 ? atoi(argv[2]) : 1000000;
+
+    DiskManager disk_manager;
+    if (!disk_manager.is_dir(BENCH_DB_NAME)) {
+        disk_manager.create_dir(BENCH_DB_NAME);
+    }
+    if (chdir(BENCH_DB_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+    for (int n : {16, 32, 64, 128, 340}) {
+        bench_node_search(n, num_lookups);
+    }
+    bench_index_lookup(num_keys, num_lookups);
+    if (chdir("..") < 0) {
+        throw UnixError();
+    }
+    return 0;
+}
@@ -22,6 +22,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -97,6 +98,15 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
         assert(disk_manager_->is_dir(TEST_DB_NAME));
     };
 
+    // 把测试文件重新建成B-link树
+    void UseBLink() {
+        ix_manager_->close_index(ih_.get());
+        ix_manager_->destroy_index(TEST_FILE_NAME, index_no);
+        ix_manager_->create_index(TEST_FILE_NAME, index_no, TYPE_INT, sizeof(int), sizeof(Rid), true);
+        ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+        assert(ih_->file_hdr_.blink);
+    }
+
     void ToGraph(const IxIndexHandle *ih, IxNodeHandle *node, BufferPoolManager *bpm, std::ofstream &out) const {
         std::string leaf_prefix("LEAF_");
         std::string internal_prefix("INT_");
@@ -274,6 +284,39 @@ void DeleteHelper(IxIndexHandle *tree, const std::vector<int64_t> &keys,
     delete transaction;
 }
 
+// helper function for the throughput benchmark: 80%查找，其余为插入和删除，每个线程只插入和删除属于自己的key
+void MixedHelper(IxIndexHandle *tree, int64_t preload, int64_t num_ops, uint64_t num_threads, uint64_t thread_itr) {
+    Transaction *transaction = new Transaction(0);
+    std::default_random_engine rng(thread_itr);
+
+    std::vector<int64_t> own_keys;  // 本线程插入但还没有删除的key
+    int64_t next_key = preload + 1 + thread_itr;
+    std::vector<Rid> rids;
+    for (int64_t i = 0; i < num_ops; i++) {
+        int op = rng() % 10;
+        if (op < 8) {
+            int64_t key = rng() % preload + 1;
+            rids.clear();
+            tree->GetValue((const char *)&key, &rids, transaction);
+            EXPECT_EQ(rids.size(), 1);
+        } else if (op == 8 || own_keys.empty()) {
+            Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(next_key)};
+            EXPECT_TRUE(tree->insert_entry((const char *)&next_key, rid, transaction));
+            own_keys.push_back(next_key);
+            next_key += num_threads;
+        } else {
+            int64_t key = own_keys.back();
+            own_keys.pop_back();
+            EXPECT_TRUE(tree->delete_entry((const char *)&key, transaction));
+        }
+    }
+    for (auto key : own_keys) {
+        tree->delete_entry((const char *)&key, transaction);
+    }
+
+    delete transaction;
+}
+
 /**
  * @brief concurrent insert 1~10000
  * 
@@ -361,3 +404,165 @@ TEST_F(BPlusTreeConcurrentTest, MixScaleTest) {
     }
     EXPECT_EQ(size, keys.size() - delete_keys.size());
 }
+
+/**
+ * @brief 并发插入时Bloom filter不能丢key：filter加满后由某个插入重建，其他线程已加入filter、还没插入叶子的key不能丢
+ * 每个线程插入后立刻查找自己插入的key
+ */
+TEST_F(BPlusTreeConcurrentTest, BloomFilterInsertStressTest) {
+    const int64_t scale = 40000;
+    const int thread_num = 16;
+    const int order = 255;
+
+    assert(ih_->bloom_enabled());
+    ih_->file_hdr_.btree_order = order;
+
+    std::vector<int64_t> keys;
+    for (int64_t key = 1; key <= scale; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::atomic<int> num_missing{0};
+    auto insert_and_check = [&](uint64_t thread_itr) {
+        Transaction transaction(0);
+        std::vector<Rid> rids;
+        for (size_t i = thread_itr; i < keys.size(); i += thread_num) {
+            int64_t key = keys[i];
+            const char *index_key = (const char *)&key;
+            ih_->insert_entry(index_key, Rid{.page_no = 0, .slot_no = (int)key}, &transaction);
+            rids.clear();
+            if (!ih_->GetValue(index_key, &rids, &transaction) || !ih_->may_contain(index_key)) {
+                num_missing++;
+            }
+        }
+    };
+    LaunchParallelTest(thread_num, insert_and_check);
+    EXPECT_EQ(num_missing.load(), 0);
+    // filter加满过多次，重建之后的filter中也有所有的key
+    EXPECT_GE(ih_->get_bloom().num_keys(), (size_t)scale);
+    for (int64_t key = 1; key <= scale; key++) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih_->GetValue((const char *)&key, &rids, txn_.get()));
+        EXPECT_EQ(rids[0].slot_no, key);
+    }
+}
+
+// 吞吐量测试：在不同线程数下并发执行查找、插入和删除的混合负载，输出每秒完成的操作数
+// 总操作数固定，平均分给各个线程；结束后索引中应当只剩下预先插入的key
+void RunThroughput(IxIndexHandle *tree, BufferPoolManager *bpm) {
+    const int64_t preload = 10000;
+    const int64_t total_ops = 200000;
+
+    std::vector<int64_t> keys;
+    for (int64_t key = 1; key <= preload; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    InsertHelper(tree, keys);
+
+    printf("%8s %12s %12s\n", "threads", "time(ms)", "ops/s");
+    for (uint64_t thread_num : {1, 2, 4, 8, 16}) {
+        auto start = std::chrono::steady_clock::now();
+        LaunchParallelTest(thread_num, MixedHelper, tree, preload, total_ops / thread_num, thread_num);
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("%8lu %12.1f %12.0f\n", thread_num, ms, total_ops / ms * 1000);
+    }
+
+    int64_t current_key = 1;
+    IxScan scan(tree, tree->leaf_begin(), tree->leaf_end(), bpm);
+    while (!scan.is_end()) {
+        EXPECT_EQ(scan.rid().slot_no, current_key);
+        current_key++;
+        scan.next();
+    }
+    EXPECT_EQ(current_key, preload + 1);
+}
+
+TEST_F(BPlusTreeConcurrentTest, ThroughputTest) {
+    const int order = 255;
+
+    assert(order > 2 && order <= ih_->file_hdr_.btree_order);
+    ih_->file_hdr_.btree_order = order;
+
+    RunThroughput(ih_.get(), buffer_pool_manager_.get());
+}
+
+/**
+ * @brief B-link树：并发插入1~10000（包括并发查找）后并发删除1~9900，删除不合并结点，扫描时跳过空叶子
+ */
+TEST_F(BPlusTreeConcurrentTest, BLinkMixScaleTest) {
+    const int64_t scale = 10000;
+    const int64_t delete_scale = 9900;
+    const int thread_num = 50;
+    const int order = 255;
+
+    UseBLink();
+    assert(order > 2 && order <= ih_->file_hdr_.btree_order);
+    ih_->file_hdr_.btree_order = order;
+
+    std::vector<int64_t> keys;
+    for (int64_t key = 1; key <= scale; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    LaunchParallelTest(thread_num, InsertHelper, ih_.get(), keys);
+
+    std::vector<int64_t> delete_keys;
+    for (int64_t key = 1; key <= delete_scale; key++) {
+        delete_keys.push_back(key);
+    }
+    LaunchParallelTest(thread_num, DeleteHelper, ih_.get(), delete_keys);
+
+    int64_t current_key = delete_scale + 1;
+    IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+    while (!scan.is_end()) {
+        EXPECT_EQ(scan.rid().slot_no, current_key);
+        current_key++;
+        scan.next();
+    }
+    EXPECT_EQ(current_key, scale + 1);
+    // 删空的叶子之后仍然可以插入
+    int64_t key = 1;
+    EXPECT_TRUE(ih_->insert_entry((const char *)&key, Rid{0, 1}, nullptr));
+    EXPECT_EQ(ih_->leaf_begin(), ih_->lower_bound((const char *)&key));
+}
+
+/**
+ * @brief B-link树：批量建树之后继续并发插入，再测吞吐量
+ */
+TEST_F(BPlusTreeConcurrentTest, BLinkThroughputTest) {
+    const int order = 255;
+
+    UseBLink();
+    assert(order > 2 && order <= ih_->file_hdr_.btree_order);
+    ih_->file_hdr_.btree_order = order;
+
+    // 批量建树得到的结点同样有high key和右兄弟，并发插入可以在其上分裂
+    const int64_t bulk = 5000;
+    std::vector<int> bulk_keys(bulk);
+    std::vector<std::pair<const char *, Rid>> entries;
+    for (int i = 0; i < bulk; i++) {
+        bulk_keys[i] = i + 1;
+        entries.emplace_back((const char *)&bulk_keys[i], Rid{0, i + 1});
+    }
+    EXPECT_TRUE(ih_->bulk_load(entries, nullptr));
+    std::vector<int64_t> keys;
+    for (int64_t key = bulk + 1; key <= 2 * bulk; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    LaunchParallelTest(8, InsertHelper, ih_.get(), keys);
+    for (int64_t key = 1; key <= 2 * bulk; key++) {
+        std::vector<Rid> rids;
+        EXPECT_TRUE(ih_->GetValue((const char *)&key, &rids, nullptr));
+        ih_->delete_entry((const char *)&key, nullptr);
+    }
+
+    RunThroughput(ih_.get(), buffer_pool_manager_.get());
+}
@@ -494,3 +494,45 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     std::cout << "Insert keys count: " << add_cnt << '\n' << "Delete keys count: " << del_cnt << '\n';
     check_all(ih_.get(), mock);
 }
+
+/**
+ * @brief 批量建树（COPY FROM）之后，树结构正确，并且可以继续插入和删除
+ */
+TEST_F(BPlusTreeTests, BulkLoadTest) {
+    const int order = 16;  // 较小的order使批量建出的树有多层内部结点
+    const int scale = 600;  // IxScan会pin住扫描过的叶子，叶子太多将会超出缓冲池
+
+    if (order >= 2 && order <= ih_->file_hdr_.btree_order) {
+        ih_->file_hdr_.btree_order = order;
+    }
+    std::multimap<int, Rid> mock;
+    std::vector<int> keys;
+    for (int i = 0; i < scale; i++) {
+        keys.push_back(i * 2);
+    }
+    std::vector<std::pair<const char *, Rid>> entries;
+    for (auto &key : keys) {
+        Rid rid = {.page_no = rand(), .slot_no = rand()};
+        entries.emplace_back((const char *)&key, rid);
+        mock.insert(std::make_pair(key, rid));
+    }
+    ASSERT_EQ(ih_->bulk_load(entries, txn_.get()), true);
+    check_all(ih_.get(), mock);
+    // 非空的树不能再批量建树
+    ASSERT_EQ(ih_->bulk_load(entries, txn_.get()), false);
+
+    // 插入奇数key，删除一部分偶数key
+    for (int i = 0; i < scale; i++) {
+        if (rand() % 2 == 0) {
+            int key = i * 2 + 1;
+            Rid rid = {.page_no = rand(), .slot_no = rand()};
+            ASSERT_EQ(ih_->insert_entry((const char *)&key, rid, txn_.get()), true);
+            mock.insert(std::make_pair(key, rid));
+        } else if (rand() % 2 == 0 && i != 0) {
+            int key = i * 2;
+            ASSERT_EQ(ih_->delete_entry((const char *)&key, txn_.get()), true);
+            mock.erase(key);
+        }
+    }
+    check_all(ih_.get(), mock);
+}
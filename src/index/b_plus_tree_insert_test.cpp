@@ -23,13 +23,18 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <numeric>
 #include <random>  // for std::default_random_engine
+#include <thread>
 
 #include "gtest/gtest.h"
 
 #define private public
 #include "ix.h"
+#include "ix_search.h"
 #undef private  // for use private variables in "ix.h"
 
 #include "storage/buffer_pool_manager.h"
@@ -312,3 +317,925 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     }
     EXPECT_EQ(current_key, keys.size() + 1);
 }
+
+/**
+ * @brief 结点中的key是保序编码后的形式：负数、正负零和float都要按数值的顺序排列
+ */
+TEST_F(BPlusTreeTests, NormalizedKeyTest) {
+    ASSERT_TRUE(ih_->file_hdr_.normalized);
+
+    // 编码后按字节比较的结果与按类型比较的结果相同，且可以解码回原值
+    std::vector<int> ints = {INT32_MIN, -100000, -256, -1, 0, 1, 255, 256, 65536, INT32_MAX};
+    std::vector<float> floats = {-1e30f, -100.5f, -1.0f, -0.25f, -0.0f, 0.0f, 1e-30f, 0.5f, 3.0f, 1e30f};
+    auto check_order = [](auto &vals, ColType type) {
+        for (size_t i = 0; i < vals.size(); i++) {
+            for (size_t j = 0; j < vals.size(); j++) {
+                char a[4], b[4];
+                ix_encode_col((const char *)&vals[i], a, type, 4);
+                ix_encode_col((const char *)&vals[j], b, type, 4);
+                int expected = ix_compare((const char *)&vals[i], (const char *)&vals[j], type, 4);
+                int actual = memcmp(a, b, 4);
+                EXPECT_EQ(expected < 0, actual < 0);
+                EXPECT_EQ(expected == 0, actual == 0);
+            }
+            auto decoded = vals[i];
+            char buf[4];
+            ix_encode_col((const char *)&vals[i], buf, type, 4);
+            ix_decode_col(buf, (char *)&decoded, type, 4);
+            EXPECT_TRUE(decoded == vals[i]);
+        }
+    };
+    check_order(ints, TYPE_INT);
+    check_order(floats, TYPE_FLOAT);
+
+    // 正负key混合插入，扫描结果按数值有序
+    const int order = 4;
+    ih_->file_hdr_.btree_order = order;
+    std::vector<int> keys;
+    for (int key = -50; key <= 50; key++) {
+        keys.push_back(key * 1000);
+    }
+    auto sorted_keys = keys;
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, txn_.get()));
+    }
+    size_t i = 0;
+    IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+    for (; !scan.is_end(); scan.next(), i++) {
+        ASSERT_LT(i, sorted_keys.size());
+        EXPECT_EQ(scan.rid().slot_no, sorted_keys[i]);
+    }
+    EXPECT_EQ(i, sorted_keys.size());
+
+    // 按原始的key查找和确定范围
+    int key = -20000;
+    std::vector<Rid> rids;
+    EXPECT_TRUE(ih_->GetValue((const char *)&key, &rids, txn_.get()));
+    EXPECT_EQ(rids.size(), 1);
+    Iid lower = ih_->lower_bound((const char *)&key);
+    EXPECT_EQ(ih_->get_rid(lower).slot_no, key);
+    key = -19999;
+    Iid upper = ih_->upper_bound((const char *)&key);
+    EXPECT_EQ(ih_->get_rid(upper).slot_no, -19000);
+    key = 0;
+    EXPECT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+    rids.clear();
+    EXPECT_FALSE(ih_->GetValue((const char *)&key, &rids, txn_.get()));
+}
+
+/**
+ * @brief 长key的索引在叶子结点中做前缀压缩：每个叶子放下的key比不压缩时多，插入前缀不同的key时先分裂
+ */
+TEST_F(BPlusTreeTests, PrefixCompressionTest) {
+    const int col_len = 128;
+    const int num_keys = 3000;
+    const std::string common = "tenant-000042/warehouse-eu-west-1/aisle-0007/shelf-0003/bin-";
+    auto make_key = [&](const std::string &prefix, int id) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%06d", id);
+        std::string key = prefix + buf;
+        key.resize(col_len, '\0');
+        return key;
+    };
+    // 检查叶子链表上的key有序、个数不超过结点能放下的个数，返回叶子的个数
+    auto check_leaves = [&](IxIndexHandle *ih, size_t num_expected) {
+        size_t num_leaves = 0, total = 0;
+        std::string prev;
+        for (page_id_t page_no = ih->file_hdr_.first_leaf; page_no != IX_LEAF_HEADER_PAGE;) {
+            IxNodeHandle *leaf = ih->FetchNode(page_no);
+            EXPECT_TRUE(leaf->IsCompressed());
+            EXPECT_LE(leaf->GetSize(), leaf->GetMaxSize());
+            for (int i = 0; i < leaf->GetSize(); i++) {
+                std::string key(col_len, '\0');
+                leaf->copy_key(i, key.data());
+                EXPECT_LT(prev, key);
+                prev = key;
+            }
+            total += leaf->GetSize();
+            num_leaves++;
+            page_no = leaf->GetNextLeaf();
+            buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+            delete leaf;
+        }
+        EXPECT_EQ(total, num_expected);
+        return num_leaves;
+    };
+
+    ix_manager_->create_index(TEST_FILE_NAME, 1, TYPE_STRING, col_len);
+    auto ih = ix_manager_->open_index(TEST_FILE_NAME, 1);
+    ASSERT_TRUE(ih->file_hdr_.compressed);
+    int uncompressed_capacity = ih->file_hdr_.btree_order - 1;
+
+    std::vector<int> ids;
+    for (int id = 0; id < num_keys; id++) {
+        ids.push_back(id);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(ids.begin(), ids.end(), rng);
+    for (int id : ids) {
+        auto key = make_key(common, id);
+        ASSERT_TRUE(ih->insert_entry(key.data(), Rid{.page_no = 0, .slot_no = id}, txn_.get()));
+    }
+    // 每个叶子平均放下的key多于不压缩时一个叶子最多能放的
+    size_t num_leaves = check_leaves(ih.get(), num_keys);
+    EXPECT_GT((double)num_keys / num_leaves, (double)uncompressed_capacity);
+    for (int id : ids) {
+        auto key = make_key(common, id);
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih->GetValue(key.data(), &rids, txn_.get()));
+        EXPECT_EQ(rids[0].slot_no, id);
+    }
+
+    // 前缀不同的key插到最前和最后，叶子的前缀变短
+    for (int id = 0; id < 100; id++) {
+        auto low = make_key("a/", id);
+        auto high = make_key("z/", id);
+        ASSERT_TRUE(ih->insert_entry(low.data(), Rid{.page_no = 1, .slot_no = id}, txn_.get()));
+        ASSERT_TRUE(ih->insert_entry(high.data(), Rid{.page_no = 2, .slot_no = id}, txn_.get()));
+    }
+    check_leaves(ih.get(), num_keys + 200);
+    {
+        IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        for (int i = 0; i < num_keys + 200; i++, scan.next()) {
+            ASSERT_FALSE(scan.is_end());
+            Rid rid = scan.rid();
+            int page_no = i < 100 ? 1 : (i < num_keys + 100 ? 0 : 2);
+            int slot_no = i < 100 ? i : (i < num_keys + 100 ? i - 100 : i - num_keys - 100);
+            EXPECT_EQ(rid.page_no, page_no);
+            EXPECT_EQ(rid.slot_no, slot_no);
+        }
+        EXPECT_TRUE(scan.is_end());
+    }
+
+    // 删除三分之二的key，合并和重分配的结点也要保持压缩后的格式
+    int num_deleted = 0;
+    for (int id : ids) {
+        auto key = make_key(common, id);
+        if (id % 3 != 0) {
+            ASSERT_TRUE(ih->delete_entry(key.data(), txn_.get()));
+            num_deleted++;
+        }
+    }
+    check_leaves(ih.get(), num_keys + 200 - num_deleted);
+    for (int id = 0; id < num_keys; id++) {
+        auto key = make_key(common, id);
+        std::vector<Rid> rids;
+        EXPECT_EQ(ih->GetValue(key.data(), &rids, txn_.get()), id % 3 == 0);
+    }
+
+    // 批量建树同样按前缀压缩后的容量装满叶子
+    ix_manager_->create_index(TEST_FILE_NAME, 2, TYPE_STRING, col_len);
+    auto bulk_ih = ix_manager_->open_index(TEST_FILE_NAME, 2);
+    std::vector<std::string> keys;
+    for (int id = 0; id < num_keys; id++) {
+        keys.push_back(make_key(common, id));
+    }
+    std::vector<std::pair<const char *, Rid>> entries;
+    for (int id = 0; id < num_keys; id++) {
+        entries.emplace_back(keys[id].data(), Rid{.page_no = 0, .slot_no = id});
+    }
+    ASSERT_TRUE(bulk_ih->bulk_load(entries, txn_.get()));
+    num_leaves = check_leaves(bulk_ih.get(), num_keys);
+    EXPECT_GT((double)num_keys / num_leaves, (double)uncompressed_capacity);
+    for (int id = 0; id < num_keys; id += 7) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(bulk_ih->GetValue(keys[id].data(), &rids, txn_.get()));
+        EXPECT_EQ(rids[0].slot_no, id);
+    }
+    auto key = make_key("m/", 0);
+    EXPECT_TRUE(bulk_ih->insert_entry(key.data(), Rid{.page_no = 1, .slot_no = 0}, txn_.get()));
+    check_leaves(bulk_ih.get(), num_keys + 1);
+
+    ix_manager_->close_index(ih.get());
+    ix_manager_->destroy_index(TEST_FILE_NAME, 1);
+    ix_manager_->close_index(bulk_ih.get());
+    ix_manager_->destroy_index(TEST_FILE_NAME, 2);
+}
+
+/**
+ * @brief CREATE INDEX的建树方式：内存放不下时外部归并排序，key重复时保留最先加入的，叶子按fill factor装填
+ */
+TEST_F(BPlusTreeTests, SortedBulkBuildTest) {
+    const int num_keys = 20000;
+    const double fill_factor = 0.7;
+    // 每个key加入两次，第二次的rid的page_no为1
+    std::vector<int> keys;
+    for (int key = 0; key < num_keys; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    const std::string run_prefix = "table1.sort";
+    {
+        IxSorter sorter(ih_->file_hdr_, 4096, run_prefix);
+        for (int round = 0; round < 2; round++) {
+            for (int key : keys) {
+                Rid rid{.page_no = round, .slot_no = key};
+                sorter.add(reinterpret_cast<const char *>(&key), reinterpret_cast<const char *>(&rid));
+            }
+        }
+        EXPECT_EQ(sorter.size(), 2u * num_keys);
+        EXPECT_GT(sorter.num_runs(), 1u);
+        ASSERT_TRUE(ih_->bulk_load(&sorter, txn_.get(), fill_factor));
+    }
+    // 排序结束后删除run文件
+    EXPECT_FALSE(disk_manager_->is_file(run_prefix + "0"));
+
+    int target = (int)((ih_->file_hdr_.btree_order - 1) * fill_factor);
+    int min_size = (ih_->file_hdr_.btree_order + 1) / 2;
+    int expected_key = 0;
+    for (page_id_t page_no = ih_->file_hdr_.first_leaf; page_no != IX_LEAF_HEADER_PAGE;) {
+        IxNodeHandle *leaf = ih_->FetchNode(page_no);
+        // 最后一个叶子可能合并了前一个叶子，不超过容量即可
+        bool is_last = leaf->GetNextLeaf() == IX_LEAF_HEADER_PAGE;
+        EXPECT_LE(leaf->GetSize(), is_last ? ih_->file_hdr_.btree_order - 1 : target);
+        EXPECT_GE(leaf->GetSize(), min_size);
+        for (int i = 0; i < leaf->GetSize(); i++) {
+            EXPECT_EQ(leaf->KeyAt(i), expected_key);
+            EXPECT_EQ(leaf->get_rid(i)->page_no, 0);
+            EXPECT_EQ(leaf->get_rid(i)->slot_no, expected_key);
+            expected_key++;
+        }
+        page_no = leaf->GetNextLeaf();
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        delete leaf;
+    }
+    EXPECT_EQ(expected_key, num_keys);
+
+    // 留出的空间可以直接插入，树的结构仍然正确
+    for (int key = num_keys; key < num_keys + 100; key++) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    for (int key = 0; key < num_keys + 100; key += 13) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih_->GetValue(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+        EXPECT_EQ(rids[0].slot_no, key);
+    }
+}
+
+/**
+ * @brief 并行建索引：多个线程各自往一个sorter中add，归并后key重复时保留下标最小的sorter中的
+ */
+TEST_F(BPlusTreeTests, ParallelSortedBulkBuildTest) {
+    const int num_keys = 20000;
+    const int num_sorters = 4;
+    std::vector<int> keys;
+    for (int key = 0; key < num_keys; key++) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+    const std::string run_prefix = "table1.sort";
+    {
+        IxParallelSorter sorter(ih_->file_hdr_, num_sorters, 4096 * num_sorters, run_prefix);
+        // 每个key加入第key % 4和第(key + 1) % 4个sorter，rid的page_no为sorter的下标
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_sorters; i++) {
+            threads.emplace_back([&, i]() {
+                for (int key : keys) {
+                    if (key % num_sorters == i || (key + 1) % num_sorters == i) {
+                        Rid rid{.page_no = i, .slot_no = key};
+                        sorter.get(i)->add(reinterpret_cast<const char *>(&key), reinterpret_cast<const char *>(&rid));
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(sorter.size(), 2u * num_keys);
+        ASSERT_TRUE(ih_->bulk_load(&sorter, txn_.get()));
+    }
+    for (int i = 0; i < num_sorters; i++) {
+        EXPECT_FALSE(disk_manager_->is_file(run_prefix + std::to_string(i) + "_0"));
+    }
+
+    int expected_key = 0;
+    for (page_id_t page_no = ih_->file_hdr_.first_leaf; page_no != IX_LEAF_HEADER_PAGE;) {
+        IxNodeHandle *leaf = ih_->FetchNode(page_no);
+        for (int i = 0; i < leaf->GetSize(); i++) {
+            EXPECT_EQ(leaf->KeyAt(i), expected_key);
+            EXPECT_EQ(leaf->get_rid(i)->page_no, std::min(expected_key % num_sorters, (expected_key + 1) % num_sorters));
+            EXPECT_EQ(leaf->get_rid(i)->slot_no, expected_key);
+            expected_key++;
+        }
+        page_no = leaf->GetNextLeaf();
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        delete leaf;
+    }
+    EXPECT_EQ(expected_key, num_keys);
+}
+
+/**
+ * @brief 整数key在结点内的查找（SIMD、无分支二分查找）与std::lower_bound/std::upper_bound的结果一致
+ */
+TEST_F(BPlusTreeTests, NodeSearchTest) {
+    auto rng = std::default_random_engine{};
+    for (int n : {0, 1, 3, 8, 9, 31, 64, 65, 200}) {
+        std::vector<int> values(n);
+        for (int i = 0; i < n; i++) {
+            values[i] = i * 3 - n;
+        }
+        std::vector<char> keys32(n * sizeof(int));
+        std::vector<char> keys64(n * sizeof(int64_t));
+        for (int i = 0; i < n; i++) {
+            ix_encode_col(reinterpret_cast<const char *>(&values[i]), keys32.data() + i * sizeof(int), TYPE_INT,
+                          sizeof(int));
+            // 两个int的组合索引的key是8字节
+            memcpy(keys64.data() + i * sizeof(int64_t), keys32.data() + i * sizeof(int), sizeof(int));
+            memset(keys64.data() + i * sizeof(int64_t) + sizeof(int), 0x55, sizeof(int));
+        }
+        std::uniform_int_distribution<int> dist(-n - 2, 2 * n + 2);
+        for (int round = 0; round < 200; round++) {
+            int v = dist(rng);
+            int begin = std::min(n, round % 2);
+            int lower = std::lower_bound(values.begin() + begin, values.end(), v) - values.begin();
+            int upper = std::upper_bound(values.begin() + begin, values.end(), v) - values.begin();
+            char target[sizeof(int64_t)];
+            ix_encode_col(reinterpret_cast<const char *>(&v), target, TYPE_INT, sizeof(int));
+            memset(target + sizeof(int), 0x55, sizeof(int));
+            uint32_t t32 = ix_load_be32(target);
+            uint64_t t64 = ix_load_be64(target);
+            EXPECT_EQ((ix_search_keys<uint32_t, false>(keys32.data(), begin, n, t32)), lower);
+            EXPECT_EQ((ix_search_keys<uint32_t, true>(keys32.data(), begin, n, t32)), upper);
+            EXPECT_EQ((ix_search_keys<uint64_t, false>(keys64.data(), begin, n, t64)), lower);
+            EXPECT_EQ((ix_search_keys<uint64_t, true>(keys64.data(), begin, n, t64)), upper);
+            if (n > begin) {
+                EXPECT_EQ((ix_branchless_search<uint32_t, false>(keys32.data(), begin, n, t32)), lower);
+                EXPECT_EQ((ix_branchless_search<uint64_t, true>(keys64.data(), begin, n, t64)), upper);
+#ifdef IX_HAVE_AVX2_SEARCH
+                if (ix_cpu_has_avx2()) {
+                    EXPECT_EQ((ix_simd_search<uint32_t, true>(keys32.data(), begin, n, t32)), upper);
+                    EXPECT_EQ((ix_simd_search<uint64_t, false>(keys64.data(), begin, n, t64)), lower);
+                }
+#endif
+            }
+        }
+    }
+}
+
+/**
+ * @brief 可扩展哈希索引：桶分裂和目录加倍（跨多个目录页）之后等值查找、遍历、删除和重新打开都正确
+ */
+TEST_F(BPlusTreeTests, HashIndexTest) {
+    // 64字节的key使每个桶只能放几十个键值对，目录会超过一页
+    const int key_len = 64;
+    ix_manager_->close_index(ih_.get());
+    ix_manager_->destroy_index(TEST_FILE_NAME, index_no);
+    ix_manager_->create_index(TEST_FILE_NAME, index_no, TYPE_STRING, key_len, sizeof(Rid), false, true);
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    ASSERT_TRUE(ih_->file_hdr_.hash);
+    ASSERT_FALSE(ih_->file_hdr_.compressed);
+
+    const int num_keys = 50000;
+    auto make_key = [&](int i, char *key) {
+        memset(key, 0, key_len);
+        snprintf(key, key_len, "key%d", i);
+    };
+    std::vector<int> order(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::default_random_engine{});
+    char key[key_len];
+    for (int i : order) {
+        make_key(i, key);
+        ASSERT_TRUE(ih_->insert_entry(key, Rid{.page_no = i / 100, .slot_no = i % 100}, txn_.get()));
+    }
+    make_key(7, key);
+    EXPECT_FALSE(ih_->insert_entry(key, Rid{.page_no = -1, .slot_no = -1}, txn_.get()));
+    EXPECT_GT(ih_->file_hdr_.hash_global_depth, 9);  // 超过一个目录页的IX_HASH_DIR_SLOTS项
+    EXPECT_NE(ih_->file_hdr_.hash_dir_pages[1], 0);
+
+    auto check = [&](const std::function<bool(int)> &exists) {
+        for (int i = 0; i < num_keys; i++) {
+            make_key(i, key);
+            std::vector<Rid> rids;
+            ASSERT_EQ(ih_->GetValue(key, &rids, txn_.get()), exists(i)) << "key " << i;
+            if (exists(i)) {
+                EXPECT_EQ(rids[0], (Rid{.page_no = i / 100, .slot_no = i % 100}));
+                // 等值查找的范围正好是这一个键值对
+                Iid lower = ih_->lower_bound(key);
+                Iid upper = ih_->upper_bound(key);
+                IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get());
+                ASSERT_FALSE(scan.is_end());
+                EXPECT_EQ(scan.rid(), rids[0]);
+                scan.next();
+                EXPECT_TRUE(scan.is_end());
+            } else {
+                EXPECT_EQ(ih_->lower_bound(key), ih_->upper_bound(key));
+            }
+        }
+        // 遍历所有的桶，每个键值对恰好出现一次，并且都在它的哈希值对应的桶里
+        std::vector<bool> seen(num_keys);
+        int num_seen = 0;
+        for (IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+             scan.next()) {
+            Rid rid = scan.rid();
+            int i = rid.page_no * 100 + rid.slot_no;
+            ASSERT_TRUE(exists(i) && !seen[i]);
+            seen[i] = true;
+            num_seen++;
+            make_key(i, key);
+            IxNodeHandle *bucket = ih_->hash_find_bucket(key, Operation::FIND);
+            EXPECT_EQ(bucket->GetPageNo(), scan.iid().page_no);
+            ih_->release_node(bucket, Operation::FIND, false);
+        }
+        int num_expected = 0;
+        for (int i = 0; i < num_keys; i++) {
+            num_expected += exists(i);
+        }
+        EXPECT_EQ(num_seen, num_expected);
+    };
+    check([](int) { return true; });
+
+    // 删除一半的key，桶不合并
+    for (int i = 0; i < num_keys; i += 2) {
+        make_key(i, key);
+        ASSERT_TRUE(ih_->delete_entry(key, txn_.get()));
+    }
+    make_key(0, key);
+    EXPECT_FALSE(ih_->delete_entry(key, txn_.get()));
+    check([](int i) { return i % 2 == 1; });
+
+    // 目录和桶在重新打开之后仍然可用，可以继续插入
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    for (int i = 0; i < num_keys; i += 4) {
+        make_key(i, key);
+        ASSERT_TRUE(ih_->insert_entry(key, Rid{.page_no = i / 100, .slot_no = i % 100}, txn_.get()));
+    }
+    check([](int i) { return i % 2 == 1 || i % 4 == 0; });
+}
+
+/**
+ * @brief 反向扫描沿prev_leaf从上界向前遍历，结果与正向扫描相反
+ */
+TEST_F(BPlusTreeTests, BackwardScanTest) {
+    // 只插入偶数key，奇数作为不存在的边界
+    const int num_keys = 5000;
+    std::vector<int> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(i * 2);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    ASSERT_NE(ih_->file_hdr_.first_leaf, ih_->file_hdr_.last_leaf);
+
+    auto scan_keys = [&](const Iid &lower, const Iid &upper, bool reverse) {
+        std::vector<int> result;
+        for (IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get(), reverse); !scan.is_end(); scan.next()) {
+            result.push_back(scan.rid().slot_no);
+        }
+        return result;
+    };
+    // 整个索引
+    auto forward = scan_keys(ih_->leaf_begin(), ih_->leaf_end(), false);
+    auto backward = scan_keys(ih_->leaf_begin(), ih_->leaf_end(), true);
+    ASSERT_EQ(forward.size(), (size_t)num_keys);
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(forward, backward);
+
+    // 各种范围：[lo, hi]的上下界落在叶子中间、叶子边界和索引两端
+    for (auto [lo, hi] : std::vector<std::pair<int, int>>{
+             {-5, 20000}, {0, 0}, {3, 3}, {-5, -1}, {20000, 30000}, {1, 777}, {1000, 1001}, {9000, 9998}, {500, 8501}}) {
+        Iid lower = ih_->lower_bound(reinterpret_cast<const char *>(&lo));
+        Iid upper = ih_->upper_bound(reinterpret_cast<const char *>(&hi));
+        std::vector<int> expected;
+        for (int key = num_keys * 2 - 2; key >= 0; key -= 2) {
+            if (lo <= key && key <= hi) {
+                expected.push_back(key);
+            }
+        }
+        EXPECT_EQ(scan_keys(lower, upper, true), expected) << "[" << lo << ", " << hi << "]";
+    }
+
+    // 最大值只需读最后一个叶子
+    IxScan max_scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get(), true);
+    ASSERT_FALSE(max_scan.is_end());
+    EXPECT_EQ(max_scan.rid().slot_no, num_keys * 2 - 2);
+    EXPECT_EQ(max_scan.iid().page_no, ih_->file_hdr_.last_leaf);
+}
+
+/**
+ * @brief 测试IxScan的叶子游标：扫描期间只pin住当前叶子，按叶子成批取出的rid与逐个取出的相同，
+ * 扫描过程中修改当前叶子不会死锁
+ */
+TEST_F(BPlusTreeTests, PinnedLeafScanTest) {
+    const int num_keys = 5000;
+    std::vector<int> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(i * 2);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    auto num_pinned = [&]() {
+        int num = 0;
+        for (size_t i = 0; i < buffer_pool_manager_->pool_size_; i++) {
+            num += buffer_pool_manager_->pages_[i].pin_count_ > 0;
+        }
+        return num;
+    };
+    int pinned_before = num_pinned();
+
+    int lo = 1001;
+    int hi = 8999;
+    Iid lower = ih_->lower_bound(reinterpret_cast<const char *>(&lo));
+    Iid upper = ih_->upper_bound(reinterpret_cast<const char *>(&hi));
+    std::vector<Rid> rids;
+    {
+        IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get());
+        for (; !scan.is_end(); scan.next()) {
+            EXPECT_EQ(num_pinned(), pinned_before + 1);
+            rids.push_back(scan.rid());
+        }
+    }
+    EXPECT_EQ(num_pinned(), pinned_before);
+    ASSERT_EQ(rids.size(), (size_t)(hi - lo + 1) / 2);
+    for (size_t i = 0; i < rids.size(); i++) {
+        EXPECT_EQ(rids[i].slot_no, lo + 1 + (int)i * 2);
+    }
+
+    std::vector<Rid> batch;
+    {
+        IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get());
+        int num_batches = 0;
+        while (!scan.is_end()) {
+            scan.next_batch(&batch);
+            num_batches++;
+        }
+        EXPECT_GT(num_batches, 1);
+    }
+    ASSERT_EQ(batch.size(), rids.size());
+    for (size_t i = 0; i < rids.size(); i++) {
+        EXPECT_EQ(batch[i].slot_no, rids[i].slot_no);
+    }
+
+    // 在扫描过程中向当前叶子插入奇数key
+    int count = 0;
+    for (IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+         scan.next()) {
+        int key = scan.rid().slot_no + 1;
+        if (key % 2 == 1 && count < 100) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                          txn_.get()));
+            count++;
+        }
+    }
+    EXPECT_EQ(num_pinned(), pinned_before);
+    EXPECT_EQ(count, 100);
+}
+
+/**
+ * @brief 测试批量查找GetValues：有序的一批key（含不存在的）与逐个GetValue的结果相同，无序时也正确
+ */
+TEST_F(BPlusTreeTests, BatchProbeTest) {
+    const int num_keys = 20000;
+    std::vector<int> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(i * 2);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = key, .slot_no = 0},
+                                      txn_.get()));
+    }
+
+    // 奇数key不存在，两端也各有不存在的key
+    std::vector<int> probe;
+    for (int key = -10; key < num_keys * 2 + 10; key += 3) {
+        probe.push_back(key);
+    }
+    auto check = [&](const std::vector<int> &probe_keys) {
+        std::vector<const char *> key_ptrs;
+        for (auto &key : probe_keys) {
+            key_ptrs.push_back(reinterpret_cast<const char *>(&key));
+        }
+        std::vector<Rid> values(probe_keys.size());
+        std::vector<bool> found;
+        int num_found = ih_->GetValues(key_ptrs, reinterpret_cast<char *>(values.data()), &found, txn_.get());
+        int expected_found = 0;
+        for (size_t i = 0; i < probe_keys.size(); i++) {
+            int key = probe_keys[i];
+            std::vector<Rid> result;
+            bool exists = ih_->GetValue(reinterpret_cast<const char *>(&key), &result, txn_.get());
+            ASSERT_EQ(exists, key >= 0 && key < num_keys * 2 && key % 2 == 0) << key;
+            ASSERT_EQ(found[i], exists) << key;
+            if (exists) {
+                EXPECT_EQ(values[i].page_no, key);
+                expected_found++;
+            }
+        }
+        EXPECT_EQ(num_found, expected_found);
+    };
+    check(probe);
+    std::shuffle(probe.begin(), probe.end(), std::default_random_engine{});
+    check(probe);
+    check({});
+}
+
+/**
+ * @brief 测试删除结点后页面的复用和REINDEX（rebuild）：删除后再插入时复用空闲页面，文件不增长；
+ * 大量删除后重建，页面数减少、所有key仍然存在，重新打开索引后继续插入仍然正确
+ */
+TEST_F(BPlusTreeTests, ReindexTest) {
+    const int num_keys = 20000;
+    std::vector<int> keys;
+    for (int key = 0; key < num_keys; key++) {
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    int high_water = ih_->file_hdr_.num_pages;
+
+    // 删掉一半再插回来，被合并掉的结点的页面被复用
+    for (int round = 0; round < 3; round++) {
+        for (int key = 0; key < num_keys; key += 2) {
+            ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+        EXPECT_NE(ih_->file_hdr_.first_free_page_no, IX_NO_PAGE);
+        for (int key = 0; key < num_keys; key += 2) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                          txn_.get()));
+        }
+    }
+    EXPECT_LE(ih_->file_hdr_.num_pages, high_water * 11 / 10);
+
+    // 只留下每10个key中的一个，重建后页面数减少
+    for (int key = 0; key < num_keys; key++) {
+        if (key % 10 != 0) {
+            ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+    }
+    int pages_before = ih_->file_hdr_.num_pages;
+    // 进行中的扫描pin着当前叶子，REINDEX等它结束后才丢弃页面，扫描读到的是重建前完整的树
+    std::atomic<bool> rebuilt{false};
+    std::thread reindex;
+    {
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        reindex = std::thread([&]() {
+            EXPECT_TRUE(ih_->rebuild(0.9));
+            rebuilt = true;
+        });
+        int expected_key = 0;
+        for (; !scan.is_end(); scan.next()) {
+            if (expected_key == num_keys / 2) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            EXPECT_EQ(scan.rid().slot_no, expected_key);
+            expected_key += 10;
+        }
+        EXPECT_EQ(expected_key, num_keys);
+        EXPECT_FALSE(rebuilt);
+    }
+    reindex.join();
+    ASSERT_TRUE(rebuilt);
+    EXPECT_LT(ih_->file_hdr_.num_pages, pages_before / 4);
+    EXPECT_EQ(ih_->file_hdr_.first_free_page_no, IX_NO_PAGE);
+    EXPECT_EQ(disk_manager_->GetFileSize(disk_manager_->GetFileName(ih_->fd_)) / PAGE_SIZE,
+              IX_INIT_NUM_PAGES);  // 截断后新结点还在缓冲池中
+    int expected_key = 0;
+    for (IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+         scan.next()) {
+        EXPECT_EQ(scan.rid().slot_no, expected_key);
+        expected_key += 10;
+    }
+    EXPECT_EQ(expected_key, num_keys);
+
+    // 重新打开索引，从文件末尾继续分配页面
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    for (int key = 0; key < num_keys; key++) {
+        if (key % 10 != 0) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                          txn_.get()));
+        }
+    }
+    for (int key = 0; key < num_keys; key += 7) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih_->GetValue(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+        EXPECT_EQ(rids[0].slot_no, key);
+    }
+    expected_key = 0;
+    for (IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+         scan.next()) {
+        ASSERT_EQ(scan.rid().slot_no, expected_key);
+        expected_key++;
+    }
+    EXPECT_EQ(expected_key, num_keys);
+}
+
+/**
+ * @brief 测试扫描进行中删除的页面：先放到延迟释放的链表中，不被新结点复用；扫描结束后并入空闲链表
+ */
+TEST_F(BPlusTreeTests, DeferredFreeTest) {
+    const int num_keys = 20000;
+    for (int key = 0; key < num_keys; key++) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    auto delete_and_reinsert = [&](int begin, int end) {
+        for (int key = begin; key < end; key++) {
+            ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+        for (int key = begin; key < end; key++) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                          txn_.get()));
+        }
+    };
+    int pages_before = ih_->file_hdr_.num_pages;
+    {
+        // 扫描停在第一个叶子上，删除后半部分的key时被合并掉的结点都不能复用，重新插入时文件增长
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        for (int key = num_keys / 2; key < num_keys; key++) {
+            ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+        EXPECT_EQ(ih_->file_hdr_.first_free_page_no, IX_NO_PAGE);
+        EXPECT_NE(ih_->deferred_free_head_, IX_NO_PAGE);
+        for (int key = num_keys / 2; key < num_keys; key++) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                          txn_.get()));
+        }
+        EXPECT_GT(ih_->file_hdr_.num_pages, pages_before);
+        EXPECT_EQ(scan.rid().slot_no, 0);
+    }
+    // 扫描结束后，延迟释放的页面和新删除的页面都被复用，文件不再增长
+    int pages_after_scan = ih_->file_hdr_.num_pages;
+    delete_and_reinsert(num_keys / 2, num_keys);
+    EXPECT_EQ(ih_->deferred_free_head_, IX_NO_PAGE);
+    EXPECT_EQ(ih_->file_hdr_.num_pages, pages_after_scan);
+
+    // 关闭索引时延迟释放的页面并入空闲链表，重新打开后复用
+    {
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        for (int key = num_keys / 2; key < num_keys; key++) {
+            ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+    }
+    ASSERT_NE(ih_->deferred_free_head_, IX_NO_PAGE);
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    EXPECT_NE(ih_->file_hdr_.first_free_page_no, IX_NO_PAGE);
+    for (int key = num_keys / 2; key < num_keys; key++) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    EXPECT_EQ(ih_->file_hdr_.num_pages, pages_after_scan);
+    int expected_key = 0;
+    for (IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+         scan.next()) {
+        ASSERT_EQ(scan.rid().slot_no, expected_key);
+        expected_key++;
+    }
+    EXPECT_EQ(expected_key, num_keys);
+}
+
+/**
+ * @brief 测试Bloom filter：插入过程中容量不够时自动重建，存在的key都能找到，不存在的key大多被filter排除；
+ * 关闭索引时写出filter，重新打开后读入；删除key后重建filter去掉它们
+ */
+TEST_F(BPlusTreeTests, BloomFilterTest) {
+    ASSERT_TRUE(ih_->bloom_enabled());
+    const int num_keys = 20000;
+    std::vector<int> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(i * 2);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 0, .slot_no = key},
+                                      txn_.get()));
+    }
+    EXPECT_FALSE(ih_->get_bloom().is_full());
+    EXPECT_GT(ih_->get_bloom().num_blocks(), (size_t)INDEX_BLOOM_MIN_BLOCKS);
+
+    // 存在的key没有误判为不存在；不存在的key误判的比例与每个key的位数相符
+    auto count_false_positives = [&]() {
+        int false_positives = 0;
+        for (int i = 0; i < num_keys; i++) {
+            int key = i * 2;
+            EXPECT_TRUE(ih_->may_contain(reinterpret_cast<const char *>(&key)));
+            key = i * 2 + 1;
+            false_positives += ih_->may_contain(reinterpret_cast<const char *>(&key));
+        }
+        return false_positives;
+    };
+    EXPECT_LT(count_false_positives(), num_keys / 100);
+    int key = 12345;
+    std::vector<Rid> rids;
+    EXPECT_FALSE(ih_->GetValue(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+
+    // 关闭时写出filter，打开时读入并删掉文件
+    std::string bloom_name = disk_manager_->GetFileName(ih_->fd_) + ".bloom";
+    size_t num_blocks = ih_->get_bloom().num_blocks();
+    ix_manager_->close_index(ih_.get());
+    EXPECT_TRUE(disk_manager_->is_file(bloom_name));
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    EXPECT_FALSE(disk_manager_->is_file(bloom_name));
+    EXPECT_EQ(ih_->get_bloom().num_blocks(), num_blocks);
+    EXPECT_LT(count_false_positives(), num_keys / 100);
+
+    // 删除的key仍在filter中，重建后去掉
+    for (int i = 0; i < num_keys; i += 2) {
+        key = i * 2;
+        ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+    }
+    size_t num_bloom_keys = ih_->get_bloom().num_keys();
+    ih_->rebuild_bloom();
+    EXPECT_EQ(ih_->get_bloom().num_keys(), num_bloom_keys / 2);
+    for (int i = 0; i < num_keys; i++) {
+        key = i * 2;
+        rids.clear();
+        bool exists = ih_->GetValue(reinterpret_cast<const char *>(&key), &rids, txn_.get());
+        ASSERT_EQ(exists, i % 2 == 1) << key;
+        if (exists) {
+            EXPECT_TRUE(ih_->may_contain(reinterpret_cast<const char *>(&key)));
+        }
+    }
+}
+
+/**
+ * @brief 旧的索引文件：文件头只有最初的9个字段，其后的字节为0
+ * @note 后加的字段读出来都是0/false（val_len为0即sizeof(Rid)），索引按未编码、不压缩的单列B+树使用
+ */
+TEST_F(BPlusTreeTests, OldFileHeaderTest) {
+    struct OldIxFileHdr {
+        page_id_t first_free_page_no;
+        int num_pages;
+        page_id_t root_page;
+        ColType col_type;
+        int col_len;
+        int btree_order;
+        int keys_size;
+        page_id_t first_leaf;
+        page_id_t last_leaf;
+    };
+    IxFileHdr hdr = ih_->get_file_hdr();
+    OldIxFileHdr old_hdr = {
+        .first_free_page_no = hdr.first_free_page_no,
+        .num_pages = hdr.num_pages,
+        .root_page = hdr.root_page,
+        .col_type = hdr.col_type,
+        .col_len = hdr.col_len,
+        .btree_order = hdr.btree_order,
+        .keys_size = hdr.keys_size,
+        .first_leaf = hdr.first_leaf,
+        .last_leaf = hdr.last_leaf,
+    };
+    std::string bloom_name = disk_manager_->GetFileName(ih_->fd_) + ".bloom";
+    ix_manager_->close_index(ih_.get());
+    unlink(bloom_name.c_str());
+    {
+        int fd = disk_manager_->open_file(ix_manager_->get_index_name(TEST_FILE_NAME, index_no));
+        char page[PAGE_SIZE] = {};
+        memcpy(page, &old_hdr, sizeof(old_hdr));
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, page, PAGE_SIZE);
+        disk_manager_->close_file(fd);
+    }
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, index_no);
+    hdr = ih_->get_file_hdr();
+    ASSERT_EQ(hdr.val_len, (int)sizeof(Rid));
+    ASSERT_EQ(hdr.btree_order, old_hdr.btree_order);
+    ASSERT_FALSE(hdr.blink || hdr.normalized || hdr.compressed || hdr.hash);
+    ASSERT_FALSE(ih_->bloom_enabled());
+
+    const int num_keys = 5000;
+    std::vector<int> keys(num_keys);
+    std::iota(keys.begin(), keys.end(), -num_keys / 2);
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = key, .slot_no = 0},
+                                      txn_.get()));
+    }
+    for (int key : keys) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih_->GetValue(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+        ASSERT_EQ(rids.size(), 1u);
+        ASSERT_EQ(rids[0].page_no, key);
+    }
+    // 没有编码的int key也按数值排序，负数在前
+    int prev = INT32_MIN;
+    int num_scanned = 0;
+    {
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        for (; !scan.is_end(); scan.next()) {
+            int key = scan.rid().page_no;
+            ASSERT_GT(key, prev);
+            prev = key;
+            num_scanned++;
+        }
+    }
+    ASSERT_EQ(num_scanned, num_keys);
+}
@@ -0,0 +1,115 @@
+#include "ix_bloom.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "common/config.h"
+#include "errors.h"
+
+namespace {
+
+constexpr uint64_t BLOOM_FILE_MAGIC = 0x314d4f4f4c425849ull;  // "IXBLOOM1"
+
+// 每个字中置位的位置由哈希值的低32位乘以不同的奇数得到（同Parquet的split block Bloom filter）
+constexpr uint32_t BLOOM_SALTS[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                     0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+}  // namespace
+
+uint64_t IxBloomFilter::hash(const char *key, int len) {
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (uint64_t)len;
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, key + i, sizeof(word));
+        h = mix64(h ^ word);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, len - i);
+    return mix64(h ^ tail);
+}
+
+void IxBloomFilter::allocate(size_t num_blocks) {
+    num_blocks_ = num_blocks;
+    words_ = std::make_unique<std::atomic<uint64_t>[]>(num_blocks * WORDS_PER_BLOCK);
+    for (size_t i = 0; i < num_blocks * WORDS_PER_BLOCK; i++) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+    capacity_ = num_blocks * BITS_PER_BLOCK / INDEX_BLOOM_BITS_PER_KEY;
+    num_keys_.store(0, std::memory_order_relaxed);
+}
+
+void IxBloomFilter::reset(size_t num_keys) {
+    size_t num_blocks = INDEX_BLOOM_MIN_BLOCKS;
+    while (num_blocks * BITS_PER_BLOCK < num_keys * INDEX_BLOOM_BITS_PER_KEY) {
+        num_blocks *= 2;
+    }
+    allocate(num_blocks);
+}
+
+void IxBloomFilter::add(uint64_t h) {
+    std::atomic<uint64_t> *block = &words_[((h >> 32) & (num_blocks_ - 1)) * WORDS_PER_BLOCK];
+    for (int i = 0; i < WORDS_PER_BLOCK; i++) {
+        block[i].fetch_or(1ull << (((uint32_t)h * BLOOM_SALTS[i]) >> 26), std::memory_order_relaxed);
+    }
+    num_keys_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool IxBloomFilter::may_contain(uint64_t h) const {
+    const std::atomic<uint64_t> *block = &words_[((h >> 32) & (num_blocks_ - 1)) * WORDS_PER_BLOCK];
+    for (int i = 0; i < WORDS_PER_BLOCK; i++) {
+        uint64_t bit = 1ull << (((uint32_t)h * BLOOM_SALTS[i]) >> 26);
+        if ((block[i].load(std::memory_order_relaxed) & bit) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 把filter写到文件中：魔数、块数、key的个数，然后是位数组
+ */
+void IxBloomFilter::save(const std::string &file_name) const {
+    std::ofstream os(file_name, std::ios::binary | std::ios::trunc);
+    if (!os.is_open()) {
+        throw UnixError();
+    }
+    uint64_t hdr[3] = {BLOOM_FILE_MAGIC, num_blocks_, num_keys()};
+    os.write(reinterpret_cast<const char *>(hdr), sizeof(hdr));
+    for (size_t i = 0; i < num_blocks_ * WORDS_PER_BLOCK; i++) {
+        uint64_t word = words_[i].load(std::memory_order_relaxed);
+        os.write(reinterpret_cast<const char *>(&word), sizeof(word));
+    }
+    if (!os) {
+        throw UnixError();
+    }
+}
+
+bool IxBloomFilter::load(const std::string &file_name) {
+    std::ifstream is(file_name, std::ios::binary);
+    uint64_t hdr[3];
+    if (!is.read(reinterpret_cast<char *>(hdr), sizeof(hdr)) || hdr[0] != BLOOM_FILE_MAGIC || hdr[1] == 0 ||
+        (hdr[1] & (hdr[1] - 1)) != 0) {
+        return false;
+    }
+    std::vector<uint64_t> words(hdr[1] * WORDS_PER_BLOCK);
+    if (!is.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(uint64_t))) {
+        return false;
+    }
+    allocate(hdr[1]);
+    for (size_t i = 0; i < words.size(); i++) {
+        words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    num_keys_.store(hdr[2], std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief 索引的分块Bloom filter，用于快速排除不存在的key（等值查找）
+ *
+ * 位数组分成64字节的块（正好一条cache line），每个key只落在一个块中：哈希值的高32位选块，
+ * 低32位分别乘8个不同的奇数后取高6位，在块内的8个字中各置一位，查找一个key最多一次cache miss。
+ * 块数是2的幂，按INDEX_BLOOM_BITS_PER_KEY个位一个key分配；加入的key超过容量后误判率升高，由IxIndexHandle按更大的容量重建。
+ * 置位用原子的fetch_or，持有共享latch的多个插入可以并发地add；reset和load要求没有并发的访问。
+ * 删除的key无法从filter中去掉，只会使误判率升高，重建时才去掉
+ */
+class IxBloomFilter {
+    static constexpr int WORDS_PER_BLOCK = 8;
+    static constexpr int BITS_PER_BLOCK = WORDS_PER_BLOCK * 64;
+
+    size_t num_blocks_ = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    size_t capacity_ = 0;                // 按INDEX_BLOOM_BITS_PER_KEY能容纳的key的个数
+    std::atomic<size_t> num_keys_{0};  // 加入过的key的个数（包括已经删除的）
+
+   public:
+    // key的64位哈希值，filter会持久化，不能依赖std::hash的实现
+    static uint64_t hash(const char *key, int len);
+
+    // 清空filter，按num_keys个key分配空间
+    void reset(size_t num_keys);
+
+    void add(uint64_t h);
+
+    // 返回false时key一定不存在
+    bool may_contain(uint64_t h) const;
+
+    // 加入的key超过了容量
+    bool is_full() const { return num_keys_.load(std::memory_order_relaxed) > capacity_; }
+
+    size_t num_blocks() const { return num_blocks_; }
+
+    size_t num_keys() const { return num_keys_.load(std::memory_order_relaxed); }
+
+    void save(const std::string &file_name) const;
+
+    // 文件不存在或格式不对时返回false，filter不变
+    bool load(const std::string &file_name);
+
+   private:
+    void allocate(size_t num_blocks);
+};
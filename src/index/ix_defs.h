@@ -3,17 +3,36 @@
 #include "defs.h"
 #include "storage/buffer_pool_manager.h"
 
+constexpr int IX_MAX_INDEX_COLS = 8;  // 组合索引最多的列数
+constexpr int IX_COMPRESS_MIN_COL_LEN = 16;  // key不短于它时叶子结点做前缀压缩，更短的key（int、float等）保持定长
+constexpr int IX_SIMD_SEARCH_MAX_KEYS = 32;  // 结点内不超过这么多个整数key时用SIMD顺序比较，更多时用二分查找
+constexpr int IX_HASH_DIR_SLOTS = 512;       // 哈希索引每个目录页中的目录项个数
+constexpr int IX_HASH_MAX_DIR_PAGES = 256;   // 哈希索引最多的目录页个数，目录页的页号保存在文件头中
+constexpr int IX_HASH_MAX_GLOBAL_DEPTH = 17;  // 目录项最多为IX_HASH_DIR_SLOTS * IX_HASH_MAX_DIR_PAGES个
+static_assert((1 << IX_HASH_MAX_GLOBAL_DEPTH) == IX_HASH_DIR_SLOTS * IX_HASH_MAX_DIR_PAGES);
+
 struct IxFileHdr {
     page_id_t first_free_page_no;
     int num_pages;        // disk pages
     page_id_t root_page;  // root page no
-    ColType col_type;
-    int col_len;      // ColMeta->len
+    ColType col_type;  // 组合索引中为第一列的类型
+    int col_len;      // ColMeta->len；组合索引中为各列长度之和，即索引键的长度
     int btree_order;  // children per page 每个结点最多可插入的键值对数量
     int keys_size;  // keys_size = (btree_order + 1) * col_len
     // first_leaf初始化之后没有进行修改，只不过是在测试文件中遍历叶子结点的时候用了
     page_id_t first_leaf;  // 在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf;
+    // 以上是最初的索引文件头；以下的字段都是后加的，旧的索引文件中文件头之后的字节为0，读出来都是0/false
+    bool blink;  // B-link模式：结点有high key和右兄弟指针，查找不加root_latch_，删除不合并结点
+    int col_num;  // 索引列的个数，大于1时是组合索引，key由各列按顺序拼接而成（旧的索引文件中为0，按单列处理）
+    ColType col_types[IX_MAX_INDEX_COLS];  // 组合索引各列的类型
+    int col_lens[IX_MAX_INDEX_COLS];       // 组合索引各列的长度
+    bool normalized;  // 结点中的key是否为保序的二进制编码（见ix_encode_key），旧的索引文件中为false，按类型比较
+    bool compressed;  // 叶子结点是否做前缀压缩：结点内所有key的公共前缀只存一份，槽位里只存后缀（B-link树不压缩）
+    bool hash;  // 可扩展哈希索引：叶子结点就是哈希桶，由目录按key的哈希值找到，只支持等值查找（见IxIndexHandle）
+    int hash_global_depth;                          // 目录有2^hash_global_depth项
+    page_id_t hash_dir_pages[IX_HASH_MAX_DIR_PAGES];  // 各目录页的页号，第i页存放第i * IX_HASH_DIR_SLOTS项开始的目录项
+    int val_len;  // 每个值的长度：普通索引为sizeof(Rid)；聚簇表的主键索引为整条记录，其二级索引为主键（旧的索引文件中为0，即sizeof(Rid)）
 };
 
 struct IxPageHdr {
@@ -21,9 +40,21 @@ struct IxPageHdr {
     page_id_t parent;  // its parent's page_no
     int num_key;  // # current keys (always equals to #child - 1) 已插入的keys数量，key_idx∈[0,num_key)
     bool is_leaf;
+    bool has_high_key;    // B-link模式下除每层最右的结点外都有high key，存放在页面末尾
+    uint16_t prefix_len;  // 前缀压缩的叶子结点中key的公共前缀长度，前缀存放在页头之后
     page_id_t prev_leaf;  // previous leaf node's page_no, effective only when is_leaf is true
-    page_id_t next_leaf;  // next leaf node's page_no, effective only when is_leaf is true
+    page_id_t next_leaf;  // next leaf node's page_no; B-link模式下内部结点也用它指向右兄弟
+};
+
+/**
+ * @brief 哈希索引的目录页：第i项是哈希值的低hash_global_depth位为i的key所在的桶
+ * @note 桶的局部深度为d时，低d位相同的2^(global_depth - d)个目录项都指向它
+ */
+struct IxHashDirPage {
+    page_id_t buckets[IX_HASH_DIR_SLOTS];
+    uint8_t local_depths[IX_HASH_DIR_SLOTS];
 };
+static_assert(sizeof(IxHashDirPage) <= PAGE_SIZE);
 
 // 这个其实和Rid结构类似
 struct Iid {
@@ -1,13 +1,47 @@
 #include "ix_index_handle.h"
 
+#include <unistd.h>
+
+#include <fstream>
+
 #include "ix_scan.h"
 
 IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
     : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
     // init file_hdr_
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
-    // disk_manager管理的fd对应的文件中，设置从原来编号+1开始分配page_no
-    disk_manager_->set_fd2pageno(fd, disk_manager_->get_fd2pageno(fd) + 1);
+    // num_pages是文件中的页面个数（包括空闲链表中的页面），新的page_no从文件末尾开始分配；
+    // 旧的索引文件中释放结点时num_pages减少了，以文件大小为准
+    int file_pages = disk_manager_->GetFileSize(disk_manager_->GetFileName(fd)) / PAGE_SIZE;
+    file_hdr_.num_pages = std::max(file_hdr_.num_pages, file_pages);
+    disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
+    // 旧的索引文件头中没有val_len（读出来为0），值都是rid
+    if (file_hdr_.val_len == 0) {
+        file_hdr_.val_len = sizeof(Rid);
+    }
+    if (bloom_enabled()) {
+        // 读入后删掉文件，之后没有正常关闭（没有再写出）时下次打开从叶子重建，不会用到过时的filter
+        std::string bloom_name = disk_manager_->GetFileName(fd) + ".bloom";
+        if (bloom_.load(bloom_name)) {
+            unlink(bloom_name.c_str());
+        } else {
+            rebuild_bloom_locked();
+        }
+    }
+}
+
+/**
+ * @brief 把上层传入的key编码为结点中存放的形式（见ix_encode_key）
+ *
+ * @param buf 编码结果存放在这里，长度至少为col_len
+ * @return 编码后的key；旧的索引文件不编码，直接返回key
+ */
+const char *IxIndexHandle::encode_key(const char *key, char *buf) const {
+    if (!file_hdr_.normalized) {
+        return key;
+    }
+    ix_encode_key(key, buf, file_hdr_);
+    return buf;
 }
 
 /**
@@ -24,22 +58,283 @@ IxNodeHandle *IxIndexHandle::FindLeafPage(const char *key, Operation operation,
     // 1. 获取根节点
     // 2. 从根节点开始不断向下查找目标key
     // 3. 找到包含该key值的叶子结点停止查找，并返回叶子节点
+    if (file_hdr_.blink) {
+        return blink_find_leaf(key, operation, nullptr);
+    }
+    if (file_hdr_.hash) {
+        return hash_find_bucket(key, operation);
+    }
+    // 调用者已经持有root_latch_，查找期间根结点和树的结构不会改变；
+    // latch crabbing：先锁住孩子结点再释放父结点，返回的叶子结点仍持有latch
     IxNodeHandle * cur_node = FetchNode(file_hdr_.root_page);//获得根节点
+    latch_node(cur_node, operation);
     while(!cur_node->page_hdr->is_leaf){//直到找到了对应的叶子节点
-        // printf("当前的根节点是%d\n",file_hdr_.root_page);
-        // printf("当前的page_no是%d\n",cur_node->GetPageNo());
         page_id_t page_no_now = cur_node->InternalLookup(key);
-        // printf("得到的page_no是%d\n",page_no_now);
-        //unpin page
-        buffer_pool_manager_->UnpinPage({fd_,page_no_now},false);
+        IxNodeHandle *child_node = FetchNode(page_no_now);
+        latch_node(child_node, operation);
+        //孩子已经锁住，释放当前的内部结点（而不是还没有fetch的孩子结点）
+        release_node(cur_node, operation, false);
         //更新cur_node
-        cur_node = FetchNode(page_no_now);        
+        cur_node = child_node;
     }
-    //注意这里现在不用unpin 叶子节点，因为叶子节点现在还没有用完，
-    // buffer_pool_manager_->UnpinPage(PageId(fd_,page_no_now),false);
+    //注意这里现在不用unpin 叶子节点，因为叶子节点现在还没有用完，由调用者release_node
     return cur_node;
 }
 
+/**
+ * @brief B-link模式下key是否已经被并发的分裂移到了node的右兄弟中
+ */
+bool IxIndexHandle::need_move_right(IxNodeHandle *node, const char *key) const {
+    return node->HasHighKey() && ix_key_compare(key, node->get_high_key(), file_hdr_) >= 0;
+}
+
+/**
+ * @brief B-link模式下的FindLeafPage：任何时刻只持有一个结点的latch
+ *
+ * @param path 不为空时记录从根到叶子经过的内部结点（每层向右移动之后的那个）
+ * @note 结点在B-link模式下不会被删除，所以可以先释放当前结点再去锁孩子或右兄弟
+ */
+IxNodeHandle *IxIndexHandle::blink_find_leaf(const char *key, Operation operation, std::vector<page_id_t> *path) {
+    IxNodeHandle *node = FetchNode(file_hdr_.root_page);
+    latch_node(node, operation);
+    while (true) {
+        while (need_move_right(node, key)) {
+            page_id_t right = node->GetNextLeaf();
+            release_node(node, operation, false);
+            node = FetchNode(right);
+            latch_node(node, operation);
+        }
+        if (node->IsLeafPage()) {
+            return node;
+        }
+        if (path != nullptr) {
+            path->push_back(node->GetPageNo());
+        }
+        page_id_t child = node->InternalLookup(key);
+        release_node(node, operation, false);
+        node = FetchNode(child);
+        latch_node(node, operation);
+    }
+}
+
+/**
+ * @brief B-link模式下会引起分裂的插入
+ *
+ * @note 分裂由smo_latch_串行执行，内部结点只会被持有smo_latch_的线程修改，path中就是各层真正的父结点。
+ * 每次分裂一个结点并设置好它的high key和右兄弟后才锁父结点、释放该结点，
+ * 在新结点被插入父结点之前，并发的查找通过右兄弟指针找到它
+ */
+bool IxIndexHandle::blink_insert(const char *key, const char *value, Transaction *transaction) {
+    std::scoped_lock lock{smo_latch_};
+    // 路径上的内部结点不会被修改，只有叶子结点加写锁
+    std::vector<page_id_t> path;
+    IxNodeHandle *node = blink_find_leaf(key, Operation::INSERT, &path);
+    auto release_write = [&](IxNodeHandle *n) {
+        n->page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(n->GetPageId(), true);
+        delete n;
+    };
+    int num_before_insert = node->GetSize();
+    if (node->Insert(key, value) == num_before_insert) {
+        release_write(node);
+        return false;
+    }
+    while (node->GetSize() >= (node->IsLeafPage() ? node->GetMaxSize() - 1 : node->GetMaxSize())) {
+        IxNodeHandle *new_node = Split(node);
+        if (node->IsLeafPage() && file_hdr_.last_leaf == node->GetPageNo()) {
+            file_hdr_.last_leaf = new_node->GetPageNo();
+        }
+        std::vector<char> new_key(new_node->get_key(0), new_node->get_key(0) + file_hdr_.col_len);
+        Rid new_child = {new_node->GetPageNo(), -1};
+        buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
+        delete new_node;
+        if (path.empty()) {
+            // 分裂的是根结点，新建根
+            IxNodeHandle *new_root = CreateNode();
+            new_root->page->WLatch();
+            *new_root->page_hdr = {
+                .next_free_page_no = IX_NO_PAGE,
+                .parent = IX_NO_PAGE,
+                .num_key = 0,
+                .is_leaf = false,
+                .has_high_key = false,
+                .prev_leaf = IX_NO_PAGE,
+                .next_leaf = IX_NO_PAGE,
+            };
+            new_root->Insert(node->get_key(0), Rid{node->GetPageNo(), -1});
+            new_root->Insert(new_key.data(), new_child);
+            page_id_t root_page = new_root->GetPageNo();
+            release_write(new_root);
+            release_write(node);
+            file_hdr_.root_page = root_page;
+            return true;
+        }
+        IxNodeHandle *parent = FetchNode(path.back());
+        path.pop_back();
+        parent->page->WLatch();
+        release_write(node);
+        parent->Insert(new_key.data(), new_child);
+        node = parent;
+    }
+    release_write(node);
+    return true;
+}
+
+/**
+ * @brief 哈希索引中第slot个目录项所在的目录页（pin住，由调用者unpin）
+ */
+IxHashDirPage *IxIndexHandle::fetch_hash_dir(uint32_t slot, Page **page) const {
+    *page = buffer_pool_manager_->FetchPage(PageId{fd_, file_hdr_.hash_dir_pages[slot / IX_HASH_DIR_SLOTS]});
+    return reinterpret_cast<IxHashDirPage *>((*page)->GetData());
+}
+
+/**
+ * @brief 哈希索引中key所在的桶，按operation加latch后返回
+ * @note 目录只在独占root_latch_时修改（桶分裂），调用者持有root_latch_，读目录页不用加latch
+ */
+IxNodeHandle *IxIndexHandle::hash_find_bucket(const char *key, Operation operation) const {
+    uint32_t slot = ix_hash_key(key, file_hdr_.col_len) & ((1u << file_hdr_.hash_global_depth) - 1);
+    Page *dir_page;
+    page_id_t bucket_no = fetch_hash_dir(slot, &dir_page)->buckets[slot % IX_HASH_DIR_SLOTS];
+    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
+    IxNodeHandle *bucket = FetchNode(bucket_no);
+    latch_node(bucket, operation);
+    return bucket;
+}
+
+/**
+ * @brief 哈希索引的插入：桶满时分裂，直到key所在的桶放得下
+ * @note 调用者独占root_latch_，key已经编码
+ */
+bool IxIndexHandle::hash_insert(const char *key, const char *value) {
+    while (true) {
+        IxNodeHandle *bucket = hash_find_bucket(key, Operation::INSERT);
+        if (bucket->GetSize() + 1 < bucket->GetMaxSize() - 1) {
+            int num_before_insert = bucket->GetSize();
+            bool is_insert = bucket->Insert(key, value) != num_before_insert;
+            release_node(bucket, Operation::INSERT, is_insert);
+            return is_insert;
+        }
+        int pos = bucket->lower_bound(key);
+        if (pos < bucket->GetSize() && bucket->compare_key(pos, key) == 0) {
+            release_node(bucket, Operation::INSERT, false);
+            return false;
+        }
+        hash_split(bucket, ix_hash_key(key, file_hdr_.col_len));
+    }
+}
+
+/**
+ * @brief 分裂哈希值为hash的key所在的桶bucket（已加写锁，函数返回时释放）
+ * @note 桶的局部深度d等于全局深度时先把目录加倍。哈希值第d位为1的键值对移到新桶中，
+ * 原来指向bucket的目录项中第d位为1的一半改为指向新桶，局部深度都变为d + 1。
+ * 新桶接在bucket之后的叶子链表中，遍历叶子链表仍能扫描到所有的键值对
+ */
+void IxIndexHandle::hash_split(IxNodeHandle *bucket, uint32_t hash) {
+    uint32_t slot = hash & ((1u << file_hdr_.hash_global_depth) - 1);
+    Page *dir_page;
+    int depth = fetch_hash_dir(slot, &dir_page)->local_depths[slot % IX_HASH_DIR_SLOTS];
+    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
+    if (depth == file_hdr_.hash_global_depth) {
+        if (depth == IX_HASH_MAX_GLOBAL_DEPTH) {
+            release_node(bucket, Operation::INSERT, false);
+            throw InternalError("IxIndexHandle::hash_split: hash directory is full");
+        }
+        hash_double();
+    }
+
+    IxNodeHandle *new_bucket = CreateNode();
+    *new_bucket->page_hdr = {
+        .next_free_page_no = IX_NO_PAGE,
+        .parent = IX_NO_PAGE,
+        .num_key = 0,
+        .is_leaf = true,
+        .has_high_key = false,
+        .prefix_len = 0,
+        .prev_leaf = bucket->GetPageNo(),
+        .next_leaf = bucket->GetNextLeaf(),
+    };
+    // 按哈希值的第depth位分成留下的和移走的两部分，各自保持原来的顺序
+    std::vector<char> keys[2], vals[2];
+    int num[2] = {0, 0};
+    for (int i = 0; i < bucket->GetSize(); i++) {
+        const char *key = bucket->get_key(i);
+        int side = ix_hash_key(key, file_hdr_.col_len) >> depth & 1;
+        keys[side].insert(keys[side].end(), key, key + file_hdr_.col_len);
+        vals[side].insert(vals[side].end(), bucket->get_val(i), bucket->get_val(i) + file_hdr_.val_len);
+        num[side]++;
+    }
+    bucket->SetSize(0);
+    for (int side = 0; side < 2; side++) {
+        IxNodeHandle *node = side == 0 ? bucket : new_bucket;
+        if (num[side] > 0) {
+            node->insert_pairs(0, keys[side].data(), vals[side].data(), num[side]);
+            node->SetSize(num[side]);
+        }
+    }
+
+    IxNodeHandle *next = FetchNode(bucket->GetNextLeaf());
+    latch_node(next, Operation::INSERT);
+    next->SetPrevLeaf(new_bucket->GetPageNo());
+    release_node(next, Operation::INSERT, true);
+    bucket->SetNextLeaf(new_bucket->GetPageNo());
+    if (file_hdr_.last_leaf == bucket->GetPageNo()) {
+        file_hdr_.last_leaf = new_bucket->GetPageNo();
+    }
+
+    // 低depth位与slot相同的目录项原来都指向bucket
+    uint32_t step = 1u << depth;
+    uint32_t dir_size = 1u << file_hdr_.hash_global_depth;
+    dir_page = nullptr;
+    for (uint32_t i = slot & (step - 1); i < dir_size; i += step) {
+        if (dir_page == nullptr || file_hdr_.hash_dir_pages[i / IX_HASH_DIR_SLOTS] != dir_page->GetPageId().page_no) {
+            if (dir_page != nullptr) {
+                buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), true);
+            }
+            fetch_hash_dir(i, &dir_page);
+        }
+        auto dir = reinterpret_cast<IxHashDirPage *>(dir_page->GetData());
+        dir->local_depths[i % IX_HASH_DIR_SLOTS] = depth + 1;
+        if (i & step) {
+            dir->buckets[i % IX_HASH_DIR_SLOTS] = new_bucket->GetPageNo();
+        }
+    }
+    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), true);
+
+    buffer_pool_manager_->UnpinPage(new_bucket->GetPageId(), true);
+    delete new_bucket;
+    release_node(bucket, Operation::INSERT, true);
+}
+
+/**
+ * @brief 把哈希索引的目录加倍：第i + 2^global_depth项复制第i项，需要时分配新的目录页
+ */
+void IxIndexHandle::hash_double() {
+    uint32_t dir_size = 1u << file_hdr_.hash_global_depth;
+    if (dir_size < IX_HASH_DIR_SLOTS) {
+        Page *dir_page;
+        auto dir = fetch_hash_dir(0, &dir_page);
+        memcpy(dir->buckets + dir_size, dir->buckets, dir_size * sizeof(page_id_t));
+        memcpy(dir->local_depths + dir_size, dir->local_depths, dir_size);
+        buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), true);
+    } else {
+        // 目录已经占满整数个目录页，逐页复制到新分配的目录页中
+        int num_dir_pages = dir_size / IX_HASH_DIR_SLOTS;
+        for (int i = 0; i < num_dir_pages; i++) {
+            Page *src;
+            fetch_hash_dir(i * IX_HASH_DIR_SLOTS, &src);
+            PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+            Page *dst = buffer_pool_manager_->NewPage(&new_page_id);
+            file_hdr_.num_pages++;
+            memcpy(dst->GetData(), src->GetData(), PAGE_SIZE);
+            file_hdr_.hash_dir_pages[num_dir_pages + i] = new_page_id.page_no;
+            buffer_pool_manager_->UnpinPage(src->GetPageId(), false);
+            buffer_pool_manager_->UnpinPage(new_page_id, true);
+        }
+    }
+    file_hdr_.hash_global_depth++;
+}
+
 /**
  * @brief 用于查找指定键在叶子结点中的对应的值result
  *
@@ -49,60 +344,713 @@ IxNodeHandle *IxIndexHandle::FindLeafPage(const char *key, Operation operation,
  * @return bool 返回目标键值对是否存在
  */
 bool IxIndexHandle::GetValue(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
     // Todo:
     // 1. 获取目标key值所在的叶子结点
     // 2. 在叶子节点中查找目标key值的位置，并读取key对应的rid
     // 3. 把rid存入result参数中
     // 提示：使用完buffer_pool提供的page之后，记得unpin page；记得处理并发的上锁
-    std::scoped_lock lock{root_latch_};
+    auto lock = shared_tree_latch();
+    if (bloom_enabled() && !bloom_.may_contain(bloom_hash(key))) {
+        return false;
+    }
     IxNodeHandle * target_leaf = FindLeafPage(key,Operation::FIND,transaction);
-    Rid *rid_now = new Rid;
+    Rid *rid_now = nullptr;
     bool is_find = target_leaf->LeafLookup(key,&rid_now);
     if(is_find)
         result->push_back(*rid_now);
-    buffer_pool_manager_->UnpinPage(target_leaf->GetPageId(),false);
+    release_node(target_leaf, Operation::FIND, false);
     return is_find;
 }
 
+/**
+ * @brief 同上，把key对应的值（长度为val_len）复制到value中
+ * @note 用于聚簇表：主键索引的值就是整条记录，二级索引的值是主键
+ */
+bool IxIndexHandle::GetValue(const char *key, char *value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
+    auto lock = shared_tree_latch();
+    if (bloom_enabled() && !bloom_.may_contain(bloom_hash(key))) {
+        return false;
+    }
+    IxNodeHandle *leaf = FindLeafPage(key, Operation::FIND, transaction);
+    int pos = leaf->lower_bound(key);
+    bool is_find = pos < leaf->GetSize() &&
+                   leaf->compare_key(pos, key) == 0;
+    if (is_find) {
+        memcpy(value, leaf->get_val(pos), file_hdr_.val_len);
+    }
+    release_node(leaf, Operation::FIND, false);
+    return is_find;
+}
+
+/**
+ * @brief 批量查找：把keys[i]对应的值（长度为val_len）复制到values + i * val_len中，(*found)[i]表示是否找到
+ * @note keys按key的顺序排列时，相邻的key大多落在同一个子树甚至同一个叶子中：保留从根到当前叶子的路径
+ * （各结点pin住并加读latch，记下每个结点的key范围），下一个key只需退回到范围包含它的最低的结点再向下查找，
+ * 同一个叶子中的key不再访问其他结点。keys无序时结果仍然正确，只是复用的路径少。
+ * B-link和哈希索引逐个查找
+ *
+ * @return 找到的key的个数
+ */
+int IxIndexHandle::GetValues(const std::vector<const char *> &keys, char *values, std::vector<bool> *found,
+                             Transaction *transaction) {
+    found->assign(keys.size(), false);
+    int num_found = 0;
+    if (file_hdr_.blink || file_hdr_.hash) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            (*found)[i] = GetValue(keys[i], values + i * file_hdr_.val_len, transaction);
+            num_found += (*found)[i];
+        }
+        return num_found;
+    }
+    // 路径上的一个结点：子树中的key在[lower, upper)中，nullptr表示无穷
+    struct PathNode {
+        IxNodeHandle *node;
+        const char *lower;
+        const char *upper;
+    };
+    auto lock = shared_tree_latch();
+    std::vector<PathNode> path;
+    char key_buf[IX_MAX_COL_LEN];
+    for (size_t i = 0; i < keys.size(); i++) {
+        const char *key = encode_key(keys[i], key_buf);
+        if (bloom_enabled() && !bloom_.may_contain(bloom_hash(key))) {
+            continue;
+        }
+        while (!path.empty() &&
+               ((path.back().lower != nullptr && ix_key_compare(key, path.back().lower, file_hdr_) < 0) ||
+                (path.back().upper != nullptr && ix_key_compare(key, path.back().upper, file_hdr_) >= 0))) {
+            release_node(path.back().node, Operation::FIND, false);
+            path.pop_back();
+        }
+        if (path.empty()) {
+            IxNodeHandle *root = FetchNode(file_hdr_.root_page);
+            latch_node(root, Operation::FIND);
+            path.push_back({root, nullptr, nullptr});
+        }
+        while (!path.back().node->IsLeafPage()) {
+            // 同InternalLookup：最后一个<=key的孩子，key比第一个key还小时是第一个孩子
+            PathNode &parent = path.back();
+            int idx = std::max(parent.node->upper_bound(key) - 1, 0);
+            const char *lower = idx > 0 ? parent.node->get_key(idx) : parent.lower;
+            const char *upper = idx + 1 < parent.node->GetSize() ? parent.node->get_key(idx + 1) : parent.upper;
+            IxNodeHandle *child = FetchNode(parent.node->ValueAt(idx));
+            latch_node(child, Operation::FIND);
+            path.push_back({child, lower, upper});
+        }
+        IxNodeHandle *leaf = path.back().node;
+        int pos = leaf->lower_bound(key);
+        if (pos < leaf->GetSize() && leaf->compare_key(pos, key) == 0) {
+            memcpy(values + i * file_hdr_.val_len, leaf->get_val(pos), file_hdr_.val_len);
+            (*found)[i] = true;
+            num_found++;
+        }
+    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        release_node(it->node, Operation::FIND, false);
+    }
+    return num_found;
+}
+
+/**
+ * @brief 用Bloom filter判断key是否可能存在，返回false时key一定不在索引中；没有filter时总是返回true
+ * @note 用于等值条件的索引扫描，在查找上下界之前排除不存在的key
+ *
+ * @param key 原始的key
+ */
+bool IxIndexHandle::may_contain(const char *key) {
+    if (!bloom_enabled()) {
+        return true;
+    }
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
+    auto lock = shared_tree_latch();
+    return bloom_.may_contain(bloom_hash(key));
+}
+
 /**
  * @brief 将指定键值对插入到B+树中
  *
  * @param (key, value) 要插入的键值对
  * @param transaction 事务指针
- * @return 是否插入成功
+ * @return 是否插入成功，key已存在时返回false
  */
 bool IxIndexHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    assert(file_hdr_.val_len == (int)sizeof(Rid));
+    return insert_entry(key, reinterpret_cast<const char *>(&value), transaction);
+}
+
+/**
+ * @brief 同上，value指向长度为val_len的值
+ */
+bool IxIndexHandle::insert_entry(const char *key, const char *value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
     // Todo:
     // 1. 查找key值应该插入到哪个叶子节点
     // 2. 在该叶子节点中插入键值对
     // 3. 如果结点已满，分裂结点，并把新结点的相关信息插入父节点
     // 提示：记得unpin page；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
-    std::scoped_lock lock{root_latch_};
+    {
+        // 乐观执行：只写锁叶子结点，插入后既不分裂、也不改变叶子的第一个key（不用维护父结点）时直接完成
+        auto lock = shared_tree_latch();
+        IxNodeHandle *leaf = FindLeafPage(key, Operation::INSERT, transaction);
+        // B-link树的父结点中的key只是子树的下界，不需要维护；哈希索引的桶没有父结点
+        if (leaf->GetSize() + 1 < leaf->GetMaxSizeWith(key) - 1 &&
+            (file_hdr_.blink || file_hdr_.hash || leaf->lower_bound(key) > 0)) {
+            int num_before_insert = leaf->GetSize();
+            bool is_insert = leaf->Insert(key, value) != num_before_insert;
+            // key进入叶子后才加入filter：重建filter要独占root_latch_，不会在两者之间从叶子重建而丢掉它
+            if (is_insert && bloom_enabled()) {
+                bloom_.add(bloom_hash(key));
+            }
+            release_node(leaf, Operation::INSERT, is_insert);
+            return is_insert;
+        }
+        release_node(leaf, Operation::INSERT, false);
+    }
+    if (file_hdr_.blink) {
+        return blink_insert(key, value, transaction);
+    }
+    if (file_hdr_.hash) {
+        std::unique_lock lock{root_latch_};
+        return hash_insert(key, value);
+    }
+    // 悲观执行：独占整棵树，从根重新查找
+    std::unique_lock lock{root_latch_};
+    if (bloom_enabled() && bloom_.is_full()) {
+        rebuild_bloom_locked();
+    }
     IxNodeHandle *insert_node = FindLeafPage(key,Operation::INSERT,transaction);//注意我们招到的这个节点还在被pin住，没有释放
+    // 前缀压缩的叶子插入前缀不同的key后前缀变短，可能放不下，先分裂，直到key所在的那一半能放下
+    while (insert_node->GetSize() + 1 > insert_node->GetMaxSizeWith(key)) {
+        IxNodeHandle *new_node = Split(insert_node);
+        std::vector<char> new_key(file_hdr_.col_len);
+        new_node->copy_key(0, new_key.data());
+        InsertIntoParent(insert_node, new_key.data(), new_node, transaction);
+        if (file_hdr_.last_leaf == insert_node->GetPageNo()) {
+            file_hdr_.last_leaf = new_node->GetPageNo();
+        }
+        new_node->page->WLatch();
+        if (ix_key_compare(key, new_key.data(), file_hdr_) >= 0) {
+            std::swap(insert_node, new_node);
+        }
+        release_node(new_node, Operation::INSERT, true);
+    }
     // printf("过了InsertEntry的findleafpage\n");
+    int num_before_insert = insert_node->GetSize();
     int num_after_insert = insert_node->Insert(key,value);
+    if (num_after_insert != num_before_insert && bloom_enabled()) {
+        bloom_.add(bloom_hash(key));
+    }
     // printf("插入后的num为%d\n",num_after_insert);
     if( insert_node->IsLeafPage() && (insert_node->GetSize() >= (insert_node->GetMaxSize() - 1))){//如果叶子节点大于等于btree_order，则分裂
         IxNodeHandle *new_node = Split(insert_node);
-        InsertIntoParent(insert_node,new_node->get_key(0),new_node,transaction);
+        std::vector<char> new_key(file_hdr_.col_len);
+        new_node->copy_key(0, new_key.data());
+        InsertIntoParent(insert_node,new_key.data(),new_node,transaction);
         if(file_hdr_.last_leaf == insert_node->GetPageNo()){
             file_hdr_.last_leaf = new_node->GetPageNo();
         }
         buffer_pool_manager_->UnpinPage(new_node->GetPageId(),true);
+        delete new_node;
     }
     if( ! insert_node->IsLeafPage() && (insert_node->GetSize() >= insert_node->GetMaxSize())){//如果非叶子节点大于等于MaxSize，则分裂
         IxNodeHandle *new_node = Split(insert_node);
         InsertIntoParent(insert_node,new_node->get_key(0),new_node,transaction);
         buffer_pool_manager_->UnpinPage(new_node->GetPageId(),true);
     }
-    if(insert_node->GetPageNo() == file_hdr_.first_leaf && ix_compare(insert_node->get_key(0),key,file_hdr_.col_type,file_hdr_.col_len) == 0){
+    if(insert_node->GetPageNo() == file_hdr_.first_leaf && insert_node->compare_key(0,key) == 0){
         maintain_parent(insert_node);
     }
-    buffer_pool_manager_->UnpinPage(insert_node->GetPageId(),true);
+    release_node(insert_node, Operation::INSERT, true);
+
+    return num_after_insert != num_before_insert;
+}
+
+/**
+ * @brief 在空的B+树上批量建树：先把有序的键值对依次填满叶子结点，再自底向上逐层构建内部结点
+ *
+ * @param entries 按key严格升序排列（无重复key）的键值对，key指向长度为col_len的数据
+ * @param transaction 事务指针
+ * @return 树为空并完成建树时返回true；树非空时不做任何修改并返回false，由上层逐条insert_entry
+ * @note 叶子结点从左到右依次装满，最后一个叶子不少于半满；内部结点每层的结点数为ceil(n / 容量)，
+ * 孩子在这些结点间平均分配，因此除根外每个结点都不少于半满；第一个叶子复用原来的根结点（IX_INIT_ROOT_PAGE），叶子链表的两端仍然连到leaf header
+ */
+bool IxIndexHandle::bulk_load(const std::vector<std::pair<const char *, Rid>> &entries, Transaction *transaction) {
+    assert(file_hdr_.val_len == (int)sizeof(Rid));
+    std::vector<std::pair<const char *, const char *>> raw_entries;
+    raw_entries.reserve(entries.size());
+    for (auto &entry : entries) {
+        raw_entries.emplace_back(entry.first, reinterpret_cast<const char *>(&entry.second));
+    }
+    return bulk_load(raw_entries, transaction);
+}
+
+/**
+ * @brief 同上，每个值指向长度为val_len的数据
+ */
+bool IxIndexHandle::bulk_load(const std::vector<std::pair<const char *, const char *>> &raw_entries,
+                              Transaction *transaction) {
+    // 先把所有key编码，编码不改变key之间的顺序
+    std::vector<char> encoded_keys;
+    std::vector<std::pair<const char *, const char *>> encoded_entries;
+    if (file_hdr_.normalized) {
+        encoded_keys.resize((size_t)raw_entries.size() * file_hdr_.col_len);
+        encoded_entries.reserve(raw_entries.size());
+        for (size_t i = 0; i < raw_entries.size(); i++) {
+            char *key = encoded_keys.data() + i * file_hdr_.col_len;
+            ix_encode_key(raw_entries[i].first, key, file_hdr_);
+            encoded_entries.emplace_back(key, raw_entries[i].second);
+        }
+    }
+    auto &entries = file_hdr_.normalized ? encoded_entries : raw_entries;
+    size_t pos = 0;
+    return bulk_build(
+        [&](const char **key, const char **val) {
+            if (pos == entries.size()) {
+                return false;
+            }
+            *key = entries[pos].first;
+            *val = entries[pos].second;
+            pos++;
+            return true;
+        },
+        1.0);
+}
+
+/**
+ * @brief 同上，键值对由外部排序的结果依次给出（CREATE INDEX），会先调用sorter->finish()
+ *
+ * @param fill_factor 叶子结点装填到容量的比例，给之后的插入留出空间，避免建好后马上分裂
+ * @return 树非空时返回false，此时可以继续从sorter中依次取出键值对逐条插入
+ */
+bool IxIndexHandle::bulk_load(IxSorter *sorter, Transaction *transaction, double fill_factor) {
+    sorter->finish();
+    return bulk_build([&](const char **key, const char **val) { return sorter->next(key, val); }, fill_factor);
+}
+
+/**
+ * @brief 同上，键值对来自多个线程各自排好序的结果的归并（并行的CREATE INDEX）
+ */
+bool IxIndexHandle::bulk_load(IxParallelSorter *sorter, Transaction *transaction, double fill_factor) {
+    sorter->finish();
+    return bulk_build([&](const char **key, const char **val) { return sorter->next(key, val); }, fill_factor);
+}
 
+/**
+ * @brief 批量建树的实现：从next依次取出编码后的、严格升序的键值对，从左到右装满叶子结点，再逐层构建内部结点
+ * @note 只在内存中保留两个叶子的键值对和每个叶子的第一个key，键值对的个数不需要事先知道
+ */
+bool IxIndexHandle::bulk_build(const std::function<bool(const char **key, const char **val)> &next,
+                               double fill_factor) {
+    std::unique_lock lock{root_latch_};
+    if (file_hdr_.hash) {
+        // 哈希索引没有顺序可以利用，逐条插入；桶按需分裂，索引非空时也可以直接插入
+        const char *key, *val;
+        while (next(&key, &val)) {
+            hash_insert(key, val);
+        }
+        return true;
+    }
+    // B-link模式下查找不加root_latch_，建树时每个结点都加写锁，新的根在最后才生效
+    std::unique_lock smo_lock{smo_latch_, std::defer_lock};
+    if (file_hdr_.blink) {
+        smo_lock.lock();
+    }
+    IxNodeHandle *root = FetchNode(file_hdr_.root_page);
+    bool is_empty = root->IsLeafPage() && root->GetSize() == 0;
+    buffer_pool_manager_->UnpinPage(root->GetPageId(), false);
+    if (!is_empty) {
+        return false;
+    }
+    build_tree(next, fill_factor);
     return true;
 }
 
+/**
+ * @brief bulk_build的建树部分：从空树（根结点是空的叶子）开始装填叶子、构建内部结点
+ * @note 调用者独占root_latch_，B-link模式下还持有smo_latch_
+ */
+void IxIndexHandle::build_tree(const std::function<bool(const char **key, const char **val)> &next,
+                               double fill_factor) {
+    auto common_prefix_len = [&](const char *a, const char *b) {
+        int len = 0;
+        while (len < file_hdr_.col_len && a[len] == b[len]) {
+            len++;
+        }
+        return len;
+    };
+    // 叶子结点的键值对数量达到最大个数减一就会分裂，再留出一个空位；
+    // 前缀压缩的叶子能放下的个数取决于其中第一个和最后一个key的公共前缀
+    auto leaf_capacity = [&](const char *first, const char *last) {
+        int max_size = file_hdr_.compressed ? ix_leaf_slot_num(file_hdr_, common_prefix_len(first, last))
+                                            : file_hdr_.btree_order + 1;
+        return max_size - 2;
+    };
+    int min_size = (file_hdr_.btree_order + 1) / 2;
+    auto leaf_target = [&](const char *first, const char *last) {
+        int capacity = leaf_capacity(first, last);
+        return std::min(capacity, std::max(min_size, (int)(capacity * fill_factor)));
+    };
+
+    // 每个叶子的第一个key和page_no，作为内部结点的键值对
+    std::vector<char> first_keys;
+    std::vector<page_id_t> leaf_pages;
+    IxNodeHandle *prev = nullptr;
+    auto write_leaf = [&](const char *entries, int size) {
+        size_t entry_len = file_hdr_.col_len + file_hdr_.val_len;
+        auto key_at = [&](int i) { return entries + i * entry_len; };
+        // 第一个叶子复用原来的根结点
+        IxNodeHandle *leaf = leaf_pages.empty() ? FetchNode(file_hdr_.root_page) : CreateNode();
+        leaf->page->WLatch();
+        leaf->page_hdr->next_free_page_no = IX_NO_PAGE;
+        leaf->page_hdr->parent = IX_NO_PAGE;
+        leaf->page_hdr->is_leaf = true;
+        leaf->page_hdr->has_high_key = false;
+        leaf->SetPrevLeaf(prev == nullptr ? IX_LEAF_HEADER_PAGE : prev->GetPageNo());
+        leaf->SetNextLeaf(IX_LEAF_HEADER_PAGE);
+        leaf->page_hdr->prefix_len = 0;
+        if (leaf->IsCompressed()) {
+            leaf->page_hdr->prefix_len = common_prefix_len(key_at(0), key_at(size - 1));
+            memcpy(leaf->prefix(), key_at(0), leaf->page_hdr->prefix_len);
+        }
+        for (int j = 0; j < size; j++) {
+            leaf->set_key(j, key_at(j));
+            leaf->set_val(j, key_at(j) + file_hdr_.col_len);
+        }
+        leaf->SetSize(size);
+        if (prev != nullptr) {
+            if (file_hdr_.blink) {
+                prev->SetHighKey(key_at(0));
+            }
+            prev->SetNextLeaf(leaf->GetPageNo());
+            prev->page->WUnlatch();
+            buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+            delete prev;
+        }
+        first_keys.insert(first_keys.end(), key_at(0), key_at(0) + file_hdr_.col_len);
+        leaf_pages.push_back(leaf->GetPageNo());
+        prev = leaf;
+    };
+
+    // 已经装满、还没有写出的叶子（pending）和正在装填的叶子（current）：
+    // 最后一个叶子太少时要和前一个叶子合并或从它的末尾借一些，所以前一个叶子晚一步写出
+    size_t entry_len = file_hdr_.col_len + file_hdr_.val_len;
+    std::vector<char> pending, current;
+    int pending_size = 0, current_size = 0;
+    const char *key, *val;
+    std::vector<uint64_t> hashes;  // 各key的哈希值，建完叶子后按key的个数重建Bloom filter
+    while (next(&key, &val)) {
+        if (bloom_enabled()) {
+            hashes.push_back(bloom_hash(key));
+        }
+        if (current_size > 0 && current_size + 1 > leaf_target(current.data(), key)) {
+            if (pending_size > 0) {
+                write_leaf(pending.data(), pending_size);
+            }
+            std::swap(pending, current);
+            pending_size = current_size;
+            current.clear();
+            current_size = 0;
+        }
+        current.insert(current.end(), key, key + file_hdr_.col_len);
+        current.insert(current.end(), val, val + file_hdr_.val_len);
+        current_size++;
+    }
+    if (pending_size > 0 && current_size < min_size) {
+        // 两个叶子放得下时合并成一个；否则最后一个叶子从前一个借到不少于最小结点的个数，前缀变为空也能放下
+        pending.insert(pending.end(), current.begin(), current.end());
+        int total = pending_size + current_size;
+        const char *last = pending.data() + (total - 1) * entry_len;
+        if (total <= leaf_capacity(pending.data(), last)) {
+            pending_size = total;
+            current_size = 0;
+        } else {
+            current_size = std::max(current_size, std::min(total / 2, min_size));
+            pending_size = total - current_size;
+            current.assign(pending.begin() + pending_size * entry_len, pending.end());
+        }
+    }
+    if (pending_size > 0) {
+        write_leaf(pending.data(), pending_size);
+    }
+    if (current_size > 0) {
+        write_leaf(current.data(), current_size);
+    }
+    if (bloom_enabled()) {
+        bloom_.reset(hashes.size() * 2);
+        for (uint64_t h : hashes) {
+            bloom_.add(h);
+        }
+    }
+    if (prev == nullptr) {
+        return;
+    }
+    prev->page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+    delete prev;
+
+    file_hdr_.first_leaf = leaf_pages.front();
+    file_hdr_.last_leaf = leaf_pages.back();
+    IxNodeHandle *leaf_header = FetchNode(IX_LEAF_HEADER_PAGE);
+    leaf_header->SetNextLeaf(file_hdr_.first_leaf);
+    leaf_header->SetPrevLeaf(file_hdr_.last_leaf);
+    buffer_pool_manager_->UnpinPage(leaf_header->GetPageId(), true);
+    delete leaf_header;
+
+    // 内部结点放满btree_order个孩子，每层的结点数为ceil(n / btree_order)，孩子在这些结点间平均分配
+    int internal_capacity = file_hdr_.btree_order;
+    // 当前层每个结点的(第一个key, page_no)，作为上一层的键值对
+    std::vector<std::pair<const char *, page_id_t>> level;
+    for (size_t i = 0; i < leaf_pages.size(); i++) {
+        level.emplace_back(first_keys.data() + i * file_hdr_.col_len, leaf_pages[i]);
+    }
+    while (level.size() > 1) {
+        std::vector<std::pair<const char *, page_id_t>> upper;
+        int num_children = level.size();
+        int num_nodes = (num_children + internal_capacity - 1) / internal_capacity;
+        IxNodeHandle *prev_node = nullptr;
+        for (int i = 0, pos = 0; i < num_nodes; i++) {
+            int size = num_children / num_nodes + (i < num_children % num_nodes ? 1 : 0);
+            IxNodeHandle *node = CreateNode();
+            node->page->WLatch();
+            node->page_hdr->next_free_page_no = IX_NO_PAGE;
+            node->page_hdr->parent = IX_NO_PAGE;
+            node->page_hdr->is_leaf = false;
+            node->page_hdr->has_high_key = false;
+            node->page_hdr->prev_leaf = IX_NO_PAGE;
+            node->page_hdr->next_leaf = IX_NO_PAGE;
+            for (int j = 0; j < size; j++) {
+                node->set_key(j, level[pos + j].first);
+                node->set_rid(j, Rid{level[pos + j].second, -1});
+            }
+            node->SetSize(size);
+            if (file_hdr_.blink) {
+                // B-link树内部结点链接右兄弟，不使用parent
+                if (i + 1 < num_nodes) {
+                    node->SetHighKey(level[pos + size].first);
+                }
+                if (prev_node != nullptr) {
+                    prev_node->SetNextLeaf(node->GetPageNo());
+                }
+            } else {
+                for (int j = 0; j < size; j++) {
+                    maintain_child(node, j);
+                }
+            }
+            upper.emplace_back(level[pos].first, node->GetPageNo());
+            if (prev_node != nullptr) {
+                prev_node->page->WUnlatch();
+                buffer_pool_manager_->UnpinPage(prev_node->GetPageId(), true);
+                delete prev_node;
+            }
+            prev_node = node;
+            pos += size;
+        }
+        prev_node->page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(prev_node->GetPageId(), true);
+        delete prev_node;
+        level = std::move(upper);
+    }
+    file_hdr_.root_page = level.front().second;
+}
+
+/**
+ * @brief 按叶子中现有的key重建Bloom filter，容量为key数的两倍
+ */
+void IxIndexHandle::rebuild_bloom() {
+    std::unique_lock lock{root_latch_};
+    rebuild_bloom_locked();
+}
+
+/**
+ * @brief 同上，调用者独占root_latch_（或者没有并发的访问，如构造函数中）
+ */
+void IxIndexHandle::rebuild_bloom_locked() {
+    if (!bloom_enabled()) {
+        return;
+    }
+    std::vector<uint64_t> hashes;
+    char key[IX_MAX_COL_LEN];
+    for (page_id_t page_no = file_hdr_.first_leaf; page_no != IX_LEAF_HEADER_PAGE;) {
+        IxNodeHandle *leaf = FetchNode(page_no);
+        for (int i = 0; i < leaf->GetSize(); i++) {
+            leaf->copy_key(i, key);
+            hashes.push_back(bloom_hash(key));
+        }
+        page_no = leaf->GetNextLeaf();
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        delete leaf;
+    }
+    bloom_.reset(hashes.size() * 2);
+    for (uint64_t h : hashes) {
+        bloom_.add(h);
+    }
+}
+
+/**
+ * @brief 关闭索引时把Bloom filter写到索引文件名 + ".bloom"中，下次打开时读入
+ */
+void IxIndexHandle::save_bloom() const {
+    if (bloom_enabled()) {
+        bloom_.save(disk_manager_->GetFileName(fd_) + ".bloom");
+    }
+}
+
+/**
+ * @brief REINDEX：把所有键值对按fill_factor重新装填成一棵新树，释放合并和删除留下的半空结点
+ * @note 先按叶子链表的顺序把键值对（已经编码、严格升序）写到临时文件中，然后截断索引文件，
+ * 只保留文件头、leaf header和根结点，再从临时文件自底向上建树，新的结点从文件前部按key的顺序分配。
+ * 进行中的IxScan pin着叶子但不加latch，要先等它们全部结束（丢弃仍被pin的页面会让扫描读到被重用的帧），
+ * 重建期间新的扫描等待；然后独占root_latch_（B-link模式下还持有smo_latch_），对本索引的操作等待重建完成，
+ * 表和其他索引不受影响。哈希索引的桶没有顺序，不重建
+ * @return 是否重建了
+ */
+bool IxIndexHandle::rebuild(double fill_factor) {
+    if (file_hdr_.hash) {
+        return false;
+    }
+    {
+        std::unique_lock lock{scan_latch_};
+        scan_cv_.wait(lock, [&] { return num_scans_ == 0 && !rebuilding_; });
+        rebuilding_ = true;
+    }
+    auto finish = [&]() {
+        std::scoped_lock lock{scan_latch_};
+        rebuilding_ = false;
+        scan_cv_.notify_all();
+    };
+    try {
+        rebuild_tree(fill_factor);
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    return true;
+}
+
+void IxIndexHandle::begin_scan() const {
+    std::unique_lock lock{scan_latch_};
+    scan_cv_.wait(lock, [&] { return !rebuilding_; });
+    num_scans_++;
+}
+
+void IxIndexHandle::end_scan() const {
+    std::scoped_lock lock{scan_latch_};
+    if (--num_scans_ == 0) {
+        scan_cv_.notify_all();
+    }
+}
+
+/**
+ * @brief rebuild的实现，调用者保证没有进行中的IxScan
+ */
+void IxIndexHandle::rebuild_tree(double fill_factor) {
+    std::unique_lock lock{root_latch_};
+    std::unique_lock smo_lock{smo_latch_, std::defer_lock};
+    if (file_hdr_.blink) {
+        smo_lock.lock();
+    }
+    size_t entry_len = file_hdr_.col_len + file_hdr_.val_len;
+    std::string dump_name = disk_manager_->GetFileName(fd_) + ".reindex";
+    std::fstream dump(dump_name, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!dump.is_open()) {
+        throw UnixError();
+    }
+    std::vector<char> entry(entry_len);
+    for (page_id_t page_no = file_hdr_.first_leaf; page_no != IX_LEAF_HEADER_PAGE;) {
+        IxNodeHandle *leaf = FetchNode(page_no);
+        for (int i = 0; i < leaf->GetSize(); i++) {
+            leaf->copy_key(i, entry.data());
+            memcpy(entry.data() + file_hdr_.col_len, leaf->get_val(i), file_hdr_.val_len);
+            dump.write(entry.data(), entry_len);
+        }
+        page_no = leaf->GetNextLeaf();
+        buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+        delete leaf;
+    }
+
+    // 丢弃根结点之后的所有页面，根结点恢复为空的叶子（与新建索引时相同）
+    buffer_pool_manager_->DiscardPages(fd_, IX_INIT_NUM_PAGES);
+    disk_manager_->truncate_file(fd_, IX_INIT_NUM_PAGES);
+    file_hdr_.num_pages = IX_INIT_NUM_PAGES;
+    file_hdr_.first_free_page_no = IX_NO_PAGE;
+    deferred_free_head_ = IX_NO_PAGE;
+    deferred_free_tail_ = IX_NO_PAGE;
+    file_hdr_.root_page = IX_INIT_ROOT_PAGE;
+    file_hdr_.first_leaf = IX_INIT_ROOT_PAGE;
+    file_hdr_.last_leaf = IX_INIT_ROOT_PAGE;
+    IxNodeHandle *root = FetchNode(IX_INIT_ROOT_PAGE);
+    memset(root->page->GetData(), 0, PAGE_SIZE);
+    *root->page_hdr = {
+        .next_free_page_no = IX_NO_PAGE,
+        .parent = IX_NO_PAGE,
+        .num_key = 0,
+        .is_leaf = true,
+        .prev_leaf = IX_LEAF_HEADER_PAGE,
+        .next_leaf = IX_LEAF_HEADER_PAGE,
+    };
+    buffer_pool_manager_->UnpinPage(root->GetPageId(), true);
+    delete root;
+    IxNodeHandle *leaf_header = FetchNode(IX_LEAF_HEADER_PAGE);
+    leaf_header->SetNextLeaf(IX_INIT_ROOT_PAGE);
+    leaf_header->SetPrevLeaf(IX_INIT_ROOT_PAGE);
+    buffer_pool_manager_->UnpinPage(leaf_header->GetPageId(), true);
+    delete leaf_header;
+
+    dump.seekg(0);
+    build_tree(
+        [&](const char **key, const char **val) {
+            if (!dump.read(entry.data(), entry_len)) {
+                return false;
+            }
+            *key = entry.data();
+            *val = entry.data() + file_hdr_.col_len;
+            return true;
+        },
+        fill_factor);
+    dump.close();
+    unlink(dump_name.c_str());
+}
+
+/**
+ * @brief 修改指定键对应的值（rid），不改变B+树的结构
+ *
+ * @param (key, value) 要修改的键值对，value为key新的rid
+ * @param transaction 事务指针
+ * @return 目标key是否存在
+ * @note 用于VACUUM：记录在堆文件中被搬动之后，只需原地修改叶子结点中的rid
+ */
+bool IxIndexHandle::update_entry(const char *key, const Rid &value, Transaction *transaction) {
+    assert(file_hdr_.val_len == (int)sizeof(Rid));
+    return update_entry(key, reinterpret_cast<const char *>(&value), transaction);
+}
+
+/**
+ * @brief 同上，value指向长度为val_len的值
+ * @note 用于聚簇表：不修改主键的UPDATE直接原地覆盖叶子结点中的记录
+ */
+bool IxIndexHandle::update_entry(const char *key, const char *value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
+    // 只修改叶子结点中的值，不会改变树的结构
+    auto lock = shared_tree_latch();
+    IxNodeHandle *leaf = FindLeafPage(key, Operation::UPDATE, transaction);
+    int pos = leaf->lower_bound(key);
+    bool is_find = pos < leaf->GetSize() &&
+                   leaf->compare_key(pos, key) == 0;
+    if (is_find) {
+        leaf->set_val(pos, value);
+    }
+    release_node(leaf, Operation::UPDATE, is_find);
+    return is_find;
+}
+
 /**
  * @brief 将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
  *
@@ -122,19 +1070,29 @@ IxNodeHandle *IxIndexHandle::Split(IxNodeHandle *node) {
     new_node->page_hdr->next_free_page_no = IX_NO_PAGE;
     new_node->page_hdr->parent = IX_NO_PAGE;
     new_node->page_hdr->num_key = 0;
+    new_node->page_hdr->has_high_key = false;
+    new_node->page_hdr->prefix_len = 0;
     int left_num = -1;
     if(node->IsLeafPage()){
         new_node->page_hdr->is_leaf = true;
-        left_num = (node->GetMaxSize() - 1)/2;
+        // 前缀压缩的叶子可能在没满时就要分裂（插入的key放不下），按实际个数平分
+        left_num = old_num/2;
     }else{
         new_node->page_hdr->is_leaf = false;
         left_num = node->GetMinSize();
     }
     
-    //开始分配
-    new_node->insert_pairs(0,node->get_key(left_num),node->get_rid(left_num),node->GetMaxSize()-node->GetMinSize());
+    //开始分配（前缀压缩的叶子中只存了后缀，先取出完整的key）
+    int move_num = old_num - left_num;
+    std::vector<char> move_keys((size_t)move_num * file_hdr_.col_len);
+    for (int i = 0; i < move_num; i++) {
+        node->copy_key(left_num + i, move_keys.data() + (size_t)i * file_hdr_.col_len);
+    }
+    new_node->insert_pairs(0,move_keys.data(),node->get_val(left_num),move_num);
     // printf("分裂后的new_node的第一个值是%d,第二个值是%d\n",*new_node->get_key(0),*new_node->get_key(1));
     node->SetSize(left_num);
+    // 两半的key的范围都变小了，前缀可能变长
+    node->Recompress();
     // printf("Split之后oldnode的值Size是%d\n",node->GetSize());
     new_node->SetSize(old_num-left_num);
     // printf("Split之后newnode的值Size是%d\n",new_node->GetSize());
@@ -143,17 +1101,33 @@ IxNodeHandle *IxIndexHandle::Split(IxNodeHandle *node) {
         new_node->page_hdr->is_leaf = true;
         new_node->SetNextLeaf(node->GetNextLeaf());
         new_node->SetPrevLeaf(node->GetPageNo());
+        // B-link模式下其他线程可能正在修改右边的叶子，从左到右加latch
         IxNodeHandle *node_next = FetchNode(node->GetNextLeaf());
+        latch_node(node_next, Operation::INSERT);
         node_next->SetPrevLeaf(new_node->GetPageNo());
+        release_node(node_next, Operation::INSERT, true);
         node->SetNextLeaf(new_node->GetPageNo());
         
     }else{
         new_node->page_hdr->is_leaf = false;
-        for(int i = 0; i < new_node->GetSize(); ++i){
-            maintain_child(new_node,i);
+        if (file_hdr_.blink) {
+            // B-link树不使用parent，内部结点也链接右兄弟
+            new_node->SetNextLeaf(node->GetNextLeaf());
+            node->SetNextLeaf(new_node->GetPageNo());
+        } else {
+            for(int i = 0; i < new_node->GetSize(); ++i){
+                maintain_child(new_node,i);
+            }
         }
 
     }
+    if (file_hdr_.blink) {
+        // 新结点继承原结点的high key，原结点的high key变为新结点的第一个key
+        if (node->HasHighKey()) {
+            new_node->SetHighKey(node->get_high_key());
+        }
+        node->SetHighKey(new_node->get_key(0));
+    }
     new_node->SetParentPageNo(node->GetParentPageNo());
     return new_node;
 }
@@ -191,10 +1165,12 @@ void IxIndexHandle::InsertIntoParent(IxNodeHandle *old_node, const char *key, Ix
         //建立关系
         Rid old_node_rid = {old_node->GetPageNo(),-1};//rid后面这个slot num貌似不太重要？因为在索引页里面我们只需要知道page_no能够找到那个页就够了，在leaf里面貌似才需要rid?
         Rid new_node_rid = {new_node->GetPageNo(),-1};
+        std::vector<char> old_first_key(file_hdr_.col_len);
+        old_node->copy_key(0, old_first_key.data());
         // new_root->insert_pair(0,old_node->get_key(0),old_node_rid);
-        new_root->Insert(old_node->get_key(0),old_node_rid);
+        new_root->Insert(old_first_key.data(),old_node_rid);
         // new_root->insert_pair(1,new_node->get_key(0),new_node_rid);
-        new_root->Insert(new_node->get_key(0),new_node_rid);
+        new_root->Insert(key,new_node_rid);
         new_node->SetParentPageNo(new_root->GetPageNo());
         old_node->SetParentPageNo(new_root->GetPageNo());
         file_hdr_.root_page = new_root->GetPageNo();
@@ -206,12 +1182,14 @@ void IxIndexHandle::InsertIntoParent(IxNodeHandle *old_node, const char *key, Ix
     IxNodeHandle *parent_node = FetchNode(old_node->GetParentPageNo());
     int pos = parent_node->find_child(old_node);
     Rid new_node_rid = {new_node->GetPageNo(),-1};
-    parent_node->insert_pair(pos+1,new_node->get_key(0),new_node_rid);
+    parent_node->insert_pair(pos+1,key,new_node_rid);
     parent_node->SetSize(parent_node->GetSize() + 1);
     if(parent_node->GetSize() >= parent_node->GetMaxSize()){
         // printf("----------------进入了递归过程-------------------------\n");
         IxNodeHandle * new_parent_node = Split(parent_node);
-        InsertIntoParent(parent_node,new_node->get_key(0),new_parent_node,transaction);
+        InsertIntoParent(parent_node,new_parent_node->get_key(0),new_parent_node,transaction);
+        buffer_pool_manager_->UnpinPage(new_parent_node->GetPageId(),true);
+        delete new_parent_node;
     }
 
     buffer_pool_manager_->UnpinPage(parent_node->GetPageId(),true);
@@ -227,20 +1205,41 @@ void IxIndexHandle::InsertIntoParent(IxNodeHandle *old_node, const char *key, Ix
  * @return 是否删除成功
  */
 bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
     // Todo:
     // 1. 获取该键值对所在的叶子结点
     // 2. 在该叶子结点中删除键值对
     // 3. 如果删除成功需要调用CoalesceOrRedistribute来进行合并或重分配操作，并根据函数返回结果判断是否有结点需要删除
     // 4. 如果需要并发，并且需要删除叶子结点，则需要在事务的delete_page_set中添加删除结点的对应页面；记得处理并发的上锁
-    std::scoped_lock lock{root_latch_};
+    {
+        // 乐观执行：只写锁叶子结点，删除的不是第一个key（不用维护父结点）且删除后不需要合并或重分配时直接完成
+        auto lock = shared_tree_latch();
+        IxNodeHandle *leaf = FindLeafPage(key, Operation::DELETE, transaction);
+        int pos = leaf->lower_bound(key);
+        if (pos == leaf->GetSize() || leaf->compare_key(pos, key) != 0) {
+            release_node(leaf, Operation::DELETE, false);
+            return false;
+        }
+        // B-link树删除后不合并结点，哈希索引不合并桶，总是在这里完成
+        int min_size = leaf->IsRootPage() ? 2 : leaf->GetMinSize() - 1;
+        if (file_hdr_.blink || file_hdr_.hash || (pos > 0 && leaf->GetSize() - 1 >= min_size)) {
+            leaf->erase_pair(pos);
+            release_node(leaf, Operation::DELETE, true);
+            return true;
+        }
+        release_node(leaf, Operation::DELETE, false);
+    }
+    // 悲观执行：独占整棵树，从根重新查找
+    std::unique_lock lock{root_latch_};
     IxNodeHandle *delete_node = FindLeafPage(key, Operation::DELETE, transaction);
     int num_before_delete = delete_node->GetSize();
-    char * first_key_before_delete = delete_node->get_key(0);
-    int before = *first_key_before_delete;
+    std::vector<char> first_key_before_delete(file_hdr_.col_len);
+    delete_node->copy_key(0, first_key_before_delete.data());
     delete_node->Remove(key);
     int num_after_delete = delete_node->GetSize();
     if(num_before_delete == num_after_delete){
-        buffer_pool_manager_->UnpinPage(delete_node->GetPageId(),true);
+        release_node(delete_node, Operation::DELETE, false);
         return false;
     }
     int is_delete = false;
@@ -252,14 +1251,12 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     }
     //最后都要看一下是不是第一个节点变了，并且保持一下
     //先说明一下，不一定对
-    char * first_key_after_delete = delete_node->get_key(0);
-    int after = *first_key_after_delete;
-    if((before != after) && !is_delete){
+    if(delete_node->GetSize() > 0 && delete_node->compare_key(0, first_key_before_delete.data()) != 0 && !is_delete){
         // printf("进入了entry的保持parent\n");
         maintain_parent(delete_node);
         // printf("过了delete_entry的保持parent\n");
     }
-    buffer_pool_manager_->UnpinPage(delete_node->GetPageId(),true);
+    release_node(delete_node, Operation::DELETE, true);
     return true;
 }
 
@@ -303,6 +1300,7 @@ bool IxIndexHandle::CoalesceOrRedistribute(IxNodeHandle *node, Transaction *tran
                     //表示brother的节点也不够用了
                     //先不管，跳过这里，看看后面右兄弟够不够
                     //注意，这里加了等号
+                    buffer_pool_manager_->UnpinPage(left_brother->GetPageId(), false);
                 }else{//表示左兄弟的节点够用，那么合并他们
                     // printf("重分配左兄弟\n");
                     Redistribute(left_brother,node,parent_node,child_id);//合并
@@ -318,7 +1316,7 @@ bool IxIndexHandle::CoalesceOrRedistribute(IxNodeHandle *node, Transaction *tran
                 IxNodeHandle *right_brother = FetchNode(parent_node->ValueAt(brother_id));
                 if(((right_brother->GetSize() <= (right_brother->GetMinSize() - 1)) && (right_brother->IsLeafPage())) || ((right_brother->GetSize() <= (right_brother->GetMinSize())) && (!right_brother->IsLeafPage()) )){
                     //表示right brother也不够用了，先不管，后面看
-
+                    buffer_pool_manager_->UnpinPage(right_brother->GetPageId(), false);
                 }else{
                     // printf("重分配右兄弟\n");
                     Redistribute(right_brother,node,parent_node,child_id);
@@ -386,7 +1384,6 @@ bool IxIndexHandle::AdjustRoot(IxNodeHandle *old_root_node) {
         //将它更新成新根
         new_root->SetParentPageNo(-1);//置为根
         file_hdr_.root_page = new_root->GetPageNo();
-        // file_hdr_.first_free_page_no = old_root_node->GetPageNo();
         if(old_root_node->IsLeafPage() && (old_root_node->GetPageNo() == file_hdr_.first_leaf)){
             file_hdr_.first_leaf = old_root_node->GetNextLeaf();
         }
@@ -399,17 +1396,8 @@ bool IxIndexHandle::AdjustRoot(IxNodeHandle *old_root_node) {
         return true;
 
     }else if(old_root_node->IsLeafPage() && old_root_node->GetSize() == 0){
-        // printf("根是叶子节点\n");
-        erase_leaf(old_root_node);
-        file_hdr_.root_page = -1;//表示没有根了
-        if(old_root_node->IsLeafPage() && (old_root_node->GetPageNo() == file_hdr_.first_leaf)){
-            file_hdr_.first_leaf = old_root_node->GetNextLeaf();
-        }
-        if(old_root_node->IsLeafPage() && (old_root_node->GetPageNo() == file_hdr_.last_leaf)){
-            file_hdr_.last_leaf = old_root_node->GetPrevLeaf();
-        }
-        release_node_handle(*old_root_node);
-        return true;
+        // 根叶子被删空时保留它作为空树的根（与新建索引时相同），否则之后的查找和插入都找不到根结点
+        return false;
     }else{
         return false;
     }
@@ -435,14 +1423,14 @@ void IxIndexHandle::Redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
     // 2. 从neighbor_node中移动一个键值对到node结点中
     // 3. 更新父节点中的相关信息，并且修改移动键值对对应孩字结点的父结点信息（maintain_child函数）
     // 注意：neighbor_node的位置不同，需要移动的键值对不同，需要分类讨论
+    // 前缀压缩的叶子中只存了后缀，移动的key先取出完整的再插入，插入时按需缩短前缀
+    std::vector<char> move_key(file_hdr_.col_len);
     if(index < parent->find_child(neighbor_node)){//表示它与右兄弟重分配
     // printf("与右兄弟重新分配\n");
-        memcpy(node->keys + file_hdr_.col_len * node->GetSize(), neighbor_node->keys, file_hdr_.col_len);
-        memcpy(node->rids + node->GetSize(), neighbor_node->rids,sizeof(Rid));
+        neighbor_node->copy_key(0, move_key.data());
+        node->insert_pair(node->GetSize(), move_key.data(), neighbor_node->get_val(0));
         node->SetSize(node->GetSize() + 1);
-        memmove(neighbor_node->keys, neighbor_node->keys + file_hdr_.col_len, file_hdr_.col_len * (neighbor_node->GetSize() - 1));
-        memmove(neighbor_node->rids, neighbor_node->rids + 1, sizeof(Rid) * (neighbor_node->GetSize() - 1));
-        neighbor_node->SetSize(neighbor_node->GetSize() - 1);
+        neighbor_node->erase_pair(0);
         maintain_parent(neighbor_node);
         // printf("neighbor page_no:%d, parent page_no %d\n",neighbor_node->GetPageNo(),parent->GetPageNo());
         // printf("可以通过maintain_parent\n");
@@ -451,12 +1439,11 @@ void IxIndexHandle::Redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
         }
     }else{//表示它与左兄弟重分配
     // printf("与左兄弟重分配\n");
-        memmove(node->keys + file_hdr_.col_len, node->keys, file_hdr_.col_len * node->GetSize());
-        memmove(node->rids + 1, node->rids, sizeof(Rid) * node->GetSize());
-        memcpy(node->keys, neighbor_node->keys + file_hdr_.col_len * (neighbor_node->GetSize() - 1), file_hdr_.col_len);
-        memcpy(node->rids, neighbor_node->rids + (neighbor_node->GetSize() - 1), sizeof(Rid));
+        int last = neighbor_node->GetSize() - 1;
+        neighbor_node->copy_key(last, move_key.data());
+        node->insert_pair(0, move_key.data(), neighbor_node->get_val(last));
         node->SetSize(node->GetSize() + 1);
-        neighbor_node->SetSize(neighbor_node->GetSize() - 1);
+        neighbor_node->SetSize(last);
         maintain_parent(node);
         // printf("neighbor page_no:%d, parent page_no %d\n",neighbor_node->GetPageNo(),parent->GetPageNo());
         // printf("可以通过maintain_parent\n");
@@ -498,9 +1485,16 @@ bool IxIndexHandle::Coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
     //前面已经交换完了，只是换了个名字，这就是为什么这个函数要传入二级指针的原因
     //现在，我们都默认为左边是neighbor 右边是node
     int col_len = file_hdr_.col_len;
-    memcpy((*neighbor_node)->keys + (*neighbor_node)->GetSize() * col_len, (*node)->keys, col_len * (*node)->GetSize());
-    memcpy((*neighbor_node)->rids + (*neighbor_node)->GetSize(), (*node)->rids, sizeof(Rid) * (*node)->GetSize());
-    (*neighbor_node)->SetSize((*neighbor_node)->GetSize() + (*node)->GetSize());
+    int move_num = (*node)->GetSize();
+    if (move_num > 0) {
+        // 前缀压缩的叶子中只存了后缀，先取出完整的key；合并后的结点不超过两个最小结点，缩短前缀后也放得下
+        std::vector<char> move_keys((size_t)move_num * col_len);
+        for (int i = 0; i < move_num; i++) {
+            (*node)->copy_key(i, move_keys.data() + (size_t)i * col_len);
+        }
+        (*neighbor_node)->insert_pairs((*neighbor_node)->GetSize(), move_keys.data(), (*node)->get_val(0), move_num);
+        (*neighbor_node)->SetSize((*neighbor_node)->GetSize() + move_num);
+    }
     // printf("neighbor的最新Size为%d\n",(*neighbor_node)->GetSize());
     for(int i = 0; i < (*neighbor_node)->GetSize(); ++i){
         // printf("%d ",i);
@@ -556,22 +1550,69 @@ IxNodeHandle *IxIndexHandle::FetchNode(int page_no) const {
     return node;
 }
 
+/**
+ * @brief 查找和不改变树结构的修改持有的root_latch_，B-link模式下不需要
+ */
+std::shared_lock<std::shared_mutex> IxIndexHandle::shared_tree_latch() const {
+    if (file_hdr_.blink) {
+        return std::shared_lock<std::shared_mutex>(root_latch_, std::defer_lock);
+    }
+    return std::shared_lock<std::shared_mutex>(root_latch_);
+}
+
+/**
+ * @brief 给结点加latch：叶子结点在插入、删除、修改时加写锁，其余情况加读锁
+ */
+void IxIndexHandle::latch_node(IxNodeHandle *node, Operation operation) const {
+    if (node->IsLeafPage() && operation != Operation::FIND) {
+        node->page->WLatch();
+    } else {
+        node->page->RLatch();
+    }
+}
+
+/**
+ * @brief 释放latch_node加的latch，然后unpin并释放结点
+ */
+void IxIndexHandle::release_node(IxNodeHandle *node, Operation operation, bool is_dirty) const {
+    if (node->IsLeafPage() && operation != Operation::FIND) {
+        node->page->WUnlatch();
+    } else {
+        node->page->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), is_dirty);
+    delete node;
+}
+
 /**
  * @brief 创建一个新结点
  *
  * @return IxNodeHandle*
  * @note pin the page, remember to unpin it outside!
  * 注意：对于Index的处理是，删除某个页面后，认为该被删除的页面是free_page
- * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
- * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
+ * 被删除的页面以IxPageHdr::next_free_page_no串成链表，first_free_page_no是最近被删除的页面，初始为IX_NO_PAGE
+ * 新结点优先复用链表头部的页面，链表为空时才在文件末尾分配新的页面
+ * 有扫描进行中时删除的页面先放在延迟释放的链表中（见release_node_handle），没有扫描时才并入空闲链表
  * 与Record的处理不同，Record将未插入满的记录页认为是free_page
  */
 IxNodeHandle *IxIndexHandle::CreateNode() {
+    {
+        std::scoped_lock lock{scan_latch_};
+        if (num_scans_ == 0) {
+            reclaim_deferred_pages();
+        }
+    }
+    if (file_hdr_.first_free_page_no != IX_NO_PAGE) {
+        // 空闲链表中的页面上不会有扫描停留，可以直接复用
+        Page *page = buffer_pool_manager_->FetchPage(PageId{fd_, file_hdr_.first_free_page_no});
+        file_hdr_.first_free_page_no = reinterpret_cast<IxPageHdr *>(page->GetData())->next_free_page_no;
+        memset(page->GetData(), 0, PAGE_SIZE);
+        return new IxNodeHandle(&file_hdr_, page);
+    }
     file_hdr_.num_pages++;
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
     // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
     Page *page = buffer_pool_manager_->NewPage(&new_page_id);
-    // 注意，和Record的free_page定义不同，此处【不能】加上：file_hdr_.first_free_page_no = page->GetPageId().page_no
     IxNodeHandle *node = new IxNodeHandle(&file_hdr_, page);
     return node;
 }
@@ -589,12 +1630,13 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
         int rank = parent->find_child(curr);
         char *parent_key = parent->get_key(rank);
         // char *child_max_key = curr.get_key(curr.page_hdr->num_key - 1);
-        char *child_first_key = curr->get_key(0);
-        if (memcmp(parent_key, child_first_key, file_hdr_.col_len) == 0) {
+        std::vector<char> child_first_key(file_hdr_.col_len);
+        curr->copy_key(0, child_first_key.data());
+        if (memcmp(parent_key, child_first_key.data(), file_hdr_.col_len) == 0) {
             assert(buffer_pool_manager_->UnpinPage(parent->GetPageId(), true));
             break;
         }
-        memcpy(parent_key, child_first_key, file_hdr_.col_len);  // 修改了parent node
+        memcpy(parent_key, child_first_key.data(), file_hdr_.col_len);  // 修改了parent node
         curr = parent;
 
         assert(buffer_pool_manager_->UnpinPage(parent->GetPageId(), true));
@@ -619,11 +1661,44 @@ void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 删除node时，把它的页面放到空闲链表的头部，之后CreateNode复用
+ * @note 调用者仍pin着node，之后要以dirty的方式unpin
+ * 有IxScan进行中时，扫描可能停在node上，之后沿它原来的next_leaf继续，所以先放到延迟释放的链表中，
+ * 所有扫描结束后再复用；是否复用只看登记的扫描个数，不看页面的pin_count
  *
  * @param node
  */
-void IxIndexHandle::release_node_handle(IxNodeHandle &node) { file_hdr_.num_pages--; }
+void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
+    std::scoped_lock lock{scan_latch_};
+    if (num_scans_ > 0) {
+        node.page_hdr->next_free_page_no = deferred_free_head_;
+        deferred_free_head_ = node.GetPageNo();
+        if (deferred_free_tail_ == IX_NO_PAGE) {
+            deferred_free_tail_ = node.GetPageNo();
+        }
+        return;
+    }
+    reclaim_deferred_pages();
+    node.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
+    file_hdr_.first_free_page_no = node.GetPageNo();
+}
+
+/**
+ * @brief 把延迟释放的页面整体并入空闲链表的头部
+ * @note 调用者保证没有进行中的IxScan，并且独占root_latch_（或者索引正在关闭）
+ */
+void IxIndexHandle::reclaim_deferred_pages() {
+    if (deferred_free_head_ == IX_NO_PAGE) {
+        return;
+    }
+    IxNodeHandle *tail = FetchNode(deferred_free_tail_);
+    tail->page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
+    buffer_pool_manager_->UnpinPage(tail->GetPageId(), true);
+    delete tail;
+    file_hdr_.first_free_page_no = deferred_free_head_;
+    deferred_free_head_ = IX_NO_PAGE;
+    deferred_free_tail_ = IX_NO_PAGE;
+}
 
 /**
  * @brief 将node的第child_idx个孩子结点的父节点置为node
@@ -649,11 +1724,54 @@ void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const {
     IxNodeHandle *node = FetchNode(iid.page_no);
+    latch_node(node, Operation::FIND);
     if (iid.slot_no >= node->GetSize()) {
+        release_node(node, Operation::FIND, false);
         throw IndexEntryNotFoundError();
     }
-    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);  // unpin it!
-    return *node->get_rid(iid.slot_no);
+    Rid rid = *node->get_rid(iid.slot_no);
+    release_node(node, Operation::FIND, false);  // unpin it!
+    return rid;
+}
+
+/**
+ * @brief 把iid位置上的值（长度为val_len）复制到val中，用于遍历聚簇表的叶子结点
+ */
+void IxIndexHandle::get_val(const Iid &iid, char *val) const {
+    IxNodeHandle *node = FetchNode(iid.page_no);
+    latch_node(node, Operation::FIND);
+    if (iid.slot_no >= node->GetSize()) {
+        release_node(node, Operation::FIND, false);
+        throw IndexEntryNotFoundError();
+    }
+    copy_entry(node, iid.slot_no, nullptr, val);
+    release_node(node, Operation::FIND, false);
+}
+
+/**
+ * @brief 读取叶子结点中iid处的key（还原为原始形式）和值，用于只扫描索引的查询
+ */
+void IxIndexHandle::get_entry(const Iid &iid, char *key, char *val) const {
+    IxNodeHandle *node = FetchNode(iid.page_no);
+    latch_node(node, Operation::FIND);
+    if (iid.slot_no >= node->GetSize()) {
+        release_node(node, Operation::FIND, false);
+        throw IndexEntryNotFoundError();
+    }
+    copy_entry(node, iid.slot_no, key, val);
+    release_node(node, Operation::FIND, false);
+}
+
+/**
+ * @brief 复制已加latch的叶子结点中第slot_no个key（还原为原始形式，key为nullptr时不复制）和值
+ */
+void IxIndexHandle::copy_entry(IxNodeHandle *node, int slot_no, char *key, char *val) const {
+    if (key != nullptr) {
+        char key_buf[IX_MAX_COL_LEN];
+        node->copy_key(slot_no, key_buf);
+        ix_decode_key(key_buf, key, file_hdr_);
+    }
+    memcpy(val, node->get_val(slot_no), file_hdr_.val_len);
 }
 
 /** --以下函数将用于lab3执行层-- */
@@ -666,16 +1784,22 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const {
  * 可用*(int *)key转换回去
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
     // int int_key = *(int *)key;
     // printf("my_lower_bound key=%d\n", int_key);
 
+    auto lock = shared_tree_latch();
     IxNodeHandle *node = FindLeafPage(key, Operation::FIND, nullptr);
     int key_idx = node->lower_bound(key);
-
+    bool is_leaf_end = key_idx == node->GetSize();
     Iid iid = {.page_no = node->GetPageNo(), .slot_no = key_idx};
 
     // unpin leaf node
-    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+    release_node(node, Operation::FIND, false);
+    if (is_leaf_end) {
+        iid = next_valid_iid(iid);
+    }
     return iid;
 }
 
@@ -686,22 +1810,23 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
+    char key_buf[IX_MAX_COL_LEN];
+    key = encode_key(key, key_buf);
     // int int_key = *(int *)key;
     // printf("my_upper_bound key=%d\n", int_key);
 
+    auto lock = shared_tree_latch();
     IxNodeHandle *node = FindLeafPage(key, Operation::FIND, nullptr);
     int key_idx = node->upper_bound(key);
+    bool is_leaf_end = key_idx == node->GetSize();
+    Iid iid = {.page_no = node->GetPageNo(), .slot_no = key_idx};
 
-    Iid iid;
-    if (key_idx == node->GetSize()) {
-        // 这种情况无法根据iid找到rid，即后续无法调用ih->get_rid(iid)
-        iid = leaf_end();
-    } else {
-        iid = {.page_no = node->GetPageNo(), .slot_no = key_idx};
+    // unpin leaf node（要先释放它的latch再去取后面的叶子）
+    release_node(node, Operation::FIND, false);
+    if (is_leaf_end) {
+        // 最后一个叶子的末尾就是leaf_end，这种情况无法根据iid找到rid，即后续无法调用ih->get_rid(iid)
+        iid = next_valid_iid(iid);
     }
-
-    // unpin leaf node
-    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
     return iid;
 }
 
@@ -712,8 +1837,9 @@ Iid IxIndexHandle::upper_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::leaf_begin() const {
+    auto lock = shared_tree_latch();
     Iid iid = {.page_no = file_hdr_.first_leaf, .slot_no = 0};
-    return iid;
+    return next_valid_iid(iid);
 }
 
 /**
@@ -723,8 +1849,36 @@ Iid IxIndexHandle::leaf_begin() const {
  * @return Iid
  */
 Iid IxIndexHandle::leaf_end() const {
+    auto lock = shared_tree_latch();
+    return last_leaf_end();
+}
+
+/**
+ * @brief 同leaf_end，调用者已经持有root_latch_
+ */
+Iid IxIndexHandle::last_leaf_end() const {
     IxNodeHandle *node = FetchNode(file_hdr_.last_leaf);
+    latch_node(node, Operation::FIND);
     Iid iid = {.page_no = file_hdr_.last_leaf, .slot_no = node->GetSize()};
-    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);  // unpin it!
+    release_node(node, Operation::FIND, false);  // unpin it!
+    return iid;
+}
+
+/**
+ * @brief 如果iid在某个叶子的末尾（最后一个叶子除外），把它移到下一个非空叶子的第一个位置
+ * @note B-link树删除后不合并结点，中间可能有空的叶子
+ */
+Iid IxIndexHandle::next_valid_iid(Iid iid) const {
+    while (iid.page_no != file_hdr_.last_leaf) {
+        IxNodeHandle *node = FetchNode(iid.page_no);
+        latch_node(node, Operation::FIND);
+        bool is_leaf_end = iid.slot_no >= node->GetSize();
+        page_id_t next_leaf = node->GetNextLeaf();
+        release_node(node, Operation::FIND, false);
+        if (!is_leaf_end) {
+            break;
+        }
+        iid = {.page_no = next_leaf, .slot_no = 0};
+    }
     return iid;
 }
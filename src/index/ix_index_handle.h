@@ -1,13 +1,38 @@
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+
+#include "ix_bloom.h"
 #include "ix_defs.h"
 #include "ix_node_handle.h"
+#include "ix_sort.h"
 #include "transaction/transaction.h"
 
-enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
+enum class Operation { FIND = 0, INSERT, DELETE, UPDATE };  // 四种操作：查找、插入、删除、原地修改值
 
 /**
  * @brief B+树索引
+ * @note 并发控制：root_latch_保护树的结构（根结点、结点间的父子和兄弟关系、file_hdr_）。
+ * 查找和不会引起结构修改的插入/删除只持有共享的root_latch_，在FindLeafPage中自顶向下做latch crabbing：
+ * 内部结点加读锁，叶子结点查找时加读锁、修改时加写锁；
+ * 插入会分裂或删除会合并/重分配、需要修改父结点时，释放所有latch后独占root_latch_重新执行。
+ * B-link模式（Lehman-Yao）下不使用root_latch_：查找时任何时刻最多持有一个结点的latch，
+ * key不小于结点的high key时说明结点被并发地分裂了，沿右兄弟指针继续查找；
+ * 分裂由smo_latch_串行执行，自底向上每次只修改一层，删除不合并结点。
+ * 结点中的key是保序编码后的形式（见ix_encode_key）：公有接口传入的是原始的key，进入时编码一次，
+ * 之后结点内的查找和比较都是按字节比较；FindLeafPage等内部函数的key都是编码后的。
+ * 哈希模式（file_hdr_.hash）下是可扩展哈希索引：叶子结点就是桶，FindLeafPage按key的哈希值经目录找到桶，
+ * 桶内的key仍然有序，查找、修改和乐观的插入/删除与B+树共用；桶满时独占root_latch_分裂桶、必要时把目录加倍，
+ * 删除不合并桶。桶也串在叶子链表中，所以IxScan能遍历所有键值对（无序），等值查找的lower_bound/upper_bound
+ * 落在同一个桶里，范围查找没有意义。
+ * 普通B+树（非B-link、非哈希，key已编码）上有一个Bloom filter（bloom_），等值查找先用它排除不存在的key：
+ * 插入的key进入叶子后再加入filter，容量不够时在独占root_latch_的插入中按两倍的key数重建；查找在共享root_latch_下读它。
+ * filter关闭索引时写到索引文件名 + ".bloom"中，打开时读入并删掉这个文件，没有正常关闭时从叶子重建。
+ * IxScan在两次next()之间不加latch，但一直pin着当前叶子，所以REINDEX（rebuild）不能只靠root_latch_：
+ * 每个IxScan在num_scans_中登记，rebuild等到没有进行中的扫描后才丢弃页面，重建期间新的扫描等待
  */
 class IxIndexHandle {
     friend class IxScan;
@@ -18,7 +43,17 @@ class IxIndexHandle {
     BufferPoolManager *buffer_pool_manager_;
     int fd_;
     IxFileHdr file_hdr_;  // 存了root_page，但root_page初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;  // 用于索引并发（请自行选择并发粒度在 Tree级 或 Page级 ）
+    mutable std::shared_mutex root_latch_;  // 共享：只读或只修改叶子结点；独占：分裂、合并等结构修改
+    std::mutex smo_latch_;                  // B-link模式下串行化结点分裂
+    IxBloomFilter bloom_;                   // 所有key的Bloom filter，bloom_enabled()时才有
+    mutable std::mutex scan_latch_;              // 保护num_scans_和rebuilding_
+    mutable std::condition_variable scan_cv_;
+    mutable int num_scans_ = 0;                  // 进行中的IxScan的个数，它们的当前叶子一直pin着
+    bool rebuilding_ = false;                    // 正在REINDEX，新的IxScan等待重建完成
+    // 有IxScan进行中时删除的结点不进空闲链表，先串在这里（首尾页号），没有扫描时再整体并入空闲链表；
+    // 和空闲链表一样在独占root_latch_时修改
+    page_id_t deferred_free_head_ = IX_NO_PAGE;
+    page_id_t deferred_free_tail_ = IX_NO_PAGE;
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
@@ -26,15 +61,46 @@ class IxIndexHandle {
     // for search
     bool GetValue(const char *key, std::vector<Rid> *result, Transaction *transaction);
 
+    bool GetValue(const char *key, char *value, Transaction *transaction);
+
+    int GetValues(const std::vector<const char *> &keys, char *values, std::vector<bool> *found,
+                  Transaction *transaction);
+
+    bool may_contain(const char *key);
+
     IxNodeHandle *FindLeafPage(const char *key, Operation operation, Transaction *transaction);
 
     // for insert
     bool insert_entry(const char *key, const Rid &value, Transaction *transaction);
 
+    bool insert_entry(const char *key, const char *value, Transaction *transaction);
+
     IxNodeHandle *Split(IxNodeHandle *node);
 
     void InsertIntoParent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
 
+    // for bulk load (COPY FROM和CREATE INDEX在空索引上自底向上建树)
+    bool bulk_load(const std::vector<std::pair<const char *, Rid>> &entries, Transaction *transaction);
+
+    bool bulk_load(const std::vector<std::pair<const char *, const char *>> &entries, Transaction *transaction);
+
+    bool bulk_load(IxSorter *sorter, Transaction *transaction, double fill_factor = 1.0);
+
+    bool bulk_load(IxParallelSorter *sorter, Transaction *transaction, double fill_factor = 1.0);
+
+    // for REINDEX（按fill_factor重新装填整棵树并截断索引文件）
+    bool rebuild(double fill_factor);
+
+    // 按当前的key重建Bloom filter，去掉已经删除的key（VACUUM）
+    void rebuild_bloom();
+
+    void save_bloom() const;
+
+    // for update (VACUUM搬动记录后修改key对应的rid)
+    bool update_entry(const char *key, const Rid &value, Transaction *transaction);
+
+    bool update_entry(const char *key, const char *value, Transaction *transaction);
+
     // for delete
     bool delete_entry(const char *key, Transaction *transaction);
 
@@ -56,8 +122,22 @@ class IxIndexHandle {
 
     Iid leaf_begin() const;
 
+    void get_val(const Iid &iid, char *val) const;
+
+    void get_entry(const Iid &iid, char *key, char *val) const;
+
+    const IxFileHdr &get_file_hdr() const { return file_hdr_; }
+
+    bool bloom_enabled() const {
+        return ENABLE_INDEX_BLOOM_FILTER && file_hdr_.normalized && !file_hdr_.blink && !file_hdr_.hash;
+    }
+
+    const IxBloomFilter &get_bloom() const { return bloom_; }
+
    private:
     // 辅助函数
+    const char *encode_key(const char *key, char *buf) const;
+
     void UpdateRootPageNo(page_id_t root) { file_hdr_.root_page = root; }
 
     bool IsEmpty() const { return file_hdr_.root_page == IX_NO_PAGE; }
@@ -65,6 +145,53 @@ class IxIndexHandle {
     // for get/create node
     IxNodeHandle *FetchNode(int page_no) const;
 
+    // for latch crabbing
+    std::shared_lock<std::shared_mutex> shared_tree_latch() const;
+
+    void latch_node(IxNodeHandle *node, Operation operation) const;
+
+    void release_node(IxNodeHandle *node, Operation operation, bool is_dirty) const;
+
+    Iid last_leaf_end() const;
+
+    Iid next_valid_iid(Iid iid) const;
+
+    void copy_entry(IxNodeHandle *node, int slot_no, char *key, char *val) const;
+
+    // for B-link tree
+    bool need_move_right(IxNodeHandle *node, const char *key) const;
+
+    IxNodeHandle *blink_find_leaf(const char *key, Operation operation, std::vector<page_id_t> *path);
+
+    bool blink_insert(const char *key, const char *value, Transaction *transaction);
+
+    // for hash index
+    IxHashDirPage *fetch_hash_dir(uint32_t slot, Page **page) const;
+
+    IxNodeHandle *hash_find_bucket(const char *key, Operation operation) const;
+
+    bool hash_insert(const char *key, const char *value);
+
+    void hash_split(IxNodeHandle *bucket, uint32_t hash);
+
+    void hash_double();
+
+    // for bulk load
+    bool bulk_build(const std::function<bool(const char **key, const char **val)> &next, double fill_factor);
+
+    void build_tree(const std::function<bool(const char **key, const char **val)> &next, double fill_factor);
+
+    uint64_t bloom_hash(const char *key) const { return IxBloomFilter::hash(key, file_hdr_.col_len); }
+
+    void rebuild_bloom_locked();
+
+    // for IxScan（在扫描的整个生命周期内登记，REINDEX等待所有扫描结束）
+    void begin_scan() const;
+
+    void end_scan() const;
+
+    void rebuild_tree(double fill_factor);
+
     IxNodeHandle *CreateNode();
 
     // for maintain data structure
@@ -74,6 +201,8 @@ class IxIndexHandle {
 
     void release_node_handle(IxNodeHandle &node);
 
+    void reclaim_deferred_pages();
+
     void maintain_child(IxNodeHandle *node, int child_idx);
 
     // for index test
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "ix_defs.h"
 #include "ix_index_handle.h"
@@ -19,29 +21,69 @@ class IxManager {
         return filename + '.' + std::to_string(index_no) + ".idx";
     }
 
+    // 组合索引的文件名中依次是各索引列的下标，以'_'分隔；单列索引与上面的文件名相同
+    std::string get_index_name(const std::string &filename, const std::vector<int> &index_cols) {
+        std::string ix_name = filename;
+        for (size_t i = 0; i < index_cols.size(); i++) {
+            ix_name += (i == 0 ? '.' : '_') + std::to_string(index_cols[i]);
+        }
+        return ix_name + ".idx";
+    }
+
     bool exists(const std::string &filename, int index_no) {
         auto ix_name = get_index_name(filename, index_no);
         return disk_manager_->is_file(ix_name);
     }
 
-    void create_index(const std::string &filename, int index_no, ColType col_type, int col_len) {
-        std::string ix_name = get_index_name(filename, index_no);
+    /**
+     * @param val_len 叶子结点中每个值的长度，普通索引存rid；聚簇表的主键索引存整条记录，二级索引存主键
+     * @param blink 是否使用B-link树，每个结点在页面末尾多留一个key的空间存放high key
+     * @param hash 是否建成可扩展哈希索引，与blink不能同时为true
+     */
+    void create_index(const std::string &filename, int index_no, ColType col_type, int col_len,
+                      int val_len = sizeof(Rid), bool blink = false, bool hash = false) {
         assert(index_no >= 0);
-        // Create index file
-        disk_manager_->create_file(ix_name);
-        // Open index file
-        int fd = disk_manager_->open_file(ix_name);
-        // Create file header and write to file
-        // Theoretically we have: |page_hdr| + (|attr| + |rid|) * n <= PAGE_SIZE
+        create_index(filename, std::vector<int>{index_no}, {col_type}, {col_len}, val_len, blink, hash);
+    }
+
+    /**
+     * @brief 建立组合索引，key由各列按index_cols中的顺序拼接而成
+     *
+     * @param index_cols 索引列在表中的下标，用于确定索引文件名
+     * @param col_types 各索引列的类型
+     * @param col_lens 各索引列的长度
+     */
+    void create_index(const std::string &filename, const std::vector<int> &index_cols,
+                      const std::vector<ColType> &col_types, const std::vector<int> &col_lens, int val_len = sizeof(Rid),
+                      bool blink = false, bool hash = false) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        assert(!index_cols.empty() && index_cols.size() == col_types.size() && col_types.size() == col_lens.size());
+        assert(!(blink && hash));
+        if (index_cols.size() > IX_MAX_INDEX_COLS) {
+            throw InvalidIndexColsError(ix_name);
+        }
+        int col_len = 0;
+        for (int len : col_lens) {
+            col_len += len;
+        }
+        // Theoretically we have: |page_hdr| + (|attr| + |val|) * n <= PAGE_SIZE
         // but we reserve one slot for convenient inserting and deleting, i.e.
-        // |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE
+        // |page_hdr| + (|attr| + |val|) * (n + 1) <= PAGE_SIZE
         if (col_len > IX_MAX_COL_LEN) {
             throw InvalidColLengthError(col_len);
         }
-        // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
+        assert(val_len >= (int)sizeof(Rid));  // 内部结点的值是孩子的Rid
+        // 根据 |page_hdr| + (|attr| + |val|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
         // 即 n <= btree_order，那么btree_order就是每个结点最多可插入的键值对数量（实际还多留了一个空位，但其不可插入）
-        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (col_len + sizeof(Rid)) - 1);
-        assert(btree_order > 2);
+        int high_key_len = blink ? col_len : 0;
+        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr) - high_key_len) / (col_len + val_len) - 1);
+        if (btree_order <= 2) {
+            throw InvalidColLengthError(col_len + val_len);
+        }
+        // Create index file
+        disk_manager_->create_file(ix_name);
+        // Open index file
+        int fd = disk_manager_->open_file(ix_name);
         // int key_offset = sizeof(IxPageHdr);
         // int rid_offset = key_offset + (btree_order + 1) * col_len;
 
@@ -50,15 +92,29 @@ class IxManager {
             .first_free_page_no = IX_NO_PAGE,
             .num_pages = IX_INIT_NUM_PAGES,
             .root_page = IX_INIT_ROOT_PAGE,
-            .col_type = col_type,
+            .col_type = col_types[0],
             .col_len = col_len,
             .btree_order = btree_order,
             // .key_offset = key_offset,
             // .rid_offset = rid_offset,
-            .keys_size = (btree_order + 1) * col_len,  // 用于IxNodeHandle初始化rids首地址
+            .keys_size = (btree_order + 1) * col_len,  // 用于IxNodeHandle初始化vals首地址
             .first_leaf = IX_INIT_ROOT_PAGE,
             .last_leaf = IX_INIT_ROOT_PAGE,
+            .blink = blink,
+            .col_num = (int)col_types.size(),
         };
+        fhdr.val_len = val_len;
+        std::copy(col_types.begin(), col_types.end(), fhdr.col_types);
+        std::copy(col_lens.begin(), col_lens.end(), fhdr.col_lens);
+        fhdr.normalized = true;
+        fhdr.compressed = !blink && !hash && col_len >= IX_COMPRESS_MIN_COL_LEN;
+        if (hash) {
+            // 哈希索引：root node作为第一个桶，其后一页是目录页，只有一个指向它的目录项
+            fhdr.hash = true;
+            fhdr.hash_global_depth = 0;
+            fhdr.hash_dir_pages[0] = IX_INIT_NUM_PAGES;
+            fhdr.num_pages++;
+        }
         disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, (const char *)&fhdr, sizeof(fhdr));
 
         char page_buf[PAGE_SIZE];  // 在内存中初始化page_buf中的内容，然后将其写入磁盘
@@ -91,29 +147,53 @@ class IxManager {
             // Must write PAGE_SIZE here in case of future fetch_node()
             disk_manager_->write_page(fd, IX_INIT_ROOT_PAGE, page_buf, PAGE_SIZE);
         }
+        if (hash) {
+            memset(page_buf, 0, PAGE_SIZE);
+            auto dir = reinterpret_cast<IxHashDirPage *>(page_buf);
+            dir->buckets[0] = IX_INIT_ROOT_PAGE;
+            dir->local_depths[0] = 0;
+            disk_manager_->write_page(fd, fhdr.hash_dir_pages[0], page_buf, PAGE_SIZE);
+        }
 
-        disk_manager_->set_fd2pageno(fd, IX_INIT_NUM_PAGES - 1);  // DEBUG
+        disk_manager_->set_fd2pageno(fd, fhdr.num_pages - 1);  // DEBUG
 
         // Close index file
         disk_manager_->close_file(fd);
     }
 
     void destroy_index(const std::string &filename, int index_no) {
-        std::string ix_name = get_index_name(filename, index_no);
+        destroy_index(filename, std::vector<int>{index_no});
+    }
+
+    void destroy_index(const std::string &filename, const std::vector<int> &index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
         disk_manager_->destroy_file(ix_name);
+        // 正常关闭的索引还有保存下来的Bloom filter
+        if (disk_manager_->is_file(ix_name + ".bloom")) {
+            disk_manager_->destroy_file(ix_name + ".bloom");
+        }
     }
 
     // 注意这里打开文件，创建并返回了index file handle的指针
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, int index_no) {
-        std::string ix_name = get_index_name(filename, index_no);
+        return open_index(filename, std::vector<int>{index_no});
+    }
+
+    std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<int> &index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
         int fd = disk_manager_->open_file(ix_name);
         return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
     }
 
-    void close_index(const IxIndexHandle *ih) {
+    void close_index(IxIndexHandle *ih) {
+        // 关闭时已没有进行中的扫描，延迟释放的页面并入空闲链表后随文件头写回
+        ih->reclaim_deferred_pages();
+        ih->save_bloom();
         disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, (const char *)&ih->file_hdr_, sizeof(ih->file_hdr_));
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->FlushAllPages(ih->fd_);
+        // 关闭之后fd可能分配给其他文件，缓冲区中不能再留有按该fd缓存的页面
+        buffer_pool_manager_->DiscardPages(ih->fd_, 0);
         disk_manager_->close_file(ih->fd_);
     }
 };
@@ -1,5 +1,9 @@
 #include "ix_node_handle.h"
 
+#include <algorithm>
+
+#include "ix_search.h"
+
 /**
  * @brief 在当前node中查找第一个>=target的key_idx
  *
@@ -11,25 +15,36 @@ int IxNodeHandle::lower_bound(const char *target) const {
     // 查找当前节点中第一个大于等于target的key，并返回key的位置给上层
     // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用ix_compare()函数进行比较
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
+    // 前缀压缩的叶子结点先和公共前缀比较：前缀不同时target在所有key之前或之后，相同时只需比较后缀
+    int prefix_cmp = memcmp(target, prefix(), prefix_len());
+    if (prefix_cmp != 0) {
+        return prefix_cmp < 0 ? 0 : num_key_now;
+    }
+    target += prefix_len();
+    // 4字节和8字节的编码后的key按整数查找（见ix_search_keys）
+    switch (integer_key_len()) {
+        case sizeof(uint32_t):
+            return ix_search_keys<uint32_t, false>(keys(), 0, num_key_now, ix_load_be32(target));
+        case sizeof(uint64_t):
+            return ix_search_keys<uint64_t, false>(keys(), 0, num_key_now, ix_load_be64(target));
+    }
     int idx = -1;
     if(binary_search){
-        //待写的二分查找
-        for(int i = 0; i < num_key_now; ++i){
-            // printf("当前的i为%d,get_key(i)为%d,target为%d\n",i,*get_key(i),*target);
-            if(ix_compare(get_key(i),target,type,col_len) >= 0){
-                idx = i; //表示找到了
-                break;
+        int lo = 0, hi = num_key_now;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (compare_suffix(get_key(mid), target) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
             }
         }
-        if(idx == -1)
-            idx = num_key_now;
+        idx = lo;
     }else{//顺序查找
         // printf("当前的num_key为%d\n",num_key_now); 
         for(int i = 0; i < num_key_now; ++i){
             // printf("当前的i为%d,get_key(i)为%d,target为%d\n",i,*get_key(i),*target);
-            if(ix_compare(get_key(i),target,type,col_len) >= 0){
+            if(compare_suffix(get_key(i), target) >= 0){
                 idx = i; //表示找到了
                 break;
             }
@@ -44,30 +59,40 @@ int IxNodeHandle::lower_bound(const char *target) const {
 /**
  * @brief 在当前node中查找第一个>target的key_idx
  *
- * @return key_idx，范围为[1,num_key)，如果返回的key_idx=num_key，则表示target大于等于最后一个key
- * @note 注意此处的范围从1开始
+ * @return key_idx，范围为[0,num_key)，如果返回的key_idx=num_key，则表示target大于等于最后一个key
+ * @note 只用于在叶子结点中确定扫描范围（IxIndexHandle::upper_bound），target小于第一个key时返回0
  */
 int IxNodeHandle::upper_bound(const char *target) const {
     // Todo:
     // 查找当前节点中第一个大于target的key，并返回key的位置给上层
     // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用ix_compare()函数进行比较
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
+    int prefix_cmp = memcmp(target, prefix(), prefix_len());
+    if (prefix_cmp != 0) {
+        return prefix_cmp < 0 ? 0 : num_key_now;
+    }
+    target += prefix_len();
+    switch (integer_key_len()) {
+        case sizeof(uint32_t):
+            return ix_search_keys<uint32_t, true>(keys(), 0, num_key_now, ix_load_be32(target));
+        case sizeof(uint64_t):
+            return ix_search_keys<uint64_t, true>(keys(), 0, num_key_now, ix_load_be64(target));
+    }
     int idx = -1;
     if(binary_search){
-        //待写的二分查找
-        for(int i = 1; i < num_key_now; ++i){
-            if(ix_compare(get_key(i),target,type,col_len) > 0){
-                idx = i; //表示找到了
-                break;
+        int lo = 0, hi = num_key_now;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (compare_suffix(get_key(mid), target) <= 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
             }
         }
-        if(idx == -1)
-            idx = num_key_now;
+        idx = lo;
     }else{//顺序查找
-        for(int i = 1; i < num_key_now; ++i){
-            if(ix_compare(get_key(i),target,type,col_len) > 0){
+        for(int i = 0; i < num_key_now; ++i){
+            if(compare_suffix(get_key(i), target) > 0){
                 idx = i; //表示找到了
                 break;
             }
@@ -94,11 +119,9 @@ bool IxNodeHandle::LeafLookup(const char *key, Rid **value) {
     // 3. 如果存在，获取key对应的Rid，并赋值给传出参数value
     // 提示：可以调用lower_bound()和get_rid()函数。
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
     //因为貌似不含有重复值，所以注意利用
     int idx = lower_bound(key);
-    if(ix_compare(get_key(idx),key,type,col_len) == 0){//表示找到了，否则没有找到
+    if(idx < num_key_now && compare_key(idx, key) == 0){//表示找到了，否则没有找到（idx为num_key时get_key(idx)是无效的槽位）
         *value = get_rid(idx);
         return true;
     }
@@ -116,11 +139,9 @@ page_id_t IxNodeHandle::InternalLookup(const char *key) {
     // 2. 获取该孩子节点（子树）所在页面的编号
     // 3. 返回页面编号
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
     //因为貌似不含有重复值，所以注意利用
     int idx = lower_bound(key);
-    if(ix_compare(get_key(idx),key,type,col_len) == 0){//表示找到了，否则没有找到
+    if(idx < num_key_now && compare_key(idx, key) == 0){//表示找到了，否则没有找到
         return ValueAt(idx);
     }else if(idx == 0){//表示新来的这个节点小于目前最小的节点
         return ValueAt(idx);
@@ -131,10 +152,10 @@ page_id_t IxNodeHandle::InternalLookup(const char *key) {
 
 /**
  * @brief 在指定位置插入n个连续的键值对
- * 将key的前n位插入到原来keys中的pos位置；将rid的前n位插入到原来rids中的pos位置
+ * 将key的前n位插入到原来keys中的pos位置；将val的前n位插入到原来vals中的pos位置
  *
  * @param pos 要插入键值对的位置
- * @param (key, rid) 连续键值对的起始地址，也就是第一个键值对，可以通过(key, rid)来获取n个键值对
+ * @param (key, val) 连续键值对的起始地址，也就是第一个键值对，可以通过(key, val)来获取n个键值对，每个val长度为val_len
  * @param n 键值对数量
  * @note [0,pos)           [pos,num_key)
  *                            key_slot
@@ -143,50 +164,66 @@ page_id_t IxNodeHandle::InternalLookup(const char *key) {
  *       [0,pos)     [pos,pos+n)   [pos+n,num_key+n)
  *                      key           key_slot
  */
-void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n) {
+void IxNodeHandle::insert_pairs(int pos, const char *key, const char *val, int n) {
     // Todo:
     // 1. 判断pos的合法性
     // 2. 通过key获取n个连续键值对的key值，并把n个key值插入到pos位置
-    // 3. 通过rid获取n个连续键值对的rid值，并把n个rid值插入到pos位置
+    // 3. 通过val获取n个连续键值对的值，并把n个值插入到pos位置
     // 4. 更新当前节点的键数量
     //在这里我实现的时候默认了连续的数组都是有序的，并且保证了插入的位置也是对的位置，并且进行了去重
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
     int col_len = file_hdr->col_len;
-    //去重，先去重再判断，注意，只要key重复那么rid就一定重复，因为key一定是不重复的，换句话说，key为码
-    char *tmp_key = new char[col_len*n];
-    Rid *tmp_rid = new Rid[n];
+    int val_len = file_hdr->val_len;
+    //去重，先去重再判断，注意，只要key重复那么val就一定重复，因为key一定是不重复的，换句话说，key为码
+    std::vector<char> tmp_key(col_len * n);
+    std::vector<char> tmp_val(val_len * n);
     int real_n = 0;//真正要插入的n个数
-    // printf("要插入的n是%d\n",n);
     //无论如何第一个值一定要进入待插区
-    memcpy(tmp_key,key,col_len);
-    memcpy(tmp_rid,rid,sizeof(Rid));
+    memcpy(tmp_key.data(), key, col_len);
+    memcpy(tmp_val.data(), val, val_len);
     real_n++;
     for(int i = 1; i < n; ++i){
-        const char * key_i = key + i;
-        const char * key_i2 = key + i -1;
-        // printf("key_i,key_i2 : %d, %d\n",*key_i,*key_i2);
-        if(ix_compare(key_i,key_i2,type,col_len) == 0){
+        const char * key_i = key + i * col_len;
+        const char * key_i2 = key + (i - 1) * col_len;
+        if(ix_key_compare(key_i,key_i2, *file_hdr) == 0){
             //如果二者相等，那么我就不插
-        }else{//如果不等，那么我
-            // printf("在insert_pairs力，应该进入一次\n");
-            memcpy(tmp_key + col_len * real_n, key + col_len * i, col_len);
-            memcpy(tmp_rid + real_n, rid + i, sizeof(Rid));
+        }else{
+            memcpy(tmp_key.data() + col_len * real_n, key_i, col_len);
+            memcpy(tmp_val.data() + val_len * real_n, val + val_len * i, val_len);
             real_n ++;
         }
     }
         //此时的real_n是数量而不是坐标了
-    // printf("real_n为%d\n",real_n);
-    if( (pos + real_n)*col_len > file_hdr->keys_size){//判断如果不合法，那么就直接不插入，或许还有其他的
-        // printf("不应该到达这里啊啊啊啊----------------------\n");
+    // 前缀压缩的叶子结点：插入的key与公共前缀不同时前缀变短；插入的key是有序的，只需看第一个和最后一个
+    const char *first_key = tmp_key.data();
+    const char *last_key = tmp_key.data() + col_len * (real_n - 1);
+    int new_prefix_len = prefix_len();
+    if (IsCompressed()) {
+        if (num_key_now == 0) {
+            new_prefix_len = 0;
+            while (new_prefix_len < col_len && first_key[new_prefix_len] == last_key[new_prefix_len]) {
+                new_prefix_len++;
+            }
+        } else {
+            new_prefix_len = std::min(prefix_len_with(first_key), prefix_len_with(last_key));
+        }
+    }
+    int capacity = IsCompressed() ? slot_num(new_prefix_len) : file_hdr->keys_size / col_len;
+    if(num_key_now + real_n > capacity){//判断如果不合法，那么就直接不插入，或许还有其他的
     }else{//如果合法的话，那么我就插入,注意，此处仅仅考虑了插入一个值的情况，所以不排序，默认位置找的是对的，也不再这里对pos之前和之后的值去重了，在Insert那里去重
-        memmove(keys+(pos + real_n)*col_len, keys+pos*col_len, col_len*(num_key_now-pos));
-        memmove(rids+(pos + real_n),rids+pos, sizeof(Rid)*(num_key_now-pos));
-        memcpy(keys+pos*col_len, tmp_key, col_len*real_n);
-        memcpy(rids+pos, tmp_rid, sizeof(Rid)*real_n);
-        // for(int i = 0; i <= num_key_now; ++i){
-        //     printf("插完后的第%d个值是%d\n",i,*get_key(i));
-        // }
+        if (num_key_now == 0 && IsCompressed()) {
+            page_hdr->prefix_len = new_prefix_len;
+            memcpy(prefix(), first_key, new_prefix_len);
+        } else if (new_prefix_len != prefix_len()) {
+            set_prefix_len(new_prefix_len);
+        }
+        int key_len = suffix_len();
+        memmove(get_key(pos + real_n), get_key(pos), key_len*(num_key_now-pos));
+        memmove(get_val(pos + real_n), get_val(pos), val_len*(num_key_now-pos));
+        for(int i = 0; i < real_n; ++i){
+            set_key(pos + i, tmp_key.data() + col_len * i);
+        }
+        memcpy(get_val(pos), tmp_val.data(), val_len*real_n);
     }
     
     return ;
@@ -195,8 +232,19 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
 
 /**
  * @brief 用于在结点中的指定位置插入单个键值对
+ * @note 内部结点的值只有孩子的Rid，val_len比sizeof(Rid)长时（聚簇表的主键索引）剩余字节补0
  */
-void IxNodeHandle::insert_pair(int pos, const char *key, const Rid &rid) { insert_pairs(pos, key, &rid, 1); };
+void IxNodeHandle::insert_pair(int pos, const char *key, const Rid &rid) {
+    if (file_hdr->val_len == (int)sizeof(Rid)) {
+        insert_pairs(pos, key, reinterpret_cast<const char *>(&rid), 1);
+        return;
+    }
+    std::vector<char> val(file_hdr->val_len, 0);
+    memcpy(val.data(), &rid, sizeof(Rid));
+    insert_pairs(pos, key, val.data(), 1);
+}
+
+void IxNodeHandle::insert_pair(int pos, const char *key, const char *val) { insert_pairs(pos, key, val, 1); }
 
 /**
  * @brief 用于在结点中插入单个键值对。
@@ -206,14 +254,24 @@ void IxNodeHandle::insert_pair(int pos, const char *key, const Rid &rid) { inser
  * @return int 键值对数量
  */
 int IxNodeHandle::Insert(const char *key, const Rid &value) {
+    if (file_hdr->val_len == (int)sizeof(Rid)) {
+        return Insert(key, reinterpret_cast<const char *>(&value));
+    }
+    std::vector<char> val(file_hdr->val_len, 0);
+    memcpy(val.data(), &value, sizeof(Rid));
+    return Insert(key, val.data());
+}
+
+/**
+ * @brief 同上，value指向长度为val_len的值
+ */
+int IxNodeHandle::Insert(const char *key, const char *value) {
     // Todo:
     // 1. 查找要插入的键值对应该插入到当前节点的哪个位置
     // 2. 如果key重复则不插入
     // 3. 如果key不重复则插入键值对
     // 4. 返回完成插入操作之后的键值对数量
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
     int pos = lower_bound(key);
     // printf("在Insert函数中，将要插入的key值为%d,应当插入的pos为%d\n",*key,pos);
     if(pos == num_key_now){  //插入最后即可
@@ -221,7 +279,7 @@ int IxNodeHandle::Insert(const char *key, const Rid &value) {
         page_hdr->num_key ++;
         
         return page_hdr->num_key;
-    }else if(ix_compare(get_key(pos),key,type,col_len) == 0){//如果找到了一个大于等于它的数，先看看是否是等于他，如果等于，那么就不插了
+    }else if(compare_key(pos, key) == 0){//如果找到了一个大于等于它的数，先看看是否是等于他，如果等于，那么就不插了
         //相等，不插入了
         // printf("%d,  %d\n",*get_key(pos),*key);
         // printf("键值对相等----------------------不该到这里\n");
@@ -246,14 +304,13 @@ void IxNodeHandle::erase_pair(int pos) {
     // 2. 删除该位置的rid
     // 3. 更新结点的键值对数量
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
+    int key_len = suffix_len();
     // printf("要删除的pos是%d,移动的数量是%d,num_key_now是%d\n",pos,(num_key_now - pos - 1),num_key_now);
     if(pos < 0 || pos >=GetSize()){
         return ;
     }else{
-        memmove( keys + pos * col_len, keys + (pos + 1) * col_len, col_len * (num_key_now - pos - 1));
-        memmove( rids + pos, rids + (pos + 1), sizeof(Rid) * (num_key_now - pos - 1));
+        memmove( get_key(pos), get_key(pos + 1), key_len * (num_key_now - pos - 1));
+        memmove( get_val(pos), get_val(pos + 1), file_hdr->val_len * (num_key_now - pos - 1));
         page_hdr->num_key --;
     }
     // printf("删除完后的num_key是%d,所有的key分别是:\n",page_hdr->num_key);
@@ -275,10 +332,8 @@ int IxNodeHandle::Remove(const char *key) {
     // 3. 返回完成删除操作后的键值对数量
 
     int num_key_now = page_hdr->num_key;
-    ColType type = file_hdr->col_type;
-    int col_len = file_hdr->col_len;
     int pos = lower_bound(key);
-    if(ix_compare(get_key(pos),key,type,col_len) == 0){
+    if(pos < num_key_now && compare_key(pos, key) == 0){
         erase_pair(pos);
         return GetSize();
     }
@@ -313,4 +368,68 @@ page_id_t IxNodeHandle::RemoveAndReturnOnlyChild() {
     erase_pair(0);
     assert(GetSize() == 0);
     return child_page_no;
-}
\ No newline at end of file
+}
+/**
+ * @brief 插入key之后的公共前缀长度：原来的前缀与key的最长公共前缀
+ */
+int IxNodeHandle::prefix_len_with(const char *key) const {
+    int len = 0;
+    int max_len = prefix_len();
+    const char *p = prefix();
+    while (len < max_len && p[len] == key[len]) {
+        len++;
+    }
+    return len;
+}
+
+/**
+ * @brief 把结点中的所有键值对按新的公共前缀长度重新存放
+ *
+ * @param new_prefix_len 新的前缀长度，所有key都必须有这个长度的公共前缀，且按这个前缀长度能放下
+ * @note 前缀变短时每个key的槽位变长，vals整体后移；前缀变长时相反
+ */
+void IxNodeHandle::set_prefix_len(int new_prefix_len) {
+    assert(IsCompressed());
+    int num_key = GetSize();
+    int col_len = file_hdr->col_len;
+    int val_len = file_hdr->val_len;
+    std::vector<char> tmp_key((size_t)num_key * col_len);
+    std::vector<char> tmp_val((size_t)num_key * val_len);
+    for (int i = 0; i < num_key; i++) {
+        copy_key(i, tmp_key.data() + (size_t)i * col_len);
+    }
+    memcpy(tmp_val.data(), vals(), tmp_val.size());
+    page_hdr->prefix_len = new_prefix_len;
+    if (num_key > 0) {
+        memcpy(prefix(), tmp_key.data(), new_prefix_len);
+    }
+    for (int i = 0; i < num_key; i++) {
+        set_key(i, tmp_key.data() + (size_t)i * col_len);
+    }
+    memcpy(vals(), tmp_val.data(), tmp_val.size());
+}
+
+int IxNodeHandle::GetMaxSizeWith(const char *key) const {
+    if (!IsCompressed()) {
+        return GetMaxSize();
+    }
+    // 空结点插入一个key后前缀就是整个key
+    return slot_num(GetSize() == 0 ? file_hdr->col_len : prefix_len_with(key));
+}
+
+void IxNodeHandle::Recompress() {
+    int num_key = GetSize();
+    if (!IsCompressed() || num_key == 0) {
+        return;
+    }
+    // key有序，第一个和最后一个key的公共前缀就是所有key的公共前缀
+    const char *first = get_key(0);
+    const char *last = get_key(num_key - 1);
+    int len = 0;
+    while (len < suffix_len() && first[len] == last[len]) {
+        len++;
+    }
+    if (len > 0) {
+        set_prefix_len(prefix_len() + len);
+    }
+}
@@ -1,4 +1,8 @@
 #pragma once
+
+#include <cstdint>
+#include <cstring>
+
 #include "ix_defs.h"
 
 static const bool binary_search = true;  // 控制在lower_bound/uppper_bound函数中是否使用二分查找
@@ -25,6 +29,175 @@ inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
     }
 }
 
+/**
+ * @brief 按索引文件头比较两个key：组合索引从第一列开始逐列比较，前面的列相等时才比较后面的列
+ */
+inline int ix_compare(const char *a, const char *b, const IxFileHdr &file_hdr) {
+    if (file_hdr.col_num <= 1) {
+        return ix_compare(a, b, file_hdr.col_type, file_hdr.col_len);
+    }
+    for (int i = 0; i < file_hdr.col_num; i++) {
+        int res = ix_compare(a, b, file_hdr.col_types[i], file_hdr.col_lens[i]);
+        if (res != 0) {
+            return res;
+        }
+        a += file_hdr.col_lens[i];
+        b += file_hdr.col_lens[i];
+    }
+    return 0;
+}
+
+/** 按大端序读写，编码后的key按字节比较的顺序就是数值的顺序 */
+inline uint32_t ix_load_be32(const char *p) {
+    auto u = reinterpret_cast<const uint8_t *>(p);
+    return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | (uint32_t)u[3];
+}
+
+inline uint64_t ix_load_be64(const char *p) { return (uint64_t)ix_load_be32(p) << 32 | ix_load_be32(p + 4); }
+
+inline void ix_store_be32(char *p, uint32_t v) {
+    for (int i = 3; i >= 0; i--, v >>= 8) {
+        p[i] = (char)(v & 0xff);
+    }
+}
+
+/**
+ * @brief 把一列的值编码为保序的二进制形式：编码后用memcmp比较的结果与按类型比较的结果相同
+ * int：翻转符号位后按大端序存放；float：正数翻转符号位、负数翻转所有位后按大端序存放（-0.0编码为0.0）；
+ * 字符串本身就按memcmp比较，原样复制
+ */
+inline void ix_encode_col(const char *src, char *dst, ColType type, int len) {
+    switch (type) {
+        case TYPE_INT: {
+            int v;
+            memcpy(&v, src, sizeof(v));
+            ix_store_be32(dst, (uint32_t)v ^ 0x80000000u);
+            break;
+        }
+        case TYPE_FLOAT: {
+            uint32_t bits;
+            memcpy(&bits, src, sizeof(bits));
+            if (bits == 0x80000000u) {
+                bits = 0;  // -0.0和0.0相等
+            }
+            ix_store_be32(dst, (bits & 0x80000000u) ? ~bits : bits | 0x80000000u);
+            break;
+        }
+        case TYPE_STRING:
+            memcpy(dst, src, len);
+            break;
+        default:
+            throw InternalError("Unexpected data type");
+    }
+}
+
+// ix_encode_col的逆变换
+inline void ix_decode_col(const char *src, char *dst, ColType type, int len) {
+    switch (type) {
+        case TYPE_INT: {
+            int v = (int)(ix_load_be32(src) ^ 0x80000000u);
+            memcpy(dst, &v, sizeof(v));
+            break;
+        }
+        case TYPE_FLOAT: {
+            uint32_t bits = ix_load_be32(src);
+            bits = (bits & 0x80000000u) ? bits ^ 0x80000000u : ~bits;
+            memcpy(dst, &bits, sizeof(bits));
+            break;
+        }
+        case TYPE_STRING:
+            memcpy(dst, src, len);
+            break;
+        default:
+            throw InternalError("Unexpected data type");
+    }
+}
+
+/**
+ * @brief 把上层传入的key编码为结点中存放的形式，组合索引逐列编码；长度不变，仍为file_hdr.col_len
+ */
+inline void ix_encode_key(const char *key, char *dst, const IxFileHdr &file_hdr) {
+    if (file_hdr.col_num <= 1) {
+        ix_encode_col(key, dst, file_hdr.col_type, file_hdr.col_len);
+        return;
+    }
+    for (int i = 0; i < file_hdr.col_num; i++) {
+        ix_encode_col(key, dst, file_hdr.col_types[i], file_hdr.col_lens[i]);
+        key += file_hdr.col_lens[i];
+        dst += file_hdr.col_lens[i];
+    }
+}
+
+/**
+ * @brief ix_encode_key的逆变换，把结点中存放的key还原为上层的原始形式
+ */
+inline void ix_decode_key(const char *key, char *dst, const IxFileHdr &file_hdr) {
+    if (!file_hdr.normalized) {
+        memcpy(dst, key, file_hdr.col_len);
+        return;
+    }
+    if (file_hdr.col_num <= 1) {
+        ix_decode_col(key, dst, file_hdr.col_type, file_hdr.col_len);
+        return;
+    }
+    for (int i = 0; i < file_hdr.col_num; i++) {
+        ix_decode_col(key, dst, file_hdr.col_types[i], file_hdr.col_lens[i]);
+        key += file_hdr.col_lens[i];
+        dst += file_hdr.col_lens[i];
+    }
+}
+
+/**
+ * @brief 比较两个结点中存放的key（都已经编码过）
+ * @note 编码后的key直接memcmp；4字节和8字节的key（如int、两个int的组合索引）按一个整数比较。
+ * 旧的索引文件没有编码，仍按类型比较
+ */
+inline int ix_key_compare(const char *a, const char *b, const IxFileHdr &file_hdr) {
+    if (!file_hdr.normalized) {
+        return ix_compare(a, b, file_hdr);
+    }
+    switch (file_hdr.col_len) {
+        case sizeof(uint32_t): {
+            uint32_t ua = ix_load_be32(a);
+            uint32_t ub = ix_load_be32(b);
+            return (ua < ub) ? -1 : ((ua > ub) ? 1 : 0);
+        }
+        case sizeof(uint64_t): {
+            uint64_t ua = ix_load_be64(a);
+            uint64_t ub = ix_load_be64(b);
+            return (ua < ub) ? -1 : ((ua > ub) ? 1 : 0);
+        }
+        default:
+            return memcmp(a, b, file_hdr.col_len);
+    }
+}
+
+/**
+ * @brief 哈希索引中编码后的key的哈希值，目录按它的低位找到桶
+ * @note FNV-1a之后再做一次murmur3的fmix32：FNV-1a的低位分布不够均匀，而且与哈希分区（TabMeta::get_key_part）
+ * 用的哈希不同，同一分区中的key在分区的索引里也能分散到各个桶；哈希值持久化在桶的分布中，不能依赖std::hash的实现
+ */
+inline uint32_t ix_hash_key(const char *key, int len) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief 前缀压缩的叶子结点中key的公共前缀长度为prefix_len时，页面中能放下的键值对个数
+ * @note 页头之后存放前缀，每个槽位存放key的后缀和值
+ */
+inline int ix_leaf_slot_num(const IxFileHdr &file_hdr, int prefix_len) {
+    return (PAGE_SIZE - (int)sizeof(IxPageHdr) - prefix_len) / (file_hdr.col_len - prefix_len + file_hdr.val_len);
+}
+
 /**
  * @brief 树中的结点
  * 记录了root page，max size等；以及实现结点内部的查找/插入/删除操作
@@ -40,16 +213,52 @@ class IxNodeHandle {
 
     /** page->data的第一部分，指针指向首地址，后续占用长度为sizeof(IxPageHdr) */
     IxPageHdr *page_hdr;
-    /** page->data的第二部分，指针指向首地址，后续占用长度为file_hdr->keys_size，每个key的长度为file_hdr->col_len */
-    char *keys;
-    /** page->data的第三部分，指针指向首地址，每个rid的长度为sizeof(Rid) */
-    Rid *rids;
+    /**
+     * page->data的第二部分是keys，每个key的长度为file_hdr->col_len，共file_hdr->keys_size；
+     * 第三部分是vals，每个值的长度为file_hdr->val_len（内部结点的值是孩子的Rid，只用前sizeof(Rid)字节）。
+     * 前缀压缩的叶子结点（IsCompressed）中，页头之后先是prefix_len字节的公共前缀，每个key的槽位只存后缀，
+     * 槽位个数随前缀长度变化（slot_num），所以keys和vals的位置都由页头中的prefix_len算出，不能缓存：
+     * 别的线程可能在本线程FetchNode之后、加latch之前改变了前缀
+     */
+    char *keys() const { return page->GetData() + sizeof(IxPageHdr) + prefix_len(); }
+
+    char *vals() const {
+        if (!IsCompressed()) {
+            return keys() + file_hdr->keys_size;
+        }
+        return keys() + slot_num(prefix_len()) * suffix_len();
+    }
+
+    char *prefix() const { return page->GetData() + sizeof(IxPageHdr); }
+
+    int prefix_len() const { return IsCompressed() ? page_hdr->prefix_len : 0; }
+
+    int suffix_len() const { return file_hdr->col_len - prefix_len(); }
+
+    int slot_num(int prefix_len) const { return ix_leaf_slot_num(*file_hdr, prefix_len); }
+
+    // 插入key之后的公共前缀长度（只会变短）
+    int prefix_len_with(const char *key) const;
+
+    // 把所有key改为按新的公共前缀存放，调用者保证所有key都有这个前缀且放得下
+    void set_prefix_len(int new_prefix_len);
+
+    // 结点中的key是按大端存放的4字节或8字节无符号整数时返回key的长度，可以按整数查找；否则返回0
+    int integer_key_len() const {
+        return file_hdr->normalized && !IsCompressed() && (file_hdr->col_len == sizeof(uint32_t) ||
+                                                           file_hdr->col_len == sizeof(uint64_t))
+                   ? file_hdr->col_len
+                   : 0;
+    }
+
+    // 比较两个key去掉公共前缀之后的部分
+    int compare_suffix(const char *a, const char *b) const {
+        return IsCompressed() ? memcmp(a, b, suffix_len()) : ix_key_compare(a, b, *file_hdr);
+    }
 
    public:
     IxNodeHandle(const IxFileHdr *file_hdr_, Page *page_) : file_hdr(file_hdr_), page(page_) {
         page_hdr = reinterpret_cast<IxPageHdr *>(page->GetData());
-        keys = page->GetData() + sizeof(IxPageHdr);
-        rids = reinterpret_cast<Rid *>(keys + file_hdr->keys_size);
     }
 
     IxNodeHandle() = default;
@@ -65,8 +274,7 @@ class IxNodeHandle {
     /**
      * @brief 在当前node中查找第一个>target的key_idx
      *
-     * @return key_idx，范围为[1,num_key)，如果返回的key_idx=num_key，则表示target大于等于最后一个key
-     * @note 注意此处的范围从1开始
+     * @return key_idx，范围为[0,num_key)，如果返回的key_idx=num_key，则表示target大于等于最后一个key
      */
     int upper_bound(const char *target) const;
 
@@ -89,17 +297,26 @@ class IxNodeHandle {
     int Remove(const char *key);
 
     /**
-     * @brief 将key的前n位插入到原来keys中的pos位置；将rid的前n位插入到原来rids中的pos位置
+     * @brief 将key的前n位插入到原来keys中的pos位置；将val的前n位插入到原来vals中的pos位置
      *
      * @note [0,pos)           [pos,num_key)
      *                            key_slot
      *       [0,pos)     [pos,pos+n)   [pos+n,num_key+n)
      *                      key           key_slot
      */
-    void insert_pairs(int pos, const char *key, const Rid *rid, int n);
+    void insert_pairs(int pos, const char *key, const char *val, int n);
 
     void insert_pair(int pos, const char *key, const Rid &rid);
 
+    void insert_pair(int pos, const char *key, const char *val);
+
+    /**
+     * @brief used in leaf node to insert (key,value) whose value is val_len bytes
+     *
+     * @return the size after Insert
+     */
+    int Insert(const char *key, const char *value);
+
     void erase_pair(int pos);
 
     /**
@@ -109,24 +326,65 @@ class IxNodeHandle {
      */
     int find_child(IxNodeHandle *child);
 
+    /**
+     * @brief 叶子结点插入key之后能放下的最多键值对个数（见GetMaxSize）
+     * @note 前缀压缩的叶子结点插入前缀不同的key后前缀变短，能放下的个数变少；
+     * 返回值小于GetSize() + 1时放不下，要先分裂
+     */
+    int GetMaxSizeWith(const char *key) const;
+
+    // 把前缀压缩的叶子结点的前缀尽量加长（分裂后key的范围变小，前缀可能变长）
+    void Recompress();
+
     /** 以下为已经实现了的辅助函数 **/
-    char *get_key(int key_idx) const { return keys + key_idx * file_hdr->col_len; }
+    // 第key_idx个key在结点中存放的位置；前缀压缩的叶子结点中只有后缀，完整的key要用copy_key
+    char *get_key(int key_idx) const { return keys() + key_idx * suffix_len(); }
 
-    Rid *get_rid(int rid_idx) const { return &rids[rid_idx]; }
+    // 把第key_idx个完整的key复制到dst中
+    void copy_key(int key_idx, char *dst) const {
+        memcpy(dst, prefix(), prefix_len());
+        memcpy(dst + prefix_len(), get_key(key_idx), suffix_len());
+    }
 
-    void set_key(int key_idx, const char *key) { memcpy(keys + key_idx * file_hdr->col_len, key, file_hdr->col_len); }
+    // 比较第key_idx个key和完整的key
+    int compare_key(int key_idx, const char *key) const {
+        if (!IsCompressed()) {
+            return ix_key_compare(get_key(key_idx), key, *file_hdr);
+        }
+        int cmp = memcmp(prefix(), key, prefix_len());
+        return cmp != 0 ? cmp : memcmp(get_key(key_idx), key + prefix_len(), suffix_len());
+    }
+
+    char *get_val(int val_idx) const { return vals() + val_idx * file_hdr->val_len; }
+
+    Rid *get_rid(int rid_idx) const { return reinterpret_cast<Rid *>(get_val(rid_idx)); }
 
-    void set_rid(int rid_idx, const Rid &rid) { rids[rid_idx] = rid; }
+    // key是完整的key，前缀压缩的叶子结点中只存它的后缀（前缀由调用者保证相同）
+    void set_key(int key_idx, const char *key) { memcpy(get_key(key_idx), key + prefix_len(), suffix_len()); }
 
-    int GetSize() { return page_hdr->num_key; }
+    void set_val(int val_idx, const char *val) { memcpy(get_val(val_idx), val, file_hdr->val_len); }
+
+    void set_rid(int rid_idx, const Rid &rid) { memcpy(get_val(rid_idx), &rid, sizeof(Rid)); }
+
+    int GetSize() const { return page_hdr->num_key; }
 
     void SetSize(int size) { page_hdr->num_key = size; }
 
-    int GetMaxSize() { return file_hdr->btree_order + 1; }
+    // 前缀压缩的叶子结点按当前前缀长度能放下的个数，其余结点为btree_order + 1
+    int GetMaxSize() const { return IsCompressed() ? slot_num(prefix_len()) : file_hdr->btree_order + 1; }
 
-    int GetMinSize() { return GetMaxSize() / 2; }
+    // 按不压缩的结点计算，前缀压缩的叶子结点少于它时，即使前缀变为空也能再放下一个结点的键值对
+    int GetMinSize() const { return (file_hdr->btree_order + 1) / 2; }
 
-    int KeyAt(int i) { return *(int *)get_key(i); }
+    // 第i个key的int值（只用于int类型的索引，测试中打印和检查结点）
+    int KeyAt(int i) {
+        if (!file_hdr->normalized) {
+            return *(int *)get_key(i);
+        }
+        int key;
+        ix_decode_col(get_key(i), (char *)&key, TYPE_INT, sizeof(int));
+        return key;
+    }
 
     /**
      * @brief 得到第i个孩子结点的page_no
@@ -143,10 +401,22 @@ class IxNodeHandle {
 
     page_id_t GetParentPageNo() { return page_hdr->parent; }
 
-    bool IsLeafPage() { return page_hdr->is_leaf; }
+    bool IsLeafPage() const { return page_hdr->is_leaf; }
+
+    bool IsCompressed() const { return file_hdr->compressed && page_hdr->is_leaf; }
 
     bool IsRootPage() { return GetParentPageNo() == INVALID_PAGE_ID; }
 
+    /** B-link模式下结点的high key：结点及其子树中的key都小于它，key >= high key时应向右兄弟查找 */
+    char *get_high_key() const { return page->GetData() + PAGE_SIZE - file_hdr->col_len; }
+
+    bool HasHighKey() const { return page_hdr->has_high_key; }
+
+    void SetHighKey(const char *key) {
+        memcpy(get_high_key(), key, file_hdr->col_len);
+        page_hdr->has_high_key = true;
+    }
+
     void SetNextLeaf(page_id_t page_no) { page_hdr->next_leaf = page_no; }
 
     void SetPrevLeaf(page_id_t page_no) { page_hdr->prev_leaf = page_no; }
@@ -1,22 +1,183 @@
 #include "ix_scan.h"
 
+IxScan::IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool reverse)
+    : ih_(ih), iid_(reverse ? upper : lower), end_(reverse ? lower : upper), bpm_(bpm), reverse_(reverse) {
+    ih_->begin_scan();
+    try {
+        if (reverse_) {
+            reverse_end_ = lower == upper;
+            if (!reverse_end_) {
+                IxNodeHandle *node = ih_->FetchNode(iid_.page_no);
+                node->page->RLatch();
+                enter_leaf_backward(node);
+            }
+        } else if (!is_end()) {
+            IxNodeHandle *node = ih_->FetchNode(iid_.page_no);
+            node->page->RLatch();
+            enter_leaf_forward(node);
+        }
+    } catch (...) {
+        ih_->end_scan();
+        throw;
+    }
+}
+
+IxScan::~IxScan() {
+    if (leaf_ != nullptr) {
+        unpin_node(leaf_);
+    }
+    ih_->end_scan();
+}
+
 /**
- * @brief 找到leaf page的下一个slot_no
+ * @brief 找到leaf page的下一个slot_no，反向扫描时是前一个
+ * @note 在当前叶子内移动时不访问页面，到达叶子的边界时才进入相邻的叶子
  */
 void IxScan::next() {
     assert(!is_end());
-    IxNodeHandle *node = ih_->FetchNode(iid_.page_no);
-    assert(node->IsLeafPage());
-    assert(iid_.slot_no < node->GetSize());
+    if (reverse_) {
+        if (iid_ == end_) {
+            reverse_end_ = true;
+        } else if (iid_.slot_no > batch_begin_) {
+            iid_.slot_no--;
+        } else {
+            leaf_->page->RLatch();
+            enter_leaf_backward(leaf_);
+        }
+        return;
+    }
     // increment slot no
     iid_.slot_no++;
-    if (iid_.page_no != ih_->file_hdr_.last_leaf && iid_.slot_no == node->GetSize()) {
-        // go to next leaf
-        iid_.slot_no = 0;
-        iid_.page_no = node->GetNextLeaf();
+    if (iid_ == end_ || iid_.slot_no < leaf_size_) {
+        return;
     }
+    // go to next leaf（跳过B-link树中的空叶子）
+    leaf_->page->RLatch();
+    enter_leaf_forward(leaf_);
+}
+
+/**
+ * @brief 把当前叶子中从iid_开始、在扫描范围内的rid一次追加到rids中，然后移动到下一个叶子；只用于正向扫描
+ */
+void IxScan::next_batch(std::vector<Rid> *rids) {
+    assert(!reverse_ && !is_end());
+    int end_slot = iid_.page_no == end_.page_no ? std::min(end_.slot_no, leaf_size_) : leaf_size_;
+    assert(iid_.slot_no < end_slot);
+    rids->insert(rids->end(), rids_.begin() + (iid_.slot_no - batch_begin_), rids_.begin() + (end_slot - batch_begin_));
+    iid_.slot_no = end_slot - 1;
+    next();
 }
 
 Rid IxScan::rid() const {
-    return ih_->get_rid(iid_);
+    int idx = iid_.slot_no - batch_begin_;
+    if (idx < 0 || idx >= static_cast<int>(rids_.size())) {
+        throw IndexEntryNotFoundError();
+    }
+    return rids_[idx];
+}
+
+/**
+ * @brief 把当前位置上的值复制到val中，直接读取pin住的叶子
+ */
+void IxScan::get_val(char *val) const { get_entry(nullptr, val); }
+
+/**
+ * @brief 读取当前位置上的key（还原为原始形式，key为nullptr时不读）和值，直接读取pin住的叶子
+ */
+void IxScan::get_entry(char *key, char *val) const {
+    assert(!is_end());
+    leaf_->page->RLatch();
+    if (iid_.slot_no >= leaf_->GetSize()) {
+        leaf_->page->RUnlatch();
+        throw IndexEntryNotFoundError();
+    }
+    ih_->copy_entry(leaf_, iid_.slot_no, key, val);
+    leaf_->page->RUnlatch();
+}
+
+/**
+ * @brief 读取当前叶子中从iid_开始、按扫描方向直到叶子边界或扫描范围末尾的各个值，按slot_no从小到大放在vals中
+ *
+ * @return vals中第一个值的slot_no
+ */
+int IxScan::leaf_vals(std::vector<char> *vals) const {
+    assert(!is_end());
+    int val_len = ih_->file_hdr_.val_len;
+    int from = iid_.slot_no;
+    int to = iid_.slot_no + 1;
+    leaf_->page->RLatch();
+    if (reverse_) {
+        from = iid_.page_no == end_.page_no ? end_.slot_no : 0;
+    } else {
+        to = iid_.page_no == end_.page_no ? end_.slot_no : leaf_->GetSize();
+    }
+    to = std::min(to, leaf_->GetSize());
+    vals->resize(std::max(to - from, 0) * val_len);
+    if (to > from) {
+        memcpy(vals->data(), leaf_->get_val(from), (to - from) * val_len);
+    }
+    leaf_->page->RUnlatch();
+    return from;
+}
+
+/**
+ * @brief 从已加读latch的node（iid_所在的叶子）开始正向找到第一个有键值对的位置，进入该叶子
+ * @note 到达叶子末尾时先latch下一个叶子再释放当前叶子（latch coupling，与分裂时从左到右加latch的顺序一致）；
+ * 最后一个叶子的末尾即leaf_end
+ */
+void IxScan::enter_leaf_forward(IxNodeHandle *node) {
+    while (iid_.slot_no >= node->GetSize() && iid_.page_no != ih_->file_hdr_.last_leaf) {
+        IxNodeHandle *next = ih_->FetchNode(node->GetNextLeaf());
+        next->page->RLatch();
+        node->page->RUnlatch();
+        if (node != leaf_) {
+            unpin_node(node);
+        }
+        node = next;
+        iid_ = {.page_no = node->GetPageNo(), .slot_no = 0};
+    }
+    set_leaf(node, iid_.slot_no, node->GetSize());
+}
+
+/**
+ * @brief 从已加读latch的node（iid_所在的叶子）开始反向找到iid_之前的一个键值对，进入该叶子
+ * @note 调用者保证iid_之前还有键值对。向左移动时先释放当前叶子再latch前一个叶子，不与从左到右加latch的操作死锁
+ */
+void IxScan::enter_leaf_backward(IxNodeHandle *node) {
+    iid_.slot_no = std::min(iid_.slot_no, node->GetSize());
+    while (iid_.slot_no == 0) {
+        page_id_t prev_leaf = node->GetPrevLeaf();
+        node->page->RUnlatch();
+        if (node != leaf_) {
+            unpin_node(node);
+        }
+        assert(prev_leaf != IX_LEAF_HEADER_PAGE);
+        node = ih_->FetchNode(prev_leaf);
+        node->page->RLatch();
+        iid_ = {.page_no = prev_leaf, .slot_no = node->GetSize()};
+    }
+    iid_.slot_no--;
+    set_leaf(node, 0, iid_.slot_no + 1);
+}
+
+/**
+ * @brief 复制已加读latch的node中第from到to - 1个rid，释放latch，并把node作为当前叶子（unpin之前的叶子）
+ */
+void IxScan::set_leaf(IxNodeHandle *node, int from, int to) {
+    leaf_size_ = node->GetSize();
+    batch_begin_ = from;
+    rids_.clear();
+    for (int i = from; i < to; i++) {
+        rids_.push_back(*node->get_rid(i));
+    }
+    node->page->RUnlatch();
+    if (leaf_ != nullptr && leaf_ != node) {
+        unpin_node(leaf_);
+    }
+    leaf_ = node;
+}
+
+void IxScan::unpin_node(IxNodeHandle *node) const {
+    bpm_->UnpinPage(node->GetPageId(), false);
+    delete node;
 }
@@ -5,22 +5,56 @@
 
 /**
  * @brief 用于直接遍历叶子结点，而不用FindLeafPage()来得到叶子结点
+ * @note 反向扫描（reverse）从upper之前的键值对开始，沿prev_leaf向前遍历到lower为止，用于降序输出
+ *
+ * 扫描期间一直pin住当前叶子：进入叶子时加读latch，把叶子中的rid一次复制到rids_后释放latch，
+ * 之后在叶子内移动、读取rid都只是内存操作，只在跨越叶子时才重新加latch并fetch下一个叶子。
+ * 不在两次next()之间持有latch：执行器在扫描的同时可能修改同一个索引（同一线程对叶子加写latch会死锁），
+ * 其他事务也可能在持有latch期间等待锁。
+ * 扫描从构造到析构在索引上登记（IxIndexHandle::begin_scan/end_scan），REINDEX要等pin着的叶子都释放后才重建
  */
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
-    Iid iid_;  // 初始为lower（用于遍历的指针）
-    Iid end_;  // 初始为upper
+    Iid iid_;  // 初始为lower（用于遍历的指针）；反向扫描时初始为upper之前的位置
+    Iid end_;  // 初始为upper；反向扫描时为lower，即最后一个要扫描的位置
     BufferPoolManager *bpm_;
+    bool reverse_;
+    bool reverse_end_ = false;  // 反向扫描是否已经越过了lower
+    IxNodeHandle *leaf_ = nullptr;  // iid_所在的叶子，pin住但不加latch
+    int leaf_size_ = 0;             // 进入leaf_时叶子中的键值对个数
+    int batch_begin_ = 0;           // rids_[i]是leaf_中第batch_begin_ + i个键值对的rid
+    std::vector<Rid> rids_;
 
    public:
-    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm)
-        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {}
+    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool reverse = false);
+
+    ~IxScan() override;
+
+    IxScan(const IxScan &) = delete;
+    IxScan &operator=(const IxScan &) = delete;
 
     void next() override;
 
-    bool is_end() const override { return iid_ == end_; }
+    void next_batch(std::vector<Rid> *rids);
+
+    bool is_end() const override { return reverse_ ? reverse_end_ : iid_ == end_; }
 
     Rid rid() const override;
 
     const Iid &iid() const { return iid_; }
+
+    void get_val(char *val) const;
+
+    void get_entry(char *key, char *val) const;
+
+    int leaf_vals(std::vector<char> *vals) const;
+
+   private:
+    void enter_leaf_forward(IxNodeHandle *node);
+
+    void enter_leaf_backward(IxNodeHandle *node);
+
+    void set_leaf(IxNodeHandle *node, int from, int to);
+
+    void unpin_node(IxNodeHandle *node) const;
 };
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ix_defs.h"
+#include "ix_node_handle.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define IX_HAVE_AVX2_SEARCH
+#endif
+
+/**
+ * 4字节和8字节key（int、float，以及两个int的组合索引等）在结点内的查找。
+ * 保序编码后这些key是按大端存放的无符号整数（见ix_encode_col），可以按整数比较而不用逐字节memcmp；
+ * Key为uint32_t或uint64_t，upper为false时查找第一个>=target的位置，为true时查找第一个>target的位置。
+ */
+
+template <typename Key>
+inline Key ix_load_key(const char *p);
+
+template <>
+inline uint32_t ix_load_key<uint32_t>(const char *p) {
+    return ix_load_be32(p);
+}
+
+template <>
+inline uint64_t ix_load_key<uint64_t>(const char *p) {
+    return ix_load_be64(p);
+}
+
+// key是否排在查找结果之前
+template <typename Key, bool upper>
+inline bool ix_key_before(Key key, Key target) {
+    return upper ? key <= target : key < target;
+}
+
+/**
+ * @brief 无分支的二分查找：每次循环只根据比较结果选择下一段的起点，不做提前结束的判断
+ */
+template <typename Key, bool upper>
+inline int ix_branchless_search(const char *keys, int begin, int end, Key target) {
+    int base = begin;
+    int n = end - begin;
+    while (n > 1) {
+        int half = n / 2;
+        base = ix_key_before<Key, upper>(ix_load_key<Key>(keys + (size_t)(base + half) * sizeof(Key)), target)
+                   ? base + half
+                   : base;
+        n -= half;
+    }
+    return base + ix_key_before<Key, upper>(ix_load_key<Key>(keys + (size_t)base * sizeof(Key)), target);
+}
+
+#ifdef IX_HAVE_AVX2_SEARCH
+// 编译时没有打开-mavx2，运行时确认CPU支持后才调用带target("avx2")的函数
+inline bool ix_cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+/**
+ * @brief 用AVX2一次比较一个256位向量中的所有key，统计排在结果之前的key的个数（key有序，个数就是位置）
+ * @note 向量中的key先按字节翻转成小端，再异或符号位，使无符号的大小关系变成有符号比较指令能用的形式
+ */
+template <typename Key, bool upper>
+__attribute__((target("avx2"))) inline int ix_simd_search(const char *keys, int begin, int end, Key target) {
+    constexpr int lanes = 32 / sizeof(Key);
+    const __m256i bswap = sizeof(Key) == 4
+                              ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7,
+                                                 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                              : _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3,
+                                                 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    __m256i sign, t;
+    if constexpr (sizeof(Key) == 4) {
+        sign = _mm256_set1_epi32(INT32_MIN);
+        t = _mm256_set1_epi32((int32_t)(target ^ 0x80000000u));
+    } else {
+        sign = _mm256_set1_epi64x(INT64_MIN);
+        t = _mm256_set1_epi64x((int64_t)(target ^ 0x8000000000000000ull));
+    }
+    int count = 0;
+    int i = begin;
+    for (; i + lanes <= end; i += lanes) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + (size_t)i * sizeof(Key)));
+        k = _mm256_xor_si256(_mm256_shuffle_epi8(k, bswap), sign);
+        int mask;
+        // lower：key < target即target > key；upper：key <= target即!(key > target)
+        if constexpr (sizeof(Key) == 4) {
+            mask = _mm256_movemask_ps(_mm256_castsi256_ps(upper ? _mm256_cmpgt_epi32(k, t) : _mm256_cmpgt_epi32(t, k)));
+        } else {
+            mask = _mm256_movemask_pd(_mm256_castsi256_pd(upper ? _mm256_cmpgt_epi64(k, t) : _mm256_cmpgt_epi64(t, k)));
+        }
+        int num = __builtin_popcount(mask);
+        count += upper ? lanes - num : num;
+    }
+    for (; i < end; i++) {
+        count += ix_key_before<Key, upper>(ix_load_key<Key>(keys + (size_t)i * sizeof(Key)), target);
+    }
+    return begin + count;
+}
+#endif
+
+/**
+ * @brief 在keys[begin, end)中查找，keys是结点中定长存放的key数组
+ * @return 第一个>=target（upper为true时>target）的位置，都不满足时返回end；end <= begin时返回end
+ * @note key个数不超过IX_SIMD_SEARCH_MAX_KEYS时用AVX2顺序比较，更多时用无分支的二分查找；
+ * 不支持AVX2的平台只用二分查找
+ */
+template <typename Key, bool upper>
+inline int ix_search_keys(const char *keys, int begin, int end, Key target) {
+    if (end <= begin) {
+        return end;
+    }
+#ifdef IX_HAVE_AVX2_SEARCH
+    if (end - begin <= IX_SIMD_SEARCH_MAX_KEYS && ix_cpu_has_avx2()) {
+        return ix_simd_search<Key, upper>(keys, begin, end, target);
+    }
+#endif
+    return ix_branchless_search<Key, upper>(keys, begin, end, target);
+}
@@ -0,0 +1,256 @@
+#include "ix_sort.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <numeric>
+#include <thread>
+
+#include "errors.h"
+
+IxSorter::~IxSorter() {
+    for (auto &run : runs_) {
+        run->is.close();
+        std::remove(run->name.c_str());
+    }
+}
+
+/**
+ * @brief 加入一个键值对，内存中的键值对超过memory_limit时排序后写成一个run文件
+ *
+ * @param key 原始的key，长度为col_len
+ * @param val 长度为val_len的值
+ */
+void IxSorter::add(const char *key, const char *val) {
+    assert(!finished_);
+    if (buf_.size() + entry_len_ > memory_limit_) {
+        write_run();
+    }
+    size_t offset = buf_.size();
+    buf_.resize(offset + entry_len_);
+    if (file_hdr_.normalized) {
+        ix_encode_key(key, buf_.data() + offset, file_hdr_);
+    } else {
+        memcpy(buf_.data() + offset, key, file_hdr_.col_len);
+    }
+    memcpy(buf_.data() + offset + file_hdr_.col_len, val, file_hdr_.val_len);
+    num_entries_++;
+}
+
+/**
+ * @brief 结束add，准备按顺序输出：写过run文件时把内存中剩下的也写成run，然后建立归并的堆
+ */
+void IxSorter::finish() {
+    assert(!finished_);
+    finished_ = true;
+    if (runs_.empty()) {
+        sort_buffer();
+        return;
+    }
+    if (!buf_.empty()) {
+        write_run();
+    }
+    std::vector<char>().swap(buf_);
+    // 归并时每个run各读入一段，总共不超过memory_limit
+    size_t chunk = std::max<size_t>(1, memory_limit_ / entry_len_ / runs_.size()) * entry_len_;
+    for (int i = 0; i < (int)runs_.size(); i++) {
+        auto &run = runs_[i];
+        run->is.open(run->name, std::ios::binary);
+        if (!run->is.is_open()) {
+            throw UnixError();
+        }
+        run->buf.resize(chunk);
+        if (fill_run(run.get())) {
+            heap_.push_back(i);
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [&](int a, int b) { return run_greater(a, b); });
+}
+
+/**
+ * @brief 按key升序取出下一个键值对，跳过与上一个key相同的键值对
+ *
+ * @param[out] key 编码后的key，在下一次调用next之前有效
+ * @param[out] val 对应的值
+ * @return 是否还有键值对
+ */
+bool IxSorter::next(const char **key, const char **val) {
+    assert(finished_);
+    const char *entry;
+    do {
+        entry = next_entry();
+        if (entry == nullptr) {
+            return false;
+        }
+    } while (has_last_ && ix_key_compare(last_.data(), entry, file_hdr_) == 0);
+    memcpy(last_.data(), entry, entry_len_);
+    has_last_ = true;
+    *key = last_.data();
+    *val = last_.data() + file_hdr_.col_len;
+    return true;
+}
+
+// 对buf_中的键值对做稳定排序，结果存在order_中
+void IxSorter::sort_buffer() {
+    order_.resize(buf_.size() / entry_len_);
+    std::iota(order_.begin(), order_.end(), 0);
+    std::stable_sort(order_.begin(), order_.end(), [&](size_t a, size_t b) {
+        return ix_key_compare(buf_.data() + a * entry_len_, buf_.data() + b * entry_len_, file_hdr_) < 0;
+    });
+    for (auto &i : order_) {
+        i *= entry_len_;
+    }
+}
+
+// 把内存中的键值对排序后写成一个新的run文件
+void IxSorter::write_run() {
+    sort_buffer();
+    auto run = std::make_unique<Run>();
+    run->name = run_prefix_ + std::to_string(runs_.size());
+    std::ofstream os(run->name, std::ios::binary | std::ios::trunc);
+    for (size_t offset : order_) {
+        os.write(buf_.data() + offset, entry_len_);
+    }
+    os.close();
+    if (!os) {
+        throw UnixError();
+    }
+    runs_.push_back(std::move(run));
+    buf_.clear();
+    order_.clear();
+}
+
+// 当前段已经用完时从run文件中读入下一段，run中没有键值对时返回false
+bool IxSorter::fill_run(Run *run) {
+    if (run->pos < run->len) {
+        return true;
+    }
+    run->is.read(run->buf.data(), run->buf.size());
+    run->len = run->is.gcount() / entry_len_ * entry_len_;
+    run->pos = 0;
+    return run->len > 0;
+}
+
+// 堆顶是最小的键值对；key相同时编号小的run（先add的键值对）在前，保证排序稳定
+bool IxSorter::run_greater(int a, int b) const {
+    int cmp = ix_key_compare(run_entry(a), run_entry(b), file_hdr_);
+    return cmp > 0 || (cmp == 0 && a > b);
+}
+
+// 取出下一个键值对（不去重），没有时返回nullptr；返回的指针在下一次调用前有效
+const char *IxSorter::next_entry() {
+    if (runs_.empty()) {
+        if (mem_pos_ == order_.size()) {
+            return nullptr;
+        }
+        return buf_.data() + order_[mem_pos_++];
+    }
+    if (heap_.empty()) {
+        return nullptr;
+    }
+    auto greater = [&](int a, int b) { return run_greater(a, b); };
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    int i = heap_.back();
+    Run *run = runs_[i].get();
+    // 先拷贝出来再前进，读入下一段会覆盖run的缓冲区
+    memcpy(cur_.data(), run_entry(i), entry_len_);
+    run->pos += entry_len_;
+    if (fill_run(run)) {
+        std::push_heap(heap_.begin(), heap_.end(), greater);
+    } else {
+        heap_.pop_back();
+    }
+    return cur_.data();
+}
+
+IxParallelSorter::IxParallelSorter(const IxFileHdr &file_hdr, int num_sorters, size_t memory_limit,
+                                   const std::string &run_prefix)
+    : file_hdr_(file_hdr),
+      cur_keys_(num_sorters),
+      cur_vals_(num_sorters),
+      last_(file_hdr.col_len + file_hdr.val_len) {
+    assert(num_sorters >= 1);
+    for (int i = 0; i < num_sorters; i++) {
+        sorters_.push_back(
+            std::make_unique<IxSorter>(file_hdr, memory_limit / num_sorters, run_prefix + std::to_string(i) + '_'));
+    }
+}
+
+/**
+ * @brief 各sorter结束add后调用：并行地finish每个sorter，然后取出各自的第一个键值对建立归并的堆
+ */
+void IxParallelSorter::finish() {
+    if (sorters_.size() == 1) {
+        sorters_[0]->finish();
+    } else {
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(sorters_.size());
+        for (size_t i = 0; i < sorters_.size(); i++) {
+            threads.emplace_back([this, i, &errors]() {
+                try {
+                    sorters_[i]->finish();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (auto &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    for (int i = 0; i < (int)sorters_.size(); i++) {
+        if (sorters_[i]->next(&cur_keys_[i], &cur_vals_[i])) {
+            heap_.push_back(i);
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [&](int a, int b) { return sorter_greater(a, b); });
+}
+
+/**
+ * @brief 同IxSorter::next：按key升序取出下一个键值对，跳过与上一个key相同的键值对
+ */
+bool IxParallelSorter::next(const char **key, const char **val) {
+    auto greater = [&](int a, int b) { return sorter_greater(a, b); };
+    while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        int i = heap_.back();
+        bool is_dup = has_last_ && ix_key_compare(last_.data(), cur_keys_[i], file_hdr_) == 0;
+        if (!is_dup) {
+            // 先拷贝出来再前进，sorter的下一次next会覆盖当前的键值对
+            memcpy(last_.data(), cur_keys_[i], file_hdr_.col_len);
+            memcpy(last_.data() + file_hdr_.col_len, cur_vals_[i], file_hdr_.val_len);
+            has_last_ = true;
+        }
+        if (sorters_[i]->next(&cur_keys_[i], &cur_vals_[i])) {
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        } else {
+            heap_.pop_back();
+        }
+        if (!is_dup) {
+            *key = last_.data();
+            *val = last_.data() + file_hdr_.col_len;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 所有sorter中add过的键值对个数
+size_t IxParallelSorter::size() const {
+    size_t total = 0;
+    for (auto &sorter : sorters_) {
+        total += sorter->size();
+    }
+    return total;
+}
+
+// 堆顶是当前key最小的sorter；key相同时编号小的sorter在前
+bool IxParallelSorter::sorter_greater(int a, int b) const {
+    int cmp = ix_key_compare(cur_keys_[a], cur_keys_[b], file_hdr_);
+    return cmp > 0 || (cmp == 0 && a > b);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+
+#include "ix_defs.h"
+#include "ix_node_handle.h"
+
+/**
+ * @brief 建索引用的外部归并排序：把(key, value)键值对按key排好序后依次交给IxIndexHandle::bulk_load
+ *
+ * add传入原始的key，进入时按索引的格式编码（见ix_encode_key），之后只做按字节的比较。
+ * 内存中的键值对超过memory_limit字节时排好序写成一个run文件，finish之后对所有run做一次多路归并；
+ * 放得下时不写文件，直接遍历内存中排好序的键值对。
+ * 排序是稳定的，key相同时next只返回最先add的那个，与逐条insert_entry时保留先插入的记录一致。
+ */
+class IxSorter {
+    struct Run {
+        std::string name;
+        std::ifstream is;
+        std::vector<char> buf;  // 从run文件中读入的一段键值对
+        size_t pos = 0;         // 当前键值对在buf中的偏移
+        size_t len = 0;         // buf中有效数据的长度
+    };
+
+    IxFileHdr file_hdr_;
+    size_t entry_len_;  // col_len + val_len
+    size_t memory_limit_;
+    std::string run_prefix_;  // run文件名的前缀，文件名为run_prefix_ + 编号
+    std::vector<char> buf_;   // 内存中还没有写出的键值对
+    std::vector<size_t> order_;  // buf_中键值对排序后的偏移
+    size_t num_entries_ = 0;
+    std::vector<std::unique_ptr<Run>> runs_;
+    std::vector<int> heap_;  // 归并时各run当前键值对组成的小根堆
+    size_t mem_pos_ = 0;     // 没有run文件时，遍历到order_中的位置
+    std::vector<char> cur_;   // 归并时从run中取出的键值对（run的缓冲区会被下一段覆盖，所以要拷贝）
+    std::vector<char> last_;  // 上一个返回的键值对，用于去重
+    bool has_last_ = false;
+    bool finished_ = false;
+
+   public:
+    IxSorter(const IxFileHdr &file_hdr, size_t memory_limit, const std::string &run_prefix)
+        : file_hdr_(file_hdr),
+          entry_len_(file_hdr.col_len + file_hdr.val_len),
+          memory_limit_(std::max(memory_limit, 2 * entry_len_)),
+          run_prefix_(run_prefix),
+          cur_(entry_len_),
+          last_(entry_len_) {}
+
+    ~IxSorter();
+
+    void add(const char *key, const char *val);
+
+    void finish();
+
+    bool next(const char **key, const char **val);
+
+    // add过的键值对个数（包括重复的key）
+    size_t size() const { return num_entries_; }
+
+    // 写出的run文件个数，为0表示全部在内存中排序
+    size_t num_runs() const { return runs_.size(); }
+
+   private:
+    void sort_buffer();
+
+    void write_run();
+
+    bool fill_run(Run *run);
+
+    const char *run_entry(int run) const { return runs_[run]->buf.data() + runs_[run]->pos; }
+
+    bool run_greater(int a, int b) const;
+
+    const char *next_entry();
+};
+
+/**
+ * @brief 并行建索引用的排序：第i个线程只往第i个IxSorter中add（各线程扫描堆文件中不相交的页面范围），
+ * finish时各个IxSorter并行地排序内存中的键值对、写出最后一个run，然后在next中按key对它们做多路归并。
+ * 第i个sorter收到的是第i段页面中的记录，key相同时编号小的sorter在前，
+ * 与单线程按页面顺序扫描时一样保留最先扫描到的记录
+ */
+class IxParallelSorter {
+    IxFileHdr file_hdr_;
+    std::vector<std::unique_ptr<IxSorter>> sorters_;
+    std::vector<const char *> cur_keys_;  // 各sorter当前的键值对，在该sorter的下一次next之前有效
+    std::vector<const char *> cur_vals_;
+    std::vector<int> heap_;    // 还有键值对的sorter组成的小根堆
+    std::vector<char> last_;   // 上一个返回的键值对，用于去重
+    bool has_last_ = false;
+
+   public:
+    /**
+     * @param num_sorters 并行add的线程数，每个sorter分到memory_limit / num_sorters的内存
+     * @param run_prefix 第i个sorter的run文件名的前缀为run_prefix + i + '_'
+     */
+    IxParallelSorter(const IxFileHdr &file_hdr, int num_sorters, size_t memory_limit, const std::string &run_prefix);
+
+    int num_sorters() const { return (int)sorters_.size(); }
+
+    // 第i个线程使用的sorter
+    IxSorter *get(int i) { return sorters_[i].get(); }
+
+    void finish();
+
+    bool next(const char **key, const char **val);
+
+    size_t size() const;
+
+   private:
+    bool sorter_greater(int a, int b) const;
+};
@@ -12,14 +12,22 @@
 const char *help_info = "Supported SQL syntax:\n"
                    "  command ;\n"
                    "command:\n"
-                   "  CREATE TABLE table_name (column_name type [, column_name type ...])\n"
+                   "  CREATE TABLE table_name (column_name type [, column_name type ...] [, PRIMARY KEY (column_name)])\n"
+                   "      [PARTITION BY HASH (column_name) PARTITIONS n]\n"
                    "  DROP TABLE table_name\n"
-                   "  CREATE INDEX table_name (column_name)\n"
-                   "  DROP INDEX table_name (column_name)\n"
+                   "  CREATE INDEX table_name (column_name [, column_name ...]) [USING BLINK | USING HASH]\n"
+                   "  CREATE INDEX table_name (column_name [, ...]) INCLUDE (column_name [, ...])\n"
+                   "  CREATE INDEX [CONCURRENTLY] table_name (column_name [, column_name ...]) [PARALLEL n]\n"
+                   "  DROP INDEX table_name (column_name [, column_name ...])\n"
+                   "  VACUUM table_name\n"
+                   "  REINDEX table_name\n"
+                   "  ANALYZE [table_name]\n"
                    "  INSERT INTO table_name VALUES (value [, value ...])\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
-                   "  SELECT selector FROM table_name [WHERE where_clause]\n"
+                   "  SELECT selector FROM table_name [WHERE where_clause] [ORDER BY order_list] [LIMIT n]\n"
+                   "  COPY table_name FROM 'file_name'\n"
+                   "  COPY {table_name | (SELECT selector FROM table_name [WHERE where_clause])} TO 'file_name' [CSV | BINARY]\n"
                    "type:\n"
                    "  {INT | FLOAT | CHAR(n)}\n"
                    "where_clause:\n"
@@ -31,7 +39,9 @@ const char *help_info = "Supported SQL syntax:\n"
                    "op:\n"
                    "  {= | <> | < | > | <= | >=}\n"
                    "selector:\n"
-                   "  {* | column [, column ...]}\n";
+                   "  {* | column [, column ...]}\n"
+                   "order_list:\n"
+                   "  column [ASC | DESC] [, column [ASC | DESC] ...]\n";
 
 class Interp {
    private:
@@ -79,10 +89,37 @@ class Interp {
                                       .type = interp_sv_type(sv_col_def->type_len->type),
                                       .len = sv_col_def->type_len->len};
                     col_defs.push_back(col_def);
-                } else {
+                } else if (std::dynamic_pointer_cast<ast::PrimaryKey>(field) == nullptr) {
                     throw InternalError("Unexpected field type");
                 }
             }
+            // 主键可以写在列定义之后，所有列都收集完再标记
+            bool has_primary_key = false;
+            for (auto &field : x->fields) {
+                if (auto sv_pk = std::dynamic_pointer_cast<ast::PrimaryKey>(field)) {
+                    auto col_def = std::find_if(col_defs.begin(), col_defs.end(),
+                                                [&](const ColDef &def) { return def.name == sv_pk->col_name; });
+                    if (col_def == col_defs.end()) {
+                        throw ColumnNotFoundError(sv_pk->col_name);
+                    }
+                    if (has_primary_key) {
+                        throw ClusteredTableError(x->tab_name, "multiple primary keys");
+                    }
+                    col_def->primary_key = true;
+                    has_primary_key = true;
+                }
+            }
+            if (!x->part_col.empty()) {
+                auto col_def = std::find_if(col_defs.begin(), col_defs.end(),
+                                            [&](const ColDef &def) { return def.name == x->part_col; });
+                if (col_def == col_defs.end()) {
+                    throw ColumnNotFoundError(x->part_col);
+                }
+                if (x->num_parts <= 0) {
+                    throw PartitionedTableError(x->tab_name, "PARTITIONS must be positive");
+                }
+                col_def->num_parts = x->num_parts;
+            }
             SetTransaction(txn_id, context);
             sm_manager_->create_table(x->tab_name, col_defs, context);
             if(context->txn_->GetTxnMode() == false)
@@ -96,13 +133,32 @@ class Interp {
         } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(root)) {
             // create index;
             SetTransaction(txn_id, context);
-            sm_manager_->create_index(x->tab_name, x->col_name, context);
+            sm_manager_->create_index(x->tab_name, x->col_names, context, x->blink, x->include_cols, x->hash,
+                                      x->concurrently, x->num_threads > 0 ? x->num_threads : INDEX_BUILD_THREADS);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
         } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(root)) {
             // drop index
             SetTransaction(txn_id, context);
-            sm_manager_->drop_index(x->tab_name, x->col_name, context);
+            sm_manager_->drop_index(x->tab_name, x->col_names, context);
+            if(context->txn_->GetTxnMode() == false)
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (auto x = std::dynamic_pointer_cast<ast::Vacuum>(root)) {
+            // vacuum table;
+            SetTransaction(txn_id, context);
+            sm_manager_->vacuum_table(x->tab_name, context);
+            if(context->txn_->GetTxnMode() == false)
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (auto x = std::dynamic_pointer_cast<ast::Reindex>(root)) {
+            // reindex table;
+            SetTransaction(txn_id, context);
+            sm_manager_->reindex_table(x->tab_name, context);
+            if(context->txn_->GetTxnMode() == false)
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (auto x = std::dynamic_pointer_cast<ast::Analyze>(root)) {
+            // analyze table;
+            SetTransaction(txn_id, context);
+            sm_manager_->analyze_table(x->tab_name, context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
         } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
@@ -144,7 +200,26 @@ class Interp {
                 sel_cols.push_back(sel_col);
             }
             SetTransaction(txn_id, context);
-            ql_manager_->select_from(sel_cols, x->tabs, conds, context);
+            ql_manager_->select_from(sel_cols, x->tabs, conds, context, interp_order_by(x->orders), x->limit);
+            if(context->txn_->GetTxnMode() == false)
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (auto x = std::dynamic_pointer_cast<ast::CopyFrom>(root)) {
+            // copy from;
+            SetTransaction(txn_id, context);
+            ql_manager_->copy_from(x->tab_name, x->file_name, context);
+            if(context->txn_->GetTxnMode() == false)
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (auto x = std::dynamic_pointer_cast<ast::CopyTo>(root)) {
+            // copy to;
+            std::vector<Condition> conds = interp_where_clause(x->query->conds);
+            std::vector<TabCol> sel_cols;
+            for (auto &sv_sel_col : x->query->cols) {
+                TabCol sel_col = {.tab_name = sv_sel_col->tab_name, .col_name = sv_sel_col->col_name};
+                sel_cols.push_back(sel_col);
+            }
+            SetTransaction(txn_id, context);
+            ql_manager_->copy_to(sel_cols, x->query->tabs, conds, x->file_name, interp_sv_copy_format(x->format),
+                                 context, interp_order_by(x->query->orders), x->query->limit);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnBegin>(root)) {
@@ -185,6 +260,13 @@ class Interp {
         return m.at(op);
     }
 
+    CopyFormat interp_sv_copy_format(ast::SvCopyFormat format) {
+        std::map<ast::SvCopyFormat, CopyFormat> m = {
+            {ast::SV_COPY_CSV, COPY_CSV}, {ast::SV_COPY_BINARY, COPY_BINARY},
+        };
+        return m.at(format);
+    }
+
     Value interp_sv_value(const std::shared_ptr<ast::Value> &sv_val) {
         Value val;
         if (auto int_lit = std::dynamic_pointer_cast<ast::IntLit>(sv_val)) {
@@ -216,4 +298,13 @@ class Interp {
         }
         return conds;
     }
+    std::vector<OrderByCol> interp_order_by(const std::vector<std::shared_ptr<ast::OrderBy>> &sv_orders) {
+        std::vector<OrderByCol> order_cols;
+        for (auto &sv_order : sv_orders) {
+            OrderByCol order_col = {.col = {.tab_name = sv_order->col->tab_name, .col_name = sv_order->col->col_name},
+                                    .desc = sv_order->dir == ast::SV_ORDER_DESC};
+            order_cols.push_back(order_col);
+        }
+        return order_cols;
+    }
 };
@@ -14,6 +14,14 @@ enum SvCompOp {
     SV_OP_EQ, SV_OP_NE, SV_OP_LT, SV_OP_GT, SV_OP_LE, SV_OP_GE
 };
 
+enum SvCopyFormat {
+    SV_COPY_CSV, SV_COPY_BINARY
+};
+
+enum SvOrderByDir {
+    SV_ORDER_ASC, SV_ORDER_DESC
+};
+
 // Base class for tree nodes
 struct TreeNode {
     virtual ~TreeNode() = default;  // enable polymorphism
@@ -55,12 +63,26 @@ struct ColDef : public Field {
             col_name(std::move(col_name_)), type_len(std::move(type_len_)) {}
 };
 
+// PRIMARY KEY (col)：有主键的表是聚簇表
+struct PrimaryKey : public Field {
+    std::string col_name;
+
+    PrimaryKey(std::string col_name_) : col_name(std::move(col_name_)) {}
+};
+
 struct CreateTable : public TreeNode {
     std::string tab_name;
     std::vector<std::shared_ptr<Field>> fields;
+    std::string part_col;  // PARTITION BY HASH(part_col) PARTITIONS num_parts，num_parts为0表示不分区
+    int num_parts = 0;
 
     CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_) :
             tab_name(std::move(tab_name_)), fields(std::move(fields_)) {}
+
+    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_, std::string part_col_,
+                int num_parts_) :
+            tab_name(std::move(tab_name_)), fields(std::move(fields_)), part_col(std::move(part_col_)),
+            num_parts(num_parts_) {}
 };
 
 struct DropTable : public TreeNode {
@@ -77,18 +99,47 @@ struct DescTable : public TreeNode {
 
 struct CreateIndex : public TreeNode {
     std::string tab_name;
-    std::string col_name;
-
-    CreateIndex(std::string tab_name_, std::string col_name_) :
-            tab_name(std::move(tab_name_)), col_name(std::move(col_name_)) {}
+    std::vector<std::string> col_names;  // 多于一列时是组合索引
+    bool blink;  // USING BLINK：建成B-link树
+    std::vector<std::string> include_cols;  // INCLUDE (...)：只存放在叶子结点中、不参与排序的列
+    bool hash;  // USING HASH：建成可扩展哈希索引
+    bool concurrently;  // CONCURRENTLY：建索引期间不阻塞对表的写
+    int num_threads;    // PARALLEL n：扫描和排序堆文件的线程数，0表示使用默认值
+
+    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_, bool blink_ = false,
+                std::vector<std::string> include_cols_ = {}, bool hash_ = false, bool concurrently_ = false,
+                int num_threads_ = 0) :
+            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)), blink(blink_),
+            include_cols(std::move(include_cols_)), hash(hash_), concurrently(concurrently_),
+            num_threads(num_threads_) {}
 };
 
 struct DropIndex : public TreeNode {
     std::string tab_name;
-    std::string col_name;
+    std::vector<std::string> col_names;
 
-    DropIndex(std::string tab_name_, std::string col_name_) :
-            tab_name(std::move(tab_name_)), col_name(std::move(col_name_)) {}
+    DropIndex(std::string tab_name_, std::vector<std::string> col_names_) :
+            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)) {}
+};
+
+struct Vacuum : public TreeNode {
+    std::string tab_name;
+
+    Vacuum(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
+// 重建表上的所有索引
+struct Reindex : public TreeNode {
+    std::string tab_name;
+
+    Reindex(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
+// 收集表的统计信息，tab_name为空时表示所有表
+struct Analyze : public TreeNode {
+    std::string tab_name;
+
+    Analyze(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
 };
 
 struct Expr : public TreeNode {
@@ -167,15 +218,45 @@ struct UpdateStmt : public TreeNode {
             tab_name(std::move(tab_name_)), set_clauses(std::move(set_clauses_)), conds(std::move(conds_)) {}
 };
 
+struct OrderBy : public TreeNode {
+    std::shared_ptr<Col> col;
+    SvOrderByDir dir;
+
+    OrderBy(std::shared_ptr<Col> col_, SvOrderByDir dir_) : col(std::move(col_)), dir(dir_) {}
+};
+
 struct SelectStmt : public TreeNode {
     std::vector<std::shared_ptr<Col>> cols;
     std::vector<std::string> tabs;
     std::vector<std::shared_ptr<BinaryExpr>> conds;
+    std::vector<std::shared_ptr<OrderBy>> orders;  // ORDER BY的各列，为空时不排序
+    int limit;                                     // LIMIT的行数，-1表示没有LIMIT
 
     SelectStmt(std::vector<std::shared_ptr<Col>> cols_,
                std::vector<std::string> tabs_,
-               std::vector<std::shared_ptr<BinaryExpr>> conds_) :
-            cols(std::move(cols_)), tabs(std::move(tabs_)), conds(std::move(conds_)) {}
+               std::vector<std::shared_ptr<BinaryExpr>> conds_,
+               std::vector<std::shared_ptr<OrderBy>> orders_ = {},
+               int limit_ = -1) :
+            cols(std::move(cols_)), tabs(std::move(tabs_)), conds(std::move(conds_)), orders(std::move(orders_)),
+            limit(limit_) {}
+};
+
+struct CopyFrom : public TreeNode {
+    std::string tab_name;
+    std::string file_name;
+
+    CopyFrom(std::string tab_name_, std::string file_name_) :
+            tab_name(std::move(tab_name_)), file_name(std::move(file_name_)) {}
+};
+
+// COPY table TO 'file'会被当作COPY (SELECT * FROM table) TO 'file'
+struct CopyTo : public TreeNode {
+    std::shared_ptr<SelectStmt> query;
+    std::string file_name;
+    SvCopyFormat format;
+
+    CopyTo(std::shared_ptr<SelectStmt> query_, std::string file_name_, SvCopyFormat format_) :
+            query(std::move(query_)), file_name(std::move(file_name_)), format(format_) {}
 };
 
 // Semantic value
@@ -189,6 +270,10 @@ struct SemValue {
 
     SvCompOp sv_comp_op;
 
+    SvCopyFormat sv_copy_format;
+
+    SvOrderByDir sv_orderby_dir;
+
     std::shared_ptr<TypeLen> sv_type_len;
 
     std::shared_ptr<Field> sv_field;
@@ -207,6 +292,9 @@ struct SemValue {
 
     std::shared_ptr<BinaryExpr> sv_cond;
     std::vector<std::shared_ptr<BinaryExpr>> sv_conds;
+
+    std::shared_ptr<OrderBy> sv_orderby;
+    std::vector<std::shared_ptr<OrderBy>> sv_orderbys;
 };
 
 extern std::shared_ptr<ast::TreeNode> parse_tree;
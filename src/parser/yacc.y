@@ -31,23 +31,32 @@ WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_CO
 %token <sv_int> VALUE_INT
 %token <sv_float> VALUE_FLOAT
 
+// keywords added after the original token set (keeps the numbering of the tokens above stable)
+%token VACUUM COPY TO CSV BINARY ANALYZE PRIMARY KEY PARTITION BY HASH PARTITIONS USING BLINK INCLUDE ORDER ASC LIMIT
+CONCURRENTLY REINDEX PARALLEL
+
 // specify types for non-terminal symbol
 %type <sv_node> stmt dbStmt ddl dml txnStmt
 %type <sv_field> field
 %type <sv_fields> fieldList
 %type <sv_type_len> type
 %type <sv_comp_op> op
+%type <sv_copy_format> optCopyFormat
 %type <sv_expr> expr
 %type <sv_val> value
 %type <sv_vals> valueList
 %type <sv_str> tbName colName
-%type <sv_strs> tableList
+%type <sv_strs> tableList colNameList
 %type <sv_col> col
 %type <sv_cols> colList selector
 %type <sv_set_clause> setClause
 %type <sv_set_clauses> setClauses
 %type <sv_cond> condition
 %type <sv_conds> whereClause optWhereClause
+%type <sv_orderby> orderBy
+%type <sv_orderbys> orderByList optOrderByClause
+%type <sv_orderby_dir> optOrderByDir
+%type <sv_int> optLimitClause
 
 %%
 start:
@@ -111,6 +120,10 @@ ddl:
     {
         $$ = std::make_shared<CreateTable>($3, $5);
     }
+    |   CREATE TABLE tbName '(' fieldList ')' PARTITION BY HASH '(' colName ')' PARTITIONS VALUE_INT
+    {
+        $$ = std::make_shared<CreateTable>($3, $5, $11, $14);
+    }
     |   DROP TABLE tbName
     {
         $$ = std::make_shared<DropTable>($3);
@@ -119,14 +132,54 @@ ddl:
     {
         $$ = std::make_shared<DescTable>($2);
     }
-    |   CREATE INDEX tbName '(' colName ')'
+    |   CREATE INDEX tbName '(' colNameList ')'
     {
         $$ = std::make_shared<CreateIndex>($3, $5);
     }
-    |   DROP INDEX tbName '(' colName ')'
+    |   CREATE INDEX CONCURRENTLY tbName '(' colNameList ')'
+    {
+        $$ = std::make_shared<CreateIndex>($4, $6, false, std::vector<std::string>{}, false, true);
+    }
+    |   CREATE INDEX tbName '(' colNameList ')' PARALLEL VALUE_INT
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, false, std::vector<std::string>{}, false, false, $8);
+    }
+    |   CREATE INDEX CONCURRENTLY tbName '(' colNameList ')' PARALLEL VALUE_INT
+    {
+        $$ = std::make_shared<CreateIndex>($4, $6, false, std::vector<std::string>{}, false, true, $9);
+    }
+    |   CREATE INDEX tbName '(' colNameList ')' USING BLINK
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, true);
+    }
+    |   CREATE INDEX tbName '(' colNameList ')' USING HASH
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, false, std::vector<std::string>{}, true);
+    }
+    |   CREATE INDEX tbName '(' colNameList ')' INCLUDE '(' colNameList ')'
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, false, $9);
+    }
+    |   DROP INDEX tbName '(' colNameList ')'
     {
         $$ = std::make_shared<DropIndex>($3, $5);
     }
+    |   VACUUM tbName
+    {
+        $$ = std::make_shared<Vacuum>($2);
+    }
+    |   REINDEX tbName
+    {
+        $$ = std::make_shared<Reindex>($2);
+    }
+    |   ANALYZE
+    {
+        $$ = std::make_shared<Analyze>("");
+    }
+    |   ANALYZE tbName
+    {
+        $$ = std::make_shared<Analyze>($2);
+    }
     ;
 
 dml:
@@ -142,9 +195,38 @@ dml:
     {
         $$ = std::make_shared<UpdateStmt>($2, $4, $5);
     }
-    |   SELECT selector FROM tableList optWhereClause
+    |   SELECT selector FROM tableList optWhereClause optOrderByClause optLimitClause
+    {
+        $$ = std::make_shared<SelectStmt>($2, $4, $5, $6, $7);
+    }
+    |   COPY tbName FROM VALUE_STRING
     {
-        $$ = std::make_shared<SelectStmt>($2, $4, $5);
+        $$ = std::make_shared<CopyFrom>($2, $4);
+    }
+    |   COPY tbName TO VALUE_STRING optCopyFormat
+    {
+        auto query = std::make_shared<SelectStmt>(std::vector<std::shared_ptr<Col>>{}, std::vector<std::string>{$2},
+                                                  std::vector<std::shared_ptr<BinaryExpr>>{});
+        $$ = std::make_shared<CopyTo>(query, $4, $5);
+    }
+    |   COPY '(' SELECT selector FROM tableList optWhereClause optOrderByClause optLimitClause ')' TO VALUE_STRING optCopyFormat
+    {
+        $$ = std::make_shared<CopyTo>(std::make_shared<SelectStmt>($4, $6, $7, $8, $9), $12, $13);
+    }
+    ;
+
+optCopyFormat:
+        /* epsilon */
+    {
+        $$ = SV_COPY_CSV;
+    }
+    |   CSV
+    {
+        $$ = SV_COPY_CSV;
+    }
+    |   BINARY
+    {
+        $$ = SV_COPY_BINARY;
     }
     ;
 
@@ -164,6 +246,10 @@ field:
     {
         $$ = std::make_shared<ColDef>($1, $2);
     }
+    |   PRIMARY KEY '(' colName ')'
+    {
+        $$ = std::make_shared<PrimaryKey>($4);
+    }
     ;
 
 type:
@@ -233,6 +319,58 @@ whereClause:
     }
     ;
 
+optOrderByClause:
+        /* epsilon */ { /* ignore*/ }
+    |   ORDER BY orderByList
+    {
+        $$ = $3;
+    }
+    ;
+
+orderByList:
+        orderBy
+    {
+        $$ = std::vector<std::shared_ptr<OrderBy>>{$1};
+    }
+    |   orderByList ',' orderBy
+    {
+        $$.push_back($3);
+    }
+    ;
+
+orderBy:
+        col optOrderByDir
+    {
+        $$ = std::make_shared<OrderBy>($1, $2);
+    }
+    ;
+
+optOrderByDir:
+        /* epsilon */
+    {
+        $$ = SV_ORDER_ASC;
+    }
+    |   ASC
+    {
+        $$ = SV_ORDER_ASC;
+    }
+    |   DESC
+    {
+        $$ = SV_ORDER_DESC;
+    }
+    ;
+
+optLimitClause:
+        /* epsilon */
+    {
+        $$ = -1;
+    }
+    |   LIMIT VALUE_INT
+    {
+        $$ = $2;
+    }
+    ;
+
 col:
         tbName '.' colName
     {
@@ -319,6 +457,17 @@ selector:
     |   colList
     ;
 
+colNameList:
+        colName
+    {
+        $$ = std::vector<std::string>{$1};
+    }
+    |   colNameList ',' colName
+    {
+        $$.push_back($3);
+    }
+    ;
+
 tableList:
         tbName
     {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/arena.h"
 #include "common/macros.h"
 #include "defs.h"
 #include "storage/buffer_pool_manager.h"
@@ -25,44 +26,78 @@ struct RmPageHdr {
     int num_records;        // 当前page中当前分配的record个数（初始化为0）
 };
 
+// 不超过该长度的记录直接存放在RmRecord内部（small buffer），不再单独申请堆内存
+constexpr int RM_INLINE_RECORD_SIZE = 64;
+
 // 类似于Tuple
+// data的三种来源：
+//   1. 自有：长度不超过RM_INLINE_RECORD_SIZE时放在inline_buf_中，否则new出来并由allocated_标记，析构时释放
+//   2. arena：从语句的Arena中分配，随Arena一起释放
+//   3. 借用（view）：指向别人的内存（如缓冲池中的页面），只在被借用的内存有效期间可用
+// 拷贝总是得到自有的深拷贝；移动会把data连同其来源一起转交给目标，源对象变为空记录
 struct RmRecord {
-    char *data;  // data初始化分配size个字节的空间
-    int size;    // size = RmFileHdr的record_size
+    char *data = nullptr;  // data初始化分配size个字节的空间
+    int size = 0;          // size = RmFileHdr的record_size
     bool allocated_ = false;
 
-    // DISALLOW_COPY(RmRecord);
-    // RmRecord(const RmRecord &other) = delete;
-    // RmRecord &operator=(const RmRecord &other) = delete;
-
     RmRecord() = default;
 
-    RmRecord(const RmRecord &other) {
-        size = other.size;
-        data = new char[size];
-        memcpy(data, other.data, size);
-        allocated_ = true;
-    };
+    RmRecord(const RmRecord &other) : RmRecord(other.size, other.data) {}
+
+    RmRecord(RmRecord &&other) noexcept { take(other); }
 
     RmRecord &operator=(const RmRecord &other) {
-        size = other.size;
-        data = new char[size];
-        memcpy(data, other.data, size);
-        allocated_ = true;
+        if (this != &other) {
+            release();
+            alloc(other.size);
+            memcpy(data, other.data, size);
+        }
         return *this;
-    };
+    }
 
-    RmRecord(int size_) {
-        size = size_;
-        data = new char[size_];
-        allocated_ = true;
+    RmRecord &operator=(RmRecord &&other) noexcept {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    RmRecord(int size_) { alloc(size_); }
+
+    // data从arena中分配，随arena一起释放，RmRecord本身不拥有data
+    RmRecord(int size_, Arena *arena) {
+        if (arena != nullptr && size_ > RM_INLINE_RECORD_SIZE) {
+            size = size_;
+            data = arena->AllocateBytes(size_);
+        } else {
+            alloc(size_);
+        }
     }
 
     RmRecord(int size_, char *data_) {
-        size = size_;
-        data = new char[size_];
+        alloc(size_);
         memcpy(data, data_, size_);
-        allocated_ = true;
+    }
+
+    // 借用data_指向的size_个字节，不拷贝也不释放
+    static RmRecord view(char *data_, int size_) {
+        RmRecord rec;
+        rec.data = data_;
+        rec.size = size_;
+        return rec;
+    }
+
+    // data是否由本对象管理（inline或new出来的）；为false时是arena中的内存或借用的内存
+    bool is_owned() const { return allocated_ || data == inline_buf_; }
+
+    // 如果data不归本对象管理，就拷贝一份自有的，使其生命周期不再依赖arena或被借用的内存
+    void make_owned() {
+        if (!is_owned() && data != nullptr) {
+            char *src = data;
+            alloc(size);
+            memcpy(data, src, size);
+        }
     }
 
     void SetData(char *data_) {
@@ -70,17 +105,48 @@ struct RmRecord {
     }
 
     void Deserialize(const char *data_) {
-        size = *reinterpret_cast<const int *>(data_);
-        delete[] data;
-        data = new char[size];
+        release();
+        alloc(*reinterpret_cast<const int *>(data_));
         memcpy(data, data_ + sizeof(int), size);
     }
 
-    ~RmRecord() {
-        if(allocated_) {
+    ~RmRecord() { release(); }
+
+   private:
+    alignas(std::max_align_t) char inline_buf_[RM_INLINE_RECORD_SIZE];
+
+    void alloc(int size_) {
+        size = size_;
+        if (size_ <= RM_INLINE_RECORD_SIZE) {
+            data = inline_buf_;
+            allocated_ = false;
+        } else {
+            data = new char[size_];
+            allocated_ = true;
+        }
+    }
+
+    void release() {
+        if (allocated_) {
             delete[] data;
         }
         allocated_ = false;
         data = nullptr;
+        size = 0;
+    }
+
+    // 接管other的data，other变为空记录
+    void take(RmRecord &other) {
+        size = other.size;
+        if (other.data == other.inline_buf_) {
+            memcpy(inline_buf_, other.inline_buf_, other.size);
+            data = inline_buf_;
+        } else {
+            data = other.data;
+            allocated_ = other.allocated_;
+        }
+        other.allocated_ = false;
+        other.data = nullptr;
+        other.size = 0;
     }
 };
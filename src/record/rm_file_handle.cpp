@@ -4,6 +4,7 @@
  * @brief 由Rid得到指向RmRecord的指针
  *
  * @param rid 指定记录所在的位置
+ * @param context 非空时记录的data从context->arena_中分配，只在本条语句内有效
  * @return std::unique_ptr<RmRecord>
  */
 std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid, Context *context) const {
@@ -14,11 +15,33 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid, Context *cont
     int size_ = tmp_page_handle.file_hdr->record_size;
     char *data_ = tmp_page_handle.get_slot(rid.slot_no);
     //printf("在get_record里面为%s\n",data_);
-    std::unique_ptr<RmRecord> record_ptr(new RmRecord(size_,data_));
+    // 有context时记录缓冲区从语句的arena中分配
+    std::unique_ptr<RmRecord> record_ptr(new RmRecord(size_, context == nullptr ? nullptr : &context->arena_));
+    memcpy(record_ptr->data, data_, size_);
+    buffer_pool_manager_->UnpinPage(tmp_page_handle.page->GetPageId(), false);
     return record_ptr;
 
 }
 
+/**
+ * @brief 读出page_no页中slot_bitmap选中的各条记录，整个页面只fetch一次（位图堆扫描按页面顺序逐页读取）
+ *
+ * @param slot_bitmap 长度为file_hdr_.bitmap_size的位图，第i位为1表示要读第i个slot
+ * @param records 追加(slot_no, 记录)，已经删除的slot跳过
+ */
+void RmFileHandle::get_page_records(int page_no, const char *slot_bitmap,
+                                    std::vector<std::pair<int, RmRecord>> *records) const {
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    int per_page = file_hdr_.num_records_per_page;
+    for (int slot_no = Bitmap::first_bit(true, slot_bitmap, per_page); slot_no < per_page;
+         slot_no = Bitmap::next_bit(true, slot_bitmap, per_page, slot_no)) {
+        if (Bitmap::is_set(page_handle.bitmap, slot_no)) {
+            records->emplace_back(slot_no, RmRecord(file_hdr_.record_size, page_handle.get_slot(slot_no)));
+        }
+    }
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+}
+
 /**
  * @brief 在该记录文件（RmFileHandle）中插入一条记录
  *
@@ -33,11 +56,14 @@ Rid RmFileHandle::insert_record(char *buf, Context *context) {
     // 4. 更新page_handle.page_hdr中的数据结构
     // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
     if(file_hdr_.first_free_page_no == -1){
-        create_new_page_handle();
+        RmPageHandle new_page_handle = create_new_page_handle();
+        buffer_pool_manager_->UnpinPage(new_page_handle.page->GetPageId(), true);
     }
         RmPageHandle insertpage_handle = fetch_page_handle(file_hdr_.first_free_page_no);
         Rid rid_;
         //rid_.slot_no = Bitmap::next_bit(true, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page,rid_.slot_no);
+        // 写页面时持有页面的写latch，与并发建索引（CREATE INDEX CONCURRENTLY）时扫描数据页的读latch互斥
+        insertpage_handle.page->WLatch();
         int slot_no = Bitmap::first_bit(false, insertpage_handle.bitmap, file_hdr_.num_records_per_page);
         if(slot_no != file_hdr_.num_records_per_page){//也即找到了一个
             //复制数据进相应的slot
@@ -51,6 +77,7 @@ Rid RmFileHandle::insert_record(char *buf, Context *context) {
                 file_hdr_.first_free_page_no = insertpage_handle.page_hdr->next_free_page_no;
             }
         }
+        insertpage_handle.page->WUnlatch();
         buffer_pool_manager_->UnpinPage(insertpage_handle.page->GetPageId(), true);
         //printf("插入后立刻比较结果为%d\n",memcmp(get_record(Rid{insertpage_handle.page->GetPageId().page_no,slot_no},context)->data,buf,file_hdr_.record_size));
         //printf("插入后立即比较的结果是%d\n",memcmp(insertpage_handle.get_slot(slot_no),buf,file_hdr_.record_size));
@@ -70,15 +97,18 @@ void RmFileHandle::delete_record(const Rid &rid, Context *context) {
     // 2. 更新page_handle.page_hdr中的数据结构
     // 注意考虑删除一条记录后页面未满的情况，需要调用release_page_handle()
     RmPageHandle deletepage_handle = fetch_page_handle(rid.page_no);
+    deletepage_handle.page->WLatch();
     if(Bitmap::is_set(deletepage_handle.bitmap,rid.slot_no)){//如果被设置了，说明记录存在，那么处理它
         Bitmap::reset(deletepage_handle.bitmap,rid.slot_no);
         deletepage_handle.page_hdr->num_records--;
         if(deletepage_handle.page_hdr->num_records == (file_hdr_.num_records_per_page-1)){
             release_page_handle(deletepage_handle);
         }
-        return ;
+        deletepage_handle.page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(deletepage_handle.page->GetPageId(), true);
     }else{//如果这个记录本来就不存在，那么啥也不干
-        return;
+        deletepage_handle.page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(deletepage_handle.page->GetPageId(), false);
     }
 }
 
@@ -93,8 +123,144 @@ void RmFileHandle::update_record(const Rid &rid, char *buf, Context *context) {
     // 1. 获取指定记录所在的page handle
     // 2. 更新记录
     RmPageHandle updatepage_handle = fetch_page_handle(rid.page_no);
+    updatepage_handle.page->WLatch();
     memcpy(updatepage_handle.get_slot(rid.slot_no),buf,file_hdr_.record_size);
+    updatepage_handle.page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(updatepage_handle.page->GetPageId(), true);
+
+}
+
+/**
+ * @brief 批量追加记录（COPY FROM）：直接在文件末尾新分配的页面上从slot 0开始依次写满
+ *
+ * @param buf num_records条连续存放的记录，每条长度为record_size
+ * @param num_records 记录条数
+ * @param[out] rids 依次追加每条记录的位置
+ * @note 不查找空闲链表、不逐条找空闲slot，每个页面只pin/unpin一次；
+ * 最后一页没有写满时挂到空闲链表头部，之后的insert_record可以继续使用
+ */
+void RmFileHandle::append_records(const char *buf, int num_records, std::vector<Rid> *rids) {
+    int per_page = file_hdr_.num_records_per_page;
+    int record_size = file_hdr_.record_size;
+    for (int start = 0; start < num_records; start += per_page) {
+        int n = std::min(per_page, num_records - start);
+        PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+        Page *page = buffer_pool_manager_->NewPage(&page_id);
+        if (page == nullptr) {
+            throw InternalError("RmFileHandle::append_records: buffer pool is full");
+        }
+        RmPageHandle page_handle(&file_hdr_, page);
+        page_handle.page_hdr->num_records = n;
+        page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
+        // bitmap的前n位置1：整字节直接memset，剩下的逐位设置
+        Bitmap::init(page_handle.bitmap, file_hdr_.bitmap_size);
+        memset(page_handle.bitmap, 0xff, n / BITMAP_WIDTH);
+        for (int slot_no = n / BITMAP_WIDTH * BITMAP_WIDTH; slot_no < n; slot_no++) {
+            Bitmap::set(page_handle.bitmap, slot_no);
+        }
+        memcpy(page_handle.slots, buf + (size_t)start * record_size, (size_t)n * record_size);
+        if (n < per_page) {
+            page_handle.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
+            file_hdr_.first_free_page_no = page_id.page_no;
+        }
+        file_hdr_.num_pages++;
+        for (int slot_no = 0; slot_no < n; slot_no++) {
+            rids->push_back(Rid{page_id.page_no, slot_no});
+        }
+        buffer_pool_manager_->UnpinPage(page_id, true);
+    }
+}
+
+/**
+ * @brief 统计文件中的记录个数（VACUUM据此判断文件是否稀疏）
+ *
+ * @return int 文件中所有page_hdr->num_records之和
+ */
+int RmFileHandle::count_records() const {
+    int num_records = 0;
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_hdr_.num_pages; page_no++) {
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        num_records += page_handle.page_hdr->num_records;
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+    }
+    return num_records;
+}
+
+/**
+ * @brief 压缩记录文件：把尾部稀疏页面中的记录搬到前面页面的空闲slot中，然后截断文件
+ *
+ * @return std::vector<std::pair<Rid, Rid>> 被搬动的记录的<旧位置, 新位置>，上层需要据此更新索引
+ * @note 双指针：lo从前往后找未满的页，hi从后往前找非空的页，直到两者相遇。
+ * 结束后[1,lo)中的页都是满的，(hi,num_pages)中的页都是空的，空页全部被截断，空闲链表重新构建
+ */
+std::vector<std::pair<Rid, Rid>> RmFileHandle::compact(Context *context) {
+    std::vector<std::pair<Rid, Rid>> moved;
+    int per_page = file_hdr_.num_records_per_page;
+    int lo = RM_FIRST_RECORD_PAGE;
+    int hi = file_hdr_.num_pages - 1;
+    while (lo < hi) {
+        RmPageHandle dst_handle = fetch_page_handle(lo);
+        if (dst_handle.page_hdr->num_records == per_page) {
+            buffer_pool_manager_->UnpinPage(dst_handle.page->GetPageId(), false);
+            lo++;
+            continue;
+        }
+        RmPageHandle src_handle = fetch_page_handle(hi);
+        if (src_handle.page_hdr->num_records == 0) {
+            buffer_pool_manager_->UnpinPage(src_handle.page->GetPageId(), false);
+            buffer_pool_manager_->UnpinPage(dst_handle.page->GetPageId(), false);
+            hi--;
+            continue;
+        }
+        // 把hi页中的记录依次搬到lo页的空闲slot中，直到lo页满或hi页空
+        int dst_slot = -1;
+        int src_slot = -1;
+        while (dst_handle.page_hdr->num_records < per_page && src_handle.page_hdr->num_records > 0) {
+            dst_slot = Bitmap::next_bit(false, dst_handle.bitmap, per_page, dst_slot);
+            src_slot = Bitmap::next_bit(true, src_handle.bitmap, per_page, src_slot);
+            memcpy(dst_handle.get_slot(dst_slot), src_handle.get_slot(src_slot), file_hdr_.record_size);
+            Bitmap::set(dst_handle.bitmap, dst_slot);
+            Bitmap::reset(src_handle.bitmap, src_slot);
+            dst_handle.page_hdr->num_records++;
+            src_handle.page_hdr->num_records--;
+            moved.emplace_back(Rid{hi, src_slot}, Rid{lo, dst_slot});
+        }
+        buffer_pool_manager_->UnpinPage(src_handle.page->GetPageId(), true);
+        buffer_pool_manager_->UnpinPage(dst_handle.page->GetPageId(), true);
+    }
+
+    // 此时(hi,num_pages)中的页都是空的，只有hi页本身可能也是空的，确定截断后的页面个数
+    int num_pages = std::max(hi + 1, RM_FIRST_RECORD_PAGE);
+    while (num_pages > RM_FIRST_RECORD_PAGE) {
+        RmPageHandle page_handle = fetch_page_handle(num_pages - 1);
+        bool is_empty = page_handle.page_hdr->num_records == 0;
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+        if (!is_empty) {
+            break;
+        }
+        num_pages--;
+    }
 
+    // 重建空闲链表：[1,lo)中的页都是满的，只需要把[lo,num_pages)中未满的页串起来
+    file_hdr_.first_free_page_no = RM_NO_PAGE;
+    for (int page_no = num_pages - 1; page_no >= lo; page_no--) {
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        bool is_free = page_handle.page_hdr->num_records < per_page;
+        if (is_free) {
+            page_handle.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
+            file_hdr_.first_free_page_no = page_no;
+        }
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), is_free);
+    }
+
+    // 丢弃缓冲池中被截断的页面，截断磁盘文件，并写回file_hdr
+    if (num_pages < file_hdr_.num_pages) {
+        buffer_pool_manager_->DiscardPages(fd_, num_pages);
+        disk_manager_->truncate_file(fd_, num_pages);
+        file_hdr_.num_pages = num_pages;
+    }
+    disk_manager_->write_page(fd_, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+    return moved;
 }
 
 /** -- 以下为辅助函数 -- */
@@ -186,9 +352,11 @@ void RmFileHandle::release_page_handle(RmPageHandle &page_handle) {
  */
 void RmFileHandle::insert_record(const Rid &rid, char *buf) {
     if (rid.page_no < file_hdr_.num_pages) {
-        create_new_page_handle();
+        RmPageHandle new_page_handle = create_new_page_handle();
+        buffer_pool_manager_->UnpinPage(new_page_handle.page->GetPageId(), true);
     }
     RmPageHandle pageHandle = fetch_page_handle(rid.page_no);
+    pageHandle.page->WLatch();
     Bitmap::set(pageHandle.bitmap, rid.slot_no);
     pageHandle.page_hdr->num_records++;
     if (pageHandle.page_hdr->num_records == file_hdr_.num_records_per_page) {
@@ -197,6 +365,7 @@ void RmFileHandle::insert_record(const Rid &rid, char *buf) {
 
     char *slot = pageHandle.get_slot(rid.slot_no);
     memcpy(slot, buf, file_hdr_.record_size);
+    pageHandle.page->WUnlatch();
 
     buffer_pool_manager_->UnpinPage(pageHandle.page->GetPageId(), true);
 }
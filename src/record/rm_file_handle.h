@@ -3,6 +3,8 @@
 #include <assert.h>
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "bitmap.h"
 #include "common/context.h"
@@ -65,11 +67,15 @@ class RmFileHandle {      // TableHeap
 
     bool is_record(const Rid &rid) const {
         RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-        return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        bool is_set = Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+        return is_set;
     }
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
+    void get_page_records(int page_no, const char *slot_bitmap, std::vector<std::pair<int, RmRecord>> *records) const;
+
     Rid insert_record(char *buf, Context *context);
 
     void insert_record(const Rid &rid, char *buf);
@@ -78,6 +84,12 @@ class RmFileHandle {      // TableHeap
 
     void update_record(const Rid &rid, char *buf, Context *context);
 
+    void append_records(const char *buf, int num_records, std::vector<Rid> *rids);
+
+    int count_records() const;
+
+    std::vector<std::pair<Rid, Rid>> compact(Context *context);
+
     RmPageHandle create_new_page_handle();
 
     RmPageHandle fetch_page_handle(int page_no) const;
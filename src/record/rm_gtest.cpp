@@ -236,4 +236,236 @@ TEST(RecordManagerTest, MultipleFilesTest) {
         std::string filename = filenames[i];
         rm_manager->destroy_file(filename);
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 测试VACUUM：大量删除后压缩记录文件，搬动的记录内容不变，文件被截断
+ */
+TEST(RecordManagerTest, CompactTest) {
+    srand((unsigned)time(nullptr));
+
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::string filename = "compact.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 4 + rand() % 256;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+
+    char write_buf[PAGE_SIZE];
+    for (int i = 0; i < 2000; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    // 删除约90%的记录，使页面变得稀疏
+    std::vector<Rid> rids;
+    for (auto &entry : mock) {
+        rids.push_back(entry.first);
+    }
+    for (auto &rid : rids) {
+        if (rand() % 10 != 0) {
+            file_handle->delete_record(rid, context);
+            mock.erase(rid);
+        }
+    }
+    int pages_before = file_handle->file_hdr_.num_pages;
+    assert(file_handle->count_records() == (int)mock.size());
+
+    auto moved = file_handle->compact(context);
+    for (auto &entry : moved) {
+        assert(mock.count(entry.first) > 0 && mock.count(entry.second) == 0);
+        mock[entry.second] = mock[entry.first];
+        mock.erase(entry.first);
+    }
+    int per_page = file_handle->file_hdr_.num_records_per_page;
+    int min_pages = RM_FIRST_RECORD_PAGE + ((int)mock.size() + per_page - 1) / per_page;
+    assert(file_handle->file_hdr_.num_pages == min_pages);
+    assert(file_handle->file_hdr_.num_pages <= pages_before);
+    assert(disk_manager->GetFileSize(filename) <= min_pages * PAGE_SIZE);
+    check_equal(file_handle.get(), mock);
+
+    // 压缩后的文件可以继续正常插入，并且重新打开后内容不变
+    for (int i = 0; i < 100; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        assert(mock.count(rid) == 0);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试COPY FROM使用的批量追加：记录按顺序写满新页面，未写满的最后一页可以继续插入
+ */
+TEST(RecordManagerTest, AppendRecordsTest) {
+    srand((unsigned)time(nullptr));
+
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::string filename = "append.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 4 + rand() % 256;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+
+    char write_buf[PAGE_SIZE];
+    for (int i = 0; i < 10; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+
+    int per_page = file_handle->file_hdr_.num_records_per_page;
+    int num_records = per_page * 2 + per_page / 2 + 1;
+    std::vector<char> batch(num_records * record_size);
+    rand_buf(batch.size(), batch.data());
+    int pages_before = file_handle->file_hdr_.num_pages;
+    std::vector<Rid> rids;
+    file_handle->append_records(batch.data(), num_records, &rids);
+    assert((int)rids.size() == num_records);
+    for (int i = 0; i < num_records; i++) {
+        assert(rids[i].page_no == pages_before + i / per_page && rids[i].slot_no == i % per_page);
+        assert(mock.count(rids[i]) == 0);
+        mock[rids[i]] = std::string(batch.data() + i * record_size, record_size);
+    }
+    assert(file_handle->file_hdr_.num_pages == pages_before + 3);
+    check_equal(file_handle.get(), mock);
+
+    // 最后一页没有写满，下一条insert_record应该插入到这一页
+    rand_buf(record_size, write_buf);
+    Rid rid = file_handle->insert_record(write_buf, context);
+    assert(rid.page_no == pages_before + 2 && rid.slot_no == num_records % per_page);
+    mock[rid] = std::string(write_buf, record_size);
+
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试RmRecord的拷贝、移动、small buffer以及借用视图
+ */
+TEST(RecordManagerTest, RecordOwnershipTest) {
+    char buf[RM_MAX_RECORD_SIZE];
+    rand_buf(RM_MAX_RECORD_SIZE, buf);
+
+    for (int size : {4, RM_INLINE_RECORD_SIZE, RM_INLINE_RECORD_SIZE + 1, RM_MAX_RECORD_SIZE}) {
+        bool is_inline = size <= RM_INLINE_RECORD_SIZE;
+        RmRecord rec(size, buf);
+        assert(rec.is_owned() && rec.allocated_ == !is_inline);
+        assert(memcmp(rec.data, buf, size) == 0);
+
+        // 拷贝是深拷贝
+        RmRecord copy(rec);
+        assert(copy.data != rec.data && memcmp(copy.data, buf, size) == 0);
+        copy = rec;
+        assert(copy.data != rec.data && memcmp(copy.data, buf, size) == 0);
+
+        // 移动堆上的记录只转交指针，源记录变为空
+        char *heap_data = rec.data;
+        RmRecord moved(std::move(rec));
+        assert(rec.data == nullptr && rec.size == 0);
+        assert(moved.size == size && memcmp(moved.data, buf, size) == 0);
+        assert(is_inline || moved.data == heap_data);
+        copy = std::move(moved);
+        assert(moved.data == nullptr && memcmp(copy.data, buf, size) == 0);
+
+        // 视图不拷贝数据，make_owned之后与原数据脱离
+        RmRecord view = RmRecord::view(buf, size);
+        assert(!view.is_owned() && view.data == buf);
+        RmRecord taken(std::move(view));
+        assert(taken.data == buf);
+        taken.make_owned();
+        assert(taken.is_owned() && taken.data != buf && memcmp(taken.data, buf, size) == 0);
+
+        // arena中的记录：小记录仍放在内部，大记录放在arena中
+        Arena arena;
+        RmRecord arena_rec(size, &arena);
+        assert(arena_rec.is_owned() == is_inline && !arena_rec.allocated_);
+        memcpy(arena_rec.data, buf, size);
+        WriteRecord wr(WType::DELETE_TUPLE, "t", std::move(arena_rec));
+        assert(wr.GetRecord().is_owned() && memcmp(wr.GetRecord().data, buf, size) == 0);
+    }
+}
+
+/**
+ * @brief 测试按页面位图读取记录：只返回位图选中且仍然存在的记录
+ */
+TEST(RecordManagerTest, GetPageRecordsTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "page_records.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    int record_size = 64;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    int per_page = file_handle->file_hdr_.num_records_per_page;
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    char write_buf[PAGE_SIZE];
+    for (int i = 0; i < per_page * 2; i++) {
+        rand_buf(record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        mock[rid] = std::string(write_buf, record_size);
+    }
+    // 删除第一页中slot_no为3的倍数的记录
+    for (int slot_no = 0; slot_no < per_page; slot_no += 3) {
+        file_handle->delete_record(Rid{RM_FIRST_RECORD_PAGE, slot_no}, context);
+        mock.erase(Rid{RM_FIRST_RECORD_PAGE, slot_no});
+    }
+
+    // 选中第一页中的偶数slot，其中已删除的不应返回
+    std::vector<char> slot_bitmap(file_handle->file_hdr_.bitmap_size, 0);
+    for (int slot_no = 0; slot_no < per_page; slot_no += 2) {
+        Bitmap::set(slot_bitmap.data(), slot_no);
+    }
+    std::vector<std::pair<int, RmRecord>> records;
+    file_handle->get_page_records(RM_FIRST_RECORD_PAGE, slot_bitmap.data(), &records);
+    int expected = 0;
+    for (int slot_no = 0; slot_no < per_page; slot_no += 2) {
+        if (slot_no % 3 != 0) {
+            assert(records[expected].first == slot_no);
+            Rid rid{RM_FIRST_RECORD_PAGE, slot_no};
+            assert(memcmp(records[expected].second.data, mock.at(rid).c_str(), record_size) == 0);
+            expected++;
+        }
+    }
+    assert((int)records.size() == expected);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
@@ -53,6 +53,8 @@ class RmManager {
                                   sizeof(file_handle->file_hdr_));
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->FlushAllPages(file_handle->fd_);
+        // 关闭之后fd可能分配给其他文件，缓冲区中不能再留有按该fd缓存的页面
+        buffer_pool_manager_->DiscardPages(file_handle->fd_, 0);
         disk_manager_->close_file(file_handle->fd_);
     }
 };
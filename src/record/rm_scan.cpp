@@ -12,15 +12,13 @@ RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
     // Todo:
     // 初始化file_handle和rid（指向第一个存放了记录的位置）
     int max_n = file_handle->file_hdr_.num_records_per_page;
-    if(file_handle->file_hdr_.num_pages == 1) {
-        rid_.slot_no = max_n;
-        rid_.page_no = 0;
-        return;
-    }
+    // 先置为is_end()的位置，文件中没有任何记录时（包括只有文件头页）扫描直接结束
+    rid_.page_no = file_handle->file_hdr_.num_pages;
+    rid_.slot_no = max_n;
     for(int i = 1; i < file_handle->file_hdr_.num_pages; ++i){
-        rid_.page_no = i;
-        RmPageHandle scanhead_page_handle = file_handle->fetch_page_handle(rid_.page_no);
+        RmPageHandle scanhead_page_handle = file_handle->fetch_page_handle(i);
         int slot_no = Bitmap::first_bit(true, scanhead_page_handle.bitmap, file_handle->file_hdr_.num_records_per_page);
+        file_handle->buffer_pool_manager_->UnpinPage(scanhead_page_handle.page->GetPageId(), false);
         if(slot_no == file_handle->file_hdr_.num_records_per_page){
             continue;
         }else{
@@ -51,6 +49,7 @@ void RmScan::next() {
         else{
             slot_no = Bitmap::first_bit(true, scannext_page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page);
         }
+        file_handle_->buffer_pool_manager_->UnpinPage(scannext_page_handle.page->GetPageId(), false);
         if(slot_no != file_handle_->file_hdr_.num_records_per_page){
             rid_.page_no = i;
             rid_.slot_no = slot_no;
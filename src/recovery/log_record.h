@@ -88,10 +88,11 @@ public:
     }
 
     // constructor for update operation
+    // 元组按值传入，可以移入或传入借用的视图(RmRecord::view)；日志在AppendLogRecord时就被序列化，视图只需在此之前有效
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, const Rid &rid,
-            const RmRecord &old_tuple, const RmRecord &new_tuple, const std::string &table_name) 
+            RmRecord old_tuple, RmRecord new_tuple, const std::string &table_name) 
         : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), 
-        update_rid_(rid), old_tuple_(old_tuple), new_tuple_(new_tuple) {
+        update_rid_(rid), old_tuple_(std::move(old_tuple)), new_tuple_(std::move(new_tuple)) {
             tab_name_size_ = table_name.size();
             tab_name_ = new char[tab_name_size_];
             memcpy(tab_name_, table_name.c_str(), tab_name_size_);
@@ -100,21 +101,21 @@ public:
 
     // constructor for insert / delete operation
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, const Rid &rid, 
-            const RmRecord &record, const std::string &table_name)
+            RmRecord record, const std::string &table_name)
         : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type) {
+            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 2 + record.size + table_name.size();
             if(log_type == LogRecordType::INSERT) {
                 insert_rid_ = rid;
-                insert_tuple_ = record;
+                insert_tuple_ = std::move(record);
             }
             else {
                 assert(log_type == LogRecordType::DELETE);
                 delete_rid_ = rid;
-                delete_tuple_ = record;
+                delete_tuple_ = std::move(record);
             }
             tab_name_size_ = table_name.size();
             tab_name_ = new char[tab_name_size_];
             memcpy(tab_name_, table_name.c_str(), tab_name_size_);
-            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 2 + record.size + tab_name_size_;
         }
 
     // constructor for new_page operation
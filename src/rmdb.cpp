@@ -93,6 +93,8 @@ void *client_handler(void *sock_fd) {
                 } catch (RedBaseError &e) {
                     std::cerr << e.what() << std::endl;
                 }
+                // 语句结束，释放context及其arena中分配的所有内存
+                delete context;
             }
         }
         yy_delete_buffer(buf);
@@ -109,6 +111,23 @@ void *client_handler(void *sock_fd) {
     pthread_exit(NULL);  // terminate calling thread!
 }
 
+// 后台压缩线程：每隔AUTO_VACUUM_INTERVAL秒对稀疏的表执行一次VACUUM
+void *auto_vacuum_handler(void *) {
+    while (!should_exit) {
+        sleep(AUTO_VACUUM_INTERVAL);
+        if (should_exit) {
+            break;
+        }
+        Context context(lock_manager.get(), log_manager.get(), nullptr);
+        try {
+            sm_manager->auto_vacuum(AUTO_VACUUM_FILL_THRESHOLD, &context);
+        } catch (RedBaseError &e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    pthread_exit(NULL);
+}
+
 void start_server() {
     int sockfd_server;
     int sockfd;
@@ -148,6 +167,15 @@ void start_server() {
         log_manager->RunFlushThread();
     }
  */
+    if (ENABLE_AUTO_VACUUM) {
+        pthread_t vacuum_thread_id;
+        if (pthread_create(&vacuum_thread_id, nullptr, &auto_vacuum_handler, nullptr) != 0) {
+            std::cout << "Create auto vacuum thread fail!" << std::endl;
+        } else {
+            pthread_detach(vacuum_thread_id);
+        }
+    }
+
     while (!should_exit) {
         std::cout << "Waiting for new connection..." << std::endl;
         pthread_t thread_id;
@@ -497,3 +497,32 @@ void BufferPoolManager::FlushAllPages(int fd) {
         }
     }
 }
+
+/**
+ * @brief Discards the pages of file fd from page start_page_no on, without writing them back.
+ *
+ * @param fd 指定的diskfile open句柄
+ * @param start_page_no 从该页开始（含）的页面都被丢弃
+ * @note 被丢弃页面的内容不会写回磁盘，调用者随后应截断文件（见DiskManager::truncate_file）；
+ * 这些页面不能还被pin着，调用者要保证没有其他使用者
+ */
+void BufferPoolManager::DiscardPages(int fd, page_id_t start_page_no) {
+    std::scoped_lock lock{latch_};
+    for (auto it = page_table_.begin(); it != page_table_.end();) {
+        if (it->first.fd != fd || it->first.page_no < start_page_no) {
+            ++it;
+            continue;
+        }
+        frame_id_t fid = it->second;
+        Page *page = &pages_[fid];
+        // 仍被pin的页面正在被使用，不能丢弃：调用者要先等使用者释放
+        assert(page->pin_count_ == 0);
+        // 从replacer中移除该帧，重置元数据后放回free_list_
+        replacer_->Pin(fid);
+        page->ResetMemory();
+        page->id_.page_no = INVALID_PAGE_ID;
+        page->is_dirty_ = false;
+        free_list_.emplace_back(fid);
+        it = page_table_.erase(it);
+    }
+}
@@ -142,6 +142,14 @@ class BufferPoolManager {
      */
     void FlushAllPages(int fd);
 
+    /**
+     * Discards every page of file fd whose page_no >= start_page_no, without writing it back.
+     * Used before truncating a file, so the pin count of the discarded pages is ignored.
+     * @param fd file descriptor of the file being truncated
+     * @param start_page_no first page_no to discard
+     */
+    void DiscardPages(int fd, page_id_t start_page_no);
+
    private:
     bool FindVictimPage(frame_id_t *frame_id);
 
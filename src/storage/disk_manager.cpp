@@ -3,7 +3,7 @@
 #include <assert.h>    // for assert
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
-#include <unistd.h>    // for lseek
+#include <unistd.h>    // for lseek, ftruncate
 
 #include "defs.h"
 
@@ -84,6 +84,21 @@ void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
 
 }
 
+/**
+ * @brief 截断文件，释放第num_pages页之后的磁盘空间（用于VACUUM）
+ *
+ * @param {int} fd 指定文件的文件句柄
+ * @param {int} num_pages 截断后文件保留的页面个数
+ * @note 调用者需要保证缓冲池中不再有该文件第num_pages页之后的页面
+ */
+void DiskManager::truncate_file(int fd, int num_pages) {
+    assert(fd >= 0 && fd < MAX_FD);
+    if (ftruncate(fd, (off_t)num_pages * PAGE_SIZE) == -1) {
+        throw UnixError();
+    }
+    fd2pageno_[fd] = num_pages;
+}
+
 bool DiskManager::is_dir(const std::string &path) {
     struct stat st;
     return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
@@ -63,6 +63,11 @@ class DiskManager {
      */
     void DeallocatePage(page_id_t page_id);
 
+    /**
+     * @brief 将文件截断为前num_pages个页面，并从num_pages开始重新分配page_no
+     */
+    void truncate_file(int fd, int num_pages);
+
     // 目录操作
     bool is_dir(const std::string &path);
 
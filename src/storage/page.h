@@ -64,6 +64,8 @@ class Page {
 
     bool IsDirty() const { return is_dirty_; }
 
+    int GetPinCount() const { return pin_count_; }
+
     /** Acquire the page write latch. */
     inline void WLatch() { rwlatch_.WLock(); }
 
@@ -4,3 +4,4 @@
 #include <string>
 
 static const std::string DB_META_NAME = "db.meta";
+static constexpr int DB_META_VERSION = 1;  // db.meta的格式版本，没有版本号的db.meta是第0版（表只有列）
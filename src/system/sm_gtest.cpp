@@ -1,10 +1,20 @@
 #undef NDEBUG
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "record/rm_manager.h"
+#include "record/rm_scan.h"
 #include "sm.h"
 #define BUFFER_LENGTH 8192
 
@@ -66,8 +76,10 @@ TEST(SystemManagerTest, SimpleTest) {
         assert(0);
     } catch (IndexExistsError &) {
     }
-    // Create index for table 2
-    sm_manager->create_index(tab2, "b", context);
+    // Create a B-link index for table 2, the mode is kept in the index file header
+    sm_manager->create_index(tab2, "b", context, true);
+    assert(sm_manager->ihs_.at(ix_manager->get_index_name(tab2, 1))->get_file_hdr().blink);
+    assert(!sm_manager->ihs_.at(ix_manager->get_index_name(tab1, 2))->get_file_hdr().blink);
     // Drop index of table 1
     sm_manager->drop_index(tab1, "a", context);
     // Cannot drop index that does not exist
@@ -87,4 +99,861 @@ TEST(SystemManagerTest, SimpleTest) {
     // Clean up
     sm_manager->close_db();
     sm_manager->drop_db(db);
-}
\ No newline at end of file
+}
+// 测试VACUUM：压缩后表的记录文件变小，索引中的rid指向搬动后的记录
+TEST(SystemManagerTest, VacuumTest) {
+    std::string db = "db_vacuum";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 64}};
+    sm_manager->create_table(tab, col_defs, context);
+    sm_manager->create_index(tab, "a", context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+    auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, 0)).get();
+
+    // Insert records and keep every tenth of them
+    constexpr int num_records = 1000;
+    char buf[68];
+    std::vector<Rid> rids;
+    for (int i = 0; i < num_records; i++) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &i, sizeof(int));
+        Rid rid = file_handle->insert_record(buf, context);
+        ih->insert_entry(buf, rid, nullptr);
+        rids.push_back(rid);
+    }
+    for (int i = 0; i < num_records; i++) {
+        if (i % 10 != 0) {
+            ih->delete_entry((char *)&i, nullptr);
+            file_handle->delete_record(rids[i], context);
+        }
+    }
+    int pages_before = file_handle->get_file_hdr().num_pages;
+    sm_manager->vacuum_table(tab, context);
+    assert(file_handle->get_file_hdr().num_pages < pages_before);
+
+    // Every remaining key still leads to its own record
+    for (int i = 0; i < num_records; i += 10) {
+        std::vector<Rid> found;
+        assert(ih->GetValue((char *)&i, &found, nullptr));
+        auto rec = file_handle->get_record(found[0], context);
+        assert(*(int *)rec->data == i);
+    }
+    // Cannot vacuum a table that does not exist
+    try {
+        sm_manager->vacuum_table("no_such_tab", context);
+        assert(0);
+    } catch (TableNotFoundError &) {
+    }
+
+    // REINDEX packs the remaining keys into fewer index pages
+    int index_pages_before = ih->get_file_hdr().num_pages;
+    sm_manager->reindex_table(tab, context);
+    assert(ih->get_file_hdr().num_pages < index_pages_before);
+    for (int i = 0; i < num_records; i++) {
+        std::vector<Rid> found;
+        assert(ih->GetValue((char *)&i, &found, nullptr) == (i % 10 == 0));
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+// 测试ANALYZE：行数精确，不同值个数和选择率的估计在误差范围内，统计信息随db.meta保存
+TEST(SystemManagerTest, AnalyzeTest) {
+    std::string db = "db_analyze";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_INT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 16}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+    assert(sm_manager->db_.get_stats(tab) == nullptr);
+
+    // a is unique in [0, num_records), b has 10 distinct values, c has 100
+    constexpr int num_records = 50000;
+    char buf[24];
+    for (int i = 0; i < num_records; i++) {
+        memset(buf, 0, sizeof(buf));
+        int b = i % 10;
+        memcpy(buf, &i, sizeof(int));
+        memcpy(buf + 4, &b, sizeof(int));
+        snprintf(buf + 8, 16, "str%d", i % 100);
+        file_handle->insert_record(buf, context);
+    }
+    sm_manager->analyze_table("", context);
+
+    auto check_stats = [&](const TabStats *stats) {
+        assert(stats != nullptr);
+        assert(stats->num_rows == num_records);
+        auto a = stats->get_col("a");
+        auto b = stats->get_col("b");
+        auto c = stats->get_col("c");
+        assert(std::abs(a->num_distinct - num_records) < num_records * 0.05);
+        assert(b->num_distinct == 10);
+        assert(std::abs(c->num_distinct - 100) <= 2);
+        // equality selectivity is 1/ndv inside the value range and 0 outside
+        int key = 5;
+        assert(std::abs(b->eq_selectivity((char *)&key) - 0.1) < 1e-6);
+        key = -1;
+        assert(b->eq_selectivity((char *)&key) == 0);
+        // range selectivity follows the uniform distribution of a
+        key = num_records / 4;
+        assert(std::abs(a->lt_selectivity((char *)&key, false) - 0.25) < 0.03);
+        key = num_records;
+        assert(a->lt_selectivity((char *)&key, false) == 1);
+    };
+    check_stats(sm_manager->db_.get_stats(tab));
+
+    // Statistics survive reopening the database
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    check_stats(sm_manager->db_.get_stats(tab));
+
+    // Cannot analyze a table that does not exist
+    try {
+        sm_manager->analyze_table("no_such_tab", context);
+        assert(0);
+    } catch (TableNotFoundError &) {
+    }
+    // Dropping the table also drops its statistics
+    sm_manager->drop_table(tab, context);
+    assert(sm_manager->db_.get_stats(tab) == nullptr);
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+// 测试读入没有版本号的（第0版）db.meta：表只有列，聚簇、分区和组合索引的字段取默认值，关闭时按新格式写回
+TEST(SystemManagerTest, OldMetaTest) {
+    std::string db = "db_old_meta";
+    std::string tab1 = "tab1";
+    std::string tab2 = "tab2";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_STRING, .len = 8}};
+    sm_manager->create_table(tab1, col_defs, context);
+    sm_manager->create_table(tab2, col_defs, context);
+    sm_manager->create_index(tab1, "a", context);
+    constexpr int num_records = 1000;
+    char buf[12];
+    for (int i = 0; i < num_records; i++) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &i, sizeof(int));
+        snprintf(buf + 4, 8, "s%d", i);
+        Rid rid = sm_manager->fhs_.at(tab1)->insert_record(buf, context);
+        sm_manager->ihs_.at(ix_manager->get_index_name(tab1, 0))->insert_entry(buf, rid, context->txn_);
+    }
+    // 按最初的格式改写db.meta：库名、表的个数，每张表只有表名和各列
+    std::string old_meta = db + "\n2\n";
+    for (auto &tab : {tab1, tab2}) {
+        auto &cols = sm_manager->db_.get_table(tab).cols;
+        old_meta += tab + "\n" + std::to_string(cols.size()) + "\n";
+        for (auto &col : cols) {
+            std::ostringstream os;
+            os << col << '\n';
+            old_meta += os.str();
+        }
+        old_meta += "\n";
+    }
+    sm_manager->close_db();
+    {
+        std::ofstream ofs(db + "/" + DB_META_NAME);
+        ofs << old_meta;
+    }
+
+    sm_manager->open_db(db);
+    for (auto &tab : {tab1, tab2}) {
+        auto &tab_meta = sm_manager->db_.get_table(tab);
+        assert(tab_meta.cols.size() == col_defs.size());
+        assert(!tab_meta.is_clustered() && !tab_meta.is_partitioned() && tab_meta.num_parts == 1);
+        assert(tab_meta.indexes.empty());
+        assert(sm_manager->fhs_.count(tab) == 1);
+        assert(tab_meta.cols[0].index == (tab == tab1));
+    }
+    auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab1, 0)).get();
+    for (int i = 0; i < num_records; i++) {
+        std::vector<Rid> rids;
+        assert(ih->GetValue((const char *)&i, &rids, nullptr));
+        auto rec = sm_manager->fhs_.at(tab1)->get_record(rids[0], context);
+        assert(*(int *)rec->data == i);
+    }
+    sm_manager->close_db();
+    {
+        std::ifstream ifs(db + "/" + DB_META_NAME);
+        std::string name, tag;
+        int version;
+        ifs >> name >> tag >> version;
+        assert(name == db && tag == "version" && version == DB_META_VERSION);
+    }
+    sm_manager->open_db(db);
+    assert(sm_manager->db_.get_table(tab1).cols[0].index && !sm_manager->db_.get_table(tab2).cols[0].index);
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+TEST(SystemManagerTest, ClusteredTest) {
+    std::string db = "db_clustered";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    // b is the primary key, the whole record is stored in the leaves of its index and there is no record file
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_STRING, .len = 8},
+                                    {.name = "b", .type = TYPE_INT, .len = 4, .primary_key = true},
+                                    {.name = "c", .type = TYPE_INT, .len = 4}};
+    sm_manager->create_table(tab, col_defs, context);
+    assert(sm_manager->db_.get_table(tab).is_clustered());
+    assert(sm_manager->fhs_.count(tab) == 0);
+
+    constexpr int num_records = 3000;
+    auto make_rec = [](char *buf, int b, int c) {
+        memset(buf, 0, 16);
+        snprintf(buf, 8, "s%d", b);
+        memcpy(buf + 8, &b, sizeof(int));
+        memcpy(buf + 12, &c, sizeof(int));
+    };
+    std::vector<int> keys(num_records);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+    char buf[16];
+    for (int b : keys) {
+        make_rec(buf, b, -b);
+        sm_manager->clustered_insert(tab, buf, context);
+    }
+    try {
+        sm_manager->clustered_insert(tab, buf, context);
+        assert(0);
+    } catch (DuplicateKeyError &) {
+    }
+    sm_manager->create_index(tab, "c", context);
+
+    // Records are visited in primary key order by walking the leaves
+    auto check_table = [&](int num_expected) {
+        auto ih = sm_manager->get_clustered_index(tab);
+        int cnt = 0;
+        int prev = -1;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end();
+             scan.next()) {
+            ih->get_val(scan.iid(), buf);
+            int b = *(int *)(buf + 8);
+            assert(b > prev);
+            assert(strcmp(buf, ("s" + std::to_string(b)).c_str()) == 0);
+            prev = b;
+            cnt++;
+        }
+        assert(cnt == num_expected);
+    };
+    check_table(num_records);
+
+    // Secondary index maps c to the primary key
+    auto lookup_by_c = [&](int c, char *rec) {
+        auto &tab_meta = sm_manager->db_.get_table(tab);
+        auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, tab_meta.get_col("c") - tab_meta.cols.begin())).get();
+        std::vector<char> pk(ih->get_file_hdr().val_len);
+        if (!ih->GetValue((char *)&c, pk.data(), nullptr)) {
+            return false;
+        }
+        return sm_manager->get_clustered_index(tab)->GetValue(pk.data(), rec, nullptr);
+    };
+    char rec[16];
+    assert(lookup_by_c(-123, rec) && *(int *)(rec + 8) == 123);
+
+    // Update in place, then move a record to a new primary key
+    char new_rec[16];
+    make_rec(buf, 123, -123);
+    make_rec(new_rec, 123, 5000);
+    sm_manager->clustered_update(tab, buf, new_rec, context);
+    assert(!lookup_by_c(-123, rec));
+    assert(lookup_by_c(5000, rec) && *(int *)(rec + 8) == 123);
+    make_rec(buf, 10000, 5000);
+    sm_manager->clustered_update(tab, new_rec, buf, context);
+    assert(lookup_by_c(5000, rec) && *(int *)(rec + 8) == 10000);
+    // Moving onto an existing primary key fails and leaves the record unchanged
+    make_rec(new_rec, 0, 5000);
+    try {
+        sm_manager->clustered_update(tab, buf, new_rec, context);
+        assert(0);
+    } catch (DuplicateKeyError &) {
+    }
+    assert(lookup_by_c(5000, rec) && *(int *)(rec + 8) == 10000);
+
+    // Delete the even keys
+    for (int b = 0; b < num_records; b += 2) {
+        make_rec(buf, b, -b);
+        sm_manager->clustered_delete(tab, buf, context);
+    }
+    assert(!lookup_by_c(-2, rec));
+    check_table(num_records / 2);
+
+    // The primary key index cannot be dropped
+    try {
+        sm_manager->drop_index(tab, "b", context);
+        assert(0);
+    } catch (ClusteredTableError &) {
+    }
+
+    // Clustered tables survive reopening the database
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    assert(sm_manager->fhs_.count(tab) == 0);
+    check_table(num_records / 2);
+    assert(lookup_by_c(-1, rec) && *(int *)(rec + 8) == 1);
+    sm_manager->analyze_table(tab, context);
+    assert(sm_manager->db_.get_stats(tab)->num_rows == num_records / 2);
+
+    sm_manager->drop_table(tab, context);
+    assert(!sm_manager->db_.is_table(tab));
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+TEST(SystemManagerTest, PartitionTest) {
+    std::string db = "db_partition";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    // a is the partition key, every partition has its own record file and index files
+    constexpr int num_parts = 4;
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4, .num_parts = num_parts},
+                                    {.name = "c", .type = TYPE_STRING, .len = 8}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto &tab_meta = sm_manager->db_.get_table(tab);
+    assert(tab_meta.is_partitioned() && tab_meta.num_parts == num_parts);
+    assert(sm_manager->fhs_.count(tab) == 0);
+    for (int part = 0; part < num_parts; part++) {
+        assert(disk_manager->is_file(tab_meta.get_part_name(part)));
+    }
+    sm_manager->create_index(tab, "a", context);
+
+    // Route every record to the partition of its key
+    constexpr int num_records = 2000;
+    char buf[12];
+    for (int i = 0; i < num_records; i++) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &i, sizeof(int));
+        auto part_name = tab_meta.get_part_name(tab_meta.get_part(buf));
+        Rid rid = sm_manager->fhs_.at(part_name)->insert_record(buf, context);
+        sm_manager->ihs_.at(ix_manager->get_index_name(part_name, 0))->insert_entry(buf, rid, nullptr);
+    }
+    auto check_parts = [&](int num_expected) {
+        auto &tab_meta = sm_manager->db_.get_table(tab);  // 重新打开数据库后元数据会重建，每次都要重新获取
+        int total = 0;
+        for (int part = 0; part < num_parts; part++) {
+            auto part_name = tab_meta.get_part_name(part);
+            auto file_handle = sm_manager->fhs_.at(part_name).get();
+            int cnt = file_handle->count_records();
+            // Hashing spreads consecutive keys evenly
+            assert(cnt > num_expected / num_parts / 2);
+            total += cnt;
+            for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+                auto rec = file_handle->get_record(scan.rid(), context);
+                assert(tab_meta.get_part(rec->data) == part);
+                std::vector<Rid> found;
+                assert(sm_manager->ihs_.at(ix_manager->get_index_name(part_name, 0))->GetValue(rec->data, &found, nullptr));
+                assert(found[0] == scan.rid());
+            }
+        }
+        assert(total == num_expected);
+    };
+    check_parts(num_records);
+
+    // 0.0 and -0.0 are equal keys and must land in the same partition
+    sm_manager->create_table("ftab", {{.name = "f", .type = TYPE_FLOAT, .len = 4, .num_parts = 7}}, context);
+    float zero = 0;
+    float neg_zero = -zero;
+    auto &ftab_meta = sm_manager->db_.get_table("ftab");
+    assert(ftab_meta.get_key_part((char *)&zero) == ftab_meta.get_key_part((char *)&neg_zero));
+    sm_manager->drop_table("ftab", context);
+
+    // Partitioned tables survive reopening the database
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    check_parts(num_records);
+    sm_manager->vacuum_table(tab, context);
+    sm_manager->analyze_table(tab, context);
+    assert(sm_manager->db_.get_stats(tab)->num_rows == num_records);
+
+    // Clustered tables cannot be partitioned
+    try {
+        sm_manager->create_table("bad", {{.name = "a", .type = TYPE_INT, .len = 4, .primary_key = true, .num_parts = 2}},
+                                 context);
+        assert(0);
+    } catch (PartitionedTableError &) {
+    }
+
+    sm_manager->drop_table(tab, context);
+    for (int part = 0; part < num_parts; part++) {
+        assert(!disk_manager->is_file(tab + '#' + std::to_string(part)));
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+// 测试组合索引：key按(a, b)逐列比较排序，可以按前缀扫描，索引随db.meta保存，修改记录时同步维护
+TEST(SystemManagerTest, CompositeIndexTest) {
+    std::string db = "db_composite";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_FLOAT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 8}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+
+    // Records inserted before the index is created are indexed by create_index
+    constexpr int num_a = 50;
+    constexpr int num_b = 20;
+    char buf[16];
+    auto make_rec = [&](int a, float b) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &a, sizeof(int));
+        memcpy(buf + 4, &b, sizeof(float));
+        snprintf(buf + 8, 8, "%d", a);
+        return buf;
+    };
+    for (int a = num_a - 1; a >= 0; a--) {
+        for (int b = 0; b < num_b; b++) {
+            file_handle->insert_record(make_rec(a, -b), context);
+        }
+    }
+    sm_manager->create_index(tab, std::vector<std::string>{"a", "b"}, context);
+    sm_manager->create_index(tab, "a", context);
+    auto &tab_meta = sm_manager->db_.get_table(tab);
+    assert(tab_meta.get_indexes().size() == 2);
+    assert(tab_meta.is_index({0, 1}) && !tab_meta.is_index({1, 0}) && !tab_meta.cols[1].index);
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a", "b"}, context);
+        assert(0);
+    } catch (IndexExistsError &) {
+    }
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a", "a"}, context);
+        assert(0);
+    } catch (InvalidIndexColsError &) {
+    }
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a", "x"}, context);
+        assert(0);
+    } catch (ColumnNotFoundError &) {
+    }
+
+    // Keys are ordered by a first, then by b
+    auto check_order = [&](int num_expected) {
+        auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, std::vector<int>{0, 1})).get();
+        assert(ih->get_file_hdr().col_num == 2 && ih->get_file_hdr().col_len == 8);
+        int cnt = 0;
+        int prev_a = -1;
+        float prev_b = 0;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end();
+             scan.next()) {
+            auto rec = file_handle->get_record(scan.rid(), context);
+            int a = *(int *)rec->data;
+            float b = *(float *)(rec->data + 4);
+            assert(a > prev_a || (a == prev_a && b > prev_b));
+            prev_a = a;
+            prev_b = b;
+            cnt++;
+        }
+        assert(cnt == num_expected);
+        // Point lookup with the concatenated key
+        std::vector<Rid> found;
+        char key[8];
+        int a = 7;
+        float b = -3;
+        memcpy(key, &a, sizeof(int));
+        memcpy(key + 4, &b, sizeof(float));
+        assert(ih->GetValue(key, &found, nullptr));
+        auto rec = file_handle->get_record(found[0], context);
+        assert(memcmp(rec->data, key, sizeof(key)) == 0);
+    };
+    check_order(num_a * num_b);
+
+    // Composite indexes survive reopening the database, and are kept up to date by compaction
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    file_handle = sm_manager->fhs_.at(tab).get();
+    assert(sm_manager->db_.get_table(tab).indexes.size() == 1);
+    check_order(num_a * num_b);
+    sm_manager->vacuum_table(tab, context);
+    check_order(num_a * num_b);
+
+    // Dropping the composite index keeps the single-column one
+    sm_manager->drop_index(tab, std::vector<std::string>{"a", "b"}, context);
+    assert(!disk_manager->is_file(ix_manager->get_index_name(tab, std::vector<int>{0, 1})));
+    assert(sm_manager->db_.get_table(tab).get_indexes().size() == 1);
+    try {
+        sm_manager->drop_index(tab, std::vector<std::string>{"a", "b"}, context);
+        assert(0);
+    } catch (IndexNotFoundError &) {
+    }
+    sm_manager->create_index(tab, std::vector<std::string>{"b", "c", "a"}, context);
+    sm_manager->drop_table(tab, context);
+    assert(!disk_manager->is_file(ix_manager->get_index_name(tab, std::vector<int>{1, 2, 0})));
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+TEST(SystemManagerTest, CoveringIndexTest) {
+    std::string db = "db_covering";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_FLOAT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 8}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+
+    constexpr int num_records = 2000;
+    char buf[16];
+    for (int a = 0; a < num_records; a++) {
+        memset(buf, 0, sizeof(buf));
+        float b = a * 0.5f;
+        memcpy(buf, &a, sizeof(int));
+        memcpy(buf + 4, &b, sizeof(float));
+        snprintf(buf + 8, 8, "c%d", a);
+        file_handle->insert_record(buf, context);
+    }
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a"}, context, false, {"a"});
+        assert(0);
+    } catch (InvalidIndexColsError &) {
+    }
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a"}, context, false, {"x"});
+        assert(0);
+    } catch (ColumnNotFoundError &) {
+    }
+    // a is the key, c is only stored in the leaves after the rid
+    sm_manager->create_index(tab, std::vector<std::string>{"a"}, context, false, {"c"});
+
+    auto check_entries = [&]() {
+        auto &tab_meta = sm_manager->db_.get_table(tab);
+        assert(tab_meta.is_index({0}) && !tab_meta.cols[0].index);
+        auto index = tab_meta.get_index_meta({0});
+        assert(index.include_cols == std::vector<int>{2} && index.include_len == 8);
+        assert(index.covers(0) && !index.covers(1) && index.covers(2));
+        auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, std::vector<int>{0})).get();
+        assert(ih->get_file_hdr().val_len == (int)sizeof(Rid) + 8);
+        char key[4];
+        char val[sizeof(Rid) + 8];
+        int cnt = 0;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end();
+             scan.next()) {
+            ih->get_entry(scan.iid(), key, val);
+            Rid rid = scan.rid();
+            auto rec = file_handle->get_record(rid, context);
+            assert(memcmp(val, &rid, sizeof(Rid)) == 0);
+            assert(memcmp(key, rec->data, 4) == 0);
+            assert(memcmp(val + sizeof(Rid), rec->data + 8, 8) == 0);
+            assert(*(int *)key == cnt);
+            cnt++;
+        }
+        assert(cnt == num_records);
+        // a > -1 starts at the first key of the first leaf
+        int below = -1;
+        assert(ih->upper_bound((const char *)&below) == ih->leaf_begin());
+    };
+    check_entries();
+
+    // The INCLUDE columns survive reopening the database, and are rewritten by compaction
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    file_handle = sm_manager->fhs_.at(tab).get();
+    check_entries();
+    for (int a = 0; a < num_records; a += 2) {
+        std::vector<Rid> rids;
+        auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, std::vector<int>{0})).get();
+        assert(ih->GetValue((char *)&a, &rids, nullptr));
+    }
+    sm_manager->vacuum_table(tab, context);
+    check_entries();
+
+    // A single-column index without INCLUDE on the same column is a different index
+    try {
+        sm_manager->create_index(tab, "a", context);
+        assert(0);
+    } catch (IndexExistsError &) {
+    }
+    sm_manager->drop_index(tab, "a", context);
+    assert(!sm_manager->db_.get_table(tab).is_index({0}));
+    assert(sm_manager->db_.get_table(tab).indexes.empty());
+    sm_manager->drop_table(tab, context);
+
+    // Records of clustered tables are already stored in the primary key index
+    std::vector<ColDef> pk_defs = {{.name = "a", .type = TYPE_INT, .len = 4, .primary_key = true},
+                                   {.name = "b", .type = TYPE_INT, .len = 4}};
+    sm_manager->create_table(tab, pk_defs, context);
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"b"}, context, false, {"a"});
+        assert(0);
+    } catch (ClusteredTableError &) {
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+TEST(SystemManagerTest, ConcurrentIndexTest) {
+    std::string db = "db_concurrent_index";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 60}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+
+    constexpr int num_records = 20000;
+    char buf[64];
+    std::vector<Rid> rids;
+    for (int a = 0; a < num_records; a++) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &a, sizeof(int));
+        rids.push_back(file_handle->insert_record(buf, context));
+    }
+
+    // The writer keeps inserting, deleting and updating records while the index is built, and a while after it:
+    // its table metadata is copied before the index exists, like an executor that started earlier
+    TabMeta writer_tab = sm_manager->db_.get_table(tab);
+    std::atomic<bool> built{false};
+    std::thread writer([&]() {
+        char result_buf[BUFFER_LENGTH];
+        int writer_offset = 0;
+        Context writer_context(nullptr, nullptr, nullptr, result_buf, &writer_offset);
+        char rec[64];
+        int next = num_records;
+        int after = 0;
+        for (int i = 0; after < 100; i++, after += built) {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            memset(rec, 0, sizeof(rec));
+            memcpy(rec, &next, sizeof(int));
+            next++;
+            Rid rid = file_handle->insert_record(rec, &writer_context);
+            sm_manager->capture_index_change(writer_tab, 0, rid, nullptr, rec, &writer_context);
+            Rid victim = rids[(i * 7) % num_records];
+            if (file_handle->is_record(victim)) {
+                auto old_rec = file_handle->get_record(victim, &writer_context);
+                if (i % 2 == 0) {
+                    file_handle->delete_record(victim, &writer_context);
+                    sm_manager->capture_index_change(writer_tab, 0, victim, old_rec->data, nullptr, &writer_context);
+                } else {
+                    memcpy(rec, old_rec->data, sizeof(rec));
+                    *(int *)rec += 1 << 24;
+                    file_handle->update_record(victim, rec, &writer_context);
+                    sm_manager->capture_index_change(writer_tab, 0, victim, old_rec->data, rec, &writer_context);
+                }
+            }
+        }
+    });
+    sm_manager->create_index(tab, std::vector<std::string>{"a"}, context, false, {}, false, true);
+    built = true;
+    writer.join();
+
+    // The index is in the catalog, and holds exactly the records of the table
+    assert(sm_manager->db_.get_table(tab).is_index({0}));
+    auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, 0)).get();
+    size_t num_rows = 0;
+    for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+        auto rec = file_handle->get_record(scan.rid(), context);
+        std::vector<Rid> found;
+        assert(ih->GetValue(rec->data, &found, nullptr));
+        assert(found[0] == scan.rid());
+        num_rows++;
+    }
+    size_t num_entries = 0;
+    for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end(); scan.next()) {
+        num_entries++;
+    }
+    assert(num_entries == num_rows);
+
+    // Cannot build the same index again
+    try {
+        sm_manager->create_index(tab, std::vector<std::string>{"a"}, context, false, {}, false, true);
+        assert(0);
+    } catch (IndexExistsError &) {
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
+
+// 测试并行建索引：多个线程扫描和排序的结果与单线程建的索引完全相同，重复的key保留页面顺序上最先的记录
+TEST(SystemManagerTest, ParallelIndexTest) {
+    std::string db = "db_parallel_index";
+    std::string tab = "tab";
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_INT, .len = 4}};
+    sm_manager->create_table(tab, col_defs, context);
+    auto file_handle = sm_manager->fhs_.at(tab).get();
+
+    // a互不相同、乱序；b只有1000个不同的值
+    constexpr int num_records = 30000;
+    std::vector<int> keys(num_records);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+    std::map<int, Rid> first_rid;  // b的每个值第一次出现的位置
+    for (int i = 0; i < num_records; i++) {
+        int rec[2] = {keys[i], keys[i] % 1000};
+        Rid rid = file_handle->insert_record(reinterpret_cast<char *>(rec), context);
+        first_rid.emplace(rec[1], rid);
+    }
+
+    auto dump_index = [&](const std::string &col_name) {
+        int col_idx = col_name == "a" ? 0 : 1;
+        auto ih = sm_manager->ihs_.at(ix_manager->get_index_name(tab, col_idx)).get();
+        std::vector<std::pair<int, Rid>> entries;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager.get()); !scan.is_end();
+             scan.next()) {
+            Rid rid = scan.rid();
+            auto rec = file_handle->get_record(rid, context);
+            entries.emplace_back(*reinterpret_cast<int *>(rec->data + col_idx * 4), rid);
+        }
+        return entries;
+    };
+    for (const std::string col_name : {"a", "b"}) {
+        sm_manager->create_index(tab, {col_name}, context, false, {}, false, false, 1);
+        auto serial = dump_index(col_name);
+        sm_manager->drop_index(tab, col_name, context);
+        sm_manager->create_index(tab, {col_name}, context, false, {}, false, false, 8);
+        auto parallel = dump_index(col_name);
+        assert(parallel.size() == (col_name == "a" ? (size_t)num_records : first_rid.size()));
+        assert(parallel == serial);
+        for (size_t i = 0; i < parallel.size(); i++) {
+            assert(parallel[i].first == (int)i);
+            if (col_name == "b") {
+                assert(parallel[i].second == first_rid.at(i));
+            }
+        }
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+}
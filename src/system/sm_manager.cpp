@@ -3,7 +3,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
+#include <numeric>
+#include <random>
+#include <thread>
 
 #include "index/ix.h"
 #include "record/rm.h"
@@ -71,14 +76,16 @@ void SmManager::open_db(const std::string &db_name) {
     for (auto &entry : db_.tabs_) {
         auto &tab = entry.second;
         // fhs_[tab.name] = rm_manager_->open_file(tab.name);
-        fhs_.emplace(tab.name, rm_manager_->open_file(tab.name));
-        for (size_t i = 0; i < tab.cols.size(); i++) {
-            auto &col = tab.cols[i];
-            if (col.index) {
-                auto index_name = ix_manager_->get_index_name(tab.name, i);
+        for (int part = 0; part < tab.num_parts; part++) {
+            auto part_name = tab.get_part_name(part);
+            if (!tab.is_clustered()) {
+                fhs_.emplace(part_name, rm_manager_->open_file(part_name));
+            }
+            for (auto &index : tab.get_indexes()) {
+                auto index_name = ix_manager_->get_index_name(part_name, index.cols);
                 assert(ihs_.count(index_name) == 0);
                 // ihs_[index_name] = ix_manager_->open_index(tab.name, i);
-                ihs_.emplace(index_name, ix_manager_->open_index(tab.name, i));
+                ihs_.emplace(index_name, ix_manager_->open_index(part_name, index.cols));
             }
         }
     }
@@ -93,6 +100,7 @@ void SmManager::close_db() {
     ofs << db_;
     db_.name_.clear();
     db_.tabs_.clear();
+    db_.stats_.clear();
     for(auto &entry : fhs_) {
         rm_manager_->close_file(entry.second.get());
     }
@@ -130,8 +138,10 @@ void SmManager::desc_table(const std::string &tab_name, Context *context) {
     printer.print_record(captions, context);
     printer.print_separator(context);
     // Print fields
-    for (auto &col : tab.cols) {
-        std::vector<std::string> field_info = {col.name, coltype2str(col.type), col.index ? "YES" : "NO"};
+    for (size_t i = 0; i < tab.cols.size(); i++) {
+        auto &col = tab.cols[i];
+        std::string index = (int)i == tab.pk_col ? "PRIMARY" : col.index ? "YES" : "NO";
+        std::vector<std::string> field_info = {col.name, coltype2str(col.type), index};
         printer.print_record(field_info, context);
     }
     // Print footer
@@ -154,14 +164,41 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
                        .offset = curr_offset,
                        .index = false};
         curr_offset += col_def.len;
+        if (col_def.primary_key) {
+            tab.pk_col = tab.cols.size();
+        }
+        if (col_def.num_parts > 0) {
+            tab.part_col = tab.cols.size();
+            tab.num_parts = col_def.num_parts;
+        }
         tab.cols.push_back(col);
     }
-    // Create & open record file
+    if (tab.is_partitioned()) {
+        if (tab.num_parts > MAX_PARTITIONS) {
+            throw PartitionedTableError(tab_name, "at most " + std::to_string(MAX_PARTITIONS) + " partitions");
+        }
+        if (tab.is_clustered()) {
+            throw PartitionedTableError(tab_name, "clustered tables cannot be partitioned");
+        }
+    }
     int record_size = curr_offset;  // record_size就是col meta所占的大小（表的元数据也是以记录的形式进行存储的）
-    rm_manager_->create_file(tab_name, record_size);
+    if (tab.is_clustered()) {
+        // 聚簇表没有记录文件，整条记录作为主键索引的值保存在叶子结点中
+        auto &pk = tab.cols[tab.pk_col];
+        ix_manager_->create_index(tab_name, tab.pk_col, pk.type, pk.len, record_size);
+        pk.index = true;
+        db_.tabs_[tab_name] = tab;
+        ihs_.emplace(ix_manager_->get_index_name(tab_name, tab.pk_col), ix_manager_->open_index(tab_name, tab.pk_col));
+        return;
+    }
+    // Create & open record file（分区表每个分区一个记录文件）
+    for (int part = 0; part < tab.num_parts; part++) {
+        auto part_name = tab.get_part_name(part);
+        rm_manager_->create_file(part_name, record_size);
+        // fhs_[tab_name] = rm_manager_->open_file(tab_name);
+        fhs_.emplace(part_name, rm_manager_->open_file(part_name));
+    }
     db_.tabs_[tab_name] = tab;
-    // fhs_[tab_name] = rm_manager_->open_file(tab_name);
-    fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
 }
 
 void SmManager::drop_table(const std::string &tab_name, Context *context) {
@@ -171,59 +208,786 @@ void SmManager::drop_table(const std::string &tab_name, Context *context) {
     // Close & destroy index file
     TabMeta &tab = db_.get_table(tab_name); 
     // Close & destroy record file
-    rm_manager_->close_file(fhs_[tab.name].get());
-    rm_manager_->destroy_file(tab.name);
+    if (!tab.is_clustered()) {
+        for (int part = 0; part < tab.num_parts; part++) {
+            auto part_name = tab.get_part_name(part);
+            rm_manager_->close_file(fhs_.at(part_name).get());
+            rm_manager_->destroy_file(part_name);
+            fhs_.erase(part_name);
+        }
+    } else {
+        // 主键索引不能通过drop_index删除，在这里直接关闭并删除
+        auto index_name = ix_manager_->get_index_name(tab_name, tab.pk_col);
+        ix_manager_->close_index(ihs_.at(index_name).get());
+        ix_manager_->destroy_index(tab_name, tab.pk_col);
+        ihs_.erase(index_name);
+        tab.cols[tab.pk_col].index = false;
+    }
     // Close & destroy index file
-    for (auto &col : tab.cols) {
-        if (col.index) {
-            drop_index(tab_name, col.name, context);
+    for (auto &index : tab.get_indexes()) {
+        std::vector<std::string> col_names;
+        for (int col : index.cols) {
+            col_names.push_back(tab.cols[col].name);
         }
+        drop_index(tab_name, col_names, context);
     }
     db_.tabs_.erase(tab_name);
-    fhs_.erase(tab.name);
+    db_.stats_.erase(tab_name);
 
     // lab3 task1 Todo End
 }
 
-void SmManager::create_index(const std::string &tab_name, const std::string &col_name, Context *context) {
+void SmManager::create_index(const std::string &tab_name, const std::string &col_name, Context *context, bool blink) {
+    create_index(tab_name, std::vector<std::string>{col_name}, context, blink);
+}
+
+// 组合索引在错误信息中显示为以逗号分隔的列名
+static std::string join_names(const std::vector<std::string> &col_names) {
+    std::string names;
+    for (auto &col_name : col_names) {
+        names += (names.empty() ? "" : ",") + col_name;
+    }
+    return names;
+}
+
+/**
+ * @brief 由索引列名得到索引列在表中的下标，列不存在时抛出ColumnNotFoundError，列重复或太多时抛出InvalidIndexColsError
+ */
+static std::vector<int> get_index_cols(TabMeta &tab, const std::vector<std::string> &col_names) {
+    std::vector<int> index_cols;
+    for (auto &col_name : col_names) {
+        auto col = tab.get_col(col_name);
+        if (col == tab.cols.end()) {
+            throw ColumnNotFoundError(col_name);
+        }
+        index_cols.push_back(col - tab.cols.begin());
+    }
+    std::vector<int> sorted = index_cols;
+    std::sort(sorted.begin(), sorted.end());
+    if (index_cols.empty() || index_cols.size() > IX_MAX_INDEX_COLS ||
+        std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        throw InvalidIndexColsError(tab.name + '(' + join_names(col_names) + ')');
+    }
+    return index_cols;
+}
+
+/**
+ * @param include_names INCLUDE的列：值和rid一起存放在叶子结点中，查询只用到索引列和这些列时不必读取记录
+ * @param hash 建成可扩展哈希索引（USING HASH），同一组索引列上只能有一个索引
+ * @param concurrently CREATE INDEX CONCURRENTLY，见create_index_concurrently
+ * @param num_threads CREATE INDEX ... PARALLEL n：每个分区的堆文件分成num_threads段并行扫描和排序，
+ * 最多INDEX_BUILD_MAX_THREADS个，聚簇表只用一个线程
+ */
+void SmManager::create_index(const std::string &tab_name, const std::vector<std::string> &col_names, Context *context,
+                             bool blink, const std::vector<std::string> &include_names, bool hash, bool concurrently,
+                             int num_threads) {
+    assert(!(blink && hash));
     TabMeta &tab = db_.get_table(tab_name);
-    auto col = tab.get_col(col_name);
-    if (col->index) {
-        throw IndexExistsError(tab_name, col_name);
+    auto index = tab.get_index_meta(get_index_cols(tab, col_names));
+    index.hash = hash;
+    if (tab.is_index(index.cols)) {
+        throw IndexExistsError(tab_name, join_names(col_names));
+    }
+    if (!include_names.empty()) {
+        if (tab.is_clustered()) {
+            throw ClusteredTableError(tab_name, "INCLUDE is not supported, records are stored in the primary key index");
+        }
+        for (auto &col_name : include_names) {
+            auto col = tab.get_col(col_name);
+            if (col == tab.cols.end()) {
+                throw ColumnNotFoundError(col_name);
+            }
+            int col_idx = col - tab.cols.begin();
+            if (index.covers(col_idx)) {
+                throw InvalidIndexColsError(tab_name + '(' + join_names(col_names) + ") INCLUDE (" +
+                                            join_names(include_names) + ')');
+            }
+            index.include_cols.push_back(col_idx);
+            index.include_len += col->len;
+        }
+    }
+    if (concurrently) {
+        create_index_concurrently(tab, index, blink, num_threads, context);
+        return;
+    }
+    // 分区表的每个分区各建一个只包含本分区记录的索引
+    for (int part = 0; part < tab.num_parts; part++) {
+        auto ih = build_part_index(tab, index, part, blink, num_threads, context);
+        // Store index handle
+        auto index_name = ix_manager_->get_index_name(tab.get_part_name(part), index.cols);
+        assert(ihs_.count(index_name) == 0);
+        // ihs_[index_name] = std::move(ih);
+        ihs_.emplace(index_name, std::move(ih));
+    }
+    // Mark column index as created
+    add_index(tab, index);
+}
+
+/**
+ * @brief 为表的第part个分区新建索引文件，扫描该分区的所有记录排序后自底向上建树
+ * @note 聚簇表的二级索引以主键作为值，遍历主键索引的叶子结点建立；
+ * 堆表由num_threads个线程各扫描一段数据页、各自排序，归并后建树
+ */
+std::unique_ptr<IxIndexHandle> SmManager::build_part_index(const TabMeta &tab, const IndexMeta &index, int part,
+                                                           bool blink, int num_threads, Context *context) {
+    std::vector<ColType> col_types;
+    std::vector<int> col_lens;
+    for (int col : index.cols) {
+        col_types.push_back(tab.cols[col].type);
+        col_lens.push_back(tab.cols[col].len);
     }
+    auto part_name = tab.get_part_name(part);
+    int val_len = tab.is_clustered() ? std::max<int>(tab.cols[tab.pk_col].len, sizeof(Rid))
+                                     : sizeof(Rid) + index.include_len;
     // Create index file
-    int col_idx = col - tab.cols.begin();
-    ix_manager_->create_index(tab_name, col_idx, col->type, col->len);  // 这里调用了
+    ix_manager_->create_index(part_name, index.cols, col_types, col_lens, val_len, blink, index.hash);
     // Open index file
-    auto ih = ix_manager_->open_index(tab_name, col_idx);
-    // Get record file handle
-    auto file_handle = fhs_.at(tab_name).get();
-    // Index all records into index
-    for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
-        auto rec = file_handle->get_record(rm_scan.rid(), context);  // rid是record的存储位置，作为value插入到索引里
-        const char *key = rec->data + col->offset;
-        // record data里以各个属性的offset进行分隔，属性的长度为col len，record里面每个属性的数据作为key插入索引里
-        ih->insert_entry(key, rm_scan.rid(), context->txn_);
-    }
-    // Store index handle
-    auto index_name = ix_manager_->get_index_name(tab_name, col_idx);
-    assert(ihs_.count(index_name) == 0);
-    // ihs_[index_name] = std::move(ih);
-    ihs_.emplace(index_name, std::move(ih));
-    // Mark column index as created
-    col->index = true;
+    auto ih = ix_manager_->open_index(part_name, index.cols);
+    auto index_name = ix_manager_->get_index_name(part_name, index.cols);
+    // Index all records into index：先收集所有(key, value)排序，再自底向上建树
+    if (tab.is_clustered()) {
+        // 聚簇表的记录在主键索引的叶子链表中，只能顺序地遍历，单线程扫描
+        IxParallelSorter sorter(ih->get_file_hdr(), 1, INDEX_BUILD_SORT_MEMORY, index_name + ".sort");
+        auto &pk = tab.cols[tab.pk_col];
+        auto pk_ih = get_clustered_index(tab.name);
+        std::vector<char> rec(pk_ih->get_file_hdr().val_len);
+        std::vector<char> key_buf(index.col_tot_len);
+        std::vector<char> val_buf(val_len, 0);
+        for (IxScan scan(pk_ih, pk_ih->leaf_begin(), pk_ih->leaf_end(), buffer_pool_manager_); !scan.is_end();
+             scan.next()) {
+            scan.get_val(rec.data());
+            memcpy(val_buf.data(), rec.data() + pk.offset, pk.len);
+            sorter.get(0)->add(tab.get_index_key(index, rec.data(), key_buf.data()), val_buf.data());
+        }
+        build_index(ih.get(), &sorter, context);
+        return ih;
+    }
+    // 堆文件的数据页平均分成num_threads段，每个线程扫描一段，把键值对加入自己的sorter并排序
+    auto file_handle = fhs_.at(part_name).get();
+    RmFileHdr file_hdr = file_handle->get_file_hdr();
+    int num_data_pages = file_hdr.num_pages - RM_FIRST_RECORD_PAGE;
+    num_threads = std::max(1, std::min({num_threads, INDEX_BUILD_MAX_THREADS, num_data_pages}));
+    IxParallelSorter sorter(ih->get_file_hdr(), num_threads, INDEX_BUILD_SORT_MEMORY, index_name + ".sort");
+    auto scan_pages = [&](int worker) {
+        IxSorter *worker_sorter = sorter.get(worker);
+        std::vector<char> key_buf(index.col_tot_len);
+        std::vector<char> val_buf(val_len, 0);
+        int begin = RM_FIRST_RECORD_PAGE + (int)((int64_t)num_data_pages * worker / num_threads);
+        int end = RM_FIRST_RECORD_PAGE + (int)((int64_t)num_data_pages * (worker + 1) / num_threads);
+        // CREATE INDEX CONCURRENTLY时写者在并发修改数据页：持有页面的读latch把整页复制出来，在副本上读位图和记录，
+        // 加入sorter（可能溢出到磁盘）时不持有latch
+        std::vector<char> page_buf(PAGE_SIZE);
+        const char *bitmap = page_buf.data() + Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr);
+        const char *slots = bitmap + file_hdr.bitmap_size;
+        for (int page_no = begin; page_no < end; page_no++) {
+            RmPageHandle page_handle = file_handle->fetch_page_handle(page_no);
+            page_handle.page->RLatch();
+            memcpy(page_buf.data(), page_handle.page->GetData(), PAGE_SIZE);
+            page_handle.page->RUnlatch();
+            buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+            for (int slot_no = Bitmap::first_bit(true, bitmap, file_hdr.num_records_per_page);
+                 slot_no < file_hdr.num_records_per_page;
+                 slot_no = Bitmap::next_bit(true, bitmap, file_hdr.num_records_per_page, slot_no)) {
+                // 索引列的数据（组合索引中拼接起来）作为key，rid（和INCLUDE列）作为value
+                const char *rec = slots + slot_no * file_hdr.record_size;
+                Rid rid{.page_no = page_no, .slot_no = slot_no};
+                worker_sorter->add(tab.get_index_key(index, rec, key_buf.data()),
+                                   tab.get_index_val(index, rec, rid, val_buf.data()));
+            }
+        }
+    };
+    if (num_threads == 1) {
+        scan_pages(0);
+    } else {
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(num_threads);
+        for (int worker = 0; worker < num_threads; worker++) {
+            workers.emplace_back([&, worker]() {
+                try {
+                    scan_pages(worker);
+                } catch (...) {
+                    errors[worker] = std::current_exception();
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        for (auto &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    // 各sorter并行排序，归并的结果交给一个线程自底向上建树
+    build_index(ih.get(), &sorter, context);
+    return ih;
+}
+
+/**
+ * @brief CREATE INDEX CONCURRENTLY：建索引期间写者照常修改表，建好之后才把索引加入表的元数据
+ * @note 先登记本次建索引，此后写者对表的修改都记录在它的changes中；扫描各分区建好索引后，在写者继续运行的同时
+ * 分几轮把记录下的修改合并进索引，剩下的修改不多时持有排他锁合并最后一批，再把索引加入ihs_和表的元数据。
+ * 没有多版本，扫描与写者并发，扫描到的可能是修改之前或之后的记录；合并时按发生的顺序重放修改（见apply_index_change），
+ * 结果与扫描到的是哪一个无关
+ */
+void SmManager::create_index_concurrently(TabMeta &tab, const IndexMeta &index, bool blink, int num_threads,
+                                          Context *context) {
+    auto build = std::make_shared<IndexBuild>();
+    build->tab_name = tab.name;
+    build->index = index;
+    {
+        std::unique_lock lock(index_build_latch_);
+        for (auto &other : index_builds_) {
+            if (other->tab_name == tab.name && other->index.cols == index.cols) {
+                std::vector<std::string> col_names;
+                for (int col : index.cols) {
+                    col_names.push_back(tab.cols[col].name);
+                }
+                throw IndexExistsError(tab.name, join_names(col_names));
+            }
+        }
+        index_builds_.push_back(build);
+    }
+    std::vector<std::unique_ptr<IxIndexHandle>> ihs;
+    try {
+        for (int part = 0; part < tab.num_parts; part++) {
+            ihs.push_back(build_part_index(tab, index, part, blink, num_threads, context));
+        }
+        for (int round = 0; round < INDEX_BUILD_MERGE_ROUNDS; round++) {
+            {
+                std::lock_guard guard(build->latch);
+                if (build->changes.size() < INDEX_BUILD_FINAL_MERGE_CHANGES) {
+                    break;
+                }
+            }
+            merge_index_changes(tab, build.get(), ihs, context);
+        }
+        std::unique_lock lock(index_build_latch_);
+        merge_index_changes(tab, build.get(), ihs, context);
+        for (int part = 0; part < tab.num_parts; part++) {
+            ihs_.emplace(ix_manager_->get_index_name(tab.get_part_name(part), index.cols), std::move(ihs[part]));
+        }
+        add_index(tab, index);
+        index_builds_.erase(std::find(index_builds_.begin(), index_builds_.end(), build));
+    } catch (...) {
+        std::unique_lock lock(index_build_latch_);
+        index_builds_.erase(std::find(index_builds_.begin(), index_builds_.end(), build));
+        for (size_t part = 0; part < ihs.size(); part++) {
+            auto index_name = ix_manager_->get_index_name(tab.get_part_name(part), index.cols);
+            if (ihs[part] == nullptr) {
+                // 句柄已经移入ihs_（之后add_index失败），从ihs_中取回再关闭
+                auto it = ihs_.find(index_name);
+                if (it == ihs_.end()) {
+                    continue;
+                }
+                ihs[part] = std::move(it->second);
+                ihs_.erase(it);
+            }
+            ix_manager_->close_index(ihs[part].get());
+            ix_manager_->destroy_index(tab.get_part_name(part), index.cols);
+        }
+        throw;
+    }
+}
+
+// 把build中记录的修改按发生的顺序合并进新建的各分区索引，合并期间写者可以继续记录新的修改
+void SmManager::merge_index_changes(const TabMeta &tab, IndexBuild *build,
+                                    const std::vector<std::unique_ptr<IxIndexHandle>> &ihs, Context *context) {
+    std::vector<IndexChange> changes;
+    {
+        std::lock_guard guard(build->latch);
+        changes.swap(build->changes);
+    }
+    for (auto &change : changes) {
+        apply_index_change(tab, build->index, ihs[change.part].get(), change.rid,
+                           change.old_rec.empty() ? nullptr : change.old_rec.data(),
+                           change.new_rec.empty() ? nullptr : change.new_rec.data(), context->txn_);
+    }
+}
+
+/**
+ * @brief 把表上的一次修改（old_rec为空是插入，new_rec为空是删除）应用到索引index上
+ * @note 索引中可能已经有扫描到的修改后的结果，应用必须可以重复：只删除值仍指向这条记录的旧key，
+ * 新key已存在时只在它指向这条记录时更新值，指向别的记录时与insert_entry一样保留原来的项
+ */
+void SmManager::apply_index_change(const TabMeta &tab, const IndexMeta &index, IxIndexHandle *ih, const Rid &rid,
+                                   const char *old_rec, const char *new_rec, Transaction *txn) {
+    int val_len = ih->get_file_hdr().val_len;
+    // 值的前缀标识记录：堆表是rid，聚簇表是主键
+    int id_len = tab.is_clustered() ? tab.cols[tab.pk_col].len : (int)sizeof(Rid);
+    std::vector<char> key_buf[2] = {std::vector<char>(index.col_tot_len), std::vector<char>(index.col_tot_len)};
+    std::vector<char> val_buf[2] = {std::vector<char>(val_len, 0), std::vector<char>(val_len, 0)};
+    const char *keys[2] = {nullptr, nullptr};
+    const char *vals[2] = {nullptr, nullptr};
+    const char *recs[2] = {old_rec, new_rec};
+    for (int i = 0; i < 2; i++) {
+        if (recs[i] == nullptr) {
+            continue;
+        }
+        keys[i] = tab.get_index_key(index, recs[i], key_buf[i].data());
+        if (tab.is_clustered()) {
+            auto &pk = tab.cols[tab.pk_col];
+            memcpy(val_buf[i].data(), recs[i] + pk.offset, pk.len);
+            vals[i] = val_buf[i].data();
+        } else {
+            vals[i] = tab.get_index_val(index, recs[i], rid, val_buf[i].data());
+        }
+    }
+    bool same_key = keys[0] != nullptr && keys[1] != nullptr && memcmp(keys[0], keys[1], index.col_tot_len) == 0;
+    if (same_key && memcmp(vals[0], vals[1], val_len) == 0) {
+        return;
+    }
+    std::vector<char> cur_val(val_len);
+    if (keys[0] != nullptr && !same_key && ih->GetValue(keys[0], cur_val.data(), txn) &&
+        memcmp(cur_val.data(), vals[0], id_len) == 0) {
+        ih->delete_entry(keys[0], txn);
+    }
+    if (keys[1] != nullptr && !ih->insert_entry(keys[1], vals[1], txn) && ih->GetValue(keys[1], cur_val.data(), txn) &&
+        memcmp(cur_val.data(), vals[1], id_len) == 0) {
+        ih->update_entry(keys[1], vals[1], txn);
+    }
+}
+
+// 把表上的一次修改记录到该表上所有正在进行的CREATE INDEX CONCURRENTLY中，调用者持有index_build_latch_的共享锁
+void SmManager::log_index_change(const std::string &tab_name, int part, const Rid &rid, const char *old_rec,
+                                 const char *new_rec) {
+    for (auto &build : index_builds_) {
+        if (build->tab_name != tab_name) {
+            continue;
+        }
+        auto &last_col = db_.get_table(tab_name).cols.back();
+        int record_size = last_col.offset + last_col.len;
+        IndexChange change{part, rid, {}, {}};
+        if (old_rec != nullptr) {
+            change.old_rec.assign(old_rec, old_rec + record_size);
+        }
+        if (new_rec != nullptr) {
+            change.new_rec.assign(new_rec, new_rec + record_size);
+        }
+        std::lock_guard guard(build->latch);
+        build->changes.push_back(std::move(change));
+    }
+}
+
+/**
+ * @brief 写者修改了表的第part个分区中rid处的记录（old_rec为空是插入，new_rec为空是删除）之后调用
+ * @note 修改记录到正在进行的CREATE INDEX CONCURRENTLY中。写者只维护它持有的表元数据tab中的索引，
+ * 此后才建好的索引不在其中，由这里代为修改
+ */
+void SmManager::capture_index_change(const TabMeta &tab, int part, const Rid &rid, const char *old_rec,
+                                     const char *new_rec, Context *context) {
+    std::shared_lock lock(index_build_latch_);
+    log_index_change(tab.name, part, rid, old_rec, new_rec);
+    TabMeta &live = db_.get_table(tab.name);
+    if (live.num_indexes() == tab.num_indexes()) {
+        return;
+    }
+    auto part_name = live.get_part_name(part);
+    for (auto &index : live.get_indexes()) {
+        if (!tab.is_index(index.cols)) {
+            apply_index_change(live, index, ihs_.at(ix_manager_->get_index_name(part_name, index.cols)).get(), rid,
+                               old_rec, new_rec, context->txn_);
+        }
+    }
 }
 
 void SmManager::drop_index(const std::string &tab_name, const std::string &col_name, Context *context) {
-    TabMeta &tab = db_.tabs_[tab_name];
-    auto col = tab.get_col(col_name);
-    if (!col->index) {
-        throw IndexNotFoundError(tab_name, col_name);
-    }
-    int col_idx = col - tab.cols.begin();
-    auto index_name = ix_manager_->get_index_name(tab_name, col_idx);
-    ix_manager_->close_index(ihs_.at(index_name).get());
-    ix_manager_->destroy_index(tab_name, col_idx);
-    ihs_.erase(index_name);
-    col->index = false;
+    drop_index(tab_name, std::vector<std::string>{col_name}, context);
+}
+
+void SmManager::drop_index(const std::string &tab_name, const std::vector<std::string> &col_names, Context *context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    auto index_cols = get_index_cols(tab, col_names);
+    if (!tab.is_index(index_cols)) {
+        throw IndexNotFoundError(tab_name, join_names(col_names));
+    }
+    if (index_cols == std::vector<int>{tab.pk_col}) {
+        throw ClusteredTableError(tab_name, "cannot drop the primary key index");
+    }
+    for (int part = 0; part < tab.num_parts; part++) {
+        auto part_name = tab.get_part_name(part);
+        auto index_name = ix_manager_->get_index_name(part_name, index_cols);
+        ix_manager_->close_index(ihs_.at(index_name).get());
+        ix_manager_->destroy_index(part_name, index_cols);
+        ihs_.erase(index_name);
+    }
+    if (index_cols.size() == 1 && tab.cols[index_cols[0]].index) {
+        tab.cols[index_cols[0]].index = false;
+    } else {
+        tab.indexes.erase(std::find_if(tab.indexes.begin(), tab.indexes.end(),
+                                       [&](const IndexMeta &index) { return index.cols == index_cols; }));
+    }
+}
+
+/**
+ * @brief 用排好序的键值对在新建的空索引上自底向上建树，叶子按INDEX_BUILD_FILL_FACTOR装填
+ * @note 比逐条insert_entry少了每条记录一次自顶向下的查找和叶子分裂，建好的叶子也更满；
+ * key重复时只保留最先扫描到的记录，与逐条插入一致
+ */
+void SmManager::build_index(IxIndexHandle *ih, IxParallelSorter *sorter, Context *context) {
+    if (!ih->bulk_load(sorter, context->txn_, INDEX_BUILD_FILL_FACTOR)) {
+        throw InternalError("SmManager::build_index: index is not empty");
+    }
+}
+
+// 在表的元数据中记下新建的索引：单列的B+树索引标记在列上，组合索引、带INCLUDE列的索引和哈希索引加入TabMeta::indexes
+void SmManager::add_index(TabMeta &tab, const IndexMeta &index) {
+    if (index.cols.size() == 1 && index.include_cols.empty() && !index.hash) {
+        tab.cols[index.cols[0]].index = true;
+    } else {
+        tab.indexes.push_back(index);
+    }
+}
+
+/**
+ * @brief 压缩表（分区表的第part个分区）的记录文件并截断，同时把被搬动记录的新rid更新到该分区的所有索引中，
+ * 并重建这些索引的Bloom filter
+ * @note 搬动记录会使其他事务写集合中的rid失效，回滚时会删除或改写别的记录：有其他未结束的事务修改过该分区时
+ * 抛出TableInUseError；有事务时先持有表的排他锁，压缩期间其他事务不能开始修改
+ *
+ * @return size_t 被搬动的记录条数
+ */
+size_t SmManager::compact_table(const std::string &tab_name, int part, Context *context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    auto part_name = tab.get_part_name(part);
+    auto file_handle = fhs_.at(part_name).get();
+    if (context->lock_mgr_ != nullptr && context->txn_ != nullptr) {
+        context->lock_mgr_->LockExclusiveOnTable(context->txn_, file_handle->GetFd());
+    }
+    if (has_active_writes_ && has_active_writes_(tab_name, part, context->txn_)) {
+        throw TableInUseError(tab_name, "other transactions have uncommitted writes, VACUUM would move their records");
+    }
+    std::shared_lock lock(index_build_latch_);
+    auto moved = file_handle->compact(context);
+    auto indexes = tab.get_indexes();
+    std::vector<IxIndexHandle *> ihs;
+    for (auto &index : indexes) {
+        ihs.push_back(ihs_.at(ix_manager_->get_index_name(part_name, index.cols)).get());
+    }
+    // 每条被搬动的记录只读一次，更新所有索引中的rid；正在建的索引中记为在原来的位置删除、在新的位置插入
+    std::vector<char> key_buf;
+    std::vector<char> val_buf;
+    for (auto &entry : moved) {
+        const Rid &new_rid = entry.second;
+        RmPageHandle page_handle = file_handle->fetch_page_handle(new_rid.page_no);
+        const char *rec = page_handle.get_slot(new_rid.slot_no);
+        for (size_t i = 0; i < indexes.size(); i++) {
+            key_buf.resize(indexes[i].col_tot_len);
+            val_buf.resize(ihs[i]->get_file_hdr().val_len);
+            const char *key = tab.get_index_key(indexes[i], rec, key_buf.data());
+            ihs[i]->update_entry(key, tab.get_index_val(indexes[i], rec, new_rid, val_buf.data()), context->txn_);
+        }
+        if (!index_builds_.empty()) {
+            log_index_change(tab_name, part, entry.first, rec, nullptr);
+            log_index_change(tab_name, part, new_rid, nullptr, rec);
+        }
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+    }
+    // 去掉Bloom filter中已经删除的key
+    for (auto ih : ihs) {
+        ih->rebuild_bloom();
+    }
+    return moved.size();
+}
+
+void SmManager::vacuum_table(const std::string &tab_name, Context *context) {
+    if (!db_.is_table(tab_name)) {
+        throw TableNotFoundError(tab_name);
+    }
+    TabMeta &tab = db_.get_table(tab_name);
+    if (tab.is_clustered()) {
+        throw ClusteredTableError(tab_name, "VACUUM is not supported, records are stored in the primary key index");
+    }
+    int pages_before = 0;
+    int pages_after = 0;
+    size_t num_moved = 0;
+    for (int part = 0; part < tab.num_parts; part++) {
+        auto file_handle = fhs_.at(tab.get_part_name(part)).get();
+        pages_before += file_handle->get_file_hdr().num_pages;
+        num_moved += compact_table(tab_name, part, context);
+        pages_after += file_handle->get_file_hdr().num_pages;
+    }
+
+    std::vector<std::string> captions = {"Table", "Pages before", "Pages after", "Moved records"};
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    printer.print_record({tab_name, std::to_string(pages_before), std::to_string(pages_after), std::to_string(num_moved)},
+                         context);
+    printer.print_separator(context);
+}
+
+/**
+ * @brief REINDEX：依次重建表上的每个索引（分区表的每个分区各一个），合并删除留下的半空结点，
+ * 叶子恢复为INDEX_BUILD_FILL_FACTOR的填充率，截断索引文件并输出重建前后的页面数
+ * @note 每次只锁住正在重建的那个索引，表和其他索引仍可读写；重建一个索引前要等它上面进行中的扫描结束，
+ * 重建期间新的扫描等待；哈希索引不重建
+ */
+void SmManager::reindex_table(const std::string &tab_name, Context *context) {
+    if (!db_.is_table(tab_name)) {
+        throw TableNotFoundError(tab_name);
+    }
+    TabMeta &tab = db_.get_table(tab_name);
+    std::vector<std::string> captions = {"Index", "Pages before", "Pages after"};
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    for (auto &index : tab.get_indexes()) {
+        std::string display_name = tab_name + '(';
+        for (size_t i = 0; i < index.cols.size(); i++) {
+            display_name += (i == 0 ? "" : ",") + tab.cols[index.cols[i]].name;
+        }
+        display_name += ')';
+        int pages_before = 0;
+        int pages_after = 0;
+        for (int part = 0; part < tab.num_parts; part++) {
+            auto ih = ihs_.at(ix_manager_->get_index_name(tab.get_part_name(part), index.cols)).get();
+            pages_before += ih->get_file_hdr().num_pages;
+            ih->rebuild(INDEX_BUILD_FILL_FACTOR);
+            pages_after += ih->get_file_hdr().num_pages;
+        }
+        printer.print_record({display_name, std::to_string(pages_before), std::to_string(pages_after)}, context);
+    }
+    printer.print_separator(context);
+}
+
+/**
+ * @brief 后台压缩：对记录页平均填充率低于fill_threshold的表执行VACUUM，不输出结果
+ * @note 分区表按分区判断，只压缩填充率低的分区
+ */
+void SmManager::auto_vacuum(double fill_threshold, Context *context) {
+    for (auto &entry : db_.tabs_) {
+        auto &tab = entry.second;
+        if (tab.is_clustered()) {
+            continue;
+        }
+        for (int part = 0; part < tab.num_parts; part++) {
+            auto file_handle = fhs_.at(tab.get_part_name(part)).get();
+            RmFileHdr file_hdr = file_handle->get_file_hdr();
+            int num_data_pages = file_hdr.num_pages - RM_FIRST_RECORD_PAGE;
+            if (num_data_pages <= 1) {
+                continue;
+            }
+            double capacity = (double)num_data_pages * file_hdr.num_records_per_page;
+            if (file_handle->count_records() < capacity * fill_threshold) {
+                try {
+                    compact_table(entry.first, part, context);
+                } catch (TableInUseError &) {
+                    // 有未提交的修改，下一轮再压缩
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 扫描一遍表的记录文件，收集统计信息
+ * @note 行数是精确的，每列不同值的个数由HyperLogLog对全部记录估计；
+ * 直方图由最多ANALYZE_SAMPLE_ROWS行的蓄水池样本生成，样本排序后每隔相同行数取一个边界；
+ * 聚簇表按顺序遍历主键索引的叶子结点，分区表依次扫描所有分区
+ */
+TabStats SmManager::collect_stats(const std::string &tab_name) {
+    TabMeta &tab = db_.get_table(tab_name);
+    int record_size = tab.cols.back().offset + tab.cols.back().len;
+
+    std::vector<HyperLogLog> hlls(tab.cols.size());
+    std::vector<char> sample;  // 样本中的记录，依次存放
+    std::mt19937_64 rng(0);
+    int64_t num_rows = 0;
+    auto add_record = [&](const char *rec) {
+        for (size_t i = 0; i < tab.cols.size(); i++) {
+            hlls[i].add(rec + tab.cols[i].offset, tab.cols[i].len);
+        }
+        if (num_rows < ANALYZE_SAMPLE_ROWS) {
+            sample.insert(sample.end(), rec, rec + record_size);
+        } else {
+            int64_t pos = rng() % (num_rows + 1);
+            if (pos < ANALYZE_SAMPLE_ROWS) {
+                memcpy(sample.data() + pos * record_size, rec, record_size);
+            }
+        }
+        num_rows++;
+    };
+
+    int num_pages;
+    if (tab.is_clustered()) {
+        auto ih = get_clustered_index(tab_name);
+        std::vector<char> rec(record_size);
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_); !scan.is_end(); scan.next()) {
+            scan.get_val(rec.data());
+            add_record(rec.data());
+        }
+        num_pages = ih->get_file_hdr().num_pages;
+    } else {
+        num_pages = 0;
+        for (int part = 0; part < tab.num_parts; part++) {
+            auto file_handle = fhs_.at(tab.get_part_name(part)).get();
+            RmFileHdr file_hdr = file_handle->get_file_hdr();
+            for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_hdr.num_pages; page_no++) {
+                RmPageHandle page_handle = file_handle->fetch_page_handle(page_no);
+                for (int slot_no = Bitmap::first_bit(true, page_handle.bitmap, file_hdr.num_records_per_page);
+                     slot_no < file_hdr.num_records_per_page;
+                     slot_no = Bitmap::next_bit(true, page_handle.bitmap, file_hdr.num_records_per_page, slot_no)) {
+                    add_record(page_handle.get_slot(slot_no));
+                }
+                buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+            }
+            num_pages += file_hdr.num_pages;
+        }
+    }
+
+    TabStats stats;
+    stats.name = tab_name;
+    stats.num_rows = num_rows;
+    stats.num_pages = num_pages;
+    int sample_size = sample.size() / record_size;
+    std::vector<int> order(sample_size);
+    for (size_t i = 0; i < tab.cols.size(); i++) {
+        auto &col = tab.cols[i];
+        ColStats col_stats;
+        col_stats.name = col.name;
+        col_stats.type = col.type;
+        col_stats.len = col.len;
+        col_stats.num_distinct = std::min<int64_t>(std::llround(hlls[i].estimate()), num_rows);
+        if (sample_size > 0) {
+            col_stats.num_distinct = std::max<int64_t>(col_stats.num_distinct, 1);
+            std::iota(order.begin(), order.end(), 0);
+            auto value = [&](int row) { return sample.data() + (size_t)row * record_size + col.offset; };
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                return ix_compare(value(a), value(b), col.type, col.len) < 0;
+            });
+            int num_bounds = std::min(ANALYZE_HISTOGRAM_BUCKETS + 1, sample_size);
+            for (int b = 0; b < num_bounds; b++) {
+                int row = order[num_bounds == 1 ? 0 : (int64_t)b * (sample_size - 1) / (num_bounds - 1)];
+                col_stats.bounds.emplace_back(value(row), col.len);
+            }
+        }
+        stats.cols.push_back(std::move(col_stats));
+    }
+    return stats;
+}
+
+/**
+ * @brief ANALYZE：收集表的统计信息，保存到db_中，close_db时随DbMeta写入db.meta
+ * @note 写路径不维护统计信息，批量修改之后要重新ANALYZE
+ *
+ * @param tab_name 表名，为空时分析所有表
+ */
+void SmManager::analyze_table(const std::string &tab_name, Context *context) {
+    std::vector<std::string> tab_names;
+    if (tab_name.empty()) {
+        for (auto &entry : db_.tabs_) {
+            tab_names.push_back(entry.first);
+        }
+    } else if (db_.is_table(tab_name)) {
+        tab_names.push_back(tab_name);
+    } else {
+        throw TableNotFoundError(tab_name);
+    }
+
+    std::vector<std::string> captions = {"Table", "Rows", "Pages"};
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    for (auto &name : tab_names) {
+        TabStats stats = collect_stats(name);
+        printer.print_record({name, std::to_string(stats.num_rows), std::to_string(stats.num_pages)}, context);
+        db_.stats_[name] = std::move(stats);
+    }
+    printer.print_separator(context);
+}
+
+IxIndexHandle *SmManager::get_clustered_index(const std::string &tab_name) {
+    TabMeta &tab = db_.get_table(tab_name);
+    assert(tab.is_clustered());
+    return ihs_.at(ix_manager_->get_index_name(tab_name, tab.pk_col)).get();
+}
+
+/**
+ * @brief 向聚簇表插入一条记录，并插入所有二级索引
+ * @note 主键已存在时抛出DuplicateKeyError，此时表没有被修改；写集合由调用者维护
+ */
+void SmManager::clustered_insert(const std::string &tab_name, const char *rec, Context *context) {
+    std::shared_lock lock(index_build_latch_);  // 二级索引的集合在修改期间不变
+    TabMeta &tab = db_.get_table(tab_name);
+    auto &pk = tab.cols[tab.pk_col];
+    if (!get_clustered_index(tab_name)->insert_entry(rec + pk.offset, rec, context->txn_)) {
+        throw DuplicateKeyError(tab_name);
+    }
+    std::vector<char> pk_val;
+    std::vector<char> key_buf;
+    for (auto &index : tab.get_indexes()) {
+        if (index.cols == std::vector<int>{tab.pk_col}) {
+            continue;
+        }
+        auto ih = ihs_.at(ix_manager_->get_index_name(tab_name, index.cols)).get();
+        pk_val.assign(ih->get_file_hdr().val_len, 0);
+        memcpy(pk_val.data(), rec + pk.offset, pk.len);
+        key_buf.resize(index.col_tot_len);
+        ih->insert_entry(tab.get_index_key(index, rec, key_buf.data()), pk_val.data(), context->txn_);
+    }
+    log_index_change(tab_name, 0, Rid{RM_NO_PAGE, -1}, nullptr, rec);
+}
+
+/**
+ * @brief 从聚簇表删除记录rec（必须是表中当前的记录），同时删除所有二级索引中的项
+ */
+void SmManager::clustered_delete(const std::string &tab_name, const char *rec, Context *context) {
+    std::shared_lock lock(index_build_latch_);
+    TabMeta &tab = db_.get_table(tab_name);
+    std::vector<char> key_buf;
+    for (auto &index : tab.get_indexes()) {
+        key_buf.resize(index.col_tot_len);
+        ihs_.at(ix_manager_->get_index_name(tab_name, index.cols))
+            ->delete_entry(tab.get_index_key(index, rec, key_buf.data()), context->txn_);
+    }
+    log_index_change(tab_name, 0, Rid{RM_NO_PAGE, -1}, rec, nullptr);
+}
+
+/**
+ * @brief 把聚簇表中的记录old_rec修改为new_rec
+ * @note 主键不变时原地覆盖叶子结点中的记录，只修改值发生变化的二级索引；
+ * 主键改变时记录要移动到新的位置，等价于先删除再插入，新主键已存在时恢复原记录并抛出DuplicateKeyError
+ */
+void SmManager::clustered_update(const std::string &tab_name, const char *old_rec, const char *new_rec,
+                                 Context *context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    auto &pk = tab.cols[tab.pk_col];
+    if (ix_compare(old_rec + pk.offset, new_rec + pk.offset, pk.type, pk.len) != 0) {
+        clustered_delete(tab_name, old_rec, context);
+        try {
+            clustered_insert(tab_name, new_rec, context);
+        } catch (DuplicateKeyError &) {
+            clustered_insert(tab_name, old_rec, context);
+            throw;
+        }
+        return;
+    }
+    std::shared_lock lock(index_build_latch_);
+    get_clustered_index(tab_name)->update_entry(new_rec + pk.offset, new_rec, context->txn_);
+    std::vector<char> pk_val;
+    std::vector<char> old_key;
+    std::vector<char> new_key;
+    for (auto &index : tab.get_indexes()) {
+        if (index.cols == std::vector<int>{tab.pk_col}) {
+            continue;
+        }
+        old_key.resize(index.col_tot_len);
+        new_key.resize(index.col_tot_len);
+        const char *old_k = tab.get_index_key(index, old_rec, old_key.data());
+        const char *new_k = tab.get_index_key(index, new_rec, new_key.data());
+        if (memcmp(old_k, new_k, index.col_tot_len) == 0) {
+            continue;
+        }
+        auto ih = ihs_.at(ix_manager_->get_index_name(tab_name, index.cols)).get();
+        ih->delete_entry(old_k, context->txn_);
+        pk_val.assign(ih->get_file_hdr().val_len, 0);
+        memcpy(pk_val.data(), new_rec + pk.offset, pk.len);
+        ih->insert_entry(new_k, pk_val.data(), context->txn_);
+    }
+    log_index_change(tab_name, 0, Rid{RM_NO_PAGE, -1}, old_rec, new_rec);
 }
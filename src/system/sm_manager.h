@@ -1,5 +1,9 @@
 #pragma once
 
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+
 #include "index/ix.h"
 // #include "record/rm.h"
 #include "common/context.h"
@@ -13,6 +17,24 @@ struct ColDef {
     std::string name;  // Column name
     ColType type;      // Type of column
     int len;           // Length of column
+    bool primary_key = false;  // 是否为主键，有主键的表是聚簇表
+    int num_parts = 0;         // 大于0时表按该列哈希分区，num_parts是分区个数
+};
+
+// 建索引期间表上发生的一次修改：old_rec为空表示插入，new_rec为空表示删除；聚簇表只有第0个分区，rid不使用
+struct IndexChange {
+    int part;
+    Rid rid;
+    std::vector<char> old_rec;
+    std::vector<char> new_rec;
+};
+
+// 一个正在进行的CREATE INDEX CONCURRENTLY：扫描表建索引时并发写入的修改记录在changes中，建好后再合并进索引
+struct IndexBuild {
+    std::string tab_name;
+    IndexMeta index;
+    std::mutex latch;  // 保护changes
+    std::vector<IndexChange> changes;
 };
 
 // SmManager类似于CMU中的Catalog
@@ -21,13 +43,18 @@ struct ColDef {
 class SmManager {
    public:
     DbMeta db_;  // create_db时将会将DbMeta写入文件，open_db时将会从文件中读出DbMeta
-    std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;   // file name -> record file handle
+    std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;   // file name -> record file handle（分区表每个分区一个）
     std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;  // file name -> index file handle
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     RmManager *rm_manager_;
     IxManager *ix_manager_;
+    // 正在进行的CREATE INDEX CONCURRENTLY；写者持有共享锁记录修改，登记、撤销和把新索引加入元数据时持有排他锁
+    std::shared_mutex index_build_latch_;
+    std::vector<std::shared_ptr<IndexBuild>> index_builds_;
+    // 除txn以外是否有未结束的事务修改过表的某个分区，由TransactionManager设置
+    std::function<bool(const std::string &, int, Transaction *)> has_active_writes_;
     // TODO: 全部改成私有变量，并且改成指针形式
     // DbMeta *db_;
     // std::map<std::string, std::unique_ptr<RmFileHandle>> *fhs_;
@@ -60,6 +87,10 @@ class SmManager {
 
     BufferPoolManager *get_bpm() { return buffer_pool_manager_; }
 
+    void set_active_writes_check(std::function<bool(const std::string &, int, Transaction *)> has_active_writes) {
+        has_active_writes_ = std::move(has_active_writes);
+    }
+
     // Database management
     bool is_dir(const std::string &db_name);
 
@@ -83,12 +114,44 @@ class SmManager {
     void apply_drop_table(const std::string &tab_name, Context *context);
 
     // Index management
-    void create_index(const std::string &tab_name, const std::string &col_name, Context *context);
+    // blink为true时建成B-link树，见IxIndexHandle
+    void create_index(const std::string &tab_name, const std::string &col_name, Context *context, bool blink = false);
+
+    // 多列的组合索引，col_names的顺序就是索引键中各列的顺序；include_names是INCLUDE的列，hash为true时建成哈希索引，
+    // concurrently为true时建索引期间不阻塞对表的写，num_threads是扫描和排序堆文件的线程数
+    void create_index(const std::string &tab_name, const std::vector<std::string> &col_names, Context *context,
+                      bool blink = false, const std::vector<std::string> &include_names = {}, bool hash = false,
+                      bool concurrently = false, int num_threads = INDEX_BUILD_THREADS);
+
+    // 堆表的写者在修改记录和自己所知的索引之后调用，tab是写者持有的表元数据
+    void capture_index_change(const TabMeta &tab, int part, const Rid &rid, const char *old_rec, const char *new_rec,
+                              Context *context);
 
     void drop_index(const std::string &tab_name, const std::string &col_name, Context *context);
 
+    void drop_index(const std::string &tab_name, const std::vector<std::string> &col_names, Context *context);
+
     void apply_drop_index(const std::string &tab_name, const std::string &col_name, Context *context);
 
+    // Storage management
+    void vacuum_table(const std::string &tab_name, Context *context);
+
+    void auto_vacuum(double fill_threshold, Context *context);
+
+    void reindex_table(const std::string &tab_name, Context *context);
+
+    // Statistics management
+    void analyze_table(const std::string &tab_name, Context *context);
+
+    // Clustered table management（聚簇表的记录保存在主键索引的叶子结点中，二级索引的值是主键）
+    IxIndexHandle *get_clustered_index(const std::string &tab_name);
+
+    void clustered_insert(const std::string &tab_name, const char *rec, Context *context);
+
+    void clustered_delete(const std::string &tab_name, const char *rec, Context *context);
+
+    void clustered_update(const std::string &tab_name, const char *old_rec, const char *new_rec, Context *context);
+
     // Transaction rollback management
     /**
      * @brief rollback the insert operation
@@ -147,4 +210,28 @@ class SmManager {
      * @param col_name the name of the column on which index is created
      */
     void rollback_drop_index(const std::string &tab_name, const std::string &col_name, Context *context);
+
+   private:
+    size_t compact_table(const std::string &tab_name, int part, Context *context);
+
+    TabStats collect_stats(const std::string &tab_name);
+
+    void add_index(TabMeta &tab, const IndexMeta &index);
+
+    void build_index(IxIndexHandle *ih, IxParallelSorter *sorter, Context *context);
+
+    std::unique_ptr<IxIndexHandle> build_part_index(const TabMeta &tab, const IndexMeta &index, int part, bool blink,
+                                                    int num_threads, Context *context);
+
+    void create_index_concurrently(TabMeta &tab, const IndexMeta &index, bool blink, int num_threads,
+                                   Context *context);
+
+    void log_index_change(const std::string &tab_name, int part, const Rid &rid, const char *old_rec,
+                          const char *new_rec);
+
+    void merge_index_changes(const TabMeta &tab, IndexBuild *build,
+                             const std::vector<std::unique_ptr<IxIndexHandle>> &ihs, Context *context);
+
+    void apply_index_change(const TabMeta &tab, const IndexMeta &index, IxIndexHandle *ih, const Rid &rid,
+                            const char *old_rec, const char *new_rec, Transaction *txn);
 };
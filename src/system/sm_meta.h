@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <string>
@@ -8,6 +10,7 @@
 
 #include "errors.h"
 #include "sm_defs.h"
+#include "sm_stats.h"
 
 struct ColMeta {
     std::string tab_name;  // 字段所属表名称
@@ -28,9 +31,174 @@ struct ColMeta {
     }
 };
 
+/**
+ * @brief 索引的元数据，索引键是各索引列的值按顺序拼接而成，比较时从第一列开始逐列比较
+ * @note 单列且没有INCLUDE列的B+树索引仍由ColMeta::index标记，TabMeta::indexes中保存组合索引、带INCLUDE列的索引和哈希索引
+ */
+struct IndexMeta {
+    std::vector<int> cols;  // 索引列在表中的下标，按在索引键中的顺序
+    int col_tot_len = 0;    // 索引键的长度，即各列长度之和
+    std::vector<int> include_cols;  // INCLUDE的列：值存放在叶子结点中rid之后，不参与比较，用于只扫描索引的查询
+    int include_len = 0;            // INCLUDE列的长度之和
+    bool hash = false;              // USING HASH：可扩展哈希索引，只能用于所有索引列上都有等值条件的查找
+
+    // 索引的叶子结点中是否有第col列的值
+    bool covers(int col) const {
+        return std::find(cols.begin(), cols.end(), col) != cols.end() ||
+               std::find(include_cols.begin(), include_cols.end(), col) != include_cols.end();
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
+        os << index.col_tot_len << ' ' << index.cols.size();
+        for (int col : index.cols) {
+            os << ' ' << col;
+        }
+        os << ' ' << index.include_len << ' ' << index.include_cols.size();
+        for (int col : index.include_cols) {
+            os << ' ' << col;
+        }
+        os << ' ' << index.hash;
+        return os;
+    }
+
+    friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
+        size_t n;
+        is >> index.col_tot_len >> n;
+        index.cols.resize(n);
+        for (auto &col : index.cols) {
+            is >> col;
+        }
+        is >> index.include_len >> n;
+        index.include_cols.resize(n);
+        for (auto &col : index.include_cols) {
+            is >> col;
+        }
+        is >> index.hash;
+        return is;
+    }
+};
+
 struct TabMeta {
     std::string name;
     std::vector<ColMeta> cols;
+    std::vector<IndexMeta> indexes;  // 多列组合索引、带INCLUDE列的索引和哈希索引
+    int pk_col = -1;  // 聚簇表的主键列下标，记录存放在该列索引的叶子结点中，没有堆文件；-1表示普通的堆表
+    int part_col = -1;  // 哈希分区表的分区键列下标，-1表示不分区
+    int num_parts = 1;  // 分区个数，每个分区有自己的记录文件和索引文件
+
+    bool is_clustered() const { return pk_col >= 0; }
+
+    bool is_partitioned() const { return part_col >= 0; }
+
+    /**
+     * @brief 分区的存储名，分区的记录文件和索引文件都以它命名（fhs_的key，get_index_name的filename）
+     * @note 不分区的表只有第0个分区，存储名就是表名
+     */
+    std::string get_part_name(int part) const {
+        return is_partitioned() ? name + '#' + std::to_string(part) : name;
+    }
+
+    // 分区键的值为key的记录所在的分区
+    int get_key_part(const char *key) const {
+        if (!is_partitioned()) {
+            return 0;
+        }
+        auto &col = cols[part_col];
+        char buf[sizeof(float)];
+        if (col.type == TYPE_FLOAT && *(const float *)key == 0) {
+            // 0.0和-0.0比较时相等，要分到同一个分区
+            float zero = 0;
+            memcpy(buf, &zero, sizeof(zero));
+            key = buf;
+        }
+        // FNV-1a，分区号会持久化在数据文件中，不能依赖std::hash的实现
+        uint32_t h = 2166136261u;
+        for (int i = 0; i < col.len; i++) {
+            h = (h ^ (unsigned char)key[i]) * 16777619u;
+        }
+        return h % num_parts;
+    }
+
+    int get_part(const char *rec) const { return is_partitioned() ? get_key_part(rec + cols[part_col].offset) : 0; }
+
+    // 以index_cols为索引列的索引的元数据（不检查索引是否存在，不存在时没有INCLUDE列）
+    IndexMeta get_index_meta(const std::vector<int> &index_cols) const {
+        auto pos = std::find_if(indexes.begin(), indexes.end(),
+                                [&](const IndexMeta &index) { return index.cols == index_cols; });
+        if (pos != indexes.end()) {
+            return *pos;
+        }
+        IndexMeta index{.cols = index_cols, .col_tot_len = 0};
+        for (int col : index_cols) {
+            index.col_tot_len += cols[col].len;
+        }
+        return index;
+    }
+
+    /**
+     * @brief 表上所有的索引：先是各个单列索引（按列的顺序），然后是组合索引
+     */
+    std::vector<IndexMeta> get_indexes() const {
+        std::vector<IndexMeta> all;
+        for (size_t i = 0; i < cols.size(); i++) {
+            if (cols[i].index) {
+                all.push_back(get_index_meta({(int)i}));
+            }
+        }
+        all.insert(all.end(), indexes.begin(), indexes.end());
+        return all;
+    }
+
+    // 索引的个数，即get_indexes().size()
+    size_t num_indexes() const {
+        return indexes.size() + std::count_if(cols.begin(), cols.end(), [](const ColMeta &col) { return col.index; });
+    }
+
+    // 以index_cols为索引列的索引是否存在
+    bool is_index(const std::vector<int> &index_cols) const {
+        if (index_cols.size() == 1 && cols[index_cols[0]].index) {
+            return true;
+        }
+        return std::any_of(indexes.begin(), indexes.end(),
+                           [&](const IndexMeta &index) { return index.cols == index_cols; });
+    }
+
+    /**
+     * @brief 记录rec在索引index上的key
+     *
+     * @param buf 组合索引的key拼接在这里，长度至少为index.col_tot_len
+     * @return const char* 单列索引直接指向记录中的该列，组合索引指向buf
+     */
+    const char *get_index_key(const IndexMeta &index, const char *rec, char *buf) const {
+        if (index.cols.size() == 1) {
+            return rec + cols[index.cols[0]].offset;
+        }
+        char *key = buf;
+        for (int col : index.cols) {
+            memcpy(key, rec + cols[col].offset, cols[col].len);
+            key += cols[col].len;
+        }
+        return buf;
+    }
+
+    /**
+     * @brief 堆表上记录rec在索引index中的值：rid之后依次是各INCLUDE列的值
+     *
+     * @param buf 有INCLUDE列时值拼接在这里，长度至少为sizeof(Rid) + index.include_len
+     * @return const char* 没有INCLUDE列时直接指向rid
+     */
+    const char *get_index_val(const IndexMeta &index, const char *rec, const Rid &rid, char *buf) const {
+        if (index.include_cols.empty()) {
+            return reinterpret_cast<const char *>(&rid);
+        }
+        memcpy(buf, &rid, sizeof(Rid));
+        char *val = buf + sizeof(Rid);
+        for (int col : index.include_cols) {
+            memcpy(val, rec + cols[col].offset, cols[col].len);
+            val += cols[col].len;
+        }
+        return buf;
+    }
 
     /**
      * @brief 根据列名在本表元数据结构体中查找是否有该名字的列
@@ -71,19 +239,41 @@ struct TabMeta {
         for (auto &col : tab.cols) {
             os << col << '\n';  // col是ColMeta类型，然后调用重载的ColMeta的操作符<<
         }
+        os << tab.pk_col << '\n';
+        os << tab.part_col << ' ' << tab.num_parts << '\n';
+        os << tab.indexes.size() << '\n';
+        for (auto &index : tab.indexes) {
+            os << index << '\n';
+        }
         return os;
     }
 
-    friend std::istream &operator>>(std::istream &is, TabMeta &tab) {
+    /**
+     * @brief 按第version版的db.meta格式读入表的元数据
+     * @note 第0版中表只有列，pk_col、part_col、num_parts和indexes保持默认值（堆表、不分区、没有组合索引）
+     */
+    std::istream &read(std::istream &is, int version) {
         size_t n;
-        is >> tab.name >> n;
+        is >> name >> n;
         for (size_t i = 0; i < n; i++) {
             ColMeta col;
             is >> col;
-            tab.cols.push_back(col);
+            cols.push_back(col);
+        }
+        if (version < 1) {
+            return is;
+        }
+        is >> pk_col;
+        is >> part_col >> num_parts;
+        is >> n;
+        indexes.resize(n);
+        for (auto &index : indexes) {
+            is >> index;
         }
         return is;
     }
+
+    friend std::istream &operator>>(std::istream &is, TabMeta &tab) { return tab.read(is, DB_META_VERSION); }
 };
 
 // 注意重载了操作符 << 和 >>，这需要更底层同样重载TabMeta、ColMeta的操作符 << 和 >>
@@ -93,6 +283,7 @@ class DbMeta {
    private:
     std::string name_;                     // 数据库名称
     std::map<std::string, TabMeta> tabs_;  // 数据库内的表名称和元数据的映射
+    std::map<std::string, TabStats> stats_;  // ANALYZE得到的表统计信息，没有ANALYZE过的表不在其中
 
    public:
     // DbMeta(std::string name) : name_(name) {}
@@ -107,23 +298,53 @@ class DbMeta {
         return pos->second;
     }
 
+    // 返回表的统计信息，没有ANALYZE过时返回nullptr；统计信息不随DML更新，见TabStats
+    const TabStats *get_stats(const std::string &tab_name) const {
+        auto pos = stats_.find(tab_name);
+        return pos == stats_.end() ? nullptr : &pos->second;
+    }
+
     // 重载操作符 <<
     friend std::ostream &operator<<(std::ostream &os, const DbMeta &db_meta) {
-        os << db_meta.name_ << '\n' << db_meta.tabs_.size() << '\n';
+        os << db_meta.name_ << '\n' << "version " << DB_META_VERSION << '\n' << db_meta.tabs_.size() << '\n';
         for (auto &entry : db_meta.tabs_) {
             os << entry.second << '\n';  // entry.second是TabMeta类型，然后调用重载的TabMeta的操作符<<
         }
+        os << db_meta.stats_.size() << '\n';
+        for (auto &entry : db_meta.stats_) {
+            os << entry.second;
+        }
         return os;
     }
 
     friend std::istream &operator>>(std::istream &is, DbMeta &db_meta) {
         size_t n;
-        is >> db_meta.name_ >> n;
+        is >> db_meta.name_;
+        // 第0版的db.meta在库名之后直接是表的个数，没有版本号
+        int version = 0;
+        if ((is >> std::ws).peek() == 'v') {
+            std::string tag;
+            is >> tag >> version;
+            if (version > DB_META_VERSION) {
+                throw InternalError("Unsupported db.meta version " + std::to_string(version));
+            }
+        }
+        is >> n;
         for (size_t i = 0; i < n; i++) {
             TabMeta tab;
-            is >> tab;
+            tab.read(is, version);
             db_meta.tabs_[tab.name] = tab;
         }
+        // 旧版本的db.meta中没有统计信息
+        if (!(is >> n)) {
+            is.clear();
+            return is;
+        }
+        for (size_t i = 0; i < n; i++) {
+            TabStats stats;
+            is >> stats;
+            db_meta.stats_[stats.name] = stats;
+        }
         return is;
     }
 };
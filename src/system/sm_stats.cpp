@@ -0,0 +1,43 @@
+#include "sm_stats.h"
+
+#include "index/ix_node_handle.h"
+
+double ColStats::eq_selectivity(const char *key) const {
+    if (num_distinct <= 0 || bounds.empty() || compare(key, bounds.front()) < 0 || compare(key, bounds.back()) > 0) {
+        return 0;
+    }
+    return 1.0 / num_distinct;
+}
+
+double ColStats::lt_selectivity(const char *key, bool inclusive) const {
+    if (bounds.empty()) {
+        return 0;
+    }
+    double sel;
+    int num_buckets = bounds.size() - 1;
+    if (compare(key, bounds.front()) <= 0) {
+        sel = 0;
+    } else if (compare(key, bounds.back()) > 0) {
+        sel = 1;
+    } else {
+        // 第一个 >= key 的边界
+        auto it = std::lower_bound(bounds.begin(), bounds.end(), key,
+                                   [&](const std::string &bound, const char *k) { return compare(bound, k) < 0; });
+        int bucket = it - bounds.begin() - 1;
+        double frac = 0.5;
+        if (type != TYPE_STRING) {
+            double lo = to_double(bounds[bucket].data());
+            double hi = to_double(bounds[bucket + 1].data());
+            frac = hi > lo ? (to_double(key) - lo) / (hi - lo) : 1;
+        }
+        sel = (bucket + frac) / std::max(num_buckets, 1);
+    }
+    if (inclusive) {
+        sel += eq_selectivity(key);
+    }
+    return std::min(std::max(sel, 0.0), 1.0);
+}
+
+int ColStats::compare(const char *a, const std::string &b) const { return ix_compare(a, b.data(), type, len); }
+
+int ColStats::compare(const std::string &a, const char *b) const { return ix_compare(a.data(), b, type, len); }
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sm_defs.h"
+
+static constexpr int HLL_PRECISION = 12;  // HyperLogLog使用2^12个寄存器，标准误差约1.04/sqrt(4096)=1.6%
+
+/**
+ * @brief HyperLogLog基数估计，用于ANALYZE估计列上不同值的个数
+ */
+class HyperLogLog {
+   public:
+    HyperLogLog() : registers_(1 << HLL_PRECISION, 0) {}
+
+    static uint64_t hash(const char *data, int len) {
+        uint64_t h = std::hash<std::string_view>{}(std::string_view(data, len));
+        // splitmix64的finalizer，保证高位也足够随机
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    void add(const char *data, int len) {
+        uint64_t h = hash(data, len);
+        size_t idx = h >> (64 - HLL_PRECISION);
+        uint64_t rest = h << HLL_PRECISION;
+        uint8_t rank = rest == 0 ? 64 - HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+        registers_[idx] = std::max(registers_[idx], rank);
+    }
+
+    double estimate() const {
+        double m = registers_.size();
+        double sum = 0;
+        int num_zeros = 0;
+        for (auto reg : registers_) {
+            sum += std::ldexp(1.0, -reg);
+            num_zeros += reg == 0;
+        }
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double est = alpha * m * m / sum;
+        if (est <= 2.5 * m && num_zeros > 0) {
+            // 基数较小时用linear counting修正
+            est = m * std::log(m / num_zeros);
+        }
+        return est;
+    }
+
+   private:
+    std::vector<uint8_t> registers_;
+};
+
+/**
+ * @brief 单列的统计信息：不同值个数的估计和等深直方图
+ * @note 直方图的边界保存列的原始字节，bounds[0]和bounds.back()分别是样本中的最小值和最大值，
+ * 相邻两个边界之间的桶包含大致相同的行数
+ */
+struct ColStats {
+    std::string name;
+    ColType type;
+    int len;
+    int64_t num_distinct = 0;
+    std::vector<std::string> bounds;
+
+    /**
+     * @brief 估计 col = key 的选择率
+     */
+    double eq_selectivity(const char *key) const;
+
+    /**
+     * @brief 估计 col < key（inclusive为true时是 col <= key）的选择率
+     * @note 先定位key所在的桶，数值类型在桶内按线性插值，字符串取桶的一半
+     */
+    double lt_selectivity(const char *key, bool inclusive) const;
+
+    friend std::ostream &operator<<(std::ostream &os, const ColStats &col) {
+        os << col.name << ' ' << col.type << ' ' << col.len << ' ' << col.num_distinct << ' ' << col.bounds.size();
+        for (auto &bound : col.bounds) {
+            os << ' ' << to_hex(bound);
+        }
+        return os;
+    }
+
+    friend std::istream &operator>>(std::istream &is, ColStats &col) {
+        size_t n;
+        is >> col.name >> col.type >> col.len >> col.num_distinct >> n;
+        col.bounds.clear();
+        for (size_t i = 0; i < n; i++) {
+            std::string hex;
+            is >> hex;
+            col.bounds.push_back(from_hex(hex));
+        }
+        return is;
+    }
+
+   private:
+    // 按索引的比较规则比较列值，定义在sm_stats.cpp中，头文件不依赖索引层
+    int compare(const char *a, const std::string &b) const;
+
+    int compare(const std::string &a, const char *b) const;
+
+    double to_double(const char *val) const {
+        return type == TYPE_INT ? (double)*(const int *)val : (double)*(const float *)val;
+    }
+
+    static std::string to_hex(const std::string &raw) {
+        static const char *digits = "0123456789abcdef";
+        std::string hex;
+        for (unsigned char c : raw) {
+            hex.push_back(digits[c >> 4]);
+            hex.push_back(digits[c & 0xf]);
+        }
+        return hex;
+    }
+
+    static std::string from_hex(const std::string &hex) {
+        std::string raw;
+        for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+            raw.push_back((char)std::stoi(hex.substr(i, 2), nullptr, 16));
+        }
+        return raw;
+    }
+};
+
+/**
+ * @brief 表的统计信息，由ANALYZE生成，和DbMeta一起保存在db.meta中
+ * @note 统计信息是ANALYZE时的快照，之后的INSERT/DELETE/UPDATE/COPY FROM不会更新它；
+ * 批量修改表之后需要重新ANALYZE，否则优化器仍按旧的行数和直方图估计代价
+ */
+struct TabStats {
+    std::string name;
+    int64_t num_rows = 0;
+    int num_pages = 0;
+    std::vector<ColStats> cols;  // 与TabMeta::cols一一对应
+
+    const ColStats *get_col(const std::string &col_name) const {
+        for (auto &col : cols) {
+            if (col.name == col_name) {
+                return &col;
+            }
+        }
+        return nullptr;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const TabStats &tab) {
+        os << tab.name << ' ' << tab.num_rows << ' ' << tab.num_pages << ' ' << tab.cols.size() << '\n';
+        for (auto &col : tab.cols) {
+            os << col << '\n';
+        }
+        return os;
+    }
+
+    friend std::istream &operator>>(std::istream &is, TabStats &tab) {
+        size_t n;
+        is >> tab.name >> tab.num_rows >> tab.num_pages >> n;
+        tab.cols.clear();
+        for (size_t i = 0; i < n; i++) {
+            ColStats col;
+            is >> col;
+            tab.cols.push_back(col);
+        }
+        return is;
+    }
+};
@@ -112,6 +112,46 @@ void TransactionManager::Commit(Transaction * txn, LogManager *log_manager) {
     // global_txn_latch_.RUnlock();
 }
 
+bool TransactionManager::HasActiveWrites(const std::string &tab_name, int part, Transaction *txn) {
+    for (auto &entry : txn_map) {
+        Transaction *other = entry.second;
+        if (other == txn || other->GetState() == TransactionState::COMMITTED ||
+            other->GetState() == TransactionState::ABORTED) {
+            continue;
+        }
+        for (auto write : *other->GetWriteSet()) {
+            if (write->GetTableName() == tab_name && write->GetPart() == part) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * 撤销聚簇表上的一个写操作
+ */
+void TransactionManager::rollback_clustered(WriteRecord *write, Context *context) {
+    auto &tab_name = write->GetTableName();
+    auto &rec = write->GetRecord();
+    switch (write->GetWriteType()) {
+        case WType::INSERT_TUPLE:
+            sm_manager_->clustered_delete(tab_name, rec.data, context);
+            break;
+        case WType::DELETE_TUPLE:
+            sm_manager_->clustered_insert(tab_name, rec.data, context);
+            break;
+        case WType::UPDATE_TUPLE: {
+            TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+            auto &pk = tab.cols[tab.pk_col];
+            RmRecord cur_rec(rec.size);
+            sm_manager_->get_clustered_index(tab_name)->GetValue(rec.data + pk.offset, cur_rec.data, context->txn_);
+            sm_manager_->clustered_update(tab_name, cur_rec.data, rec.data, context);
+            break;
+        }
+    }
+}
+
 /**
  * 事务的终止方法
  * @param txn 事务指针
@@ -132,13 +172,24 @@ void TransactionManager::Abort(Transaction * txn, LogManager *log_manager) {
     std::cout << "Aborting... "; // << std::endl;
     auto write_set = txn->GetWriteSet();
     std::cout << write_set->size() << " records " << std::endl;
+    Context abort_context(lock_manager_, log_manager, txn);
+    auto context = &abort_context;
     for(auto r_write_iter = write_set->rbegin();r_write_iter!=write_set->rend();++r_write_iter){//改成倒着读取record内容
         auto write = *r_write_iter;
 //    }
 //    for(auto&write:*write_set) {
-      auto context = new Context(lock_manager_, log_manager, txn);
+      ArenaScope arena_scope(&context->arena_);
       auto tab_name = write->GetTableName();
-      auto &table =  sm_manager_->fhs_.at(tab_name);
+      const TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+      if (tab.is_clustered()) {
+        // 聚簇表的写集合中保存的都是整条记录，UPDATE_TUPLE只记录主键没有改变的修改
+        rollback_clustered(write, context);
+        delete write;
+        continue;
+      }
+      // 分区表的写集合中记录了分区号；撤销的修改也要记录到正在CREATE INDEX CONCURRENTLY的索引中
+      int part = write->GetPart();
+      auto &table =  sm_manager_->fhs_.at(tab.get_part_name(part));
       switch (write->GetWriteType()) {
       case WType::INSERT_TUPLE: {
         auto rec = table->get_record(write->GetRid(),context); // 获取到插入的记录
@@ -151,11 +202,13 @@ void TransactionManager::Abort(Transaction * txn, LogManager *log_manager) {
         }
   */
         table->delete_record(write->GetRid(),context);
+        sm_manager_->capture_index_change(tab, part, write->GetRid(), rec->data, nullptr, context);
         break;
       }
       case WType::DELETE_TUPLE: {
-        auto old_rec = write->GetRecord();
+        auto &old_rec = write->GetRecord();
         auto rid = table->insert_record(old_rec.data,context);
+        sm_manager_->capture_index_change(tab, part, rid, nullptr, old_rec.data, context);
         std::cout << tab_name << ": deleted record is inserted ..." << std::endl;
 
 /*         for(const auto& index:sm_manager_->db_.get_table(tab_name).indexes) {
@@ -167,7 +220,7 @@ void TransactionManager::Abort(Transaction * txn, LogManager *log_manager) {
       }
 
       case WType::UPDATE_TUPLE:
-        auto old_rec = write->GetRecord();
+        auto &old_rec = write->GetRecord();
         auto new_rec = table->get_record(write->GetRid(),context);
         std::cout << tab_name << ": updated record changed backward ..." << std::endl;
 
@@ -178,6 +231,7 @@ void TransactionManager::Abort(Transaction * txn, LogManager *log_manager) {
         }
  */        auto rid = write->GetRid();
         table->update_record(rid, old_rec.data, context);
+        sm_manager_->capture_index_change(tab, part, rid, new_rec->data, old_rec.data, context);
  /*        for(const auto& index:sm_manager_->db_.get_table(tab_name).indexes) {
           auto index_name = sm_manager_->get_ix_manager()->get_index_name(tab_name,index.cols);
           auto &index_handler = sm_manager_->ihs_.at(index_name);
@@ -18,6 +18,9 @@ class TransactionManager{
         sm_manager_ = sm_manager;
         lock_manager_ = lock_manager;
         concurrency_mode_ = concurrency_mode;
+        sm_manager_->set_active_writes_check([this](const std::string &tab_name, int part, Transaction *txn) {
+            return HasActiveWrites(tab_name, part, txn);
+        });
     }
 
     ~TransactionManager() = default;
@@ -34,6 +37,9 @@ class TransactionManager{
 
     LockManager *GetLockManager() { return lock_manager_; }
 
+    // 除txn以外是否有未结束的事务修改过表的第part个分区，VACUUM据此拒绝搬动记录
+    bool HasActiveWrites(const std::string &tab_name, int part, Transaction *txn);
+
     /**
      * 获取对应ID的事务指针
      * @param txn_id 事务ID
@@ -63,6 +69,8 @@ class TransactionManager{
     void ResumeAllTransactions();
 
    private:
+    void rollback_clustered(WriteRecord *write, Context *context);
+
     ConcurrencyMode concurrency_mode_;      // 事务使用的并发控制算法，目前只需要考虑2PL
                                                   //    Transaction * current_txn_;
     std::atomic<txn_id_t> next_txn_id_{0};  // 用于分发事务ID
@@ -33,29 +33,35 @@ enum class WType { INSERT_TUPLE = 0, DELETE_TUPLE, UPDATE_TUPLE};
 /**
  * @brief 事务的写操作记录，用于事务的回滚
  * INSERT
- * --------------------------------
- * | wtype | tab_name | tuple_rid |
- * --------------------------------
+ * ---------------------------------------
+ * | wtype | tab_name | part | tuple_rid |
+ * ---------------------------------------
  * DELETE / UPDATE
- * ----------------------------------------------
- * | wtype | tab_name | tuple_rid | tuple_value |
- * ----------------------------------------------
+ * -----------------------------------------------------
+ * | wtype | tab_name | part | tuple_rid | tuple_value |
+ * -----------------------------------------------------
+ * tab_name是表名，part是记录所在的分区（不分区的表和聚簇表为0），rid是该分区记录文件中的位置
  */
 class WriteRecord {
    public:
     WriteRecord() = default;
 
     // constructor for insert operation
-    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid)
-        : wtype_(wtype), tab_name_(tab_name), rid_(rid) {}
+    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid, int part = 0)
+        : wtype_(wtype), tab_name_(tab_name), part_(part), rid_(rid) {}
 
     // constructor for delete operation
-    WriteRecord(WType wtype, const std::string &tab_name, const RmRecord &record)
-        : wtype_(wtype), tab_name_(tab_name), record_(record) {}
+    // record按值传入：调用者传右值时直接移动，不再拷贝；写集合比语句活得久，所以要保证record_拥有自己的数据
+    WriteRecord(WType wtype, const std::string &tab_name, RmRecord record)
+        : wtype_(wtype), tab_name_(tab_name), record_(std::move(record)) {
+        record_.make_owned();
+    }
 
     // constructor for update operation
-    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid, const RmRecord &record)
-        : wtype_(wtype), tab_name_(tab_name), rid_(rid), record_(record) {}
+    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid, RmRecord record, int part = 0)
+        : wtype_(wtype), tab_name_(tab_name), part_(part), rid_(rid), record_(std::move(record)) {
+        record_.make_owned();
+    }
 
     ~WriteRecord() = default;
 
@@ -67,9 +73,12 @@ class WriteRecord {
 
     inline std::string &GetTableName() { return tab_name_; }
 
+    inline int GetPart() { return part_; }
+
    private:
     WType wtype_;
     std::string tab_name_;
+    int part_ = 0;
 
     // for insert/update/delete operation
     Rid rid_;
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <thread>
+
 #include "execution/execution_manager.h"
 #include "transaction_manager.h"
 #include "gtest/gtest.h"
@@ -122,3 +125,121 @@ TEST_F(TransactionTest, AbortTest) {
     EXPECT_EQ(txn->GetState(), TransactionState::ABORTED);
 }
 
+
+// test CREATE INDEX CONCURRENTLY while another thread keeps modifying the table through SQL statements
+TEST_F(TransactionTest, ConcurrentIndexTest) {
+    exec_sql("create table t1 (a int, b int);");
+    // b identifies a record and is never changed, a is the indexed column
+    constexpr int num_records = 20000;
+    auto file_handle = sm_manager_->fhs_.at("t1").get();
+    char buf[8];
+    for (int k = 0; k < num_records; k++) {
+        memcpy(buf, &k, sizeof(int));
+        memcpy(buf + 4, &k, sizeof(int));
+        file_handle->insert_record(buf, nullptr);
+    }
+
+    // transactions belong to the thread that began them, the writer thread begins its own
+    txn_id = INVALID_TXN_ID;
+    std::atomic<int> num_writes{0};
+    std::atomic<bool> built{false};
+    std::thread writer([&]() {
+        int after = 0;
+        for (int i = 0; after < 100; i++, after += built) {
+            int next = num_records + i;
+            int victim = (i * 7) % num_records;
+            exec_sql("insert into t1 values(" + std::to_string(next) + ", " + std::to_string(next) + ");");
+            if (i % 2 == 0) {
+                exec_sql("delete from t1 where b = " + std::to_string(victim) + ";");
+            } else {
+                exec_sql("update t1 set a = " + std::to_string(victim + 1000000) +
+                         " where b = " + std::to_string(victim) + ";");
+            }
+            num_writes++;
+        }
+    });
+    // the writer is already running when the build starts
+    while (num_writes < 10) {
+        std::this_thread::yield();
+    }
+    char build_result[BUFFER_LENGTH];
+    int build_offset = 0;
+    Context build_context(nullptr, nullptr, nullptr, build_result, &build_offset);
+    sm_manager_->create_index("t1", std::vector<std::string>{"a"}, &build_context, false, {}, false, true, 4);
+    built = true;
+    writer.join();
+
+    // the index holds exactly the records of the table
+    auto ih = sm_manager_->ihs_.at(ix_manager_->get_index_name("t1", std::vector<int>{0})).get();
+    size_t num_rows = 0;
+    for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+        auto rec = file_handle->get_record(scan.rid(), nullptr);
+        std::vector<Rid> found;
+        EXPECT_TRUE(ih->GetValue(rec->data, &found, nullptr));
+        EXPECT_TRUE(!found.empty() && found[0] == scan.rid());
+        num_rows++;
+    }
+    size_t num_entries = 0;
+    for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end(); scan.next()) {
+        num_entries++;
+    }
+    EXPECT_EQ(num_entries, num_rows);
+}
+
+// VACUUM must not move records whose rids are in the write set of an unfinished transaction
+TEST_F(TransactionTest, VacuumActiveWritesTest) {
+    exec_sql("create table t1 (num int);");
+    auto file_handle = sm_manager_->fhs_.at("t1").get();
+    int per_page = file_handle->get_file_hdr().num_records_per_page;
+    char buf[4];
+    for (int num = 0; num < per_page * 4; num++) {
+        memcpy(buf, &num, sizeof(int));
+        file_handle->insert_record(buf, nullptr);
+    }
+    // leave only the records of the last page, they are moved by VACUUM
+    exec_sql("delete from t1 where num < " + std::to_string(per_page * 3) + ";");
+    exec_sql("begin;");
+    exec_sql("delete from t1 where num = " + std::to_string(per_page * 3) + ";");
+
+    char vacuum_result[BUFFER_LENGTH];
+    int vacuum_offset = 0;
+    Context vacuum_context(lock_manager_.get(), log_manager_.get(), nullptr, vacuum_result, &vacuum_offset);
+    EXPECT_THROW(sm_manager_->vacuum_table("t1", &vacuum_context), TableInUseError);
+    // the background vacuum skips the table
+    sm_manager_->auto_vacuum(1.0, &vacuum_context);
+    EXPECT_EQ(file_handle->get_file_hdr().num_pages, RM_FIRST_RECORD_PAGE + 4);
+
+    // the abort puts the deleted record back, then VACUUM can run
+    exec_sql("abort;");
+    sm_manager_->vacuum_table("t1", &vacuum_context);
+    EXPECT_EQ(file_handle->get_file_hdr().num_pages, RM_FIRST_RECORD_PAGE + 1);
+    exec_sql("select * from t1 where num = " + std::to_string(per_page * 3) + ";");
+    EXPECT_NE(strstr(result, "Total record(s): 1"), nullptr);
+}
+
+// abort on a partitioned table: the write records carry the partition of each rid
+TEST_F(TransactionTest, PartitionAbortTest) {
+    // hash partitioned on id into 4 partitions
+    std::vector<ColDef> col_defs = {{.name = "id", .type = TYPE_INT, .len = 4, .num_parts = 4},
+                                    {.name = "num", .type = TYPE_INT, .len = 4}};
+    char create_result[BUFFER_LENGTH];
+    int create_offset = 0;
+    Context create_context(nullptr, nullptr, nullptr, create_result, &create_offset);
+    sm_manager_->create_table("t1", col_defs, &create_context);
+    for (int id = 0; id < 8; id++) {
+        exec_sql("insert into t1 values(" + std::to_string(id) + ", " + std::to_string(id) + ");");
+    }
+    exec_sql("begin;");
+    exec_sql("insert into t1 values(8, 8);");
+    exec_sql("update t1 set num = 100 where id = 1;");
+    // changing the partition key moves the record to another partition
+    exec_sql("update t1 set id = 102 where id = 2;");
+    exec_sql("delete from t1 where id = 3;");
+    exec_sql("abort;");
+    exec_sql("select * from t1 where num = id;");
+    EXPECT_NE(strstr(result, "Total record(s): 8"), nullptr);
+    exec_sql("select * from t1 where id = 102;");
+    EXPECT_NE(strstr(result, "Total record(s): 0"), nullptr);
+    exec_sql("select * from t1 where id = 8;");
+    EXPECT_NE(strstr(result, "Total record(s): 0"), nullptr);
+}